@@ -2,12 +2,15 @@ package com.hungknow.pdfview
 
 import android.app.Application
 import android.os.Environment
+import com.hungknow.pdfsdk.PdfiumSDK
 import java.io.File
 import java.io.IOException
 
 class SamplesApplication: Application() {
     override fun onCreate() {
         super.onCreate()
+        // Library init and font enumeration off the first page's critical path
+        PdfiumSDK(72).warmUp()
         createSampleFile("Sample.pdf")
     }
 
@@ -0,0 +1,93 @@
+package com.hungknow.pdfsdk
+
+import android.graphics.Bitmap
+import android.os.ParcelFileDescriptor
+import androidx.benchmark.junit4.BenchmarkRule
+import androidx.benchmark.junit4.measureRepeated
+import androidx.test.ext.junit.runners.AndroidJUnit4
+import org.junit.After
+import org.junit.Before
+import org.junit.Rule
+import org.junit.Test
+import org.junit.runner.RunWith
+
+/**
+ * Per-call cost of the JNI entry points on the hot paths. The page size and
+ * page count calls do almost no work natively, so they mostly measure the
+ * JNI transition itself; the *Regular variants bypass [PdfiumFastNatives].
+ */
+@RunWith(AndroidJUnit4::class)
+class PdfiumSDKBenchmark {
+
+    @get:Rule
+    val benchmarkRule = BenchmarkRule()
+
+    private val sdk = PdfiumSDK(72)
+    private lateinit var doc: PdfDocument
+
+    @Before
+    fun setUp() {
+        val f = FileUtils.getFileFromPath(this, "sample.pdf")
+        val pfd = ParcelFileDescriptor.open(f, ParcelFileDescriptor.MODE_READ_ONLY)
+        doc = sdk.newDocument(pfd, "")
+        sdk.openPage(doc, 0)
+    }
+
+    @After
+    fun tearDown() {
+        sdk.closeDocument(doc)
+    }
+
+    @Test
+    fun pageCount() {
+        benchmarkRule.measureRepeated {
+            sdk.getPageCount(doc)
+        }
+    }
+
+    @Test
+    fun pageCountRegular() {
+        benchmarkRule.measureRepeated {
+            sdk.getPageCountRegular(doc)
+        }
+    }
+
+    @Test
+    fun pageSizeByIndex() {
+        benchmarkRule.measureRepeated {
+            sdk.getPageSizeByIndex(doc, 0)
+        }
+    }
+
+    @Test
+    fun pageSizeByIndexRegular() {
+        benchmarkRule.measureRepeated {
+            sdk.getPageSizeByIndexRegular(doc, 0)
+        }
+    }
+
+    @Test
+    fun charCount() {
+        sdk.buildPageIndex(doc, 0)
+        benchmarkRule.measureRepeated {
+            sdk.getCharCount(doc, 0)
+        }
+    }
+
+    @Test
+    fun charAtPos() {
+        sdk.buildPageIndex(doc, 0)
+        benchmarkRule.measureRepeated {
+            sdk.getCharIndexAtPos(doc, 0, 100f, 700f, 2f, 2f)
+        }
+    }
+
+    @Test
+    fun renderSmallTile() {
+        val bitmap = Bitmap.createBitmap(16, 16, Bitmap.Config.RGB_565)
+        benchmarkRule.measureRepeated {
+            sdk.renderPageBitmap(doc, bitmap, 0, 0, 0, 16, 16)
+        }
+        bitmap.recycle()
+    }
+}
@@ -1,7 +1,20 @@
 package com.hungknow.pdfsdk
 
+import android.graphics.Bitmap
+import android.graphics.Color
+import android.graphics.Rect
+import android.graphics.RectF
 import android.os.ParcelFileDescriptor
+import android.view.KeyEvent
 import androidx.test.ext.junit.runners.AndroidJUnit4
+import androidx.test.platform.app.InstrumentationRegistry
+import com.hungknow.pdfsdk.listeners.OnAssemblyListener
+import com.hungknow.pdfsdk.listeners.OnFlattenListener
+import com.hungknow.pdfsdk.listeners.OnPrintListener
+import com.hungknow.pdfsdk.listeners.OnSaveListener
+import com.hungknow.pdfsdk.listeners.OnThumbnailListener
+import com.hungknow.pdfsdk.models.PageAssemblyJob
+import com.hungknow.pdfsdk.utils.ColorScheme
 import org.junit.Assert
 import org.junit.Test
 import org.junit.runner.RunWith
@@ -18,4 +31,561 @@ class PdfiumSDKTest {
         var documentFd = PdfiumSDK(72).nativeOpenDocument(pfd.fd, "password")
         Assert.assertNotEquals(-1, documentFd)
     }
-}
\ No newline at end of file
+
+    @Test
+    fun PageIndexHitTestMatchesCharBoxes() {
+        val f = FileUtils.getFileFromPath(this, "sample.pdf")
+        val pfd = ParcelFileDescriptor.open(f, ParcelFileDescriptor.MODE_READ_ONLY)
+
+        val sdk = PdfiumSDK(72)
+        val doc = sdk.newDocument(pfd, "")
+        sdk.openPage(doc, 0)
+        Assert.assertNotEquals(0L, sdk.buildPageIndex(doc, 0))
+
+        val rects = sdk.getCharRangeRects(doc, 0, 0, 1)
+        Assert.assertEquals(4, rects.size)
+        val x = (rects[0] + rects[2]) / 2
+        val y = (rects[1] + rects[3]) / 2
+        Assert.assertEquals(0, sdk.getCharIndexAtPos(doc, 0, x, y, 0f, 0f))
+        sdk.closeDocument(doc)
+    }
+
+    @Test
+    fun PrefetchLinksCoversEveryPage() {
+        val f = FileUtils.getFileFromPath(this, "sample.pdf")
+        val pfd = ParcelFileDescriptor.open(f, ParcelFileDescriptor.MODE_READ_ONLY)
+
+        val sdk = PdfiumSDK(72)
+        val doc = sdk.newDocument(pfd, "")
+        sdk.prefetchLinks(doc)
+        Assert.assertEquals(sdk.getPageCount(doc), doc.pageLinks.size)
+
+        val prefetched = doc.pageLinks[0]
+        doc.pageLinks.clear()
+        sdk.openPage(doc, 0)
+        Assert.assertEquals(prefetched, sdk.getPageLinks(doc, 0))
+        sdk.closeDocument(doc)
+    }
+
+    @Test
+    fun PageLinksAreCachedPerPage() {
+        val f = FileUtils.getFileFromPath(this, "sample.pdf")
+        val pfd = ParcelFileDescriptor.open(f, ParcelFileDescriptor.MODE_READ_ONLY)
+
+        val sdk = PdfiumSDK(72)
+        val doc = sdk.newDocument(pfd, "")
+        sdk.openPage(doc, 0)
+        val links = sdk.getPageLinks(doc, 0)
+        Assert.assertSame(links, doc.pageLinks[0])
+        Assert.assertSame(links, sdk.getPageLinks(doc, 0))
+        Assert.assertNull(doc.pageLinks[1])
+        sdk.closeDocument(doc)
+    }
+
+    @Test
+    fun BookmarksPageThroughChildren() {
+        val f = FileUtils.getFileFromPath(this, "sample.pdf")
+        val pfd = ParcelFileDescriptor.open(f, ParcelFileDescriptor.MODE_READ_ONLY)
+
+        val sdk = PdfiumSDK(72)
+        val doc = sdk.newDocument(pfd, "")
+        val all = sdk.getBookmarks(doc)
+        Assert.assertEquals(all.totalCount, all.bookmarks.size)
+
+        val firstOnly = sdk.getBookmarks(doc, PdfDocument.OUTLINE_ROOT, 0, 1)
+        Assert.assertEquals(all.bookmarks.take(1), firstOnly.bookmarks)
+        all.bookmarks.firstOrNull()?.let {
+            Assert.assertEquals(it.id, sdk.findBookmark(doc, it.title).first())
+        }
+        sdk.closeDocument(doc)
+    }
+
+    @Test
+    fun DocumentInfoMatchesSingleQueries() {
+        val f = FileUtils.getFileFromPath(this, "sample.pdf")
+        val pfd = ParcelFileDescriptor.open(f, ParcelFileDescriptor.MODE_READ_ONLY)
+
+        val sdk = PdfiumSDK(72)
+        val doc = sdk.newDocument(pfd, "")
+        val info = sdk.getDocumentInfo(doc)
+        Assert.assertEquals(sdk.getPageCount(doc), info.pageCount)
+        Assert.assertEquals(sdk.getDocumentMetaText(doc, "Title"), info.meta.title)
+        Assert.assertEquals(sdk.getDocumentMetaText(doc, "Producer"), info.meta.producer)
+
+        val labels = sdk.getPageLabels(doc)
+        Assert.assertEquals(info.hasPageLabels, !labels.isEmpty)
+        Assert.assertSame(labels, sdk.getPageLabels(doc))
+        sdk.closeDocument(doc)
+    }
+
+    @Test
+    fun AllPageSizesAreMemoized() {
+        val f = FileUtils.getFileFromPath(this, "sample.pdf")
+        val pfd = ParcelFileDescriptor.open(f, ParcelFileDescriptor.MODE_READ_ONLY)
+
+        val sdk = PdfiumSDK(72)
+        val doc = sdk.newDocument(pfd, "")
+        val sizes = sdk.getAllPageSizes(doc)
+        Assert.assertEquals(sdk.getPageCount(doc) * 2, sizes.size)
+        Assert.assertSame(sizes, sdk.getAllPageSizes(doc))
+
+        val flags = PdfiumSDK.PAGE_SIZE_ROTATION or PdfiumSDK.PAGE_SIZE_BOXES
+        val full = sdk.getAllPageSizes(doc, flags)
+        val stride = sdk.getPageSizeStride(flags)
+        Assert.assertEquals(sdk.getPageCount(doc) * stride, full.size)
+        Assert.assertEquals(sizes[0], full[0], 0f)
+        Assert.assertEquals(sizes[1], full[1], 0f)
+        sdk.closeDocument(doc)
+    }
+
+    @Test
+    fun FastNativesMatchRegularBindings() {
+        val f = FileUtils.getFileFromPath(this, "sample.pdf")
+        val pfd = ParcelFileDescriptor.open(f, ParcelFileDescriptor.MODE_READ_ONLY)
+
+        val sdk = PdfiumSDK(72)
+        val doc = sdk.newDocument(pfd, "")
+        Assert.assertEquals(sdk.getPageCountRegular(doc), sdk.getPageCount(doc))
+        Assert.assertEquals(sdk.getPageSizeByIndexRegular(doc, 0), sdk.getPageSizeByIndex(doc, 0))
+        sdk.closeDocument(doc)
+    }
+
+    @Test
+    fun DocumentsReopenWhileLibraryIsPinned() {
+        val f = FileUtils.getFileFromPath(this, "sample.pdf")
+        val sdk = PdfiumSDK(72)
+        sdk.initLibrary()
+        sdk.initLibrary()
+
+        for (i in 0 until 2) {
+            val pfd = ParcelFileDescriptor.open(f, ParcelFileDescriptor.MODE_READ_ONLY)
+            val doc = sdk.newDocument(pfd, "")
+            Assert.assertTrue(sdk.getPageCount(doc) > 0)
+            sdk.closeDocument(doc)
+        }
+        sdk.releaseLibrary()
+    }
+
+    @Test
+    fun FontIndexIsCachedAcrossCalls() {
+        val context = InstrumentationRegistry.getInstrumentation().targetContext
+        val cache = File(context.cacheDir, "font_index_test.idx")
+        cache.delete()
+
+        val sdk = PdfiumSDK(72)
+        val scanned = sdk.setFontIndex(cache)
+        Assert.assertTrue(scanned > 0)
+        Assert.assertTrue(cache.exists())
+        Assert.assertEquals(scanned, sdk.setFontIndex(cache))
+    }
+
+    @Test
+    fun StatsRecordRenderStages() {
+        val f = FileUtils.getFileFromPath(this, "sample.pdf")
+        val pfd = ParcelFileDescriptor.open(f, ParcelFileDescriptor.MODE_READ_ONLY)
+
+        val sdk = PdfiumSDK(72)
+        sdk.setStatsMode(PdfiumSDK.STATS_COLLECT)
+        val before = sdk.getStats()
+        val doc = sdk.newDocument(pfd, "")
+        sdk.openPage(doc, 0)
+        val bitmap = Bitmap.createBitmap(64, 64, Bitmap.Config.RGB_565)
+        sdk.renderPageBitmap(doc, bitmap, 0, 0, 0, 64, 64)
+        val stats = sdk.getStats() - before
+        sdk.setStatsMode(0)
+        sdk.closeDocument(doc)
+
+        Assert.assertEquals(1L, stats.stage("documentOpen")?.count)
+        Assert.assertEquals(1L, stats.stage("rasterize")?.count)
+        Assert.assertEquals(1L, stats.stage("convert565")?.count)
+        Assert.assertTrue(stats.bytesRead > 0)
+        Assert.assertEquals(64L * 64, stats.pixelsRendered)
+    }
+
+    @Test
+    fun ThumbnailsRenderedForEveryDocument() {
+        val f = FileUtils.getFileFromPath(this, "sample.pdf")
+        val pfds = (0 until 6).map { ParcelFileDescriptor.open(f, ParcelFileDescriptor.MODE_READ_ONLY) }
+        val fds = pfds.map { it.fd }.toIntArray() + intArrayOf(-1)
+
+        val bitmaps = java.util.concurrent.ConcurrentHashMap<Int, Bitmap>()
+        val errors = java.util.concurrent.ConcurrentHashMap<Int, String>()
+        PdfiumSDK(72).renderThumbnails(fds, 96, 128, object : OnThumbnailListener {
+            override fun onThumbnail(index: Int, bitmap: Bitmap?, error: String?) {
+                if (bitmap != null) bitmaps[index] = bitmap else errors[index] = error ?: ""
+            }
+        })
+        pfds.forEach { it.close() }
+
+        Assert.assertEquals(6, bitmaps.size)
+        Assert.assertEquals(setOf(6), errors.keys)
+        for (bitmap in bitmaps.values) {
+            Assert.assertTrue(bitmap.width <= 96 && bitmap.height <= 128)
+            Assert.assertTrue(bitmap.width == 96 || bitmap.height == 128)
+        }
+    }
+
+    @Test
+    fun ColorSchemesPaintPageBackground() {
+        val f = FileUtils.getFileFromPath(this, "sample.pdf")
+        val pfd = ParcelFileDescriptor.open(f, ParcelFileDescriptor.MODE_READ_ONLY)
+
+        val sdk = PdfiumSDK(72)
+        val doc = sdk.newDocument(pfd, "")
+        sdk.openPage(doc, 0)
+        val size = sdk.getPageSize(doc, 0)
+        val width = 256
+        val height = width * size.height / size.width
+        // The top left corner is page margin, so it shows the background;
+        // the content is whatever differs from it
+        val corner = mutableMapOf<ColorScheme, Int>()
+        val contentPixels = mutableMapOf<ColorScheme, Int>()
+        for (scheme in ColorScheme.values()) {
+            val bitmap = Bitmap.createBitmap(width, height, Bitmap.Config.ARGB_8888)
+            sdk.renderPageBitmap(doc, bitmap, 0, 0, 0, width, height, false, scheme)
+            val pixels = IntArray(width * height)
+            bitmap.getPixels(pixels, 0, width, 0, 0, width, height)
+            corner[scheme] = pixels[0]
+            contentPixels[scheme] = pixels.count { it != pixels[0] }
+        }
+        sdk.closeDocument(doc)
+
+        for (scheme in ColorScheme.values()) {
+            Assert.assertTrue("$scheme draws no content", contentPixels.getValue(scheme) > 0)
+            if (scheme == ColorScheme.NONE) continue
+            val pixel = corner.getValue(scheme)
+            Assert.assertEquals(0xFF, Color.alpha(pixel))
+            Assert.assertEquals(scheme.isDark, Color.red(pixel) < 0x80)
+        }
+        Assert.assertTrue(Color.blue(corner.getValue(ColorScheme.SEPIA)) < Color.red(corner.getValue(ColorScheme.SEPIA)))
+    }
+
+    @Test
+    fun FormTypingInvalidatesOnlyTheField() {
+        val f = FileUtils.getFileFromPath(this, "form.pdf")
+        val pfd = ParcelFileDescriptor.open(f, ParcelFileDescriptor.MODE_READ_ONLY)
+
+        val sdk = PdfiumSDK(72)
+        val doc = sdk.newDocument(pfd, "")
+        Assert.assertTrue(sdk.initFormFill(doc))
+        sdk.openPage(doc, 0)
+
+        // The text field spans 100..400 x 600..630 of a 612 x 792 page
+        Assert.assertTrue(sdk.formTap(doc, 0, 250f, 615f))
+        sdk.takeFormDirtyRects(doc)
+        Assert.assertTrue(sdk.formTypeText(doc, 0, "abc"))
+        Assert.assertTrue(sdk.formPressKey(doc, 0, KeyEvent.KEYCODE_DEL))
+        val dirty = sdk.takeFormDirtyRects(doc)
+        sdk.closeDocument(doc)
+
+        Assert.assertFalse(dirty.isEmpty())
+        val field = RectF(100f / 612, 162f / 792, 400f / 612, 192f / 792)
+        field.inset(-0.01f, -0.01f)
+        for (rect in dirty) {
+            Assert.assertEquals(0, rect.pageIdx)
+            Assert.assertTrue("${rect.bounds} outside $field", field.contains(rect.bounds))
+        }
+    }
+
+    @Test
+    fun AnnotationRenderedAloneOnTransparentPixels() {
+        val f = FileUtils.getFileFromPath(this, "annotations.pdf")
+        val pfd = ParcelFileDescriptor.open(f, ParcelFileDescriptor.MODE_READ_ONLY)
+
+        val sdk = PdfiumSDK(72)
+        val doc = sdk.newDocument(pfd, "")
+        sdk.openPage(doc, 0)
+        val annotations = sdk.getLayerAnnotations(doc, 0)
+        Assert.assertEquals(1, annotations.size)
+
+        // A 200pt red square outline at 100, 100 from the top left of a 612 x 792 page
+        val bounds = annotations[0].bounds
+        Assert.assertEquals(100f / 612, bounds.left, 0.001f)
+        Assert.assertEquals(100f / 792, bounds.top, 0.001f)
+        val bitmap = Bitmap.createBitmap(200, 200, Bitmap.Config.ARGB_8888)
+        Assert.assertTrue(sdk.renderAnnotation(doc, bitmap, 0, annotations[0].index, -100, -100, 612, 792))
+        sdk.closeDocument(doc)
+
+        Assert.assertEquals(0, Color.alpha(bitmap.getPixel(100, 100)))
+        val border = bitmap.getPixel(2, 100)
+        Assert.assertEquals(0xFF, Color.alpha(border))
+        Assert.assertTrue(Color.red(border) > 0xC0 && Color.green(border) < 0x40)
+    }
+
+    @Test
+    fun AnnotationsSurviveExportAndImport() {
+        val f = FileUtils.getFileFromPath(this, "annotations.pdf")
+        val pfd = ParcelFileDescriptor.open(f, ParcelFileDescriptor.MODE_READ_ONLY)
+
+        val sdk = PdfiumSDK(72)
+        val doc = sdk.newDocument(pfd, "")
+        val blob = sdk.exportAnnotations(doc)
+        Assert.assertEquals(-1, sdk.importAnnotations(doc, blob.copyOf(blob.size - 1)))
+
+        // Replacing puts back the same square, appending doubles it
+        Assert.assertEquals(1, sdk.importAnnotations(doc, blob, replace = true))
+        Assert.assertArrayEquals(blob, sdk.exportAnnotations(doc))
+        Assert.assertEquals(1, sdk.importAnnotations(doc, blob))
+        sdk.openPage(doc, 0)
+        val annotations = sdk.getLayerAnnotations(doc, 0)
+        sdk.closeDocument(doc)
+
+        Assert.assertEquals(2, annotations.size)
+        Assert.assertEquals(annotations[0].bounds, annotations[1].bounds)
+        Assert.assertEquals(100f / 612, annotations[1].bounds.left, 0.001f)
+    }
+
+    @Test
+    fun InkStrokeDrawnThenCommittedAsAnnotation() {
+        val f = FileUtils.getFileFromPath(this, "annotations.pdf")
+        val pfd = ParcelFileDescriptor.open(f, ParcelFileDescriptor.MODE_READ_ONLY)
+
+        val sdk = PdfiumSDK(72)
+        val doc = sdk.newDocument(pfd, "")
+        sdk.openPage(doc, 0)
+
+        // A horizontal stroke across an overlay of the page at 1px per point
+        val overlay = Bitmap.createBitmap(612, 792, Bitmap.Config.ARGB_8888)
+        val stroke = sdk.newInkStroke(Color.BLUE, 6f)
+        val dirty = Rect()
+        Assert.assertTrue(sdk.addInkPoints(stroke, floatArrayOf(350f, 100f, 400f, 100f, 450f, 100f), 3, overlay, dirty))
+        sdk.finishInkStroke(stroke, overlay, dirty)
+        Assert.assertEquals(Color.BLUE, overlay.getPixel(420, 100))
+        Assert.assertEquals(0, Color.alpha(overlay.getPixel(420, 110)))
+        Assert.assertTrue(dirty.left < 450 && dirty.right > 450)
+
+        val index = sdk.commitInkStroke(doc, stroke, 0, 0, 0, 612, 792)
+        sdk.closeInkStroke(stroke)
+        Assert.assertEquals(1, index)
+        val ink = sdk.getLayerAnnotations(doc, 0).first { it.index == index }
+        Assert.assertEquals(15, ink.subtype)
+        Assert.assertEquals(350f / 612, ink.bounds.left, 0.01f)
+
+        // The appearance keeps the stroke width
+        val bitmap = Bitmap.createBitmap(612, 792, Bitmap.Config.ARGB_8888)
+        Assert.assertTrue(sdk.renderAnnotation(doc, bitmap, 0, index, 0, 0, 612, 792))
+        sdk.closeDocument(doc)
+        Assert.assertEquals(0xFF, Color.alpha(bitmap.getPixel(420, 102)))
+        Assert.assertEquals(0, Color.alpha(bitmap.getPixel(420, 110)))
+    }
+
+    @Test
+    fun IncrementalSaveAppendsOnlyTheChange() {
+        val f = FileUtils.getFileFromPath(this, "annotations.pdf")
+        val originalSize = f.length()
+        val pfd = ParcelFileDescriptor.open(f, ParcelFileDescriptor.MODE_READ_WRITE)
+
+        val sdk = PdfiumSDK(72)
+        val doc = sdk.newDocument(pfd, "")
+        val blob = sdk.exportAnnotations(doc)
+        Assert.assertEquals(1, sdk.importAnnotations(doc, blob))
+        val written = sdk.saveDocument(doc, pfd)
+        sdk.closeDocument(doc)
+
+        // The original bytes stay, the new objects follow them
+        Assert.assertTrue(written in 1 until originalSize)
+        Assert.assertEquals(originalSize + written, f.length())
+        val reopened = sdk.newDocument(ParcelFileDescriptor.open(f, ParcelFileDescriptor.MODE_READ_ONLY), "")
+        sdk.openPage(reopened, 0)
+        Assert.assertEquals(2, sdk.getLayerAnnotations(reopened, 0).size)
+        sdk.closeDocument(reopened)
+    }
+
+    @Test
+    fun SaveToFileRendersWhileWriting() {
+        val f = FileUtils.getFileFromPath(this, "annotations.pdf")
+        val pfd = ParcelFileDescriptor.open(f, ParcelFileDescriptor.MODE_READ_ONLY)
+        val sdk = PdfiumSDK(72)
+        val doc = sdk.newDocument(pfd, "")
+        sdk.openPage(doc, 0)
+        Assert.assertEquals(1, sdk.importAnnotations(doc, sdk.exportAnnotations(doc)))
+        Assert.assertEquals(1L, doc.changeCount)
+
+        // The write runs without the lock: another thread renders meanwhile
+        var renderedDuringSave = false
+        var lastWritten = 0L
+        val listener = object : OnSaveListener {
+            override fun onSaveProgress(written: Long, total: Long): Boolean {
+                Assert.assertTrue(written in (lastWritten + 1)..total)
+                lastWritten = written
+                val render = Thread {
+                    val bitmap = Bitmap.createBitmap(64, 64, Bitmap.Config.ARGB_8888)
+                    sdk.renderPageBitmap(doc, bitmap, 0, 0, 0, 64, 64)
+                    renderedDuringSave = true
+                }
+                render.start()
+                render.join(5000)
+                return true
+            }
+        }
+        Assert.assertTrue(sdk.saveToFile(doc, f, listener = listener))
+        Assert.assertTrue(renderedDuringSave)
+        Assert.assertEquals(f.length(), lastWritten)
+        Assert.assertFalse(File(f.path + ".saving").exists())
+
+        // The viewed document survives the rename over its file
+        Assert.assertEquals(2, sdk.getLayerAnnotations(doc, 0).size)
+        sdk.closeDocument(doc)
+        val reopened = sdk.newDocument(ParcelFileDescriptor.open(f, ParcelFileDescriptor.MODE_READ_ONLY), "")
+        sdk.openPage(reopened, 0)
+        Assert.assertEquals(2, sdk.getLayerAnnotations(reopened, 0).size)
+        sdk.closeDocument(reopened)
+    }
+
+    @Test
+    fun AutoSaverOnlySavesEdits() {
+        val f = FileUtils.getFileFromPath(this, "annotations.pdf")
+        val target = File(f.parentFile, "autosaved.pdf")
+        target.delete()
+        val sdk = PdfiumSDK(72)
+        val doc = sdk.newDocument(ParcelFileDescriptor.open(f, ParcelFileDescriptor.MODE_READ_ONLY), "")
+        val saver = AutoSaver(sdk, doc, target)
+
+        Assert.assertTrue(saver.saveNow().get())
+        Assert.assertFalse(target.exists())
+        sdk.importAnnotations(doc, sdk.exportAnnotations(doc))
+        Assert.assertTrue(saver.saveNow().get())
+        Assert.assertTrue(target.length() > f.length())
+        saver.stop()
+        sdk.closeDocument(doc)
+    }
+
+    @Test
+    fun PageAssemblyMergesSplitsAndLaysOut() {
+        val sdk = PdfiumSDK(72)
+        val sample = FileUtils.getFileFromPath(this, "sample.pdf")
+        val annotations = FileUtils.getFileFromPath(this, "annotations.pdf")
+        fun open(f: File, mode: Int = ParcelFileDescriptor.MODE_READ_ONLY) = ParcelFileDescriptor.open(f, mode)
+        fun pageCount(f: File): Int {
+            val doc = sdk.newDocument(open(f), "")
+            return sdk.getPageCount(doc).also { sdk.closeDocument(doc) }
+        }
+        val samplePages = pageCount(sample)
+        val annotationPages = pageCount(annotations)
+        val rw = ParcelFileDescriptor.MODE_READ_WRITE or ParcelFileDescriptor.MODE_CREATE
+
+        // Merge, with a source that isn't a PDF left out
+        val merged = File(sample.parentFile, "merged.pdf")
+        val broken = File(sample.parentFile, "broken.pdf").apply { writeText("not a pdf") }
+        val assembled = mutableListOf<Int>()
+        val job = PageAssemblyJob(open(merged, rw)).add(open(sample)).add(open(broken)).add(open(annotations))
+        job.skipBrokenSources = true
+        val result = sdk.assemblePages(job, object : OnAssemblyListener {
+            override fun onSourceAssembled(index: Int, pages: Int): Boolean {
+                assembled.add(pages)
+                return true
+            }
+        })!!
+        Assert.assertEquals(samplePages + annotationPages, result.pages)
+        Assert.assertArrayEquals(intArrayOf(1), result.skippedSources)
+        Assert.assertEquals(listOf(samplePages, samplePages, samplePages + annotationPages), assembled)
+        Assert.assertEquals(merged.length(), result.bytesWritten)
+        Assert.assertEquals(result.pages, pageCount(merged))
+
+        // Split out the last page, then 2-up everything
+        val split = File(sample.parentFile, "split.pdf")
+        val last = samplePages + annotationPages
+        Assert.assertEquals(1, sdk.assemblePages(PageAssemblyJob(open(split, rw)).add(open(merged), "$last"))!!.pages)
+        val nUp = File(sample.parentFile, "2up.pdf")
+        val sheets = PageAssemblyJob(open(nUp, rw)).add(open(merged))
+        sheets.columns = 2
+        Assert.assertEquals((last + 1) / 2, sdk.assemblePages(sheets)!!.pages)
+
+        // Cancelled jobs write nothing
+        val cancelled = File(sample.parentFile, "cancelled.pdf").apply { delete() }
+        Assert.assertNull(sdk.assemblePages(PageAssemblyJob(open(cancelled, rw)).add(open(sample)),
+            object : OnAssemblyListener {
+                override fun onSourceAssembled(index: Int, pages: Int) = false
+            }))
+        Assert.assertEquals(0L, cancelled.length())
+    }
+
+    @Test
+    fun PrintPagesWritesARasterPdf() {
+        val sdk = PdfiumSDK(72)
+        val doc = sdk.newDocument(ParcelFileDescriptor.open(FileUtils.getFileFromPath(this, "sample.pdf"),
+            ParcelFileDescriptor.MODE_READ_ONLY), "")
+        val size = sdk.getPageSize(doc, 0)
+        val out = File(InstrumentationRegistry.getInstrumentation().targetContext.cacheDir, "print.pdf")
+        val rendered = mutableListOf<Int>()
+        val result = sdk.printPages(doc, intArrayOf(0, 0), ParcelFileDescriptor.open(out,
+            ParcelFileDescriptor.MODE_READ_WRITE or ParcelFileDescriptor.MODE_CREATE), 150,
+            listener = object : OnPrintListener {
+                override fun onPageRendered(index: Int, pageIndex: Int): Boolean {
+                    rendered.add(index)
+                    return true
+                }
+            })!!
+        sdk.closeDocument(doc)
+
+        Assert.assertEquals(listOf(0, 1), rendered)
+        Assert.assertEquals(2, result.pages)
+        Assert.assertEquals(out.length(), result.bytesWritten)
+        Assert.assertTrue(result.pagesPerMinute > 0)
+        // A 150 DPI page is a few MB, the bands stay under the default budget
+        Assert.assertTrue(result.bandMemory <= 3L * (4 shl 20))
+
+        // Same page size, drawn as images
+        val printed = sdk.newDocument(ParcelFileDescriptor.open(out, ParcelFileDescriptor.MODE_READ_ONLY), "")
+        Assert.assertEquals(2, sdk.getPageCount(printed))
+        val printedSize = sdk.getPageSize(printed, 1)
+        Assert.assertEquals(size.width, printedSize.width)
+        Assert.assertEquals(size.height, printedSize.height)
+        sdk.closeDocument(printed)
+    }
+
+    @Test
+    fun FlattenDocumentBakesInAnnotations() {
+        val sdk = PdfiumSDK(72)
+        val file = FileUtils.getFileFromPath(this, "annotations.pdf")
+        val length = file.length()
+        fun open() = sdk.newDocument(ParcelFileDescriptor.open(file, ParcelFileDescriptor.MODE_READ_WRITE), "")
+        fun layerAnnotations(doc: PdfDocument): Int {
+            return (0 until sdk.getPageCount(doc)).map {
+                sdk.openPage(doc, it)
+                sdk.getLayerAnnotations(doc, it).size
+            }.sum()
+        }
+
+        // Cancelled on the first page, the file isn't touched
+        var doc = open()
+        Assert.assertNull(sdk.flattenDocument(doc, doc.FileDescriptor!!, listener = object : OnFlattenListener {
+            override fun onPageFlattened(pageIndex: Int, flattened: Boolean) = false
+        }))
+        sdk.closeDocument(doc)
+        Assert.assertEquals(length, file.length())
+
+        doc = open()
+        val pageCount = sdk.getPageCount(doc)
+        Assert.assertTrue(layerAnnotations(doc) > 0)
+        val processed = mutableListOf<Int>()
+        val result = sdk.flattenDocument(doc, doc.FileDescriptor!!, listener = object : OnFlattenListener {
+            override fun onPageFlattened(pageIndex: Int, flattened: Boolean): Boolean {
+                processed.add(pageIndex)
+                return true
+            }
+        })!!
+        sdk.closeDocument(doc)
+
+        Assert.assertEquals((0 until pageCount).toList(), processed)
+        Assert.assertEquals(pageCount, result.pages)
+        Assert.assertTrue(result.flattenedPages > 0)
+        // Appended after the original bytes
+        Assert.assertEquals(length + result.bytesWritten, file.length())
+
+        doc = open()
+        Assert.assertEquals(pageCount, sdk.getPageCount(doc))
+        Assert.assertEquals(0, layerAnnotations(doc))
+        sdk.closeDocument(doc)
+
+        // A copy gets the whole document even with nothing to flatten
+        val sample = sdk.newDocument(ParcelFileDescriptor.open(FileUtils.getFileFromPath(this, "sample.pdf"),
+            ParcelFileDescriptor.MODE_READ_ONLY), "")
+        val copy = File(file.parentFile, "flattened.pdf").apply { delete() }
+        val copied = sdk.flattenDocument(sample, ParcelFileDescriptor.open(copy,
+            ParcelFileDescriptor.MODE_READ_WRITE or ParcelFileDescriptor.MODE_CREATE))!!
+        sdk.closeDocument(sample)
+        Assert.assertTrue(copied.bytesWritten > 0)
+        Assert.assertEquals(copy.length(), copied.bytesWritten)
+    }
+}
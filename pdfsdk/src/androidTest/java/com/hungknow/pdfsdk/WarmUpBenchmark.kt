@@ -0,0 +1,51 @@
+package com.hungknow.pdfsdk
+
+import android.graphics.Bitmap
+import android.os.ParcelFileDescriptor
+import android.os.SystemClock
+import android.util.Log
+import androidx.test.ext.junit.runners.AndroidJUnit4
+import com.hungknow.pdfsdk.models.WarmUpTimings
+import org.junit.Assert
+import org.junit.Test
+import org.junit.runner.RunWith
+
+/**
+ * First-page latency before and after [PdfiumSDK.warmUp]. The cold pass
+ * only measures a real cold start when no other test left the library
+ * pinned, so run it on its own.
+ */
+@RunWith(AndroidJUnit4::class)
+class WarmUpBenchmark {
+
+    private fun firstPageNanos(sdk: PdfiumSDK): Long {
+        val f = FileUtils.getFileFromPath(this, "sample.pdf")
+        val pfd = ParcelFileDescriptor.open(f, ParcelFileDescriptor.MODE_READ_ONLY)
+        val bitmap = Bitmap.createBitmap(256, 256, Bitmap.Config.RGB_565)
+
+        val start = SystemClock.elapsedRealtimeNanos()
+        val doc = sdk.newDocument(pfd, "")
+        sdk.openPage(doc, 0)
+        sdk.renderPageBitmap(doc, bitmap, 0, 0, 0, 256, 256)
+        val elapsed = SystemClock.elapsedRealtimeNanos() - start
+
+        sdk.closeDocument(doc)
+        bitmap.recycle()
+        return elapsed
+    }
+
+    @Test
+    fun firstPageLatencySaved() {
+        val sdk = PdfiumSDK(72)
+        sdk.releaseLibrary()
+        val cold = firstPageNanos(sdk)
+
+        var timings: WarmUpTimings? = null
+        sdk.warmUp { timings = it }.join()
+        val warm = firstPageNanos(sdk)
+
+        Assert.assertNotNull(timings)
+        Log.i("WarmUpBenchmark", "warm-up $timings, first page cold " + cold / 1000 +
+                "us, after warm-up " + warm / 1000 + "us, saved " + (cold - warm) / 1000 + "us")
+    }
+}
@@ -0,0 +1,194 @@
+#!/usr/bin/env python3
+"""Writes the synthetic PDF corpus of the native benchmarks.
+
+The documents are deterministic, so the checked-in files only change when
+this script does. Run it from any directory:
+
+    python3 pdfsdk/src/benchmark/corpus/generate_corpus.py
+"""
+
+import os
+import random
+import zlib
+
+WORDS = ("lorem ipsum dolor sit amet consectetur adipiscing elit sed do eiusmod "
+         "tempor incididunt ut labore et dolore magna aliqua enim ad minim veniam "
+         "quis nostrud exercitation ullamco laboris nisi aliquip ex ea commodo").split()
+
+PAGE_WIDTH = 612
+PAGE_HEIGHT = 792
+
+
+class Document:
+    def __init__(self):
+        self.objects = []
+        self.pages = []
+        self.catalog_entries = b""
+
+    def add(self, body):
+        self.objects.append(body)
+        return len(self.objects)
+
+    def add_stream(self, data, extra=b"", compress=True):
+        if compress:
+            data = zlib.compress(data, 9)
+            extra += b" /Filter /FlateDecode"
+        return self.add(b"<< /Length %d%s >>\nstream\n" % (len(data), extra) + data +
+                        b"\nendstream")
+
+    def add_page(self, content, resources, entries=b""):
+        self.pages.append((self.add_stream(content), resources, entries))
+
+    def write(self, path):
+        font = self.add(b"<< /Type /Font /Subtype /Type1 /BaseFont /Helvetica "
+                        b"/Encoding /WinAnsiEncoding >>")
+        pages_id = len(self.objects) + len(self.pages) + 1
+        kids = []
+        for content, resources, entries in self.pages:
+            kids.append(self.add(
+                b"<< /Type /Page /Parent %d 0 R /MediaBox [0 0 %d %d] /Contents %d 0 R "
+                b"/Resources << /Font << /F1 %d 0 R >> %s >>%s >>"
+                % (pages_id, PAGE_WIDTH, PAGE_HEIGHT, content, font, resources, entries)))
+        assert self.add(b"<< /Type /Pages /Kids [%s] /Count %d >>" % (
+            b" ".join(b"%d 0 R" % kid for kid in kids), len(kids))) == pages_id
+        catalog = self.add(b"<< /Type /Catalog /Pages %d 0 R%s >>" % (
+            pages_id, self.catalog_entries))
+
+        out = bytearray(b"%PDF-1.7\n%\xe2\xe3\xcf\xd3\n")
+        offsets = []
+        for number, body in enumerate(self.objects, 1):
+            offsets.append(len(out))
+            out += b"%d 0 obj\n" % number + body + b"\nendobj\n"
+        xref = len(out)
+        out += b"xref\n0 %d\n0000000000 65535 f \n" % (len(self.objects) + 1)
+        for offset in offsets:
+            out += b"%010d 00000 n \n" % offset
+        out += b"trailer\n<< /Size %d /Root %d 0 R >>\nstartxref\n%d\n%%%%EOF\n" % (
+            len(self.objects) + 1, catalog, xref)
+        with open(path, "wb") as f:
+            f.write(out)
+
+
+def text_block(rng, top, bottom, size=10):
+    lines = [b"BT /F1 %d Tf %d TL 54 %d Td" % (size, size + 2, top)]
+    y = top
+    while y > bottom:
+        line = " ".join(rng.choice(WORDS) for _ in range(14))
+        lines.append(b"(%s) '" % line.encode("ascii"))
+        y -= size + 2
+    lines.append(b"ET")
+    return b"\n".join(lines) + b"\n"
+
+
+def vector_art(rng, count, area):
+    x0, y0, x1, y1 = area
+    ops = []
+    for _ in range(count):
+        ops.append(b"%.3f %.3f %.3f RG %.2f w" % (rng.random(), rng.random(), rng.random(),
+                                                 rng.uniform(0.2, 3)))
+        x, y = rng.uniform(x0, x1), rng.uniform(y0, y1)
+        ops.append(b"%.1f %.1f m" % (x, y))
+        for _ in range(3):
+            ops.append(b"%.1f %.1f %.1f %.1f %.1f %.1f c" % tuple(
+                rng.uniform(a, b) for a, b in ((x0, x1), (y0, y1)) * 3))
+        ops.append(b"S" if rng.random() < 0.5 else b"%.3f %.3f %.3f rg f" % (
+            rng.random(), rng.random(), rng.random()))
+    return b"\n".join(ops) + b"\n"
+
+
+def gradient_image(document, width, height):
+    pixels = bytearray()
+    for y in range(height):
+        for x in range(width):
+            pixels += bytes(((x * 255) // width, (y * 255) // height,
+                             (x + y) * 255 // (width + height)))
+    return document.add_stream(
+        bytes(pixels),
+        b" /Type /XObject /Subtype /Image /Width %d /Height %d /ColorSpace /DeviceRGB "
+        b"/BitsPerComponent 8" % (width, height))
+
+
+def text_document(path):
+    rng = random.Random(1)
+    document = Document()
+    for _ in range(20):
+        document.add_page(text_block(rng, 740, 50), b"")
+    document.write(path)
+
+
+def vector_document(path):
+    rng = random.Random(2)
+    document = Document()
+    for _ in range(4):
+        document.add_page(vector_art(rng, 1000, (0, 0, PAGE_WIDTH, PAGE_HEIGHT)), b"")
+    document.write(path)
+
+
+def image_document(path):
+    document = Document()
+    image = gradient_image(document, 384, 384)
+    for _ in range(4):
+        document.add_page(b"q 540 0 0 540 36 126 cm /Im1 Do Q\n",
+                          b"/XObject << /Im1 %d 0 R >>" % image)
+    document.write(path)
+
+
+def mixed_document(path):
+    rng = random.Random(4)
+    document = Document()
+    image = gradient_image(document, 256, 256)
+    for _ in range(4):
+        content = (text_block(rng, 740, 420) +
+                   vector_art(rng, 200, (54, 60, 300, 400)) +
+                   b"q 250 0 0 250 310 120 cm /Im1 Do Q\n")
+        document.add_page(content, b"/XObject << /Im1 %d 0 R >>" % image)
+    document.write(path)
+
+
+def forms_document(path):
+    # A bundle of filled-in forms: every page has text fields with their
+    # appearance and a reviewer's mark, all of it for flattening to bake in
+    rng = random.Random(5)
+    document = Document()
+    font = document.add(b"<< /Type /Font /Subtype /Type1 /BaseFont /Helvetica "
+                        b"/Encoding /WinAnsiEncoding >>")
+    fields = []
+    for page in range(1000):
+        annots = []
+        for field in range(3):
+            y = 640 - field * 60
+            value = " ".join(rng.choice(WORDS) for _ in range(3)).encode("ascii")
+            appearance = document.add_stream(
+                b"/Tx BMC q 0.9 g 0 0 240 20 re f Q BT /F1 11 Tf 0 g 2 6 Td (%s) Tj ET EMC"
+                % value, b" /Type /XObject /Subtype /Form /BBox [0 0 240 20] "
+                         b"/Resources << /Font << /F1 %d 0 R >> >>" % font, compress=False)
+            annots.append(document.add(
+                b"<< /Type /Annot /Subtype /Widget /FT /Tx /T (p%df%d) /V (%s) /F 4 "
+                b"/Rect [300 %d 540 %d] /DA (/F1 11 Tf 0 g) /AP << /N %d 0 R >> >>"
+                % (page, field, value, y, y + 20, appearance)))
+        fields.extend(annots)
+        mark = document.add_stream(b"1 0 0 RG 2 w 1 1 98 38 re S",
+                                   b" /Type /XObject /Subtype /Form /BBox [0 0 100 40]",
+                                   compress=False)
+        annots.append(document.add(
+            b"<< /Type /Annot /Subtype /Square /F 4 /C [1 0 0] /Rect [440 700 540 740] "
+            b"/Contents (Checked) /AP << /N %d 0 R >> >>" % mark))
+        labels = b"BT /F1 11 Tf 54 646 Td (Name) Tj 0 -60 Td (Address) Tj 0 -60 Td (Notes) Tj ET\n"
+        document.add_page(labels, b"", b" /Annots [%s]" % b" ".join(b"%d 0 R" % a for a in annots))
+    document.catalog_entries = (
+        b" /AcroForm << /Fields [%s] /DA (/F1 11 Tf 0 g) /DR << /Font << /F1 %d 0 R >> >> >>"
+        % (b" ".join(b"%d 0 R" % f for f in fields), font))
+    document.write(path)
+
+
+def main():
+    directory = os.path.dirname(os.path.abspath(__file__))
+    text_document(os.path.join(directory, "text.pdf"))
+    vector_document(os.path.join(directory, "vector.pdf"))
+    image_document(os.path.join(directory, "image.pdf"))
+    mixed_document(os.path.join(directory, "mixed.pdf"))
+    forms_document(os.path.join(directory, "forms.pdf"))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,270 @@
+#include "benchmark_harness.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <regex>
+
+namespace benchmark {
+
+static int64_t nowNanos(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (int64_t) ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static std::vector<Benchmark *> &registry() {
+    static std::vector<Benchmark *> benchmarks;
+    return benchmarks;
+}
+
+Benchmark *RegisterBenchmark(const char *name, Function function) {
+    Benchmark *benchmark = new Benchmark(name, function);
+    registry().push_back(benchmark);
+    return benchmark;
+}
+
+State::State(int64_t iterations, const std::vector<int64_t> &args)
+        : maxIterations(iterations), args(args) {}
+
+void State::start() {
+    realStart = nowNanos(CLOCK_MONOTONIC);
+    cpuStart = nowNanos(CLOCK_PROCESS_CPUTIME_ID);
+    running = true;
+}
+
+void State::stop() {
+    if (!running) return;
+    realNanos += nowNanos(CLOCK_MONOTONIC) - realStart;
+    cpuNanos += nowNanos(CLOCK_PROCESS_CPUTIME_ID) - cpuStart;
+    running = false;
+}
+
+void State::PauseTiming() {
+    stop();
+}
+
+void State::ResumeTiming() {
+    start();
+}
+
+void State::SkipWithError(const std::string &message) {
+    failed = true;
+    error = message;
+}
+
+State::Iterator State::begin() {
+    start();
+    return Iterator(this, failed ? 0 : maxIterations);
+}
+
+bool State::Iterator::operator!=(const Iterator &) const {
+    if (remaining > 0 && !state->failed) return true;
+    state->stop();
+    return false;
+}
+
+struct Result {
+    std::string name;
+    int64_t iterations;
+    double realTime;
+    double cpuTime;
+    State *state;
+};
+
+class Runner {
+public:
+    static Result run(Benchmark *benchmark, const std::vector<int64_t> &args, double minTime) {
+        std::string name = benchmark->name;
+        for (size_t i = 0; i < args.size(); i++) {
+            name += "/" + std::to_string(args[i]);
+        }
+
+        // Grow the iteration count until one run is long enough to trust
+        int64_t iterations = 1;
+        State *state = nullptr;
+        while (true) {
+            delete state;
+            state = new State(iterations, args);
+            benchmark->function(*state);
+            double seconds = state->realNanos / 1e9;
+            if (state->failed || seconds >= minTime || iterations >= 1000000000) break;
+            double multiplier = seconds > 0 ? minTime * 1.4 / seconds : 10;
+            if (multiplier > 10) multiplier = 10;
+            if (multiplier < 1.5) multiplier = 1.5;
+            iterations = (int64_t) (iterations * multiplier) + 1;
+        }
+
+        Result result;
+        result.name = name;
+        result.iterations = state->maxIterations;
+        result.realTime = (double) state->realNanos / state->maxIterations;
+        result.cpuTime = (double) state->cpuNanos / state->maxIterations;
+        result.state = state;
+        return result;
+    }
+};
+
+static std::string jsonEscape(const std::string &text) {
+    std::string out;
+    for (size_t i = 0; i < text.size(); i++) {
+        char c = text[i];
+        if (c == '"' || c == '\\') {
+            out.push_back('\\');
+            out.push_back(c);
+        } else if ((unsigned char) c < 0x20) {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            out += escaped;
+        } else {
+            out.push_back(c);
+        }
+    }
+    return out;
+}
+
+class Reporter {
+public:
+    static void json(FILE *out, const std::vector<Result> &results) {
+        char host[256] = "unknown";
+        gethostname(host, sizeof(host) - 1);
+        char date[64] = "";
+        time_t now = time(nullptr);
+        strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S%z", localtime(&now));
+
+        fprintf(out, "{\n  \"context\": {\n");
+        fprintf(out, "    \"date\": \"%s\",\n", date);
+        fprintf(out, "    \"host_name\": \"%s\",\n", jsonEscape(host).c_str());
+        fprintf(out, "    \"num_cpus\": %ld,\n", sysconf(_SC_NPROCESSORS_ONLN));
+#ifdef NDEBUG
+        fprintf(out, "    \"library_build_type\": \"release\"\n");
+#else
+        fprintf(out, "    \"library_build_type\": \"debug\"\n");
+#endif
+        fprintf(out, "  },\n  \"benchmarks\": [\n");
+        for (size_t i = 0; i < results.size(); i++) {
+            const Result &r = results[i];
+            const State &s = *r.state;
+            fprintf(out, "    {\n");
+            fprintf(out, "      \"name\": \"%s\",\n", jsonEscape(r.name).c_str());
+            fprintf(out, "      \"run_name\": \"%s\",\n", jsonEscape(r.name).c_str());
+            fprintf(out, "      \"run_type\": \"iteration\",\n");
+            if (s.failed) {
+                fprintf(out, "      \"error_occurred\": true,\n");
+                fprintf(out, "      \"error_message\": \"%s\",\n", jsonEscape(s.error).c_str());
+            }
+            fprintf(out, "      \"iterations\": %lld,\n", (long long) r.iterations);
+            fprintf(out, "      \"real_time\": %.3f,\n", r.realTime);
+            fprintf(out, "      \"cpu_time\": %.3f,\n", r.cpuTime);
+            fprintf(out, "      \"time_unit\": \"ns\"");
+            double seconds = s.realNanos / 1e9;
+            if (s.bytesProcessed > 0 && seconds > 0) {
+                fprintf(out, ",\n      \"bytes_per_second\": %.3f", s.bytesProcessed / seconds);
+            }
+            if (s.itemsProcessed > 0 && seconds > 0) {
+                fprintf(out, ",\n      \"items_per_second\": %.3f", s.itemsProcessed / seconds);
+            }
+            for (std::map<std::string, double>::const_iterator it = s.counters.begin();
+                 it != s.counters.end(); ++it) {
+                fprintf(out, ",\n      \"%s\": %.3f", jsonEscape(it->first).c_str(), it->second);
+            }
+            if (!s.label.empty()) {
+                fprintf(out, ",\n      \"label\": \"%s\"", jsonEscape(s.label).c_str());
+            }
+            fprintf(out, "\n    }%s\n", i + 1 < results.size() ? "," : "");
+        }
+        fprintf(out, "  ]\n}\n");
+    }
+
+    static void console(FILE *out, const std::vector<Result> &results) {
+        fprintf(out, "%-48s %14s %14s %12s\n", "Benchmark", "Time", "CPU", "Iterations");
+        for (size_t i = 0; i < results.size(); i++) {
+            const Result &r = results[i];
+            const State &s = *r.state;
+            if (s.failed) {
+                fprintf(out, "%-48s ERROR: %s\n", r.name.c_str(), s.error.c_str());
+                continue;
+            }
+            fprintf(out, "%-48s %11.0f ns %11.0f ns %12lld", r.name.c_str(), r.realTime, r.cpuTime,
+                    (long long) r.iterations);
+            double seconds = s.realNanos / 1e9;
+            if (s.itemsProcessed > 0 && seconds > 0) {
+                fprintf(out, " items/s=%.4g", s.itemsProcessed / seconds);
+            }
+            for (std::map<std::string, double>::const_iterator it = s.counters.begin();
+                 it != s.counters.end(); ++it) {
+                fprintf(out, " %s=%.4g", it->first.c_str(), it->second);
+            }
+            if (!s.label.empty()) fprintf(out, " %s", s.label.c_str());
+            fprintf(out, "\n");
+        }
+    }
+};
+
+static const char *flagValue(const char *arg, const char *flag) {
+    size_t length = strlen(flag);
+    if (strncmp(arg, flag, length) == 0 && arg[length] == '=') return arg + length + 1;
+    return nullptr;
+}
+
+int RunSpecifiedBenchmarks(int argc, char **argv) {
+    std::string filter;
+    std::string format = "console";
+    std::string outPath;
+    double minTime = 0.5;
+    for (int i = 1; i < argc; i++) {
+        const char *value;
+        if ((value = flagValue(argv[i], "--benchmark_filter")) != nullptr) {
+            filter = value;
+        } else if ((value = flagValue(argv[i], "--benchmark_format")) != nullptr) {
+            format = value;
+        } else if ((value = flagValue(argv[i], "--benchmark_out")) != nullptr) {
+            outPath = value;
+        } else if ((value = flagValue(argv[i], "--benchmark_min_time")) != nullptr) {
+            minTime = atof(value);
+        }
+    }
+
+    std::regex pattern(filter.empty() ? "." : filter);
+    std::vector<Result> results;
+    for (size_t b = 0; b < registry().size(); b++) {
+        Benchmark *benchmark = registry()[b];
+        std::vector<std::vector<int64_t> > argSets = benchmark->argSets;
+        if (argSets.empty()) argSets.push_back(std::vector<int64_t>());
+        for (size_t a = 0; a < argSets.size(); a++) {
+            std::string name = benchmark->name;
+            for (size_t i = 0; i < argSets[a].size(); i++) {
+                name += "/" + std::to_string(argSets[a][i]);
+            }
+            if (!std::regex_search(name, pattern)) continue;
+            results.push_back(Runner::run(benchmark, argSets[a], minTime));
+        }
+    }
+
+    if (format == "json") {
+        Reporter::json(stdout, results);
+    } else {
+        Reporter::console(stdout, results);
+    }
+    if (!outPath.empty()) {
+        FILE *out = fopen(outPath.c_str(), "w");
+        if (out == nullptr) {
+            fprintf(stderr, "Unable to write %s\n", outPath.c_str());
+            return 1;
+        }
+        Reporter::json(out, results);
+        fclose(out);
+    }
+
+    int failures = 0;
+    for (size_t i = 0; i < results.size(); i++) {
+        if (results[i].state->error_occurred()) failures++;
+        delete results[i].state;
+    }
+    return failures == 0 ? 0 : 1;
+}
+
+} // namespace benchmark
@@ -0,0 +1,134 @@
+#ifndef PDFVIEW_BENCHMARK_HARNESS_H
+#define PDFVIEW_BENCHMARK_HARNESS_H
+
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+ * A small harness in the style of Google Benchmark, so the suite builds
+ * with nothing but a compiler. Benchmarks are functions taking a State and
+ * looping `for (auto _ : state)`; the iteration count grows until a run
+ * lasts at least --benchmark_min_time. --benchmark_format=json prints the
+ * same JSON schema as Google Benchmark, so its compare tools work on it.
+ */
+namespace benchmark {
+
+class State {
+public:
+    State(int64_t iterations, const std::vector<int64_t> &args);
+
+    int64_t range(size_t index) const { return args[index]; }
+
+    int64_t iterations() const { return maxIterations; }
+
+    // Excludes setup done inside the loop from the timings
+    void PauseTiming();
+
+    void ResumeTiming();
+
+    void SetItemsProcessed(int64_t items) { itemsProcessed = items; }
+
+    void SetBytesProcessed(int64_t bytes) { bytesProcessed = bytes; }
+
+    void SetLabel(const std::string &text) { label = text; }
+
+    void SkipWithError(const std::string &message);
+
+    bool error_occurred() const { return failed; }
+
+    // Reported as is next to the timings
+    std::map<std::string, double> counters;
+
+    class Iterator {
+    public:
+        Iterator(State *state, int64_t remaining) : state(state), remaining(remaining) {}
+
+        bool operator!=(const Iterator &end) const;
+
+        Iterator &operator++() {
+            remaining--;
+            return *this;
+        }
+
+        // Non-trivial so `for (auto _ : state)` doesn't warn as unused
+        struct Value {
+            ~Value() {}
+        };
+
+        Value operator*() const { return Value(); }
+
+    private:
+        State *state;
+        int64_t remaining;
+    };
+
+    Iterator begin();
+
+    Iterator end() { return Iterator(this, 0); }
+
+private:
+    friend class Runner;
+    friend class Reporter;
+
+    void start();
+
+    void stop();
+
+    int64_t maxIterations;
+    std::vector<int64_t> args;
+    int64_t realNanos = 0;
+    int64_t cpuNanos = 0;
+    int64_t realStart = 0;
+    int64_t cpuStart = 0;
+    bool running = false;
+    bool failed = false;
+    std::string error;
+    std::string label;
+    int64_t itemsProcessed = 0;
+    int64_t bytesProcessed = 0;
+};
+
+typedef void (*Function)(State &);
+
+class Benchmark {
+public:
+    Benchmark(const char *name, Function function) : name(name), function(function) {}
+
+    Benchmark *Arg(int64_t value) {
+        argSets.push_back(std::vector<int64_t>(1, value));
+        return this;
+    }
+
+    Benchmark *Args(const std::vector<int64_t> &values) {
+        argSets.push_back(values);
+        return this;
+    }
+
+    std::string name;
+    Function function;
+    std::vector<std::vector<int64_t> > argSets;
+};
+
+Benchmark *RegisterBenchmark(const char *name, Function function);
+
+// Parses the --benchmark_* flags, runs the selected benchmarks and reports.
+// Returns the process exit code.
+int RunSpecifiedBenchmarks(int argc, char **argv);
+
+// Keeps the compiler from optimizing a result away
+template<class T>
+inline void DoNotOptimize(const T &value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+} // namespace benchmark
+
+#define BENCHMARK_CONCAT_(a, b) a##b
+#define BENCHMARK_CONCAT(a, b) BENCHMARK_CONCAT_(a, b)
+#define BENCHMARK(function) \
+    static ::benchmark::Benchmark *BENCHMARK_CONCAT(sBenchmark, __LINE__) = \
+        ::benchmark::RegisterBenchmark(#function, function)
+
+#endif //PDFVIEW_BENCHMARK_HARNESS_H
@@ -0,0 +1,448 @@
+#include "benchmark_harness.h"
+
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "document.h"
+#include "flatten_job.h"
+#include "ink_engine.h"
+#include "page_assembly.h"
+#include "print_renderer.h"
+#include "pdfium_library.h"
+#include "render_core.h"
+#include "text_index.h"
+
+#include <public/fpdf_annot.h>
+
+// Synthetic documents of pdfsdk/src/benchmark/corpus, see generate_corpus.py
+static const char *const kCorpus[] = {
+        "text.pdf",
+        "vector.pdf",
+        "image.pdf",
+        "mixed.pdf",
+        "forms.pdf",
+};
+
+static std::string sCorpusDir = PDFSDK_CORPUS_DIR;
+
+static std::string corpusPath(int64_t index) {
+    return sCorpusDir + "/" + kCorpus[index];
+}
+
+static std::unique_ptr<Document> openCorpus(int64_t index, bool cachePageSizes, int *fd) {
+    *fd = open(corpusPath(index).c_str(), O_RDONLY | O_CLOEXEC);
+    unsigned long error;
+    return Document::openFd(*fd, nullptr, &error, cachePageSizes);
+}
+
+/**
+ * A corpus document opened through its file descriptor, as the app opens
+ * documents.
+ */
+class CorpusDocument {
+public:
+    explicit CorpusDocument(int64_t index, bool cachePageSizes = false)
+            : document(openCorpus(index, cachePageSizes, &fd)) {}
+
+    ~CorpusDocument() {
+        document.reset();
+        if (fd >= 0) close(fd);
+    }
+
+    Document *get() const { return document.get(); }
+
+    int pageCount() const { return document ? document->pageCount() : 0; }
+
+private:
+    int fd = -1;
+    std::unique_ptr<Document> document;
+};
+
+// Second arg 1 opens as the SDK does, reading every page size up front
+static void BM_OpenDocument(benchmark::State &state) {
+    const bool cachePageSizes = state.range(1) != 0;
+    for (auto _ : state) {
+        CorpusDocument doc(state.range(0), cachePageSizes);
+        if (doc.get() == nullptr) {
+            state.SkipWithError("cannot open " + corpusPath(state.range(0)));
+            break;
+        }
+        benchmark::DoNotOptimize(doc.pageCount());
+    }
+    state.SetLabel(std::string(kCorpus[state.range(0)]) +
+                   (cachePageSizes ? " sizes cached" : ""));
+}
+BENCHMARK(BM_OpenDocument)->Args({0, 0})->Args({1, 0})->Args({2, 0})->Args({3, 0})
+        ->Args({0, 1})->Args({1, 1})->Args({2, 1})->Args({3, 1});
+
+// Size of every page in turn, from the table cached at open (Arg 1) or
+// from PDFium (Arg 0), both through Document::pageSize
+static void BM_PageSize(benchmark::State &state) {
+    CorpusDocument doc(0, state.range(0) != 0);
+    const int pageCount = doc.pageCount();
+    if (pageCount == 0) {
+        state.SkipWithError("empty document");
+        return;
+    }
+    int pageIndex = 0;
+    FS_SIZEF size;
+    for (auto _ : state) {
+        doc.get()->pageSize(pageIndex, &size);
+        benchmark::DoNotOptimize(size);
+        pageIndex = (pageIndex + 1) % pageCount;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PageSize)->Arg(0)->Arg(1);
+
+static void BM_PageParse(benchmark::State &state) {
+    CorpusDocument doc(state.range(0));
+    int pageCount = doc.pageCount();
+    if (pageCount == 0) {
+        state.SkipWithError("empty document");
+        return;
+    }
+    int pageIndex = 0;
+    for (auto _ : state) {
+        std::unique_ptr<Page> page = doc.get()->loadPage(pageIndex);
+        benchmark::DoNotOptimize(page.get());
+        pageIndex = (pageIndex + 1) % pageCount;
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetLabel(kCorpus[state.range(0)]);
+}
+BENCHMARK(BM_PageParse)->Arg(0)->Arg(1)->Arg(2)->Arg(3);
+
+// A 256x256 tile from the middle of the first page of the mixed document
+// at a DPI, into a RGBA_8888 (format 0) or RGB_565 (format 1) target
+static void BM_RenderTile(benchmark::State &state) {
+    int dpi = (int) state.range(0);
+    TilePixelFormat format = state.range(1) == 0 ? kTileRgba8888 : kTileRgb565;
+    CorpusDocument doc(3);
+    std::unique_ptr<Page> page = doc.get() ? doc.get()->loadPage(0) : nullptr;
+    if (!page) {
+        state.SkipWithError("cannot load page");
+        return;
+    }
+
+    const int tileSize = 256;
+    int bytesPerPixel = format == kTileRgb565 ? 2 : 4;
+    std::vector<unsigned char> pixels(tileSize * tileSize * bytesPerPixel);
+    RenderTarget target;
+    target.pixels = pixels.data();
+    target.width = tileSize;
+    target.height = tileSize;
+    target.stride = tileSize * bytesPerPixel;
+    target.format = format;
+
+    int pageWidth = (int) (page->width() * dpi / 72);
+    int pageHeight = (int) (page->height() * dpi / 72);
+    int startX = -(pageWidth - tileSize) / 2;
+    int startY = -(pageHeight - tileSize) / 2;
+    TileRenderer renderer;
+    for (auto _ : state) {
+        renderer.render(page->get(), target, startX, startY, pageWidth, pageHeight, true);
+        benchmark::DoNotOptimize(pixels[0]);
+    }
+    state.SetItemsProcessed(state.iterations() * tileSize * tileSize);
+    state.counters["dpi"] = dpi;
+}
+BENCHMARK(BM_RenderTile)->Args({72, 0})->Args({144, 0})->Args({288, 0})
+        ->Args({72, 1})->Args({144, 1})->Args({288, 1});
+
+static void BM_Rgb565Convert(benchmark::State &state) {
+    int size = (int) state.range(0);
+    std::vector<unsigned char> source(size * size * 3);
+    for (size_t i = 0; i < source.size(); i++) {
+        source[i] = (unsigned char) (i * 31);
+    }
+    std::vector<uint16_t> dest(size * size);
+    for (auto _ : state) {
+        rgbBitmapTo565(source.data(), size * 3, dest.data(), size * 2, size, size);
+        benchmark::DoNotOptimize(dest[0]);
+    }
+    state.SetBytesProcessed(state.iterations() * (int64_t) source.size());
+}
+BENCHMARK(BM_Rgb565Convert)->Arg(256)->Arg(512)->Arg(1024);
+
+static void BM_TextExtract(benchmark::State &state) {
+    CorpusDocument doc(state.range(0));
+    std::unique_ptr<Page> page = doc.get() ? doc.get()->loadPage(0) : nullptr;
+    if (!page) {
+        state.SkipWithError("cannot load page");
+        return;
+    }
+    for (auto _ : state) {
+        TextIndex text(*page);
+        std::u16string chars = text.text(0, text.countChars());
+        benchmark::DoNotOptimize(chars.data());
+    }
+    state.SetLabel(kCorpus[state.range(0)]);
+}
+BENCHMARK(BM_TextExtract)->Arg(0)->Arg(3);
+
+// Case-insensitive search of a word over every page, text pages loaded
+// once up front as a viewer would keep them
+static void BM_TextSearch(benchmark::State &state) {
+    CorpusDocument doc(0);
+    std::vector<std::unique_ptr<Page> > pages;
+    std::vector<std::unique_ptr<TextIndex> > textPages;
+    for (int i = 0; i < doc.pageCount(); i++) {
+        pages.push_back(doc.get()->loadPage(i));
+        textPages.push_back(std::unique_ptr<TextIndex>(new TextIndex(*pages.back())));
+    }
+    std::vector<TextMatch> matches;
+    for (auto _ : state) {
+        matches.clear();
+        for (size_t i = 0; i < textPages.size(); i++) {
+            textPages[i]->find(u"dolor", 0, &matches);
+        }
+    }
+    state.counters["matches"] = (double) matches.size();
+    state.SetItemsProcessed(state.iterations() * (int64_t) textPages.size());
+}
+BENCHMARK(BM_TextSearch);
+
+// Touch input of a fast pen sampled at 240 Hz: a wave 3px per sample
+static void inkTouchPoints(int count, std::vector<float> *xy) {
+    xy->resize(count * 2);
+    for (int i = 0; i < count; i++) {
+        (*xy)[i * 2] = 40 + (i * 3) % 1000;
+        (*xy)[i * 2 + 1] = 700 + 200 * sinf(i * 0.05f) + (i * 3) / 1000 * 40;
+    }
+}
+
+// Input to pixels: one batch of touch points of a growing stroke fitted
+// and drawn into a phone-sized page overlay, what runs between a
+// MotionEvent and invalidating the view. Arg is the points per batch.
+static void BM_InkInputToPixel(benchmark::State &state) {
+    const int batch = (int) state.range(0);
+    const int strokePoints = 2000;
+    std::vector<float> xy;
+    inkTouchPoints(strokePoints, &xy);
+
+    const int width = 1080;
+    const int height = 1400;
+    std::vector<unsigned char> pixels(width * height * 4);
+    RenderTarget overlay;
+    overlay.pixels = pixels.data();
+    overlay.width = width;
+    overlay.height = height;
+    overlay.stride = width * 4;
+    overlay.format = kTileRgba8888;
+
+    std::unique_ptr<InkStroke> stroke(new InkStroke(0xFF2040C0, 6));
+    int next = 0;
+    int64_t dirtyPixels = 0;
+    for (auto _ : state) {
+        if (next + batch > strokePoints) {
+            state.PauseTiming();
+            stroke.reset(new InkStroke(0xFF2040C0, 6));
+            memset(pixels.data(), 0, pixels.size());
+            next = 0;
+            state.ResumeTiming();
+        }
+        InkDirtyRect dirty = stroke->addPoints(&xy[next * 2], batch, overlay);
+        dirtyPixels += (int64_t) (dirty.right - dirty.left) * (dirty.bottom - dirty.top);
+        next += batch;
+    }
+    state.SetItemsProcessed(state.iterations() * batch);
+    state.counters["dirty_pixels"] = (double) dirtyPixels / state.iterations();
+}
+BENCHMARK(BM_InkInputToPixel)->Arg(1)->Arg(4)->Arg(16);
+
+// Pen up: simplifying a 400-point stroke and adding it to a page as an
+// /Ink annotation with its appearance stream
+static void BM_InkCommit(benchmark::State &state) {
+    CorpusDocument doc(0);
+    std::unique_ptr<Page> page = doc.get() ? doc.get()->loadPage(0) : nullptr;
+    if (!page) {
+        state.SkipWithError("cannot load page");
+        return;
+    }
+    std::vector<float> xy;
+    inkTouchPoints(400, &xy);
+    std::vector<unsigned char> pixels(1080 * 1400 * 4);
+    RenderTarget overlay = {pixels.data(), 1080, 1400, 1080 * 4, kTileRgba8888};
+    InkStroke stroke(0xFF2040C0, 6);
+    stroke.addPoints(xy.data(), 400, overlay);
+    stroke.finish(overlay);
+
+    for (auto _ : state) {
+        int index = commitInkStroke(page->get(), stroke, 0, 0, 1080, 1400, 0.5f);
+        state.PauseTiming();
+        if (index < 0 || !FPDFPage_RemoveAnnot(page->get(), index)) {
+            state.SkipWithError("cannot commit the stroke");
+            break;
+        }
+        state.ResumeTiming();
+    }
+    state.counters["path_points"] = (double) stroke.path().size();
+}
+BENCHMARK(BM_InkCommit);
+
+// Single-threaded, no other PDFium user to serialize with
+template <class Sink>
+class UnlockedSink : public Sink {
+public:
+    void lockPdfium() override {}
+
+    void unlockPdfium() override {}
+};
+
+class UnlockedAssemblySink : public UnlockedSink<AssemblySink> {
+public:
+    bool onSourceAssembled(int, int) override { return true; }
+};
+
+// Merge of Arg documents of 100 pages into a file, the 20 pages of
+// text.pdf five times each. max_rss_kib shows memory stays bounded by the
+// output rather than growing with a serialized copy of it.
+static void BM_AssemblePages(benchmark::State &state) {
+    const int count = (int) state.range(0);
+    const int fd = open(corpusPath(0).c_str(), O_RDONLY | O_CLOEXEC);
+    char outputPath[] = "/tmp/pdfsdk_assembly_XXXXXX";
+    const int outputFd = mkstemp(outputPath);
+    unlink(outputPath);
+    if (fd < 0 || outputFd < 0) {
+        state.SkipWithError("cannot open the files");
+        return;
+    }
+
+    std::vector<AssemblySource> sources(count);
+    for (AssemblySource &source : sources) {
+        source.fd = fd;
+        source.pageRange = "1-20,1-20,1-20,1-20,1-20";
+    }
+    UnlockedAssemblySink sink;
+    AssemblyResult result;
+    int64_t pages = 0;
+    int64_t bytes = 0;
+    for (auto _ : state) {
+        if (!assemblePages(sources, AssemblyOptions(), outputFd, kSyncNone, &sink, &result)) {
+            state.SkipWithError(result.error != nullptr ? result.error : "cancelled");
+            break;
+        }
+        pages += result.pages;
+        bytes += (int64_t) result.bytesWritten;
+    }
+    state.SetItemsProcessed(pages);
+    state.SetBytesProcessed(bytes);
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    state.counters["max_rss_kib"] = (double) usage.ru_maxrss;
+    close(outputFd);
+    close(fd);
+}
+BENCHMARK(BM_AssemblePages)->Arg(1)->Arg(50);
+
+class UnlockedPrintSink : public UnlockedSink<PrintSink> {
+public:
+    bool onPageRendered(int, int) override { return true; }
+};
+
+// All pages of a corpus document printed at Arg DPI into a raster PDF,
+// rendering and compression overlapped; band_kib is the pixel memory
+static void BM_PrintPages(benchmark::State &state) {
+    CorpusDocument doc(3);
+    char outputPath[] = "/tmp/pdfsdk_print_XXXXXX";
+    const int outputFd = mkstemp(outputPath);
+    unlink(outputPath);
+    if (!doc.get() || outputFd < 0) {
+        state.SkipWithError("cannot open the files");
+        return;
+    }
+
+    std::vector<int> pages(doc.pageCount());
+    for (size_t i = 0; i < pages.size(); i++) pages[i] = (int) i;
+    PrintOptions options;
+    options.dpi = (int) state.range(0);
+    UnlockedPrintSink sink;
+    PrintResult result;
+    int64_t printed = 0;
+    int64_t nanos = 0;
+    for (auto _ : state) {
+        if (!printPages(doc.get(), pages, options, outputFd, kSyncNone, &sink, &result)) {
+            state.SkipWithError(result.error != nullptr ? result.error : "cancelled");
+            break;
+        }
+        printed += result.pages;
+        nanos += result.elapsedNanos;
+    }
+    state.SetItemsProcessed(printed);
+    state.counters["pages_per_min"] = nanos > 0 ? printed * 60e9 / nanos : 0;
+    state.counters["band_kib"] = (double) (result.bandMemory / 1024);
+    close(outputFd);
+}
+BENCHMARK(BM_PrintPages)->Arg(150)->Arg(300);
+
+class UnlockedFlattenSink : public UnlockedSink<FlattenSink> {
+public:
+    bool onPageFlattened(int, bool) override { return true; }
+};
+
+// The 1,000 pages of forms.pdf, three filled-in fields and a markup
+// annotation each, flattened and saved incrementally into a file. The job
+// flattens the document itself, so every iteration reopens it, untimed.
+// max_rss_kib shows memory stays at one page whatever the page count.
+static void BM_FlattenDocument(benchmark::State &state) {
+    char outputPath[] = "/tmp/pdfsdk_flatten_XXXXXX";
+    const int outputFd = mkstemp(outputPath);
+    unlink(outputPath);
+    if (outputFd < 0) {
+        state.SkipWithError("cannot create the output");
+        return;
+    }
+
+    UnlockedFlattenSink sink;
+    FlattenResult result;
+    int64_t pages = 0;
+    int64_t bytes = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        std::unique_ptr<CorpusDocument> doc(new CorpusDocument(4));
+        ftruncate(outputFd, 0);
+        state.ResumeTiming();
+        if (!doc->get()) {
+            state.SkipWithError("cannot open " + corpusPath(4));
+            break;
+        }
+        if (!flattenDocument(doc->get(), FlattenOptions(), outputFd, kSyncNone, &sink, &result)) {
+            state.SkipWithError(result.error != nullptr ? result.error : "cancelled");
+            break;
+        }
+        pages += result.flattenedPages;
+        bytes += (int64_t) result.bytesWritten;
+        state.PauseTiming();
+        doc.reset();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(pages);
+    state.SetBytesProcessed(bytes);
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    state.counters["max_rss_kib"] = (double) usage.ru_maxrss;
+    close(outputFd);
+}
+BENCHMARK(BM_FlattenDocument);
+
+int main(int argc, char **argv) {
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--corpus=", 9) == 0) sCorpusDir = argv[i] + 9;
+    }
+
+    // Kept up across benchmarks, so opens don't re-initialize the library
+    PdfiumLibrary::pin();
+    int result = benchmark::RunSpecifiedBenchmarks(argc, argv);
+    PdfiumLibrary::unpin();
+    return result;
+}
@@ -0,0 +1,212 @@
+#include "annot_codec.h"
+
+#include <string.h>
+
+static const uint8_t kMagic[4] = {'P', 'D', 'F', 'A'};
+static const uint8_t kVersion = 1;
+
+enum {
+    kHasColor = 1 << 0,
+    kHasAttachmentPoints = 1 << 1,
+    kHasInkList = 1 << 2,
+    kHasContents = 1 << 3,
+};
+
+static void putVarint(std::vector<uint8_t> *out, uint32_t value) {
+    while (value >= 0x80) {
+        out->push_back((uint8_t) (value | 0x80));
+        value >>= 7;
+    }
+    out->push_back((uint8_t) value);
+}
+
+static void putFloat(std::vector<uint8_t> *out, float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    for (int i = 0; i < 4; i++) {
+        out->push_back((uint8_t) (bits >> (8 * i)));
+    }
+}
+
+void encodeAnnotRecords(const std::vector<AnnotRecord> &records, std::vector<uint8_t> *out) {
+    out->clear();
+    out->insert(out->end(), kMagic, kMagic + sizeof(kMagic));
+    out->push_back(kVersion);
+    putVarint(out, (uint32_t) records.size());
+    for (size_t i = 0; i < records.size(); i++) {
+        const AnnotRecord &record = records[i];
+        putVarint(out, (uint32_t) record.page);
+        putVarint(out, (uint32_t) record.subtype);
+        putVarint(out, (uint32_t) record.flags);
+        putFloat(out, record.rect.left);
+        putFloat(out, record.rect.top);
+        putFloat(out, record.rect.right);
+        putFloat(out, record.rect.bottom);
+
+        uint8_t parts = 0;
+        if (record.hasColor) parts |= kHasColor;
+        if (!record.attachmentPoints.empty()) parts |= kHasAttachmentPoints;
+        if (!record.inkList.empty()) parts |= kHasInkList;
+        if (!record.contents.empty()) parts |= kHasContents;
+        out->push_back(parts);
+
+        if (record.hasColor) {
+            out->insert(out->end(), record.color, record.color + 4);
+        }
+        if (!record.attachmentPoints.empty()) {
+            putVarint(out, (uint32_t) record.attachmentPoints.size());
+            for (size_t q = 0; q < record.attachmentPoints.size(); q++) {
+                const FS_QUADPOINTSF &quad = record.attachmentPoints[q];
+                const float values[8] = {quad.x1, quad.y1, quad.x2, quad.y2,
+                                         quad.x3, quad.y3, quad.x4, quad.y4};
+                for (int v = 0; v < 8; v++) putFloat(out, values[v]);
+            }
+        }
+        if (!record.inkList.empty()) {
+            putVarint(out, (uint32_t) record.inkList.size());
+            for (size_t s = 0; s < record.inkList.size(); s++) {
+                const std::vector<FS_POINTF> &stroke = record.inkList[s];
+                putVarint(out, (uint32_t) stroke.size());
+                for (size_t p = 0; p < stroke.size(); p++) {
+                    putFloat(out, stroke[p].x);
+                    putFloat(out, stroke[p].y);
+                }
+            }
+        }
+        if (!record.contents.empty()) {
+            putVarint(out, (uint32_t) record.contents.size());
+            for (size_t c = 0; c < record.contents.size(); c++) {
+                putVarint(out, record.contents[c]);
+            }
+        }
+    }
+}
+
+namespace {
+
+// Bounds-checked reads, every one fails once the data runs out
+class Reader {
+public:
+    Reader(const uint8_t *data, size_t size) : data(data), end(data + size) {}
+
+    size_t remaining() const { return (size_t) (end - data); }
+
+    bool byte(uint8_t *value) {
+        if (data == end) return false;
+        *value = *data++;
+        return true;
+    }
+
+    bool varint(uint32_t *value) {
+        uint32_t result = 0;
+        for (int shift = 0; shift < 35; shift += 7) {
+            uint8_t b;
+            if (!byte(&b)) return false;
+            result |= (uint32_t) (b & 0x7F) << shift;
+            if ((b & 0x80) == 0) {
+                *value = result;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool integer(int *value) {
+        uint32_t v;
+        if (!varint(&v)) return false;
+        *value = (int) v;
+        return true;
+    }
+
+    // A count of items taking at least minSize bytes each, so a corrupt
+    // count can't make the caller allocate more than the blob holds
+    bool count(size_t minSize, uint32_t *value) {
+        return varint(value) && *value <= remaining() / minSize;
+    }
+
+    bool floatValue(float *value) {
+        if (remaining() < 4) return false;
+        uint32_t bits = (uint32_t) data[0] | (uint32_t) data[1] << 8 |
+                        (uint32_t) data[2] << 16 | (uint32_t) data[3] << 24;
+        memcpy(value, &bits, sizeof(*value));
+        data += 4;
+        return true;
+    }
+
+private:
+    const uint8_t *data;
+    const uint8_t *end;
+};
+
+}
+
+bool decodeAnnotRecords(const uint8_t *data, size_t size, std::vector<AnnotRecord> *records) {
+    records->clear();
+    if (size < sizeof(kMagic) + 1 || memcmp(data, kMagic, sizeof(kMagic)) != 0 ||
+        data[sizeof(kMagic)] != kVersion) {
+        return false;
+    }
+    Reader reader(data + sizeof(kMagic) + 1, size - sizeof(kMagic) - 1);
+
+    // A record has at least three varints, a rect and the parts byte
+    uint32_t recordCount;
+    if (!reader.count(3 + 16 + 1, &recordCount)) return false;
+    records->resize(recordCount);
+    for (uint32_t i = 0; i < recordCount; i++) {
+        AnnotRecord &record = (*records)[i];
+        uint8_t parts;
+        if (!reader.integer(&record.page) || !reader.integer(&record.subtype) ||
+            !reader.integer(&record.flags) || !reader.floatValue(&record.rect.left) ||
+            !reader.floatValue(&record.rect.top) || !reader.floatValue(&record.rect.right) ||
+            !reader.floatValue(&record.rect.bottom) || !reader.byte(&parts)) {
+            return false;
+        }
+
+        record.hasColor = (parts & kHasColor) != 0;
+        if (record.hasColor) {
+            for (int c = 0; c < 4; c++) {
+                if (!reader.byte(&record.color[c])) return false;
+            }
+        }
+        if (parts & kHasAttachmentPoints) {
+            uint32_t quadCount;
+            if (!reader.count(8 * 4, &quadCount)) return false;
+            record.attachmentPoints.resize(quadCount);
+            for (uint32_t q = 0; q < quadCount; q++) {
+                FS_QUADPOINTSF &quad = record.attachmentPoints[q];
+                float *values[8] = {&quad.x1, &quad.y1, &quad.x2, &quad.y2,
+                                    &quad.x3, &quad.y3, &quad.x4, &quad.y4};
+                for (int v = 0; v < 8; v++) {
+                    if (!reader.floatValue(values[v])) return false;
+                }
+            }
+        }
+        if (parts & kHasInkList) {
+            uint32_t strokeCount;
+            if (!reader.count(1, &strokeCount)) return false;
+            record.inkList.resize(strokeCount);
+            for (uint32_t s = 0; s < strokeCount; s++) {
+                uint32_t pointCount;
+                if (!reader.count(2 * 4, &pointCount)) return false;
+                std::vector<FS_POINTF> &stroke = record.inkList[s];
+                stroke.resize(pointCount);
+                for (uint32_t p = 0; p < pointCount; p++) {
+                    if (!reader.floatValue(&stroke[p].x) || !reader.floatValue(&stroke[p].y)) {
+                        return false;
+                    }
+                }
+            }
+        }
+        if (parts & kHasContents) {
+            uint32_t length;
+            if (!reader.count(1, &length)) return false;
+            record.contents.resize(length);
+            for (uint32_t c = 0; c < length; c++) {
+                uint32_t unit;
+                if (!reader.varint(&unit) || unit > 0xFFFF) return false;
+                record.contents[c] = (uint16_t) unit;
+            }
+        }
+    }
+    return reader.remaining() == 0;
+}
@@ -0,0 +1,54 @@
+#ifndef PDFVIEW_ANNOT_CODEC_H
+#define PDFVIEW_ANNOT_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include <public/fpdf_doc.h>
+#include <public/fpdfview.h>
+
+// One annotation as stored in an annotation blob. Coordinates are PDF user
+// space of its page.
+struct AnnotRecord {
+    int page;
+    int subtype;            // FPDF_ANNOT_*
+    int flags;              // FPDF_ANNOT_FLAG_*
+    FS_RECTF rect;
+    bool hasColor;
+    uint8_t color[4];       // R, G, B, A
+    std::vector<FS_QUADPOINTSF> attachmentPoints;
+    std::vector<std::vector<FS_POINTF> > inkList;
+    std::vector<uint16_t> contents;     // UTF-16 without terminator
+
+    AnnotRecord() : page(0), subtype(0), flags(0), rect(), hasColor(false), color() {}
+};
+
+/**
+ * The annotation blob: "PDFA", a version byte and a varint record count,
+ * then per record the varint page, subtype and flags, the rect as four
+ * little-endian floats and a byte telling which optional parts follow:
+ * the color, the attachment points, the ink list and the contents. Counts
+ * and UTF-16 units are varints, coordinates floats.
+ */
+void encodeAnnotRecords(const std::vector<AnnotRecord> &records, std::vector<uint8_t> *out);
+
+// False, leaving records in an unspecified state, if the blob is truncated,
+// malformed or of another version
+bool decodeAnnotRecords(const uint8_t *data, size_t size, std::vector<AnnotRecord> *records);
+
+// Appends the annotations of pages [firstPage, lastPage] to records, except
+// popups and form widgets, which belong to their parent and field. PDFium
+// only reads the color of annotations without an appearance stream.
+void readAnnotRecords(FPDF_DOCUMENT document, int firstPage, int lastPage,
+                      std::vector<AnnotRecord> *records);
+
+// Creates the annotations of records, loading each page once. With
+// replace, every annotation but the form widgets is removed first from the
+// pages the records touch. Records without flags are created printable.
+// Returns the number created; records of missing pages or subtypes PDFium
+// can't create are skipped.
+int writeAnnotRecords(FPDF_DOCUMENT document, const std::vector<AnnotRecord> &records,
+                      bool replace);
+
+#endif //PDFVIEW_ANNOT_CODEC_H
@@ -0,0 +1,146 @@
+#include "annot_layer.h"
+
+#include <algorithm>
+#include <new>
+#include <string.h>
+#include <utility>
+
+#include <public/fpdf_annot.h>
+#include <public/cpp/fpdf_scopers.h>
+
+void listLayerAnnots(FPDF_PAGE page, std::vector<LayerAnnot> *annots) {
+    annots->clear();
+    const float width = FPDF_GetPageWidthF(page);
+    const float height = FPDF_GetPageHeightF(page);
+    if (width <= 0 || height <= 0) return;
+
+    const int count = FPDFPage_GetAnnotCount(page);
+    for (int i = 0; i < count; i++) {
+        ScopedFPDFAnnotation annot(FPDFPage_GetAnnot(page, i));
+        if (!annot) continue;
+        const int subtype = FPDFAnnot_GetSubtype(annot.get());
+        if (subtype == FPDF_ANNOT_POPUP ||
+            (FPDFAnnot_GetFlags(annot.get()) & FPDF_ANNOT_FLAG_HIDDEN) != 0) {
+            continue;
+        }
+        FS_RECTF rect;
+        if (!FPDFAnnot_GetRect(annot.get(), &rect)) continue;
+
+        // PDF user space grows upwards
+        LayerAnnot layerAnnot;
+        layerAnnot.index = i;
+        layerAnnot.subtype = subtype;
+        layerAnnot.left = std::max(0.f, std::min(rect.left, rect.right) / width);
+        layerAnnot.right = std::min(1.f, std::max(rect.left, rect.right) / width);
+        layerAnnot.top = std::max(0.f, 1 - std::max(rect.top, rect.bottom) / height);
+        layerAnnot.bottom = std::min(1.f, 1 - std::min(rect.top, rect.bottom) / height);
+        if (layerAnnot.left < layerAnnot.right && layerAnnot.top < layerAnnot.bottom) {
+            annots->push_back(layerAnnot);
+        }
+    }
+}
+
+// Opaque white, under the content of the schemes that don't paint a
+// background
+static void fillWhite(const RenderTarget &target) {
+    for (int y = 0; y < target.height; y++) {
+        memset(static_cast<uint8_t *>(target.pixels) + (size_t) y * target.stride, 0xFF,
+               (size_t) target.width * 4);
+    }
+}
+
+// Hides the visible annotations of a page other than keep through their
+// /F for a scope. Their flags are set back after; one that had no /F gets
+// /F 0, which means the same.
+class HideOtherAnnots {
+public:
+    HideOtherAnnots(FPDF_PAGE page, int keep) : page(page) {
+        const int count = FPDFPage_GetAnnotCount(page);
+        for (int i = 0; i < count; i++) {
+            if (i == keep) continue;
+            ScopedFPDFAnnotation annot(FPDFPage_GetAnnot(page, i));
+            if (!annot) continue;
+            const int flags = FPDFAnnot_GetFlags(annot.get());
+            if ((flags & FPDF_ANNOT_FLAG_HIDDEN) != 0) continue;
+            FPDFAnnot_SetFlags(annot.get(), flags | FPDF_ANNOT_FLAG_HIDDEN);
+            hidden.push_back(std::make_pair(i, flags));
+        }
+    }
+
+    ~HideOtherAnnots() {
+        for (size_t i = 0; i < hidden.size(); i++) {
+            ScopedFPDFAnnotation annot(FPDFPage_GetAnnot(page, hidden[i].first));
+            if (annot) FPDFAnnot_SetFlags(annot.get(), hidden[i].second);
+        }
+    }
+
+private:
+    HideOtherAnnots(const HideOtherAnnots &);
+
+    FPDF_PAGE page;
+    // Index and flags before hiding
+    std::vector<std::pair<int, int>> hidden;
+};
+
+bool AnnotRenderer::render(FPDF_PAGE page, int annotIndex, const RenderTarget &target,
+                           int startX, int startY, int drawSizeHor, int drawSizeVer,
+                           ColorScheme scheme) {
+    ScopedFPDFAnnotation annot(FPDFPage_GetAnnot(page, annotIndex));
+    if (!annot || target.format != kTileRgba8888) {
+        return false;
+    }
+    const size_t pixels = (size_t) target.width * target.height;
+    if (scratch.size() < pixels) {
+        try {
+            scratch.resize(pixels);
+        } catch (const std::bad_alloc &) {
+            return false;
+        }
+    }
+    RenderTarget withoutAnnot = target;
+    withoutAnnot.pixels = scratch.data();
+    withoutAnnot.stride = target.width * 4;
+    fillWhite(target);
+    fillWhite(withoutAnnot);
+
+    // The annotation is hidden through its /F for the second render, then
+    // set back; the other annotations are in both renders and cancel out.
+    // Writing /F into a dict without one would make the next incremental
+    // save rewrite it, so such an annotation is left as is: the others are
+    // hidden for the first render instead and the second one leaves out
+    // every annotation.
+    if (FPDFAnnot_HasKey(annot.get(), "F")) {
+        if (!tiles.render(page, target, startX, startY, drawSizeHor, drawSizeVer, true,
+                          scheme)) {
+            return false;
+        }
+        const int flags = FPDFAnnot_GetFlags(annot.get());
+        FPDFAnnot_SetFlags(annot.get(), flags | FPDF_ANNOT_FLAG_HIDDEN);
+        const bool rendered = tiles.render(page, withoutAnnot, startX, startY, drawSizeHor,
+                                           drawSizeVer, true, scheme);
+        FPDFAnnot_SetFlags(annot.get(), flags);
+        if (!rendered) return false;
+    } else {
+        bool rendered;
+        {
+            HideOtherAnnots others(page, annotIndex);
+            rendered = tiles.render(page, target, startX, startY, drawSizeHor, drawSizeVer,
+                                    true, scheme);
+        }
+        if (!rendered || !tiles.render(page, withoutAnnot, startX, startY, drawSizeHor,
+                                       drawSizeVer, false, scheme)) {
+            return false;
+        }
+    }
+
+    // Whatever the annotation left untouched becomes transparent
+    for (int y = 0; y < target.height; y++) {
+        uint32_t *row = reinterpret_cast<uint32_t *>(
+                static_cast<uint8_t *>(target.pixels) + (size_t) y * target.stride);
+        const uint32_t *content = &scratch[(size_t) y * target.width];
+        for (int x = 0; x < target.width; x++) {
+            if (row[x] == content[x]) row[x] = 0;
+        }
+    }
+    return true;
+}
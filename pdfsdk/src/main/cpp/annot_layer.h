@@ -0,0 +1,52 @@
+#ifndef PDFVIEW_ANNOT_LAYER_H
+#define PDFVIEW_ANNOT_LAYER_H
+
+#include <vector>
+
+#include <public/fpdfview.h>
+
+#include "render_core.h"
+
+// An annotation drawn on the annotation layer
+struct LayerAnnot {
+    int index;      // FPDFPage_GetAnnot order, as in PageIndex
+    int subtype;    // FPDF_ANNOT_*
+    // Relative to the page size with the origin at the top left, like
+    // PagePart bounds
+    float left;
+    float top;
+    float right;
+    float bottom;
+};
+
+// The annotations of a page with something to draw, without popups,
+// hidden annotations and empty rects
+void listLayerAnnots(FPDF_PAGE page, std::vector<LayerAnnot> *annots);
+
+/**
+ * Renders single annotations onto transparent pixels, so they can be
+ * cached and composited over tiles rendered without FPDF_ANNOT. The area
+ * is rendered with and without that annotation, both through TileRenderer
+ * in the tiles' color scheme; the pixels that differ are the annotation,
+ * blended over the content exactly as PDFium draws it. The other
+ * annotations are in both renders and cancel out. Not thread-safe.
+ */
+class AnnotRenderer {
+public:
+    // Renders annotation annotIndex of a page placed like a tile of
+    // TileRenderer::render into an RGBA_8888 target. The annotation is
+    // hidden through its /F for the second render and its flags restored
+    // after. One without /F is left untouched: the other annotations are
+    // hidden for the first render instead, and the second render skips
+    // them all. False if there is no such annotation, no buffer could be
+    // allocated or PDFium failed to render.
+    bool render(FPDF_PAGE page, int annotIndex, const RenderTarget &target, int startX,
+                int startY, int drawSizeHor, int drawSizeVer,
+                ColorScheme scheme = kColorSchemeNone);
+
+private:
+    TileRenderer tiles;
+    std::vector<uint32_t> scratch;
+};
+
+#endif //PDFVIEW_ANNOT_LAYER_H
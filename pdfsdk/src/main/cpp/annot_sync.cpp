@@ -0,0 +1,150 @@
+#include "annot_codec.h"
+#include "render_stats.h"
+
+#include <algorithm>
+
+#include <public/fpdf_annot.h>
+#include <public/cpp/fpdf_scopers.h>
+
+static const char kContentsKey[] = "Contents";
+
+static void readRecord(FPDF_ANNOTATION annot, AnnotRecord *record) {
+    record->flags = FPDFAnnot_GetFlags(annot);
+    if (!FPDFAnnot_GetRect(annot, &record->rect)) record->rect = FS_RECTF();
+
+    unsigned int r, g, b, a;
+    if (FPDFAnnot_HasKey(annot, "C") &&
+        FPDFAnnot_GetColor(annot, FPDFANNOT_COLORTYPE_Color, &r, &g, &b, &a)) {
+        record->hasColor = true;
+        record->color[0] = (uint8_t) r;
+        record->color[1] = (uint8_t) g;
+        record->color[2] = (uint8_t) b;
+        record->color[3] = (uint8_t) a;
+    }
+
+    const size_t quadCount = FPDFAnnot_CountAttachmentPoints(annot);
+    record->attachmentPoints.resize(quadCount);
+    for (size_t q = 0; q < quadCount; q++) {
+        if (!FPDFAnnot_GetAttachmentPoints(annot, q, &record->attachmentPoints[q])) {
+            record->attachmentPoints.resize(q);
+            break;
+        }
+    }
+
+    const unsigned long strokeCount = FPDFAnnot_GetInkListCount(annot);
+    record->inkList.resize(strokeCount);
+    for (unsigned long s = 0; s < strokeCount; s++) {
+        std::vector<FS_POINTF> &stroke = record->inkList[s];
+        stroke.resize(FPDFAnnot_GetInkListPath(annot, s, NULL, 0));
+        if (!stroke.empty()) {
+            FPDFAnnot_GetInkListPath(annot, s, stroke.data(), (unsigned long) stroke.size());
+        }
+    }
+
+    // Length in bytes with the terminator
+    const unsigned long bytes = FPDFAnnot_GetStringValue(annot, kContentsKey, NULL, 0);
+    if (bytes > 2) {
+        record->contents.resize(bytes / 2);
+        FPDFAnnot_GetStringValue(annot, kContentsKey, record->contents.data(), bytes);
+        record->contents.pop_back();
+    }
+}
+
+void readAnnotRecords(FPDF_DOCUMENT document, int firstPage, int lastPage,
+                      std::vector<AnnotRecord> *records) {
+    firstPage = std::max(firstPage, 0);
+    lastPage = std::min(lastPage, FPDF_GetPageCount(document) - 1);
+    for (int pageIndex = firstPage; pageIndex <= lastPage; pageIndex++) {
+        ScopedFPDFPage page;
+        {
+            StageTimer timer(kStagePageLoad);
+            page.reset(FPDF_LoadPage(document, pageIndex));
+        }
+        if (!page) continue;
+        const int count = FPDFPage_GetAnnotCount(page.get());
+        for (int i = 0; i < count; i++) {
+            ScopedFPDFAnnotation annot(FPDFPage_GetAnnot(page.get(), i));
+            if (!annot) continue;
+            const int subtype = FPDFAnnot_GetSubtype(annot.get());
+            if (subtype == FPDF_ANNOT_POPUP || subtype == FPDF_ANNOT_WIDGET) continue;
+            records->push_back(AnnotRecord());
+            records->back().page = pageIndex;
+            records->back().subtype = subtype;
+            readRecord(annot.get(), &records->back());
+        }
+    }
+}
+
+static bool writeRecord(FPDF_PAGE page, const AnnotRecord &record) {
+    if (!FPDFAnnot_IsSupportedSubtype(record.subtype)) return false;
+    ScopedFPDFAnnotation annot(FPDFPage_CreateAnnot(page, record.subtype));
+    if (!annot) return false;
+
+    FPDFAnnot_SetRect(annot.get(), &record.rect);
+    // Always written: FPDFPage_CreateAnnot leaves out /F, which the
+    // annotation layer hides annotations through. A record without flags
+    // gets the print flag, like a committed ink stroke.
+    FPDFAnnot_SetFlags(annot.get(), record.flags != 0 ? record.flags : FPDF_ANNOT_FLAG_PRINT);
+    if (record.hasColor) {
+        FPDFAnnot_SetColor(annot.get(), FPDFANNOT_COLORTYPE_Color, record.color[0],
+                           record.color[1], record.color[2], record.color[3]);
+    }
+    // The annotation is new, so the quads are appended rather than set
+    for (size_t q = 0; q < record.attachmentPoints.size(); q++) {
+        FPDFAnnot_AppendAttachmentPoints(annot.get(), &record.attachmentPoints[q]);
+    }
+    for (size_t s = 0; s < record.inkList.size(); s++) {
+        const std::vector<FS_POINTF> &stroke = record.inkList[s];
+        if (!stroke.empty()) {
+            FPDFAnnot_AddInkStroke(annot.get(), stroke.data(), stroke.size());
+        }
+    }
+    if (!record.contents.empty()) {
+        std::vector<uint16_t> contents(record.contents);
+        contents.push_back(0);
+        FPDFAnnot_SetStringValue(annot.get(), kContentsKey, contents.data());
+    }
+    return true;
+}
+
+static void removeAnnots(FPDF_PAGE page) {
+    for (int i = FPDFPage_GetAnnotCount(page) - 1; i >= 0; i--) {
+        ScopedFPDFAnnotation annot(FPDFPage_GetAnnot(page, i));
+        if (annot && FPDFAnnot_GetSubtype(annot.get()) == FPDF_ANNOT_WIDGET) continue;
+        annot.reset();
+        FPDFPage_RemoveAnnot(page, i);
+    }
+}
+
+int writeAnnotRecords(FPDF_DOCUMENT document, const std::vector<AnnotRecord> &records,
+                      bool replace) {
+    // Grouped by page, keeping the order within a page
+    std::vector<size_t> order(records.size());
+    for (size_t i = 0; i < order.size(); i++) order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&records](size_t a, size_t b) {
+        return records[a].page < records[b].page;
+    });
+
+    const int pageCount = FPDF_GetPageCount(document);
+    int created = 0;
+    size_t next = 0;
+    while (next < order.size()) {
+        const int pageIndex = records[order[next]].page;
+        size_t end = next;
+        while (end < order.size() && records[order[end]].page == pageIndex) end++;
+
+        ScopedFPDFPage page;
+        if (pageIndex >= 0 && pageIndex < pageCount) {
+            StageTimer timer(kStagePageLoad);
+            page.reset(FPDF_LoadPage(document, pageIndex));
+        }
+        if (page) {
+            if (replace) removeAnnots(page.get());
+            for (size_t i = next; i < end; i++) {
+                if (writeRecord(page.get(), records[order[i]])) created++;
+            }
+        }
+        next = end;
+    }
+    return created;
+}
@@ -0,0 +1,124 @@
+#include "color_scheme.h"
+
+#include <algorithm>
+#include <utility>
+
+#include <public/fpdf_edit.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+bool schemeColors(ColorScheme scheme, SchemeColors *colors) {
+    switch (scheme) {
+        case kColorSchemeNight:
+            colors->background = 0xFF121212;
+            colors->colors.path_fill_color = 0xFF2C2C2C;
+            colors->colors.path_stroke_color = 0xFFB0B0B0;
+            colors->colors.text_fill_color = 0xFFE0E0E0;
+            colors->colors.text_stroke_color = 0xFFE0E0E0;
+            colors->renderFlags = 0;
+            return true;
+        case kColorSchemeSepia:
+            colors->background = 0xFFF4ECD8;
+            colors->colors.path_fill_color = 0xFFE6D8B8;
+            colors->colors.path_stroke_color = 0xFF5B4636;
+            colors->colors.text_fill_color = 0xFF5B4636;
+            colors->colors.text_stroke_color = 0xFF5B4636;
+            colors->renderFlags = 0;
+            return true;
+        case kColorSchemeHighContrast:
+            // Filled paths become outlines, otherwise a filled box behind
+            // the text would take the text color
+            colors->background = 0xFF000000;
+            colors->colors.path_fill_color = 0xFFFFFFFF;
+            colors->colors.path_stroke_color = 0xFFFFFFFF;
+            colors->colors.text_fill_color = 0xFFFFFF00;
+            colors->colors.text_stroke_color = 0xFFFFFF00;
+            colors->renderFlags = FPDF_CONVERT_FILL_TO_STROKE;
+            return true;
+        default:
+            return false;
+    }
+}
+
+void invertPixels(void *pixels, int count, int bytesPerPixel) {
+    // 16 bytes are a whole number of 4 byte pixels, so the pattern lines up
+    // with every pixel of a row. 3 byte pixels have no alpha to keep.
+    const uint8_t a = bytesPerPixel == 4 ? 0x00 : 0xFF;
+    const uint8_t pattern[16] = {0xFF, 0xFF, 0xFF, a, 0xFF, 0xFF, 0xFF, a,
+                                 0xFF, 0xFF, 0xFF, a, 0xFF, 0xFF, 0xFF, a};
+    uint8_t *p = static_cast<uint8_t *>(pixels);
+    const size_t n = (size_t) count * bytesPerPixel;
+    size_t i = 0;
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    const uint8x16_t mask = vld1q_u8(pattern);
+    for (; i + 16 <= n; i += 16) {
+        vst1q_u8(p + i, veorq_u8(vld1q_u8(p + i), mask));
+    }
+#elif defined(__SSE2__)
+    const __m128i mask = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pattern));
+    for (; i + 16 <= n; i += 16) {
+        __m128i *block = reinterpret_cast<__m128i *>(p + i);
+        _mm_storeu_si128(block, _mm_xor_si128(_mm_loadu_si128(block), mask));
+    }
+#endif
+    for (; i < n; i++) {
+        p[i] ^= pattern[i & 15];
+    }
+}
+
+void collectImageRects(FPDF_PAGE page, int startX, int startY, int sizeX, int sizeY,
+                       int width, int height, std::vector<DeviceRect> *rects) {
+    rects->clear();
+    const int count = FPDFPage_CountObjects(page);
+    for (int i = 0; i < count; i++) {
+        FPDF_PAGEOBJECT object = FPDFPage_GetObject(page, i);
+        if (FPDFPageObj_GetType(object) != FPDF_PAGEOBJ_IMAGE) continue;
+
+        float left, bottom, right, top;
+        if (!FPDFPageObj_GetBounds(object, &left, &bottom, &right, &top)) continue;
+
+        int x1, y1, x2, y2;
+        FPDF_PageToDevice(page, startX, startY, sizeX, sizeY, 0, left, bottom, &x1, &y1);
+        FPDF_PageToDevice(page, startX, startY, sizeX, sizeY, 0, right, top, &x2, &y2);
+
+        DeviceRect rect;
+        rect.left = std::max(0, std::min(x1, x2));
+        rect.top = std::max(0, std::min(y1, y2));
+        rect.right = std::min(width, std::max(x1, x2));
+        rect.bottom = std::min(height, std::max(y1, y2));
+        if (rect.left < rect.right && rect.top < rect.bottom) {
+            rects->push_back(rect);
+        }
+    }
+}
+
+void invertOutsideRects(void *pixels, int stride, int width, int height, int bytesPerPixel,
+                        const std::vector<DeviceRect> &keep) {
+    std::vector<std::pair<int, int> > spans;
+    for (int y = 0; y < height; y++) {
+        // Merged x ranges of the rects crossing this row, possibly overlapping
+        spans.clear();
+        for (size_t i = 0; i < keep.size(); i++) {
+            if (keep[i].top <= y && y < keep[i].bottom) {
+                spans.push_back(std::make_pair(keep[i].left, keep[i].right));
+            }
+        }
+        std::sort(spans.begin(), spans.end());
+
+        uint8_t *row = static_cast<uint8_t *>(pixels) + (size_t) y * stride;
+        int x = 0;
+        for (size_t i = 0; i < spans.size(); i++) {
+            if (spans[i].first > x) {
+                invertPixels(row + (size_t) x * bytesPerPixel, spans[i].first - x, bytesPerPixel);
+            }
+            x = std::max(x, spans[i].second);
+        }
+        if (x < width) {
+            invertPixels(row + (size_t) x * bytesPerPixel, width - x, bytesPerPixel);
+        }
+    }
+}
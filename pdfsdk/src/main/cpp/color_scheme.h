@@ -0,0 +1,53 @@
+#ifndef PDFVIEW_COLOR_SCHEME_H
+#define PDFVIEW_COLOR_SCHEME_H
+
+#include <stdint.h>
+#include <vector>
+
+#include <public/fpdfview.h>
+
+// Reading modes a page is rendered in. The values are the ordinals of the
+// Kotlin ColorScheme enum.
+enum ColorScheme {
+    kColorSchemeNone = 0,
+    kColorSchemeNight,
+    kColorSchemeSepia,
+    kColorSchemeHighContrast,
+    // Inverts the rendered page except its raster images, for documents
+    // whose colored vector art the flat schemes above would wash out
+    kColorSchemeInvert,
+    kColorSchemeCount
+};
+
+// How PDFium recolors a page for one of the flat schemes
+struct SchemeColors {
+    FPDF_DWORD background;  // ARGB, filled under the page content
+    FPDF_COLORSCHEME colors;
+    int renderFlags;        // Added to the FPDF_Render* flags
+};
+
+// False for the schemes that don't go through FPDF_COLORSCHEME
+bool schemeColors(ColorScheme scheme, SchemeColors *colors);
+
+// Flips the color channels of count pixels of 3 or 4 bytes, keeping the
+// alpha byte of the latter. Vectorized with NEON or SSE2 when available.
+void invertPixels(void *pixels, int count, int bytesPerPixel);
+
+struct DeviceRect {
+    int left;
+    int top;
+    int right;
+    int bottom;
+};
+
+// The device rects, clipped to width x height, covered by the top level
+// image objects of a page rendered at (startX, startY, sizeX, sizeY).
+// Images nested in form XObjects are not reported.
+void collectImageRects(FPDF_PAGE page, int startX, int startY, int sizeX, int sizeY,
+                       int width, int height, std::vector<DeviceRect> *rects);
+
+// Inverts every pixel of the image except those inside a keep rect
+void invertOutsideRects(void *pixels, int stride, int width, int height, int bytesPerPixel,
+                        const std::vector<DeviceRect> &keep);
+
+#endif //PDFVIEW_COLOR_SCHEME_H
@@ -0,0 +1,199 @@
+#include "document.h"
+#include "pdfsdk_log.h"
+#include "render_stats.h"
+
+#include <stdint.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include <hk_file.h>
+
+const char *describePdfError(unsigned long error) {
+    switch (error) {
+        case FPDF_ERR_SUCCESS:
+            return "Success";
+        case FPDF_ERR_FILE:
+            return "File not found or could not be opened";
+        case FPDF_ERR_FORMAT:
+            return "File not in PDF format or corrupted";
+        case FPDF_ERR_PASSWORD:
+            return "Password required or incorrect password";
+        case FPDF_ERR_SECURITY:
+            return "Unsupported security scheme";
+        case FPDF_ERR_PAGE:
+            return "Page not found or content error";
+        default:
+            return "Unknown error";
+    }
+}
+
+static int getBlock(void *param, unsigned long position, unsigned char *outBuffer,
+                    unsigned long size) {
+    StageTimer timer(kStageFileRead);
+    const int fd = (int) reinterpret_cast<intptr_t>(param);
+    const ssize_t readCount = pread(fd, outBuffer, size, position);
+    if (readCount < 0) {
+        LOGE("Cannot read from file descriptor.");
+        return 0;
+    }
+    countStat(kCounterBytesRead, readCount);
+    return 1;
+}
+
+std::unique_ptr<Document> Document::openFd(int fd, const char *password, unsigned long *error,
+                                           bool cachePageSizes) {
+    ssize_t fileLen = fd >= 0 ? fs_get_size_for_fd(fd) : -1;
+    if (fileLen <= 0) {
+        *error = FPDF_ERR_FILE;
+        return std::unique_ptr<Document>();
+    }
+
+    std::unique_ptr<Document> doc(new Document());
+    doc->fileAccess.m_FileLen = static_cast<unsigned long>(fileLen);
+    doc->fileAccess.m_GetBlock = &getBlock;
+    doc->fileAccess.m_Param = reinterpret_cast<void *>(intptr_t(fd));
+
+    FPDF_DOCUMENT handle;
+    {
+        StageTimer timer(kStageDocumentOpen);
+        handle = FPDF_LoadCustomDocument(&doc->fileAccess, password);
+    }
+    return finishOpen(std::move(doc), handle, cachePageSizes, error);
+}
+
+std::unique_ptr<Document> Document::openMemory(const void *data, size_t size,
+                                               const char *password, unsigned long *error,
+                                               bool cachePageSizes) {
+    std::unique_ptr<Document> doc(new Document());
+    FPDF_DOCUMENT handle;
+    {
+        StageTimer timer(kStageDocumentOpen);
+        handle = FPDF_LoadMemDocument64(data, size, password);
+    }
+    return finishOpen(std::move(doc), handle, cachePageSizes, error);
+}
+
+std::unique_ptr<Document> Document::finishOpen(std::unique_ptr<Document> doc,
+                                               FPDF_DOCUMENT handle, bool cachePageSizes,
+                                               unsigned long *error) {
+    if (handle == nullptr) {
+        *error = FPDF_GetLastError();
+        return std::unique_ptr<Document>();
+    }
+    doc->document.reset(handle);
+    doc->pages = std::max(0, FPDF_GetPageCount(handle));
+    if (cachePageSizes) {
+        std::vector<FS_SIZEF> sizes(doc->pages);
+        for (int i = 0; i < doc->pages; i++) doc->pageSize(i, &sizes[i]);
+        doc->pageSizes.swap(sizes);
+    }
+    *error = FPDF_ERR_SUCCESS;
+    return doc;
+}
+
+bool Document::pageSize(int pageIndex, FS_SIZEF *size) const {
+    if (pageIndex < 0 || pageIndex >= pages) return false;
+    if (!pageSizes.empty()) {
+        *size = pageSizes[pageIndex];
+        return true;
+    }
+    // A broken page reads as 0 x 0, as the cached table has it
+    if (!FPDF_GetPageSizeByIndexF(document.get(), pageIndex, size)) {
+        size->width = 0;
+        size->height = 0;
+    }
+    return true;
+}
+
+bool Document::cachedPageSize(int pageIndex, FS_SIZEF *size) const {
+    if (pageIndex < 0 || pageIndex >= (int) pageSizes.size()) return false;
+    *size = pageSizes[pageIndex];
+    return true;
+}
+
+std::unique_ptr<Page> Document::loadPage(int pageIndex) const {
+    FPDF_PAGE page;
+    {
+        StageTimer timer(kStagePageLoad);
+        page = FPDF_LoadPage(document.get(), pageIndex);
+    }
+    if (page == nullptr) return std::unique_ptr<Page>();
+    std::unique_ptr<Page> result(new Page(page, pageIndex));
+    if (formFill) formFill->attachPage(result.get());
+    return result;
+}
+
+FormFill *Document::enableForms() {
+    if (!formFill) {
+        formFill = FormFill::create(document.get());
+    }
+    return formFill.get();
+}
+
+OutlineTree *Document::outline() {
+    if (!outlineTree) {
+        outlineTree.reset(new OutlineTree(document.get()));
+    }
+    return outlineTree.get();
+}
+
+bool Document::isSourceFile(int fd) const {
+    if (fileAccess.m_GetBlock != &getBlock) return false;
+    const int sourceFd = (int) reinterpret_cast<intptr_t>(fileAccess.m_Param);
+    struct stat source;
+    struct stat target;
+    return fstat(sourceFd, &source) == 0 && fstat(fd, &target) == 0 &&
+           source.st_dev == target.st_dev && source.st_ino == target.st_ino;
+}
+
+int64_t Document::save(int fd, int flags, int version, SyncMode sync) {
+    // PDFium only commits the text of the focused field when it loses focus
+    if (formFill) formFill->killFocus();
+
+    // PDFium starts an incremental save with a copy of the original bytes,
+    // they are already in the source file
+    uint64_t skip = 0;
+    if (isSourceFile(fd)) {
+        if ((flags & FPDF_INCREMENTAL) == 0) {
+            LOGE("Only incremental saves can go to the file being read");
+            return -1;
+        }
+        skip = fileAccess.m_FileLen;
+    }
+
+    FdFileWriter writer(fd, skip);
+    bool saved = version != 0 ? FPDF_SaveWithVersion(document.get(), &writer, flags, version)
+                              : FPDF_SaveAsCopy(document.get(), &writer, flags);
+    if (!saved || writer.outputSize() < skip || !writer.finish(sync)) {
+        LOGE("Cannot save the document");
+        // Drops a partial append, the original document stays readable
+        if (skip > 0) fs_truncate_fd(fd, (off_t) skip);
+        return -1;
+    }
+    return (int64_t) writer.bytesWritten();
+}
+
+bool Document::snapshot(int flags, int version, SaveSnapshot *snapshot) {
+    // PDFium only commits the text of the focused field when it loses focus
+    if (formFill) formFill->killFocus();
+
+    snapshot->tail.clear();
+    snapshot->sourceFd = -1;
+    snapshot->sourceLength = 0;
+    if ((flags & FPDF_INCREMENTAL) != 0 && fileAccess.m_GetBlock == &getBlock) {
+        snapshot->sourceFd = (int) reinterpret_cast<intptr_t>(fileAccess.m_Param);
+        snapshot->sourceLength = fileAccess.m_FileLen;
+    }
+
+    SnapshotWriter writer(snapshot);
+    bool saved = version != 0 ? FPDF_SaveWithVersion(document.get(), &writer, flags, version)
+                              : FPDF_SaveAsCopy(document.get(), &writer, flags);
+    if (!saved || writer.failed() || writer.outputSize() < snapshot->sourceLength) {
+        LOGE("Cannot take a snapshot of the document");
+        snapshot->tail.clear();
+        return false;
+    }
+    return true;
+}
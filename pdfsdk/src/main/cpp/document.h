@@ -0,0 +1,148 @@
+#ifndef PDFVIEW_DOCUMENT_H
+#define PDFVIEW_DOCUMENT_H
+
+#include <stddef.h>
+#include <memory>
+#include <vector>
+
+#include <public/fpdfview.h>
+#include <public/cpp/fpdf_scopers.h>
+
+#include "file_writer.h"
+#include "form_fill.h"
+#include "outline_tree.h"
+#include "pdfium_library.h"
+#include "save_snapshot.h"
+
+// Readable message for an FPDF_GetLastError code
+const char *describePdfError(unsigned long error);
+
+class Page;
+
+/**
+ * An open PDF document and what the SDK caches per document. Holds a
+ * library reference, so PDFium stays initialized while any document is
+ * open. Free of JNI and Android types: the JNI adapter, the benchmarks and
+ * the command line tools all go through it.
+ *
+ * Like every PDFium object it is not thread-safe, callers serialize the
+ * calls on one document. The page count is the exception: it is read once
+ * at open, the SDK never adds or removes pages of an open document, so it
+ * can be queried without the lock. So can the page sizes of a document
+ * opened with cachePageSizes.
+ */
+class Document {
+public:
+    // Reads the document with pread on fd, which must stay open until the
+    // document is closed. cachePageSizes reads every page size at open, for
+    // viewers that lay out all pages anyway; it costs a page dictionary
+    // lookup per page. Returns NULL and sets error to the FPDF_ERR_* code
+    // if it can't be opened.
+    static std::unique_ptr<Document> openFd(int fd, const char *password,
+                                            unsigned long *error,
+                                            bool cachePageSizes = false);
+
+    // The data must outlive the document
+    static std::unique_ptr<Document> openMemory(const void *data, size_t size,
+                                                const char *password, unsigned long *error,
+                                                bool cachePageSizes = false);
+
+    FPDF_DOCUMENT get() const { return document.get(); }
+
+    int pageCount() const { return pages; }
+
+    // Page size in points without loading the page, false if out of range.
+    // Asks PDFium, under the caller's lock, unless the sizes are cached.
+    bool pageSize(int pageIndex, FS_SIZEF *size) const;
+
+    // The size cached at open, without the lock. False if out of range or
+    // the document wasn't opened with cachePageSizes.
+    bool cachedPageSize(int pageIndex, FS_SIZEF *size) const;
+
+    std::unique_ptr<Page> loadPage(int pageIndex) const;
+
+    // Built on first use
+    OutlineTree *outline();
+
+    // Creates the interactive form environment. Only pages loaded after it
+    // get their fields drawn and take input, so call it before loading
+    // pages. NULL if PDFium can't create it.
+    FormFill *enableForms();
+
+    // NULL until enableForms
+    FormFill *forms() const { return formFill.get(); }
+
+    // Saves into fd, which must be open for reading and writing, with
+    // FPDF_SaveAsCopy flags, or FPDF_SaveWithVersion if version isn't 0.
+    // An FPDF_INCREMENTAL save into the file the document was opened from
+    // only appends the changes after the original bytes; other saves
+    // rewrite fd from the start and can't target that file. The focused
+    // form field loses focus first, as for snapshot. Returns the bytes
+    // written, or -1.
+    int64_t save(int fd, int flags, int version, SyncMode sync);
+
+    // Takes what save would write, for writeSnapshot to write without the
+    // document. An FPDF_INCREMENTAL snapshot of a document read from a file
+    // refers to that file instead of holding a copy; PDFium still reads it
+    // through, but nothing is written or synced while the caller holds the
+    // document. The focused form field loses focus first, so the text being
+    // typed is in the snapshot. False if PDFium can't save it.
+    bool snapshot(int flags, int version, SaveSnapshot *snapshot);
+
+    // True if fd is the file openFd read the document from
+    bool isSourceFile(int fd) const;
+
+private:
+    Document() {}
+
+    Document(const Document &);
+
+    Document &operator=(const Document &);
+
+    static std::unique_ptr<Document> finishOpen(std::unique_ptr<Document> doc,
+                                                FPDF_DOCUMENT handle, bool cachePageSizes,
+                                                unsigned long *error);
+
+    // Declared first so the library outlives the handles below
+    PdfiumLibrary::Ref library;
+    FPDF_FILEACCESS fileAccess = {};
+    ScopedFPDFDocument document;
+    // Both set at open and read without the PDFium lock; pageSizes stays
+    // empty without cachePageSizes
+    int pages = 0;
+    std::vector<FS_SIZEF> pageSizes;
+    std::unique_ptr<OutlineTree> outlineTree;
+    // Last, exits before the document closes
+    std::unique_ptr<FormFill> formFill;
+};
+
+// A loaded page. Its document must stay open while the page is alive.
+class Page {
+public:
+    explicit Page(FPDF_PAGE page, int index) : page(page), pageIndex(index), formFill(NULL) {}
+
+    ~Page() {
+        if (formFill) formFill->detachPage(this);
+    }
+
+    FPDF_PAGE get() const { return page.get(); }
+
+    int index() const { return pageIndex; }
+
+    float width() const { return FPDF_GetPageWidthF(page.get()); }
+
+    float height() const { return FPDF_GetPageHeightF(page.get()); }
+
+    // The form environment the page is attached to, or NULL
+    FormFill *form() const { return formFill; }
+
+    // Set by FormFill
+    void setForm(FormFill *form) { formFill = form; }
+
+private:
+    ScopedFPDFPage page;
+    int pageIndex;
+    FormFill *formFill;
+};
+
+#endif //PDFVIEW_DOCUMENT_H
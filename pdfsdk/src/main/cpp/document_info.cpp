@@ -0,0 +1,149 @@
+#include "document_info.h"
+#include "document.h"
+
+#include <public/fpdf_catalog.h>
+#include <public/fpdf_doc.h>
+#include <public/fpdf_edit.h>
+#include <public/fpdf_ext.h>
+#include <public/fpdf_transformpage.h>
+#include <public/cpp/fpdf_scopers.h>
+
+const char *const kDocumentMetaTags[] = {
+        "Title", "Author", "Subject", "Keywords",
+        "Creator", "Producer", "CreationDate", "ModDate"
+};
+
+std::u16string getMetaText(FPDF_DOCUMENT document, const char *tag) {
+    unsigned long bytes = FPDF_GetMetaText(document, tag, nullptr, 0);
+    if (bytes <= 2) {
+        return std::u16string();
+    }
+    std::u16string text(bytes / 2, u'\0');
+    FPDF_GetMetaText(document, tag, &text[0], bytes);
+    text.resize(bytes / 2 - 1);
+    return text;
+}
+
+// One FPDF_GetPageLabel call for the usual short label. Returns the bytes
+// PDFium reported: 0 if the document has no /PageLabels, since with one
+// every page has a label (its page number when no range covers it).
+static unsigned long getPageLabel(FPDF_DOCUMENT document, int pageIndex,
+                                  std::u16string *label) {
+    char16_t buffer[64];
+    unsigned long bytes = FPDF_GetPageLabel(document, pageIndex, buffer, sizeof(buffer));
+    if (bytes <= 2) {
+        label->clear();
+    } else if (bytes <= sizeof(buffer)) {
+        label->assign(buffer, bytes / 2 - 1);
+    } else {
+        label->assign(bytes / 2, u'\0');
+        FPDF_GetPageLabel(document, pageIndex, &(*label)[0], bytes);
+        label->resize(bytes / 2 - 1);
+    }
+    return bytes;
+}
+
+static bool hasPageLabels(FPDF_DOCUMENT document) {
+    std::u16string label;
+    return FPDF_GetPageCount(document) > 0 && getPageLabel(document, 0, &label) > 0;
+}
+
+// Splits a label into a prefix and its trailing decimal number, if any.
+static bool splitLabel(const std::u16string &label, std::u16string *prefix, long *number) {
+    size_t digits = label.size();
+    while (digits > 0 && label[digits - 1] >= u'0' && label[digits - 1] <= u'9') {
+        digits--;
+    }
+    if (digits == label.size() || label.size() - digits > 9) {
+        return false;
+    }
+    *prefix = label.substr(0, digits);
+    *number = 0;
+    for (size_t i = digits; i < label.size(); i++) {
+        *number = *number * 10 + (label[i] - u'0');
+    }
+    return true;
+}
+
+static std::u16string toDecimal(long number) {
+    std::string digits = std::to_string(number);
+    return std::u16string(digits.begin(), digits.end());
+}
+
+void readPageLabels(FPDF_DOCUMENT document, PageLabels *labels) {
+    labels->starts.clear();
+    labels->labels.clear();
+    std::u16string prefix;
+    long number = 0;
+    bool numbered = false;
+    std::u16string label;
+    const int pageCount = FPDF_GetPageCount(document);
+    for (int i = 0; i < pageCount; i++) {
+        if (getPageLabel(document, i, &label) == 0) return;
+        if (numbered && label == prefix + toDecimal(number + 1)) {
+            number++;
+            continue;
+        }
+        numbered = splitLabel(label, &prefix, &number);
+        labels->starts.push_back(i);
+        labels->labels.push_back(label);
+    }
+}
+
+void readDocumentInfo(FPDF_DOCUMENT document, DocumentInfo *info) {
+    for (int i = 0; i < kDocumentMetaTagCount; i++) {
+        info->meta[i] = getMetaText(document, kDocumentMetaTags[i]);
+    }
+    info->pageCount = FPDF_GetPageCount(document);
+    if (!FPDF_GetFileVersion(document, &info->fileVersion)) {
+        info->fileVersion = 0;
+    }
+    info->permissions = FPDF_GetDocPermissions(document);
+    info->pageMode = FPDFDoc_GetPageMode(document);
+    info->tagged = FPDFCatalog_IsTagged(document) != 0;
+    info->hasPageLabels = hasPageLabels(document);
+}
+
+int pageSizeStride(int flags) {
+    return 2 + ((flags & kPageSizeRotation) ? 1 : 0) + ((flags & kPageSizeBoxes) ? 8 : 0);
+}
+
+void readPageSizes(const Document &document, int flags, std::vector<float> *out) {
+    int pageCount = document.pageCount();
+    int stride = pageSizeStride(flags);
+    out->assign((size_t) pageCount * stride, 0.0f);
+
+    for (int i = 0; i < pageCount; i++) {
+        float *record = out->data() + (size_t) i * stride;
+        FS_SIZEF size;
+        if (document.pageSize(i, &size)) {
+            record[0] = size.width;
+            record[1] = size.height;
+        }
+        if ((flags & (kPageSizeRotation | kPageSizeBoxes)) == 0) {
+            continue;
+        }
+
+        ScopedFPDFPage page(FPDF_LoadPage(document.get(), i));
+        if (!page) continue;
+        float *next = record + 2;
+        if (flags & kPageSizeRotation) {
+            *next++ = (float) FPDFPage_GetRotation(page.get());
+        }
+        if (flags & kPageSizeBoxes) {
+            // Missing boxes fall back to the page size, as PDFium does
+            if (!FPDFPage_GetCropBox(page.get(), &next[0], &next[1], &next[2], &next[3])) {
+                next[0] = 0;
+                next[1] = 0;
+                next[2] = record[0];
+                next[3] = record[1];
+            }
+            if (!FPDFPage_GetMediaBox(page.get(), &next[4], &next[5], &next[6], &next[7])) {
+                next[4] = 0;
+                next[5] = 0;
+                next[6] = record[0];
+                next[7] = record[1];
+            }
+        }
+    }
+}
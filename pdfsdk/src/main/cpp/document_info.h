@@ -0,0 +1,56 @@
+#ifndef PDFVIEW_DOCUMENT_INFO_H
+#define PDFVIEW_DOCUMENT_INFO_H
+
+#include <string>
+#include <vector>
+
+#include <public/fpdfview.h>
+
+class Document;
+
+// Info dictionary keys, in the order they are stored in DocumentInfo::meta
+extern const char *const kDocumentMetaTags[];
+const int kDocumentMetaTagCount = 8;
+
+struct DocumentInfo {
+    std::u16string meta[kDocumentMetaTagCount];
+    int pageCount = 0;
+    int fileVersion = 0;
+    unsigned long permissions = 0;
+    int pageMode = 0;
+    bool tagged = false;
+    // The catalog has a /PageLabels number tree, see readPageLabels
+    bool hasPageLabels = false;
+};
+
+// Page labels compressed into ranges: starts[i] is the first page of a range
+// and labels[i] its label. Following pages of the range continue the
+// trailing decimal number of that label.
+struct PageLabels {
+    std::vector<int> starts;
+    std::vector<std::u16string> labels;
+};
+
+std::u16string getMetaText(FPDF_DOCUMENT document, const char *tag);
+
+// Everything but the page labels: each of those takes a number tree lookup
+// per page, only their presence is checked
+void readDocumentInfo(FPDF_DOCUMENT document, DocumentInfo *info);
+
+// Reads the label of every page, nothing if the document has no labels
+void readPageLabels(FPDF_DOCUMENT document, PageLabels *labels);
+
+// Optional parts of the page size table. Both need the page to be loaded,
+// while plain sizes are read from the page dictionary only.
+const int kPageSizeRotation = 1;
+const int kPageSizeBoxes = 2;
+
+int pageSizeStride(int flags);
+
+// Fills out with one record per page: width, height in points, then the
+// rotation (0-3) and the crop and media boxes (left, bottom, right, top)
+// when requested by flags. Widths and heights come from the document's size
+// cache when it was opened with cachePageSizes.
+void readPageSizes(const Document &document, int flags, std::vector<float> *out);
+
+#endif //PDFVIEW_DOCUMENT_INFO_H
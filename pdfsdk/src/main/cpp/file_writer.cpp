@@ -0,0 +1,111 @@
+#include "file_writer.h"
+#include "pdfsdk_log.h"
+#include "render_stats.h"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include <hk_file.h>
+
+FdFileWriter::FdFileWriter(int fd, uint64_t skip, size_t bufferSize)
+        : fd(fd), skip(skip), produced(0), written(0), error(false), buffer(bufferSize),
+          buffered(0) {
+    version = 1;
+    WriteBlock = &writeBlockCallback;
+}
+
+int FdFileWriter::writeBlockCallback(FPDF_FILEWRITE *self, const void *data,
+                                     unsigned long size) {
+    return static_cast<FdFileWriter *>(self)->writeBlock(static_cast<const uint8_t *>(data),
+                                                         size) ? 1 : 0;
+}
+
+bool FdFileWriter::writeBlock(const uint8_t *data, size_t size) {
+    if (error) return false;
+
+    // Skipped output is already in the file
+    const uint64_t end = produced + size;
+    if (produced < skip) {
+        const size_t dropped = (size_t) std::min<uint64_t>(size, skip - produced);
+        const uint64_t headEnd = skip < kCheckedBytes ? skip : kCheckedBytes;
+        const uint64_t tailBegin = skip - headEnd;
+        if (!matchesFile(data, dropped, produced, 0, headEnd) ||
+            !matchesFile(data, dropped, produced, tailBegin, skip)) {
+            LOGE("The saved document doesn't start with the file, not appending");
+            error = true;
+            return false;
+        }
+        data += dropped;
+        size -= dropped;
+        produced += dropped;
+    }
+    if (size == 0) return true;
+
+    if (buffered + size > buffer.size()) {
+        if (!flush()) return false;
+    }
+    if (size >= buffer.size()) {
+        StageTimer timer(kStageFileWrite);
+        if (fs_pwrite_all(fd, data, size, (off_t) produced) != FS_SUCCESS) {
+            LOGE("Cannot write the document: %s", strerror(errno));
+            error = true;
+            return false;
+        }
+        written += size;
+        countStat(kCounterBytesWritten, size);
+    } else {
+        memcpy(buffer.data() + buffered, data, size);
+        buffered += size;
+    }
+    produced = end;
+    return true;
+}
+
+// Compares the part of [begin, end) covered by a block at offset
+bool FdFileWriter::matchesFile(const uint8_t *data, size_t size, uint64_t offset,
+                               uint64_t begin, uint64_t end) {
+    const uint64_t from = std::max(begin, offset);
+    const uint64_t to = std::min(end, offset + size);
+    if (from >= to) return true;
+    const size_t count = (size_t) (to - from);
+    fileData.resize(count);
+    return pread(fd, fileData.data(), count, (off_t) from) == (ssize_t) count &&
+           memcmp(fileData.data(), data + (from - offset), count) == 0;
+}
+
+bool FdFileWriter::flush() {
+    if (buffered == 0) return true;
+    StageTimer timer(kStageFileWrite);
+    // The buffer ends where the output produced so far does
+    if (fs_pwrite_all(fd, buffer.data(), buffered, (off_t) (produced - buffered)) != FS_SUCCESS) {
+        LOGE("Cannot write the document: %s", strerror(errno));
+        error = true;
+        return false;
+    }
+    written += buffered;
+    countStat(kCounterBytesWritten, buffered);
+    buffered = 0;
+    return true;
+}
+
+bool FdFileWriter::finish(SyncMode sync) {
+    if (error || !flush()) return false;
+    // A shorter document than the file held before leaves no stale tail
+    if (fs_truncate_fd(fd, (off_t) produced) != FS_SUCCESS) {
+        LOGE("Cannot truncate the document: %s", strerror(errno));
+        error = true;
+        return false;
+    }
+    if (sync != kSyncNone) {
+        StageTimer timer(kStageFileWrite);
+        if (fs_sync_fd(fd, sync == kSyncData) != FS_SUCCESS) {
+            LOGE("Cannot sync the document: %s", strerror(errno));
+            error = true;
+            return false;
+        }
+    }
+    return true;
+}
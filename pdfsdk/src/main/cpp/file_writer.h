@@ -0,0 +1,70 @@
+#ifndef PDFVIEW_FILE_WRITER_H
+#define PDFVIEW_FILE_WRITER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <vector>
+
+#include <public/fpdf_save.h>
+
+// How far a save is flushed to storage before it reports success
+enum SyncMode {
+    kSyncNone = 0,      // left to the kernel
+    kSyncData,          // fdatasync
+    kSyncFull,          // fsync
+};
+
+/**
+ * The FPDF_FILEWRITE PDFium saves through, writing to a file descriptor.
+ * PDFium hands out one small block per token; they are coalesced in a
+ * buffer and written with pwrite in large chunks, blocks larger than the
+ * buffer go straight through. The first skip bytes of the output are
+ * dropped rather than written, which turns an incremental save into an
+ * append to the file it was read from; as for SnapshotWriter, only the
+ * ones near both ends of that range are compared with the file. Not
+ * thread-safe.
+ */
+class FdFileWriter : public FPDF_FILEWRITE {
+public:
+    // Output byte skip lands at offset skip of fd
+    FdFileWriter(int fd, uint64_t skip, size_t bufferSize = kDefaultBufferSize);
+
+    // Writes what is buffered, then cuts the file at the end of the
+    // output and syncs it. False if any write failed.
+    bool finish(SyncMode sync);
+
+    bool failed() const { return error; }
+
+    // Bytes PDFium produced, skipped ones included
+    uint64_t outputSize() const { return produced; }
+
+    // Bytes that reached the file
+    uint64_t bytesWritten() const { return written; }
+
+    static const size_t kDefaultBufferSize = 1 << 20;
+
+    // Bytes compared at each end of the skipped range
+    static const size_t kCheckedBytes = 4096;
+
+private:
+    static int writeBlockCallback(FPDF_FILEWRITE *self, const void *data, unsigned long size);
+
+    bool writeBlock(const uint8_t *data, size_t size);
+
+    bool flush();
+
+    bool matchesFile(const uint8_t *data, size_t size, uint64_t offset, uint64_t begin,
+                     uint64_t end);
+
+    int fd;
+    uint64_t skip;
+    uint64_t produced;
+    uint64_t written;
+    bool error;
+    std::vector<uint8_t> buffer;
+    size_t buffered;
+    std::vector<uint8_t> fileData;
+};
+
+#endif //PDFVIEW_FILE_WRITER_H
@@ -0,0 +1,81 @@
+#include "flatten_job.h"
+#include "document.h"
+#include "pdfsdk_log.h"
+#include "render_stats.h"
+
+#include <public/fpdf_flatten.h>
+#include <public/fpdf_save.h>
+#include <public/fpdfview.h>
+#include <public/cpp/fpdf_scopers.h>
+
+// FLATTEN_SUCCESS or FLATTEN_NOTHINGTODO, FLATTEN_FAIL if the page can't
+// be loaded or flattened
+static int flattenPage(Document *doc, int pageIndex, int usage) {
+    // Not Document::loadPage: attaching the page to the form environment
+    // would run its open actions for nothing
+    ScopedFPDFPage page;
+    {
+        StageTimer timer(kStagePageLoad);
+        page.reset(FPDF_LoadPage(doc->get(), pageIndex));
+    }
+    if (!page) return FLATTEN_FAIL;
+    return FPDFPage_Flatten(page.get(), usage);
+}
+
+static bool flatten(Document *doc, const FlattenOptions &options, int outputFd, SyncMode sync,
+                    FlattenSink *sink, FlattenResult *result) {
+    int pageCount;
+    {
+        PdfiumLock lock(sink);
+        // Commits the text of a focused field to its appearance first
+        if (doc->forms() != NULL) doc->forms()->killFocus();
+        pageCount = doc->pageCount();
+    }
+
+    const int usage = options.forPrint ? FLAT_PRINT : FLAT_NORMALDISPLAY;
+    for (int i = 0; i < pageCount; i++) {
+        int flattened;
+        {
+            PdfiumLock lock(sink);
+            flattened = flattenPage(doc, i, usage);
+        }
+        if (flattened == FLATTEN_FAIL) {
+            LOGE("Cannot flatten page %d", i);
+            result->error = "Cannot flatten a page";
+            return false;
+        }
+        result->pages++;
+        if (flattened == FLATTEN_SUCCESS) result->flattenedPages++;
+        if (!sink->onPageFlattened(i, flattened == FLATTEN_SUCCESS)) {
+            result->cancelled = true;
+            return false;
+        }
+    }
+    // Appending nothing to the source file would only cost a sync, any
+    // other output needs the document written out
+    if (result->flattenedPages == 0 && doc->isSourceFile(outputFd)) return true;
+
+    PdfiumLock lock(sink);
+    const int64_t written = doc->save(outputFd, FPDF_INCREMENTAL, options.version, sync);
+    if (written < 0) {
+        result->error = "Cannot save the flattened document";
+        return false;
+    }
+    result->bytesWritten = (uint64_t) written;
+    return true;
+}
+
+bool flattenDocument(Document *doc, const FlattenOptions &options, int outputFd, SyncMode sync,
+                     FlattenSink *sink, FlattenResult *result) {
+    const int64_t start = statsNowNanos();
+    *result = FlattenResult();
+    bool flattened;
+    if (doc == NULL || outputFd < 0) {
+        result->error = "Nothing to flatten";
+        flattened = false;
+    } else {
+        flattened = flatten(doc, options, outputFd, sync, sink, result);
+    }
+    result->elapsedNanos = statsNowNanos() - start;
+    return flattened;
+}
@@ -0,0 +1,67 @@
+#ifndef PDFVIEW_FLATTEN_JOB_H
+#define PDFVIEW_FLATTEN_JOB_H
+
+#include <stdint.h>
+
+#include "file_writer.h"
+#include "pdfium_lock.h"
+
+class Document;
+
+struct FlattenOptions {
+    // Bake in what printing shows (FLAT_PRINT) instead of what the screen
+    // shows (FLAT_NORMALDISPLAY)
+    bool forPrint = false;
+    // FPDF_SaveWithVersion version for the save, 0 keeps the document's
+    int version = 0;
+};
+
+struct FlattenResult {
+    int pages = 0;
+    // Pages that had form fields or annotations to bake in
+    int flattenedPages = 0;
+    uint64_t bytesWritten = 0;
+    int64_t elapsedNanos = 0;
+    // Why the job failed, NULL if it didn't
+    const char *error = nullptr;
+    bool cancelled = false;
+
+    double pagesPerSecond() const {
+        return elapsedNanos > 0 ? pages * 1e9 / elapsedNanos : 0;
+    }
+};
+
+/**
+ * Serializes the job's PDFium calls and follows its progress. Every method
+ * runs on the thread of flattenDocument; onPageFlattened is called without
+ * the PDFium lock held.
+ */
+class FlattenSink : public PdfiumLockSink {
+public:
+    // Page pageIndex was processed, flattened if it had anything to bake
+    // in. False cancels the job before anything is saved.
+    virtual bool onPageFlattened(int pageIndex, bool flattened) = 0;
+};
+
+/**
+ * Bakes the form fields and annotations of every page of doc into its
+ * content with FPDFPage_Flatten, in page order, then saves the result
+ * incrementally into outputFd through Document::save, so saving into the
+ * file the document was opened from only appends the flattened pages.
+ * Each page is loaded on its own, outside the form environment, and closed
+ * right after, so memory stays at one page whatever the page count. The
+ * PDFium lock is taken per page and for the save, rendering interleaves
+ * with the job. The source file isn't touched if no page needed
+ * flattening; any other output always gets the whole document.
+ *
+ * The flattening happens in doc itself: once the job fails or is
+ * cancelled the pages done so far stay flattened in memory, unsaved.
+ * FPDFPage_Flatten rewrites the shared page dictionaries, so pages loaded
+ * before the job lose their annotations while keeping their old parsed
+ * content; reload them. Returns false with result->error set on failure,
+ * or with result->cancelled.
+ */
+bool flattenDocument(Document *doc, const FlattenOptions &options, int outputFd, SyncMode sync,
+                     FlattenSink *sink, FlattenResult *result);
+
+#endif //PDFVIEW_FLATTEN_JOB_H
@@ -0,0 +1,522 @@
+#include "font_index.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <map>
+
+static const uint32_t kIndexMagic = 0x58494650; // "PFIX"
+static const uint32_t kIndexVersion = 1;
+
+static const uint32_t kMaxFacesPerFile = 256;
+static const uint32_t kMaxTables = 256;
+static const uint32_t kMaxNameTableSize = 1 << 20;
+
+// Serialized layout: header, directory records, face records, then a pool
+// of NUL terminated strings. Every field is a native-endian uint32 (uint16
+// for weight and flags) and is read with memcpy, so the buffer needs no
+// particular alignment.
+struct IndexHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t faceCount;
+    uint32_t dirCount;
+    uint32_t dirsOffset;
+    uint32_t facesOffset;
+    uint32_t stringsOffset;
+    uint32_t totalSize;
+};
+
+struct DirRecord {
+    uint32_t pathOffset;
+    uint32_t pathLength;
+    uint32_t mtimeLow;
+    uint32_t mtimeHigh;
+    uint32_t mtimeNsec;
+};
+
+struct FaceRecord {
+    uint32_t familyOffset;
+    uint32_t familyLength;
+    uint32_t pathOffset;
+    uint32_t pathLength;
+    uint32_t faceIndex;
+    uint32_t faceOffset;
+    uint32_t codePages;
+    uint32_t fileSize;
+    uint16_t weight;
+    uint16_t flags;
+};
+
+static uint16_t readU16(const unsigned char *p) {
+    return (uint16_t) ((p[0] << 8) | p[1]);
+}
+
+static uint32_t readU32(const unsigned char *p) {
+    return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) | ((uint32_t) p[2] << 8) | p[3];
+}
+
+static uint32_t tag(const char *name) {
+    return readU32(reinterpret_cast<const unsigned char *>(name));
+}
+
+static bool readAt(int fd, void *buffer, size_t length, off_t offset) {
+    ssize_t read = pread(fd, buffer, length, offset);
+    return read >= 0 && (size_t) read == length;
+}
+
+static void appendUtf8(std::string *out, uint32_t c) {
+    if (c < 0x80) {
+        out->push_back((char) c);
+    } else if (c < 0x800) {
+        out->push_back((char) (0xC0 | (c >> 6)));
+        out->push_back((char) (0x80 | (c & 0x3F)));
+    } else if (c < 0x10000) {
+        out->push_back((char) (0xE0 | (c >> 12)));
+        out->push_back((char) (0x80 | ((c >> 6) & 0x3F)));
+        out->push_back((char) (0x80 | (c & 0x3F)));
+    } else {
+        out->push_back((char) (0xF0 | (c >> 18)));
+        out->push_back((char) (0x80 | ((c >> 12) & 0x3F)));
+        out->push_back((char) (0x80 | ((c >> 6) & 0x3F)));
+        out->push_back((char) (0x80 | (c & 0x3F)));
+    }
+}
+
+// Family name from the name table: the typographic family (16) if present,
+// otherwise the legacy family (1). Windows US English records win over
+// other Windows records, which win over Macintosh Roman ones.
+static std::string readFamilyName(const std::vector<unsigned char> &table) {
+    if (table.size() < 6) return std::string();
+    const unsigned char *p = table.data();
+    uint16_t count = readU16(p + 2);
+    uint16_t stringOffset = readU16(p + 4);
+
+    int bestScore = 0;
+    const unsigned char *best = nullptr;
+    uint16_t bestLength = 0;
+    bool bestUtf16 = false;
+    for (uint16_t i = 0; i < count; i++) {
+        size_t recordOffset = 6 + (size_t) i * 12;
+        if (recordOffset + 12 > table.size()) break;
+        const unsigned char *r = p + recordOffset;
+        uint16_t platform = readU16(r);
+        uint16_t encoding = readU16(r + 2);
+        uint16_t language = readU16(r + 4);
+        uint16_t nameId = readU16(r + 6);
+        uint16_t length = readU16(r + 8);
+        uint16_t offset = readU16(r + 10);
+        if (nameId != 1 && nameId != 16) continue;
+        if ((size_t) stringOffset + offset + length > table.size()) continue;
+
+        int score;
+        bool utf16;
+        if (platform == 3 && (encoding == 0 || encoding == 1 || encoding == 10)) {
+            score = language == 0x409 ? 3 : 2;
+            utf16 = true;
+        } else if (platform == 0) {
+            score = 2;
+            utf16 = true;
+        } else if (platform == 1 && encoding == 0) {
+            score = 1;
+            utf16 = false;
+        } else {
+            continue;
+        }
+        if (nameId == 16) score += 4;
+        if (score > bestScore) {
+            bestScore = score;
+            best = p + stringOffset + offset;
+            bestLength = length;
+            bestUtf16 = utf16;
+        }
+    }
+
+    std::string family;
+    if (best == nullptr) return family;
+    if (!bestUtf16) {
+        // Mac Roman; the printable ASCII half is all family names use
+        for (uint16_t i = 0; i < bestLength; i++) {
+            appendUtf8(&family, best[i]);
+        }
+        return family;
+    }
+    for (uint16_t i = 0; i + 1 < bestLength; i += 2) {
+        uint32_t c = readU16(best + i);
+        if (c >= 0xD800 && c < 0xDC00 && i + 3 < bestLength) {
+            uint32_t low = readU16(best + i + 2);
+            if (low >= 0xDC00 && low < 0xE000) {
+                c = 0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00);
+                i += 2;
+            }
+        }
+        appendUtf8(&family, c);
+    }
+    return family;
+}
+
+static bool readFace(int fd, uint32_t faceOffset, uint32_t fileSize, FontFace *face,
+                     std::string *family) {
+    unsigned char header[12];
+    if (!readAt(fd, header, sizeof(header), faceOffset)) return false;
+    uint32_t version = readU32(header);
+    if (version != 0x00010000 && version != tag("OTTO") && version != tag("true")) {
+        return false;
+    }
+    uint16_t numTables = std::min<uint32_t>(readU16(header + 4), kMaxTables);
+
+    std::vector<unsigned char> records(numTables * 16u);
+    if (!readAt(fd, records.data(), records.size(), faceOffset + 12)) return false;
+
+    uint32_t nameOffset = 0, nameLength = 0, os2Offset = 0, os2Length = 0;
+    for (uint16_t i = 0; i < numTables; i++) {
+        const unsigned char *r = records.data() + i * 16;
+        uint32_t tableTag = readU32(r);
+        uint32_t offset = readU32(r + 8);
+        uint32_t length = readU32(r + 12);
+        if (offset > fileSize || length > fileSize - offset) continue;
+        if (tableTag == tag("name")) {
+            nameOffset = offset;
+            nameLength = length;
+        } else if (tableTag == tag("OS/2")) {
+            os2Offset = offset;
+            os2Length = length;
+        }
+    }
+    if (nameLength == 0 || nameLength > kMaxNameTableSize) return false;
+
+    std::vector<unsigned char> name(nameLength);
+    if (!readAt(fd, name.data(), nameLength, nameOffset)) return false;
+    *family = readFamilyName(name);
+    if (family->empty()) return false;
+
+    face->faceOffset = faceOffset;
+    face->fileSize = fileSize;
+    face->weight = 400;
+    face->flags = 0;
+    face->codePages = 0;
+
+    unsigned char os2[86];
+    uint32_t os2Read = std::min<uint32_t>(os2Length, sizeof(os2));
+    if (os2Read >= 64 && readAt(fd, os2, os2Read, os2Offset)) {
+        uint16_t os2Version = readU16(os2);
+        uint16_t weight = readU16(os2 + 4);
+        if (weight >= 1 && weight <= 1000) face->weight = weight;
+        // sFamilyClass 1-5 and 7 are the serif classes
+        uint8_t familyClass = os2[30];
+        if ((familyClass >= 1 && familyClass <= 5) || familyClass == 7) {
+            face->flags |= kFontSerif;
+        }
+        // PANOSE bProportion 9 is monospaced
+        if (os2[35] == 9) face->flags |= kFontFixedPitch;
+        uint16_t selection = readU16(os2 + 62);
+        if (selection & 1) face->flags |= kFontItalic;
+        if (os2Version >= 1 && os2Read >= 86) {
+            face->codePages = readU32(os2 + 78);
+        }
+    }
+    return true;
+}
+
+bool readFontFaces(const char *path, std::vector<FontFace> *faces,
+                   std::vector<std::string> *families) {
+    int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    bool found = false;
+    struct stat st;
+    unsigned char header[12];
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size <= 0x7FFFFFFF &&
+        readAt(fd, header, sizeof(header), 0)) {
+        uint32_t fileSize = (uint32_t) st.st_size;
+        std::vector<uint32_t> offsets;
+        if (readU32(header) == tag("ttcf")) {
+            uint32_t numFonts = std::min(readU32(header + 8), kMaxFacesPerFile);
+            std::vector<unsigned char> table(numFonts * 4u);
+            if (readAt(fd, table.data(), table.size(), 12)) {
+                for (uint32_t i = 0; i < numFonts; i++) {
+                    offsets.push_back(readU32(table.data() + i * 4));
+                }
+            }
+        } else {
+            offsets.push_back(0);
+        }
+
+        for (uint32_t i = 0; i < offsets.size(); i++) {
+            FontFace face = FontFace();
+            std::string family;
+            if (offsets[i] >= fileSize || !readFace(fd, offsets[i], fileSize, &face, &family)) {
+                continue;
+            }
+            face.faceIndex = i;
+            faces->push_back(face);
+            families->push_back(family);
+            found = true;
+        }
+    }
+    close(fd);
+    return found;
+}
+
+static bool directoryTime(const std::string &dir, struct timespec *mtime) {
+    struct stat st;
+    if (stat(dir.c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) return false;
+    *mtime = st.st_mtim;
+    return true;
+}
+
+/**
+ * Builds the flat serialized form. Strings are deduplicated, so all faces
+ * of a collection share one path.
+ */
+class IndexWriter {
+public:
+    uint32_t addString(const std::string &s) {
+        std::map<std::string, uint32_t>::iterator it = offsets.find(s);
+        if (it != offsets.end()) return it->second;
+        uint32_t offset = (uint32_t) pool.size();
+        pool.insert(pool.end(), s.begin(), s.end());
+        pool.push_back('\0');
+        offsets[s] = offset;
+        return offset;
+    }
+
+    std::vector<DirRecord> dirs;
+    std::vector<FaceRecord> faces;
+    std::vector<char> pool;
+
+    void write(std::vector<char> *out) const {
+        IndexHeader header;
+        header.magic = kIndexMagic;
+        header.version = kIndexVersion;
+        header.faceCount = (uint32_t) faces.size();
+        header.dirCount = (uint32_t) dirs.size();
+        header.dirsOffset = sizeof(IndexHeader);
+        header.facesOffset = header.dirsOffset + (uint32_t) (dirs.size() * sizeof(DirRecord));
+        header.stringsOffset = header.facesOffset + (uint32_t) (faces.size() * sizeof(FaceRecord));
+        header.totalSize = header.stringsOffset + (uint32_t) pool.size();
+
+        out->resize(header.totalSize);
+        char *p = out->data();
+        memcpy(p, &header, sizeof(header));
+        if (!dirs.empty()) {
+            memcpy(p + header.dirsOffset, dirs.data(), dirs.size() * sizeof(DirRecord));
+        }
+        if (!faces.empty()) {
+            memcpy(p + header.facesOffset, faces.data(), faces.size() * sizeof(FaceRecord));
+        }
+        if (!pool.empty()) {
+            memcpy(p + header.stringsOffset, pool.data(), pool.size());
+        }
+    }
+
+private:
+    std::map<std::string, uint32_t> offsets;
+};
+
+FontIndex::~FontIndex() {
+    if (mapped && data != nullptr) {
+        munmap(const_cast<char *>(data), size);
+    }
+}
+
+std::shared_ptr<const FontIndex> FontIndex::scan(const std::vector<std::string> &dirs) {
+    IndexWriter writer;
+    for (size_t d = 0; d < dirs.size(); d++) {
+        // The time is taken before listing, so a font added while scanning
+        // makes the cache stale rather than silently missing
+        struct timespec mtime = {0, 0};
+        bool exists = directoryTime(dirs[d], &mtime);
+
+        DirRecord dir;
+        dir.pathOffset = writer.addString(dirs[d]);
+        dir.pathLength = (uint32_t) dirs[d].size();
+        dir.mtimeLow = (uint32_t) ((uint64_t) mtime.tv_sec & 0xFFFFFFFF);
+        dir.mtimeHigh = (uint32_t) ((uint64_t) mtime.tv_sec >> 32);
+        dir.mtimeNsec = (uint32_t) mtime.tv_nsec;
+        writer.dirs.push_back(dir);
+        if (!exists) continue;
+
+        DIR *listing = opendir(dirs[d].c_str());
+        if (listing == nullptr) continue;
+        std::vector<std::string> names;
+        while (struct dirent *entry = readdir(listing)) {
+            if (entry->d_name[0] == '.') continue;
+            names.push_back(entry->d_name);
+        }
+        closedir(listing);
+        // Directory order is arbitrary; sorting keeps the index reproducible
+        std::sort(names.begin(), names.end());
+
+        for (size_t n = 0; n < names.size(); n++) {
+            std::string path = dirs[d] + "/" + names[n];
+            std::vector<FontFace> faces;
+            std::vector<std::string> families;
+            if (!readFontFaces(path.c_str(), &faces, &families)) continue;
+
+            uint32_t pathOffset = writer.addString(path);
+            for (size_t i = 0; i < faces.size(); i++) {
+                FaceRecord r;
+                r.familyOffset = writer.addString(families[i]);
+                r.familyLength = (uint32_t) families[i].size();
+                r.pathOffset = pathOffset;
+                r.pathLength = (uint32_t) path.size();
+                r.faceIndex = faces[i].faceIndex;
+                r.faceOffset = faces[i].faceOffset;
+                r.codePages = faces[i].codePages;
+                r.fileSize = faces[i].fileSize;
+                r.weight = faces[i].weight;
+                r.flags = faces[i].flags;
+                writer.faces.push_back(r);
+            }
+        }
+    }
+
+    std::shared_ptr<FontIndex> index(new FontIndex());
+    writer.write(&index->storage);
+    if (!index->attach(index->storage.data(), index->storage.size())) {
+        return std::shared_ptr<const FontIndex>();
+    }
+    return index;
+}
+
+std::shared_ptr<const FontIndex> FontIndex::load(const std::string &cachePath,
+                                                 const std::vector<std::string> &dirs) {
+    int fd = ::open(cachePath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return std::shared_ptr<const FontIndex>();
+
+    struct stat st;
+    void *bytes = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size >= (off_t) sizeof(IndexHeader)) {
+        bytes = mmap(nullptr, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    if (bytes == MAP_FAILED) return std::shared_ptr<const FontIndex>();
+
+    std::shared_ptr<FontIndex> index(new FontIndex());
+    index->mapped = true;
+    index->data = static_cast<const char *>(bytes);
+    index->size = (size_t) st.st_size;
+    if (!index->attach(index->data, index->size) || !index->matchesDirectories(dirs)) {
+        return std::shared_ptr<const FontIndex>();
+    }
+    return index;
+}
+
+std::shared_ptr<const FontIndex> FontIndex::open(const std::string &cachePath,
+                                                 const std::vector<std::string> &dirs) {
+    std::shared_ptr<const FontIndex> index = load(cachePath, dirs);
+    if (index) return index;
+
+    index = scan(dirs);
+    if (index && !cachePath.empty()) {
+        index->save(cachePath);
+    }
+    return index;
+}
+
+bool FontIndex::save(const std::string &cachePath) const {
+    std::string tempPath = cachePath + ".tmp";
+    FILE *file = fopen(tempPath.c_str(), "wb");
+    if (file == nullptr) return false;
+    bool written = fwrite(data, 1, size, file) == size;
+    written = fclose(file) == 0 && written;
+    if (!written || rename(tempPath.c_str(), cachePath.c_str()) != 0) {
+        unlink(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+// Validates every offset once so the accessors can trust them
+bool FontIndex::attach(const char *bytes, size_t length) {
+    data = bytes;
+    size = length;
+    if (length < sizeof(IndexHeader)) return false;
+
+    IndexHeader header;
+    memcpy(&header, bytes, sizeof(header));
+    if (header.magic != kIndexMagic || header.version != kIndexVersion ||
+        header.totalSize != length || header.stringsOffset > length ||
+        header.dirsOffset != sizeof(IndexHeader) ||
+        (uint64_t) header.dirCount * sizeof(DirRecord) !=
+        (uint64_t) header.facesOffset - header.dirsOffset ||
+        (uint64_t) header.faceCount * sizeof(FaceRecord) !=
+        (uint64_t) header.stringsOffset - header.facesOffset) {
+        return false;
+    }
+    // The pool must end with a terminator so every string is bounded
+    if (length > header.stringsOffset && bytes[length - 1] != '\0') return false;
+
+    uint32_t poolSize = header.totalSize - header.stringsOffset;
+    for (uint32_t i = 0; i < header.faceCount; i++) {
+        FaceRecord r;
+        memcpy(&r, bytes + header.facesOffset + i * sizeof(FaceRecord), sizeof(r));
+        if (r.familyOffset >= poolSize || r.familyLength >= poolSize - r.familyOffset ||
+            r.pathOffset >= poolSize || r.pathLength >= poolSize - r.pathOffset) {
+            return false;
+        }
+    }
+    for (uint32_t i = 0; i < header.dirCount; i++) {
+        DirRecord r;
+        memcpy(&r, bytes + header.dirsOffset + i * sizeof(DirRecord), sizeof(r));
+        if (r.pathOffset >= poolSize || r.pathLength >= poolSize - r.pathOffset) return false;
+    }
+    return true;
+}
+
+bool FontIndex::matchesDirectories(const std::vector<std::string> &dirs) const {
+    IndexHeader header;
+    memcpy(&header, data, sizeof(header));
+    if (header.dirCount != dirs.size()) return false;
+
+    const char *strings = data + header.stringsOffset;
+    for (uint32_t i = 0; i < header.dirCount; i++) {
+        DirRecord r;
+        memcpy(&r, data + header.dirsOffset + i * sizeof(DirRecord), sizeof(r));
+        if (dirs[i].size() != r.pathLength ||
+            memcmp(dirs[i].data(), strings + r.pathOffset, r.pathLength) != 0) {
+            return false;
+        }
+        struct timespec mtime = {0, 0};
+        directoryTime(dirs[i], &mtime);
+        uint64_t seconds = ((uint64_t) r.mtimeHigh << 32) | r.mtimeLow;
+        if ((uint64_t) mtime.tv_sec != seconds || (uint32_t) mtime.tv_nsec != r.mtimeNsec) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int FontIndex::faceCount() const {
+    IndexHeader header;
+    memcpy(&header, data, sizeof(header));
+    return (int) header.faceCount;
+}
+
+FontFace FontIndex::face(int index) const {
+    IndexHeader header;
+    memcpy(&header, data, sizeof(header));
+    FaceRecord r;
+    memcpy(&r, data + header.facesOffset + index * sizeof(FaceRecord), sizeof(r));
+
+    const char *strings = data + header.stringsOffset;
+    FontFace face;
+    face.family = strings + r.familyOffset;
+    face.familyLength = r.familyLength;
+    face.path = strings + r.pathOffset;
+    face.pathLength = r.pathLength;
+    face.faceIndex = r.faceIndex;
+    face.faceOffset = r.faceOffset;
+    face.codePages = r.codePages;
+    face.fileSize = r.fileSize;
+    face.weight = r.weight;
+    face.flags = r.flags;
+    return face;
+}
@@ -0,0 +1,89 @@
+#ifndef PDFVIEW_FONT_INDEX_H
+#define PDFVIEW_FONT_INDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Style bits of FontFace::flags
+static const uint32_t kFontItalic = 1;
+static const uint32_t kFontFixedPitch = 2;
+static const uint32_t kFontSerif = 4;
+
+// One face of an installed font file, pointing into the index storage
+struct FontFace {
+    const char *family;
+    size_t familyLength;
+    const char *path;
+    size_t pathLength;
+    // Face number inside a collection (.ttc/.otc), 0 for a plain font file
+    uint32_t faceIndex;
+    // Offset of the face's table directory in the file
+    uint32_t faceOffset;
+    // OS/2 ulCodePageRange1, 0 when the font doesn't declare it
+    uint32_t codePages;
+    uint32_t fileSize;
+    uint16_t weight;
+    uint16_t flags;
+};
+
+/**
+ * Compact index of the installed TrueType/OpenType faces: family, code
+ * pages, weight, style, path and face index. It is serialized to a cache
+ * file that later starts mmap instead of re-reading every font directory.
+ *
+ * The index lives in one flat buffer (heap after a scan, mmapped after a
+ * load) and is immutable, so it can be shared between threads.
+ */
+class FontIndex {
+public:
+    ~FontIndex();
+
+    // Loads the cache file if it was built from the same directories and
+    // none of them changed since; otherwise scans them and rewrites the
+    // cache. Returns NULL only if nothing could be scanned either.
+    static std::shared_ptr<const FontIndex> open(const std::string &cachePath,
+                                                 const std::vector<std::string> &dirs);
+
+    // Reads the name and OS/2 tables of every font file in the directories
+    static std::shared_ptr<const FontIndex> scan(const std::vector<std::string> &dirs);
+
+    // Maps the cache file, NULL if it is missing, corrupt or stale for dirs
+    static std::shared_ptr<const FontIndex> load(const std::string &cachePath,
+                                                 const std::vector<std::string> &dirs);
+
+    // Writes the index to a temporary file and renames it over cachePath
+    bool save(const std::string &cachePath) const;
+
+    int faceCount() const;
+
+    FontFace face(int index) const;
+
+    // True when the index was mapped from a cache file
+    bool isMapped() const { return mapped; }
+
+private:
+    FontIndex() {}
+
+    FontIndex(const FontIndex &);
+
+    FontIndex &operator=(const FontIndex &);
+
+    bool attach(const char *bytes, size_t length);
+
+    bool matchesDirectories(const std::vector<std::string> &dirs) const;
+
+    std::vector<char> storage;
+    const char *data = nullptr;
+    size_t size = 0;
+    bool mapped = false;
+};
+
+// Parses the faces of one font file, appending them to faces with empty
+// family and path pointers; exposed for tests.
+bool readFontFaces(const char *path, std::vector<FontFace> *faces,
+                   std::vector<std::string> *families);
+
+#endif //PDFVIEW_FONT_INDEX_H
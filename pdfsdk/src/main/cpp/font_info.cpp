@@ -0,0 +1,305 @@
+#include "font_info.h"
+
+#include <ctype.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <list>
+#include <mutex>
+#include <set>
+#include <string>
+#include <utility>
+
+static const size_t kMappedFileCacheSize = 8;
+
+// 'ttcf', PDFium's tag for the whole collection file
+static const unsigned int kTableTTCF = 0x74746366;
+
+// ulCodePageRange1 bit to Windows charset, as PDFium's FX_Charset uses them
+static const struct {
+    int bit;
+    int charset;
+} kCodePageCharsets[] = {
+        {0, FXFONT_ANSI_CHARSET},
+        {1, FXFONT_EASTERNEUROPEAN_CHARSET},
+        {2, FXFONT_CYRILLIC_CHARSET},
+        {3, 161},   // Greek
+        {4, 162},   // Turkish
+        {5, 177},   // Hebrew
+        {6, FXFONT_ARABIC_CHARSET},
+        {7, 186},   // Baltic
+        {8, 163},   // Vietnamese
+        {16, 222},  // Thai
+        {17, FXFONT_SHIFTJIS_CHARSET},
+        {18, FXFONT_GB2312_CHARSET},
+        {19, FXFONT_HANGEUL_CHARSET},
+        {20, FXFONT_CHINESEBIG5_CHARSET},
+        {31, FXFONT_SYMBOL_CHARSET},
+};
+
+int charsetsOfCodePages(uint32_t codePages, int *charsets, int capacity) {
+    int count = 0;
+    if (codePages == 0) {
+        if (capacity > 0) charsets[count++] = FXFONT_ANSI_CHARSET;
+        return count;
+    }
+    for (size_t i = 0; i < sizeof(kCodePageCharsets) / sizeof(kCodePageCharsets[0]); i++) {
+        if ((codePages & (1u << kCodePageCharsets[i].bit)) && count < capacity) {
+            charsets[count++] = kCodePageCharsets[i].charset;
+        }
+    }
+    return count;
+}
+
+static bool supportsCharset(uint32_t codePages, int charset) {
+    if (charset == FXFONT_DEFAULT_CHARSET) return true;
+    int charsets[32];
+    int count = charsetsOfCodePages(codePages, charsets, 32);
+    for (int i = 0; i < count; i++) {
+        if (charsets[i] == charset) return true;
+    }
+    return false;
+}
+
+class MappedFile {
+public:
+    MappedFile(const char *data, size_t size) : data(data), size(size) {}
+
+    ~MappedFile() { munmap(const_cast<char *>(data), size); }
+
+    static std::shared_ptr<MappedFile> open(const std::string &path) {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return std::shared_ptr<MappedFile>();
+        struct stat st;
+        void *bytes = MAP_FAILED;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            bytes = mmap(nullptr, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        }
+        close(fd);
+        if (bytes == MAP_FAILED) return std::shared_ptr<MappedFile>();
+        return std::make_shared<MappedFile>(static_cast<const char *>(bytes), (size_t) st.st_size);
+    }
+
+    const char *const data;
+    const size_t size;
+};
+
+// What MapFont/GetFont hand to PDFium as the opaque font handle
+struct FontHandle {
+    int face;
+    std::shared_ptr<MappedFile> file;
+};
+
+struct IndexedFontInfo : public FPDF_SYSFONTINFO {
+    std::shared_ptr<const FontIndex> index;
+    // Most recently used first; handles keep their own reference, so an
+    // evicted file stays mapped until its last face is deleted
+    std::list<std::pair<std::string, std::shared_ptr<MappedFile> > > files;
+    std::mutex filesLock;
+};
+
+static IndexedFontInfo *self(FPDF_SYSFONTINFO *info) {
+    return static_cast<IndexedFontInfo *>(info);
+}
+
+static std::shared_ptr<MappedFile> mapFile(IndexedFontInfo *info, const FontFace &face) {
+    std::string path(face.path, face.pathLength);
+    std::lock_guard<std::mutex> lock(info->filesLock);
+    for (auto it = info->files.begin(); it != info->files.end(); ++it) {
+        if (it->first == path) {
+            info->files.splice(info->files.begin(), info->files, it);
+            return it->second;
+        }
+    }
+    std::shared_ptr<MappedFile> file = MappedFile::open(path);
+    if (!file) return file;
+    info->files.push_front(std::make_pair(path, file));
+    if (info->files.size() > kMappedFileCacheSize) {
+        info->files.pop_back();
+    }
+    return file;
+}
+
+// Lower case letters and digits of a face name up to the style suffix:
+// "Arial,Bold" and "Arial Bold" give "arial", "ABCDEF+Roboto-Regular" gives
+// "roboto" once the subset tag is dropped.
+static std::string normalizeFamily(const char *name, size_t length, bool stopAtHyphen) {
+    const char *plus = static_cast<const char *>(memchr(name, '+', length));
+    if (plus != nullptr && plus - name == 6) {
+        length -= 7;
+        name = plus + 1;
+    }
+    std::string out;
+    for (size_t i = 0; i < length; i++) {
+        char c = name[i];
+        if (c == ',' || (stopAtHyphen && c == '-')) break;
+        if (isalnum((unsigned char) c)) out.push_back((char) tolower((unsigned char) c));
+    }
+    return out;
+}
+
+static int scoreFace(const FontFace &face, const std::string &family, const std::string &stem,
+                     int weight, bool italic, int charset, int pitchFamily) {
+    if (!supportsCharset(face.codePages, charset)) return -1;
+
+    int score = 1000;
+    std::string faceFamily = normalizeFamily(face.family, face.familyLength, false);
+    if (!family.empty() && faceFamily == family) {
+        score += 4000;
+    } else if (!stem.empty() && faceFamily == stem) {
+        score += 3000;
+    } else if (!stem.empty() && family.compare(0, faceFamily.size(), faceFamily) == 0) {
+        // "timesnewromanpsboldmt" still finds "timesnewroman"
+        score += 2000;
+    }
+
+    score -= abs((int) face.weight - weight) / 10;
+    if (((face.flags & kFontItalic) != 0) == italic) score += 50;
+    if ((pitchFamily & FXFONT_FF_FIXEDPITCH) && (face.flags & kFontFixedPitch)) score += 100;
+    if (((pitchFamily & FXFONT_FF_ROMAN) != 0) == ((face.flags & kFontSerif) != 0)) score += 60;
+    return score;
+}
+
+static int findFace(IndexedFontInfo *info, int weight, bool italic, int charset,
+                    int pitchFamily, const char *name) {
+    size_t nameLength = name != nullptr ? strlen(name) : 0;
+    std::string family = normalizeFamily(name != nullptr ? name : "", nameLength, false);
+    std::string stem = normalizeFamily(name != nullptr ? name : "", nameLength, true);
+
+    int best = -1;
+    int bestScore = -1;
+    int count = info->index->faceCount();
+    for (int i = 0; i < count; i++) {
+        int score = scoreFace(info->index->face(i), family, stem, weight, italic, charset,
+                              pitchFamily);
+        if (score > bestScore) {
+            best = i;
+            bestScore = score;
+        }
+    }
+    return best;
+}
+
+static void *openFace(IndexedFontInfo *info, int face) {
+    if (face < 0) return nullptr;
+    std::shared_ptr<MappedFile> file = mapFile(info, info->index->face(face));
+    if (!file) return nullptr;
+    FontHandle *handle = new FontHandle();
+    handle->face = face;
+    handle->file = file;
+    return handle;
+}
+
+static void indexedRelease(FPDF_SYSFONTINFO *info) {
+    delete self(info);
+}
+
+static void indexedEnumFonts(FPDF_SYSFONTINFO *info, void *mapper) {
+    const FontIndex *index = self(info)->index.get();
+    std::set<std::pair<std::string, int> > reported;
+    for (int i = 0; i < index->faceCount(); i++) {
+        FontFace face = index->face(i);
+        int charsets[32];
+        int count = charsetsOfCodePages(face.codePages, charsets, 32);
+        for (int c = 0; c < count; c++) {
+            if (reported.insert(std::make_pair(std::string(face.family), charsets[c])).second) {
+                FPDF_AddInstalledFont(mapper, face.family, charsets[c]);
+            }
+        }
+    }
+}
+
+static void *indexedMapFont(FPDF_SYSFONTINFO *info, int weight, FPDF_BOOL italic, int charset,
+                            int pitchFamily, const char *face, FPDF_BOOL *exact) {
+    if (exact != nullptr) *exact = 0;
+    return openFace(self(info), findFace(self(info), weight, italic != 0, charset, pitchFamily,
+                                         face));
+}
+
+static void *indexedGetFont(FPDF_SYSFONTINFO *info, const char *face) {
+    return openFace(self(info), findFace(self(info), FXFONT_FW_NORMAL, false,
+                                         FXFONT_DEFAULT_CHARSET, 0, face));
+}
+
+static unsigned long copyRange(const MappedFile &file, size_t offset, size_t length,
+                               unsigned char *buffer, unsigned long bufferSize) {
+    if (offset > file.size || length > file.size - offset) return 0;
+    if (buffer != nullptr && bufferSize >= length) {
+        memcpy(buffer, file.data + offset, length);
+    }
+    return (unsigned long) length;
+}
+
+static unsigned long indexedGetFontData(FPDF_SYSFONTINFO *info, void *font, unsigned int table,
+                                        unsigned char *buffer, unsigned long bufferSize) {
+    FontHandle *handle = static_cast<FontHandle *>(font);
+    const MappedFile &file = *handle->file;
+    FontFace face = self(info)->index->face(handle->face);
+    bool collection = file.size >= 4 && memcmp(file.data, "ttcf", 4) == 0;
+
+    if (table == kTableTTCF) {
+        return collection ? copyRange(file, 0, file.size, buffer, bufferSize) : 0;
+    }
+    if (table == 0) {
+        // For a collection PDFium takes the collection size minus this size
+        // as the face offset to find the face index, so report the bytes
+        // from the face's table directory to the end of the file
+        size_t offset = collection ? face.faceOffset : 0;
+        return copyRange(file, offset, file.size - offset, buffer, bufferSize);
+    }
+
+    const unsigned char *dir = reinterpret_cast<const unsigned char *>(file.data) + face.faceOffset;
+    if ((size_t) face.faceOffset + 12 > file.size) return 0;
+    size_t numTables = (size_t) ((dir[4] << 8) | dir[5]);
+    for (size_t i = 0; i < numTables; i++) {
+        size_t record = face.faceOffset + 12 + i * 16;
+        if (record + 16 > file.size) break;
+        const unsigned char *r = dir + 12 + i * 16;
+        unsigned int tableTag = ((unsigned int) r[0] << 24) | (r[1] << 16) | (r[2] << 8) | r[3];
+        if (tableTag != table) continue;
+        size_t offset = ((size_t) r[8] << 24) | (r[9] << 16) | (r[10] << 8) | r[11];
+        size_t length = ((size_t) r[12] << 24) | (r[13] << 16) | (r[14] << 8) | r[15];
+        return copyRange(file, offset, length, buffer, bufferSize);
+    }
+    return 0;
+}
+
+static unsigned long indexedGetFaceName(FPDF_SYSFONTINFO *info, void *font, char *buffer,
+                                        unsigned long bufferSize) {
+    FontFace face = self(info)->index->face(static_cast<FontHandle *>(font)->face);
+    unsigned long length = (unsigned long) face.familyLength + 1;
+    if (buffer != nullptr && bufferSize >= length) {
+        memcpy(buffer, face.family, length);
+    }
+    return length;
+}
+
+static int indexedGetFontCharset(FPDF_SYSFONTINFO *info, void *font) {
+    FontFace face = self(info)->index->face(static_cast<FontHandle *>(font)->face);
+    int charset = FXFONT_ANSI_CHARSET;
+    charsetsOfCodePages(face.codePages, &charset, 1);
+    return charset;
+}
+
+static void indexedDeleteFont(FPDF_SYSFONTINFO *, void *font) {
+    delete static_cast<FontHandle *>(font);
+}
+
+FPDF_SYSFONTINFO *newIndexedFontInfo(const std::shared_ptr<const FontIndex> &index) {
+    IndexedFontInfo *info = new IndexedFontInfo();
+    info->version = 1;
+    info->Release = indexedRelease;
+    info->EnumFonts = indexedEnumFonts;
+    info->MapFont = indexedMapFont;
+    info->GetFont = indexedGetFont;
+    info->GetFontData = indexedGetFontData;
+    info->GetFaceName = indexedGetFaceName;
+    info->GetFontCharset = indexedGetFontCharset;
+    info->DeleteFont = indexedDeleteFont;
+    info->index = index;
+    return info;
+}
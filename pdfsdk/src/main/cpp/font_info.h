@@ -0,0 +1,25 @@
+#ifndef PDFVIEW_FONT_INFO_H
+#define PDFVIEW_FONT_INFO_H
+
+#include <memory>
+
+#include <public/fpdf_sysfontinfo.h>
+
+#include "font_index.h"
+
+/**
+ * FPDF_SYSFONTINFO backed by a FontIndex. EnumFonts reports the indexed
+ * families without touching the font files, MapFont picks the closest
+ * face and GetFontData serves its tables from the mmapped font file. A few
+ * recently used files stay mapped so repeated lookups don't reopen them.
+ *
+ * Install with FPDF_SetSystemFontInfo; PDFium calls Release, which deletes
+ * the object.
+ */
+FPDF_SYSFONTINFO *newIndexedFontInfo(const std::shared_ptr<const FontIndex> &index);
+
+// FXFONT_*_CHARSET values covered by an OS/2 ulCodePageRange1 mask; fonts
+// declaring nothing are assumed to cover ANSI. Returns the count written.
+int charsetsOfCodePages(uint32_t codePages, int *charsets, int capacity);
+
+#endif //PDFVIEW_FONT_INFO_H
@@ -0,0 +1,205 @@
+#include "form_fill.h"
+#include "document.h"
+#include "pdfsdk_log.h"
+
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+
+// Light blue, the usual highlight of fillable fields
+static const unsigned long kFieldHighlightColor = 0xFFCCE0FF;
+static const unsigned char kFieldHighlightAlpha = 100;
+
+static void noopRelease(FPDF_FORMFILLINFO *) {}
+
+static void noopSetCursor(FPDF_FORMFILLINFO *, int) {}
+
+// The caret doesn't blink and no JavaScript runs, so timers are never needed
+static int noTimer(FPDF_FORMFILLINFO *, int, TimerCallback) {
+    return 0;
+}
+
+static void noopKillTimer(FPDF_FORMFILLINFO *, int) {}
+
+static FPDF_SYSTEMTIME localTime(FPDF_FORMFILLINFO *) {
+    time_t now = time(NULL);
+    struct tm local;
+    localtime_r(&now, &local);
+
+    FPDF_SYSTEMTIME result;
+    result.wYear = (unsigned short) (local.tm_year + 1900);
+    result.wMonth = (unsigned short) (local.tm_mon + 1);
+    result.wDayOfWeek = (unsigned short) local.tm_wday;
+    result.wDay = (unsigned short) local.tm_mday;
+    result.wHour = (unsigned short) local.tm_hour;
+    result.wMinute = (unsigned short) local.tm_min;
+    result.wSecond = (unsigned short) local.tm_sec;
+    result.wMilliseconds = 0;
+    return result;
+}
+
+static void noopOnChange(FPDF_FORMFILLINFO *) {}
+
+static int noRotation(FPDF_FORMFILLINFO *, FPDF_PAGE) {
+    return 0;
+}
+
+static void noopNamedAction(FPDF_FORMFILLINFO *, FPDF_BYTESTRING) {}
+
+static void noopTextFieldFocus(FPDF_FORMFILLINFO *, FPDF_WIDESTRING, FPDF_DWORD, FPDF_BOOL) {}
+
+// Link actions of form widgets are left to the app's own link handling
+static void noopUriAction(FPDF_FORMFILLINFO *, FPDF_BYTESTRING) {}
+
+static void noopGoToAction(FPDF_FORMFILLINFO *, int, int, float *, int) {}
+
+FormFill::FormFill() {
+    memset(&info, 0, sizeof(info));
+    info.version = 1;
+    info.owner = this;
+    info.Release = &noopRelease;
+    info.FFI_Invalidate = &FormFill::invalidate;
+    // Selected text inside a field is redrawn by FPDF_FFLDraw, the rect
+    // only says where
+    info.FFI_OutputSelectedRect = &FormFill::invalidate;
+    info.FFI_SetCursor = &noopSetCursor;
+    info.FFI_SetTimer = &noTimer;
+    info.FFI_KillTimer = &noopKillTimer;
+    info.FFI_GetLocalTime = &localTime;
+    info.FFI_OnChange = &noopOnChange;
+    info.FFI_GetPage = &FormFill::getPage;
+    info.FFI_GetCurrentPage = &FormFill::getCurrentPage;
+    info.FFI_GetRotation = &noRotation;
+    info.FFI_ExecuteNamedAction = &noopNamedAction;
+    info.FFI_SetTextFieldFocus = &noopTextFieldFocus;
+    info.FFI_DoURIAction = &noopUriAction;
+    info.FFI_DoGoToAction = &noopGoToAction;
+}
+
+std::unique_ptr<FormFill> FormFill::create(FPDF_DOCUMENT document) {
+    std::unique_ptr<FormFill> formFill(new FormFill());
+    formFill->form.reset(FPDFDOC_InitFormFillEnvironment(document, &formFill->info));
+    if (!formFill->form) {
+        LOGE("Cannot init the form fill environment");
+        return std::unique_ptr<FormFill>();
+    }
+    FPDF_SetFormFieldHighlightColor(formFill->form.get(), FPDF_FORMFIELD_UNKNOWN,
+                                    kFieldHighlightColor);
+    FPDF_SetFormFieldHighlightAlpha(formFill->form.get(), kFieldHighlightAlpha);
+    FORM_DoDocumentOpenAction(formFill->form.get());
+    return formFill;
+}
+
+FormFill::~FormFill() {
+    // Pages still open forget the environment, closing them later only
+    // closes the page
+    for (size_t i = 0; i < pages.size(); i++) {
+        FORM_OnBeforeClosePage(pages[i]->get(), form.get());
+        pages[i]->setForm(NULL);
+    }
+}
+
+void FormFill::attachPage(Page *page) {
+    pages.push_back(page);
+    page->setForm(this);
+    FORM_OnAfterLoadPage(page->get(), form.get());
+    FORM_DoPageAAction(page->get(), form.get(), FPDFPAGE_AACTION_OPEN);
+}
+
+void FormFill::detachPage(Page *page) {
+    std::vector<Page *>::iterator it = std::find(pages.begin(), pages.end(), page);
+    if (it == pages.end()) return;
+    FORM_DoPageAAction(page->get(), form.get(), FPDFPAGE_AACTION_CLOSE);
+    FORM_OnBeforeClosePage(page->get(), form.get());
+    pages.erase(it);
+    page->setForm(NULL);
+}
+
+bool FormFill::tap(Page *page, float x, float y) {
+    if (!FORM_OnLButtonDown(form.get(), page->get(), 0, x, y)) {
+        return false;
+    }
+    FORM_OnLButtonUp(form.get(), page->get(), 0, x, y);
+    return true;
+}
+
+bool FormFill::typeText(Page *page, const uint16_t *text, size_t length) {
+    bool handled = length > 0;
+    for (size_t i = 0; i < length; i++) {
+        handled = FORM_OnChar(form.get(), page->get(), text[i], 0) && handled;
+    }
+    return handled;
+}
+
+bool FormFill::pressKey(Page *page, int keyCode, int modifiers) {
+    bool handled = FORM_OnKeyDown(form.get(), page->get(), keyCode, modifiers) != 0;
+    FORM_OnKeyUp(form.get(), page->get(), keyCode, modifiers);
+    return handled;
+}
+
+void FormFill::killFocus() {
+    FORM_ForceToKillFocus(form.get());
+}
+
+void FormFill::takeDirtyRects(std::vector<DirtyRect> *rects) {
+    rects->swap(dirty);
+    dirty.clear();
+}
+
+void FormFill::invalidate(FPDF_FORMFILLINFO *info, FPDF_PAGE page,
+                          double left, double top, double right, double bottom) {
+    static_cast<Info *>(info)->owner->addDirty(page, left, top, right, bottom);
+}
+
+FPDF_PAGE FormFill::getPage(FPDF_FORMFILLINFO *info, FPDF_DOCUMENT, int index) {
+    const std::vector<Page *> &pages = static_cast<Info *>(info)->owner->pages;
+    for (size_t i = 0; i < pages.size(); i++) {
+        if (pages[i]->index() == index) return pages[i]->get();
+    }
+    return NULL;
+}
+
+FPDF_PAGE FormFill::getCurrentPage(FPDF_FORMFILLINFO *info, FPDF_DOCUMENT) {
+    const std::vector<Page *> &pages = static_cast<Info *>(info)->owner->pages;
+    return pages.empty() ? NULL : pages.back()->get();
+}
+
+void FormFill::addDirty(FPDF_PAGE page, double left, double top, double right,
+                        double bottom) {
+    int index = -1;
+    for (size_t i = 0; i < pages.size(); i++) {
+        if (pages[i]->get() == page) index = pages[i]->index();
+    }
+    if (index < 0) return;
+
+    // Through the render transform, so /Rotate and a crop box away from the
+    // origin land on the tiles that show the rect. kExtent device pixels
+    // keep the rounding well below a pixel of any tile.
+    static const int kExtent = 1 << 16;
+    int x1, y1, x2, y2;
+    FPDF_PageToDevice(page, 0, 0, kExtent, kExtent, 0, left, top, &x1, &y1);
+    FPDF_PageToDevice(page, 0, 0, kExtent, kExtent, 0, right, bottom, &x2, &y2);
+
+    DirtyRect rect;
+    rect.page = index;
+    rect.left = std::max(0.f, (float) std::min(x1, x2) / kExtent);
+    rect.right = std::min(1.f, (float) std::max(x1, x2) / kExtent);
+    rect.top = std::max(0.f, (float) std::min(y1, y2) / kExtent);
+    rect.bottom = std::min(1.f, (float) std::max(y1, y2) / kExtent);
+    if (rect.left >= rect.right || rect.top >= rect.bottom) return;
+
+    // A keystroke invalidates the same field several times, fold them
+    for (size_t i = 0; i < dirty.size(); i++) {
+        DirtyRect &other = dirty[i];
+        if (other.page == index && other.left <= rect.right && rect.left <= other.right &&
+            other.top <= rect.bottom && rect.top <= other.bottom) {
+            other.left = std::min(other.left, rect.left);
+            other.top = std::min(other.top, rect.top);
+            other.right = std::max(other.right, rect.right);
+            other.bottom = std::max(other.bottom, rect.bottom);
+            return;
+        }
+    }
+    dirty.push_back(rect);
+}
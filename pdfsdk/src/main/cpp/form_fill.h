@@ -0,0 +1,89 @@
+#ifndef PDFVIEW_FORM_FILL_H
+#define PDFVIEW_FORM_FILL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <vector>
+
+#include <public/fpdf_formfill.h>
+#include <public/cpp/fpdf_scopers.h>
+
+class Page;
+
+// Part of a page whose rendering changed, relative to the page size with
+// the origin at the top left, so it maps directly onto PagePart bounds
+struct DirtyRect {
+    int page;
+    float left;
+    float top;
+    float right;
+    float bottom;
+};
+
+/**
+ * The interactive form environment of a document. Forwards taps and key
+ * strokes to the focused field and records what PDFium invalidates, so
+ * callers repaint only those rects instead of the whole page.
+ *
+ * Pages loaded after the environment is created are attached to it by
+ * Document::loadPage. Not thread-safe, calls go under the PDFium lock.
+ */
+class FormFill {
+public:
+    // NULL if PDFium can't create the environment
+    static std::unique_ptr<FormFill> create(FPDF_DOCUMENT document);
+
+    ~FormFill();
+
+    FPDF_FORMHANDLE get() const { return form.get(); }
+
+    void attachPage(Page *page);
+
+    void detachPage(Page *page);
+
+    // Tap at a position in page coordinates, focusing or toggling the
+    // field under it. False if there is no field there.
+    bool tap(Page *page, float x, float y);
+
+    // Types UTF-16 text into the focused field
+    bool typeText(Page *page, const uint16_t *text, size_t length);
+
+    // An FWL_VKEY_* key press, for the keys that don't produce text
+    bool pressKey(Page *page, int keyCode, int modifiers);
+
+    // Commits the focused field and drops the focus
+    void killFocus();
+
+    // Moves the rects invalidated since the last call into rects, merging
+    // the overlapping ones of a page
+    void takeDirtyRects(std::vector<DirtyRect> *rects);
+
+private:
+    // PDFium hands the callbacks this struct back, hence the owner pointer
+    struct Info : FPDF_FORMFILLINFO {
+        FormFill *owner;
+    };
+
+    FormFill();
+
+    FormFill(const FormFill &);
+
+    FormFill &operator=(const FormFill &);
+
+    static void invalidate(FPDF_FORMFILLINFO *info, FPDF_PAGE page,
+                           double left, double top, double right, double bottom);
+
+    static FPDF_PAGE getPage(FPDF_FORMFILLINFO *info, FPDF_DOCUMENT document, int index);
+
+    static FPDF_PAGE getCurrentPage(FPDF_FORMFILLINFO *info, FPDF_DOCUMENT document);
+
+    void addDirty(FPDF_PAGE page, double left, double top, double right, double bottom);
+
+    Info info;
+    ScopedFPDFFormHandle form;
+    std::vector<Page *> pages;
+    std::vector<DirtyRect> dirty;
+};
+
+#endif //PDFVIEW_FORM_FILL_H
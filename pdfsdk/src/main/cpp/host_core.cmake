@@ -0,0 +1,40 @@
+# pdfsdk_core and hk_utils for host (Linux) builds, linked against a desktop
+# PDFium build, e.g. one of https://github.com/bblanchon/pdfium-binaries.
+# PDFIUM_ROOT/lib must hold a host libpdfium; headers default to the ones
+# the app builds with, they match the prebuilt library's revision.
+set(Sdk_DIR ${CMAKE_CURRENT_LIST_DIR})
+
+set(PDFIUM_ROOT "" CACHE PATH "Host PDFium build with include/ and lib/")
+if(PDFIUM_ROOT STREQUAL "")
+    message(FATAL_ERROR "Set PDFIUM_ROOT to a host PDFium build")
+endif()
+if(EXISTS ${PDFIUM_ROOT}/include/public)
+    set(Pdfium_INCLUDE_DIR ${PDFIUM_ROOT}/include)
+else()
+    set(Pdfium_INCLUDE_DIR ${Sdk_DIR}/pdfium/include)
+endif()
+find_library(Pdfium_LIBRARY NAMES pdfium PATHS ${PDFIUM_ROOT}/lib NO_DEFAULT_PATH)
+if(NOT Pdfium_LIBRARY)
+    message(FATAL_ERROR "No libpdfium in ${PDFIUM_ROOT}/lib")
+endif()
+
+include_directories(${Pdfium_INCLUDE_DIR})
+
+add_subdirectory(${Sdk_DIR}/utils ${CMAKE_CURRENT_BINARY_DIR}/utils)
+
+include(${Sdk_DIR}/pdfsdk_core.cmake)
+
+find_package(Threads REQUIRED)
+find_package(ZLIB REQUIRED)
+
+add_library(pdfsdk_core STATIC ${PDFSDK_CORE_SOURCES})
+target_include_directories(pdfsdk_core PUBLIC
+                           ${Sdk_DIR}
+                           ${Sdk_DIR}/utils
+                           ${Pdfium_INCLUDE_DIR}
+                           ${Pdfium_INCLUDE_DIR}/cpp)
+target_link_libraries(pdfsdk_core PUBLIC
+                      hk_utils
+                      ${Pdfium_LIBRARY}
+                      ZLIB::ZLIB
+                      Threads::Threads)
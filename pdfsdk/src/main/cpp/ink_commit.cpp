@@ -0,0 +1,93 @@
+#include "ink_engine.h"
+
+#include <math.h>
+
+#include <algorithm>
+
+#include <public/fpdf_annot.h>
+#include <public/fpdf_edit.h>
+#include <public/cpp/fpdf_scopers.h>
+
+// FPDF_DeviceToPage takes whole pixels, so the placement is scaled up to
+// keep the subpixel precision of touch input
+static const int kSubpixels = 16;
+
+static InkPoint toPage(FPDF_PAGE page, int startX, int startY, int sizeX, int sizeY,
+                       const InkPoint &point) {
+    double x = 0;
+    double y = 0;
+    FPDF_DeviceToPage(page, startX * kSubpixels, startY * kSubpixels, sizeX * kSubpixels,
+                      sizeY * kSubpixels, 0, (int) lroundf(point.x * kSubpixels),
+                      (int) lroundf(point.y * kSubpixels), &x, &y);
+    InkPoint result = {(float) x, (float) y};
+    return result;
+}
+
+// The stroke as the annotation's appearance, in page space like its rect
+static bool appendAppearance(FPDF_ANNOTATION annot, const std::vector<InkPoint> &points,
+                             uint32_t argb, float width) {
+    FPDF_PAGEOBJECT path = FPDFPageObj_CreateNewPath(points[0].x, points[0].y);
+    if (path == NULL) return false;
+    // A lone point still draws a round dot
+    FPDFPath_LineTo(path, points[0].x, points[0].y);
+    for (size_t i = 1; i < points.size(); i++) {
+        FPDFPath_LineTo(path, points[i].x, points[i].y);
+    }
+    FPDFPageObj_SetStrokeColor(path, (argb >> 16) & 0xFF, (argb >> 8) & 0xFF, argb & 0xFF,
+                               argb >> 24);
+    FPDFPageObj_SetStrokeWidth(path, width);
+    FPDFPageObj_SetLineCap(path, FPDF_LINECAP_ROUND);
+    FPDFPageObj_SetLineJoin(path, FPDF_LINEJOIN_ROUND);
+    FPDFPath_SetDrawMode(path, FPDF_FILLMODE_NONE, true);
+    if (!FPDFAnnot_AppendObject(annot, path)) {
+        FPDFPageObj_Destroy(path);
+        return false;
+    }
+    return true;
+}
+
+int commitInkStroke(FPDF_PAGE page, const InkStroke &stroke, int startX, int startY,
+                    int drawSizeHor, int drawSizeVer, float tolerance) {
+    if (stroke.path().empty() || drawSizeHor <= 0 || drawSizeVer <= 0) return -1;
+
+    std::vector<InkPoint> simplified;
+    simplifyPolyline(stroke.path(), tolerance, &simplified);
+    std::vector<FS_POINTF> points(simplified.size());
+    FS_RECTF rect = {INFINITY, -INFINITY, -INFINITY, INFINITY};
+    for (size_t i = 0; i < simplified.size(); i++) {
+        const InkPoint point = toPage(page, startX, startY, drawSizeHor, drawSizeVer,
+                                      simplified[i]);
+        points[i].x = point.x;
+        points[i].y = point.y;
+        simplified[i] = point;
+        rect.left = std::min(rect.left, point.x);
+        rect.right = std::max(rect.right, point.x);
+        rect.bottom = std::min(rect.bottom, point.y);
+        rect.top = std::max(rect.top, point.y);
+    }
+    const float width = stroke.width() * FPDF_GetPageWidthF(page) / drawSizeHor;
+    const float margin = width / 2 + 1;
+    rect.left -= margin;
+    rect.bottom -= margin;
+    rect.right += margin;
+    rect.top += margin;
+
+    ScopedFPDFAnnotation annot(FPDFPage_CreateAnnot(page, FPDF_ANNOT_INK));
+    if (!annot) return -1;
+    const uint32_t argb = stroke.color();
+    FPDFAnnot_SetRect(annot.get(), &rect);
+    FPDFAnnot_SetFlags(annot.get(), FPDF_ANNOT_FLAG_PRINT);
+    // PDFium only sets the color while there is no appearance stream
+    FPDFAnnot_SetColor(annot.get(), FPDFANNOT_COLORTYPE_Color, (argb >> 16) & 0xFF,
+                       (argb >> 8) & 0xFF, argb & 0xFF, argb >> 24);
+    FPDFAnnot_AddInkStroke(annot.get(), points.data(), points.size());
+
+    // Objects go into an existing appearance stream, so an empty one is
+    // set first. Without one PDFium draws the ink list 1pt wide.
+    static const FPDF_WCHAR kEmpty[] = {0};
+    if (!FPDFAnnot_SetAP(annot.get(), FPDF_ANNOT_APPEARANCEMODE_NORMAL, kEmpty) ||
+        !appendAppearance(annot.get(), simplified, argb, width)) {
+        FPDFAnnot_SetAP(annot.get(), FPDF_ANNOT_APPEARANCEMODE_NORMAL, NULL);
+    }
+    return FPDFPage_GetAnnotIndex(page, annot.get());
+}
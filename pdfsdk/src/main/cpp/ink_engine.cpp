@@ -0,0 +1,252 @@
+#include "ink_engine.h"
+
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+#include <utility>
+
+// Touch points closer than this to the previous one add nothing
+static const float kMinTouchDistance = 0.25f;
+// Length of the straight pieces a spline segment is drawn with
+static const float kSampleSpacing = 2.f;
+
+static float distanceSquared(const InkPoint &a, const InkPoint &b) {
+    const float dx = b.x - a.x;
+    const float dy = b.y - a.y;
+    return dx * dx + dy * dy;
+}
+
+// Squared distance of p to the segment a b
+static float segmentDistanceSquared(const InkPoint &p, const InkPoint &a, const InkPoint &b) {
+    const float dx = b.x - a.x;
+    const float dy = b.y - a.y;
+    const float lengthSquared = dx * dx + dy * dy;
+    float t = 0;
+    if (lengthSquared > 0) {
+        t = std::max(0.f, std::min(1.f, ((p.x - a.x) * dx + (p.y - a.y) * dy) / lengthSquared));
+    }
+    const InkPoint nearest = {a.x + t * dx, a.y + t * dy};
+    return distanceSquared(p, nearest);
+}
+
+void simplifyPolyline(const std::vector<InkPoint> &points, float tolerance,
+                      std::vector<InkPoint> *simplified) {
+    simplified->clear();
+    if (points.size() <= 2) {
+        simplified->assign(points.begin(), points.end());
+        return;
+    }
+
+    const float toleranceSquared = tolerance * tolerance;
+    std::vector<bool> keep(points.size(), false);
+    keep.front() = true;
+    keep.back() = true;
+    // Spans still to split, without recursion so long strokes can't
+    // exhaust the stack
+    std::vector<std::pair<size_t, size_t> > spans;
+    spans.push_back(std::make_pair((size_t) 0, points.size() - 1));
+    while (!spans.empty()) {
+        const size_t first = spans.back().first;
+        const size_t last = spans.back().second;
+        spans.pop_back();
+
+        float farthest = 0;
+        size_t split = first;
+        for (size_t i = first + 1; i < last; i++) {
+            const float d = segmentDistanceSquared(points[i], points[first], points[last]);
+            if (d > farthest) {
+                farthest = d;
+                split = i;
+            }
+        }
+        if (farthest > toleranceSquared) {
+            keep[split] = true;
+            spans.push_back(std::make_pair(first, split));
+            spans.push_back(std::make_pair(split, last));
+        }
+    }
+    for (size_t i = 0; i < points.size(); i++) {
+        if (keep[i]) simplified->push_back(points[i]);
+    }
+}
+
+InkStroke::InkStroke(uint32_t argb, float width)
+        : argb(argb), strokeWidth(std::max(width, 1.f)), settled(0), provisional() {}
+
+void InkStroke::fitSegment(size_t i, std::vector<InkPoint> *samples) const {
+    const InkPoint &p1 = touches[i];
+    const InkPoint &p2 = touches[i + 1];
+    const InkPoint &p0 = i > 0 ? touches[i - 1] : p1;
+    const InkPoint &p3 = i + 2 < touches.size() ? touches[i + 2] : p2;
+
+    const int steps = std::max(1, (int) ceilf(sqrtf(distanceSquared(p1, p2)) / kSampleSpacing));
+    for (int step = 1; step <= steps; step++) {
+        const float t = (float) step / steps;
+        const float t2 = t * t;
+        const float t3 = t2 * t;
+        // Uniform Catmull-Rom, passing through p1 at 0 and p2 at 1
+        InkPoint point;
+        point.x = 0.5f * (2 * p1.x + (p2.x - p0.x) * t +
+                          (2 * p0.x - 5 * p1.x + 4 * p2.x - p3.x) * t2 +
+                          (3 * p1.x - p0.x - 3 * p2.x + p3.x) * t3);
+        point.y = 0.5f * (2 * p1.y + (p2.y - p0.y) * t +
+                          (2 * p0.y - 5 * p1.y + 4 * p2.y - p3.y) * t2 +
+                          (3 * p1.y - p0.y - 3 * p2.y + p3.y) * t3);
+        samples->push_back(point);
+    }
+}
+
+static void growDirty(InkDirtyRect *dirty, int left, int top, int right, int bottom) {
+    if (left >= right || top >= bottom) return;
+    if (dirty->left >= dirty->right) {
+        dirty->left = left;
+        dirty->top = top;
+        dirty->right = right;
+        dirty->bottom = bottom;
+        return;
+    }
+    dirty->left = std::min(dirty->left, left);
+    dirty->top = std::min(dirty->top, top);
+    dirty->right = std::max(dirty->right, right);
+    dirty->bottom = std::max(dirty->bottom, bottom);
+}
+
+void InkStroke::drawPolyline(const std::vector<InkPoint> &samples, const RenderTarget &overlay,
+                             InkDirtyRect *dirty) const {
+    if (samples.empty() || overlay.format != kTileRgba8888) return;
+
+    const float alpha = (argb >> 24) / 255.f;
+    const float red = (argb >> 16) & 0xFF;
+    const float green = (argb >> 8) & 0xFF;
+    const float blue = argb & 0xFF;
+    const float radius = strokeWidth / 2;
+    const float reach = radius + 0.5f;
+
+    // A dot for a single point, else one capsule per piece. Pixels keep
+    // the highest coverage, so the overlapping ends of pieces and redrawn
+    // segments don't darken.
+    const size_t pieces = std::max((size_t) 1, samples.size() - 1);
+    for (size_t i = 0; i < pieces; i++) {
+        const InkPoint &a = samples[i];
+        const InkPoint &b = samples[std::min(i + 1, samples.size() - 1)];
+        const int left = std::max(0, (int) floorf(std::min(a.x, b.x) - reach));
+        const int top = std::max(0, (int) floorf(std::min(a.y, b.y) - reach));
+        const int right = std::min(overlay.width, (int) ceilf(std::max(a.x, b.x) + reach));
+        const int bottom = std::min(overlay.height, (int) ceilf(std::max(a.y, b.y) + reach));
+        growDirty(dirty, left, top, right, bottom);
+
+        for (int y = top; y < bottom; y++) {
+            uint8_t *row = static_cast<uint8_t *>(overlay.pixels) + (size_t) y * overlay.stride;
+            for (int x = left; x < right; x++) {
+                const InkPoint center = {x + 0.5f, y + 0.5f};
+                const float d2 = segmentDistanceSquared(center, a, b);
+                if (d2 >= reach * reach) continue;
+                const float coverage = std::min(1.f, reach - sqrtf(d2));
+                const int pixelAlpha = (int) (coverage * alpha * 255 + 0.5f);
+                uint8_t *pixel = row + x * 4;
+                if (pixelAlpha <= pixel[3]) continue;
+                // Android bitmaps are premultiplied
+                const float scale = pixelAlpha / 255.f;
+                pixel[0] = (uint8_t) (red * scale + 0.5f);
+                pixel[1] = (uint8_t) (green * scale + 0.5f);
+                pixel[2] = (uint8_t) (blue * scale + 0.5f);
+                pixel[3] = (uint8_t) pixelAlpha;
+            }
+        }
+    }
+}
+
+void InkStroke::saveUnderProvisional(const std::vector<InkPoint> &samples,
+                                     const RenderTarget &overlay) {
+    provisional = InkDirtyRect();
+    if (samples.empty() || overlay.format != kTileRgba8888) return;
+
+    // The pixels drawPolyline can touch
+    const float reach = strokeWidth / 2 + 0.5f;
+    float minX = samples[0].x, minY = samples[0].y, maxX = minX, maxY = minY;
+    for (size_t i = 1; i < samples.size(); i++) {
+        minX = std::min(minX, samples[i].x);
+        minY = std::min(minY, samples[i].y);
+        maxX = std::max(maxX, samples[i].x);
+        maxY = std::max(maxY, samples[i].y);
+    }
+    const int left = std::max(0, (int) floorf(minX - reach));
+    const int top = std::max(0, (int) floorf(minY - reach));
+    const int right = std::min(overlay.width, (int) ceilf(maxX + reach));
+    const int bottom = std::min(overlay.height, (int) ceilf(maxY + reach));
+    if (left >= right || top >= bottom) return;
+
+    const size_t rowBytes = (size_t) (right - left) * 4;
+    underProvisional.resize(rowBytes * (bottom - top));
+    for (int y = top; y < bottom; y++) {
+        memcpy(underProvisional.data() + (y - top) * rowBytes,
+               static_cast<const uint8_t *>(overlay.pixels) + (size_t) y * overlay.stride + left * 4,
+               rowBytes);
+    }
+    provisional.left = left;
+    provisional.top = top;
+    provisional.right = right;
+    provisional.bottom = bottom;
+}
+
+void InkStroke::restoreUnderProvisional(const RenderTarget &overlay, InkDirtyRect *dirty) {
+    const InkDirtyRect saved = provisional;
+    provisional = InkDirtyRect();
+    if (saved.left >= saved.right || saved.right > overlay.width ||
+        saved.bottom > overlay.height) {
+        return;
+    }
+    const size_t rowBytes = (size_t) (saved.right - saved.left) * 4;
+    for (int y = saved.top; y < saved.bottom; y++) {
+        memcpy(static_cast<uint8_t *>(overlay.pixels) + (size_t) y * overlay.stride + saved.left * 4,
+               underProvisional.data() + (y - saved.top) * rowBytes, rowBytes);
+    }
+    growDirty(dirty, saved.left, saved.top, saved.right, saved.bottom);
+}
+
+InkDirtyRect InkStroke::addPoints(const float *xy, size_t count, const RenderTarget &overlay) {
+    InkDirtyRect dirty = {0, 0, 0, 0};
+    const size_t before = touches.size();
+    for (size_t i = 0; i < count; i++) {
+        const InkPoint point = {xy[i * 2], xy[i * 2 + 1]};
+        if (!touches.empty() &&
+            distanceSquared(touches.back(), point) < kMinTouchDistance * kMinTouchDistance) {
+            continue;
+        }
+        touches.push_back(point);
+    }
+    if (touches.size() == before) return dirty;
+
+    if (fitted.empty()) {
+        fitted.push_back(touches[0]);
+    }
+    // The provisional segment's end tangent was a guess, its pixels go
+    restoreUnderProvisional(overlay, &dirty);
+    const size_t from = fitted.size() - 1;
+    // A segment settles once the point after its end is known
+    while (settled + 2 < touches.size()) {
+        fitSegment(settled++, &fitted);
+    }
+    scratch.assign(fitted.begin() + from, fitted.end());
+    drawPolyline(scratch, overlay, &dirty);
+    if (settled + 1 < touches.size()) {
+        scratch.assign(1, fitted.back());
+        fitSegment(settled, &scratch);
+        saveUnderProvisional(scratch, overlay);
+        drawPolyline(scratch, overlay, &dirty);
+    }
+    return dirty;
+}
+
+InkDirtyRect InkStroke::finish(const RenderTarget &overlay) {
+    InkDirtyRect dirty = {0, 0, 0, 0};
+    restoreUnderProvisional(overlay, &dirty);
+    if (settled + 1 < touches.size()) {
+        const size_t from = fitted.size() - 1;
+        fitSegment(settled++, &fitted);
+        scratch.assign(fitted.begin() + from, fitted.end());
+        drawPolyline(scratch, overlay, &dirty);
+    }
+    return dirty;
+}
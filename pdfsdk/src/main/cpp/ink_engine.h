@@ -0,0 +1,92 @@
+#ifndef PDFVIEW_INK_ENGINE_H
+#define PDFVIEW_INK_ENGINE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include <public/fpdfview.h>
+
+#include "render_core.h"
+
+struct InkPoint {
+    float x;
+    float y;
+};
+
+// Pixels an ink call drew, empty when left >= right
+struct InkDirtyRect {
+    int left;
+    int top;
+    int right;
+    int bottom;
+};
+
+// Ramer-Douglas-Peucker: the points of a polyline that keep it within
+// tolerance of the original, with both ends
+void simplifyPolyline(const std::vector<InkPoint> &points, float tolerance,
+                      std::vector<InkPoint> *simplified);
+
+/**
+ * A handwritten stroke being captured. Touch points come in batches, in
+ * pixels of an RGBA_8888 overlay laid over the page; the stroke is fitted
+ * with a Catmull-Rom spline through them and drawn antialiased into the
+ * overlay as it grows. The last spline segment is drawn as if the stroke
+ * ended there, after keeping a copy of the pixels it covers; they are put
+ * back when the next point comes and the segment is drawn again with its
+ * final shape. Free of PDFium and JNI, so input never waits on the
+ * rendering lock. Not thread-safe.
+ */
+class InkStroke {
+public:
+    // Color as Android's 0xAARRGGBB, width in overlay pixels
+    InkStroke(uint32_t argb, float width);
+
+    // Adds x, y pairs and draws the stroke up to the last one
+    InkDirtyRect addPoints(const float *xy, size_t count, const RenderTarget &overlay);
+
+    // Pen up: settles the last segment, or draws a dot for a tap
+    InkDirtyRect finish(const RenderTarget &overlay);
+
+    // The fitted stroke drawn so far, in overlay pixels
+    const std::vector<InkPoint> &path() const { return fitted; }
+
+    uint32_t color() const { return argb; }
+
+    float width() const { return strokeWidth; }
+
+private:
+    // Appends the spline from touch point i to i + 1 to the fitted path
+    // and draws it; the end tangent repeats the last point if there is
+    // no point after
+    void fitSegment(size_t i, std::vector<InkPoint> *samples) const;
+
+    void drawPolyline(const std::vector<InkPoint> &samples, const RenderTarget &overlay,
+                      InkDirtyRect *dirty) const;
+
+    // Copies the pixels the samples will cover before they are drawn
+    void saveUnderProvisional(const std::vector<InkPoint> &samples, const RenderTarget &overlay);
+
+    // Puts back the pixels of the last saveUnderProvisional
+    void restoreUnderProvisional(const RenderTarget &overlay, InkDirtyRect *dirty);
+
+    uint32_t argb;
+    float strokeWidth;
+    std::vector<InkPoint> touches;
+    std::vector<InkPoint> fitted;
+    // Touch segments already in fitted
+    size_t settled;
+    std::vector<InkPoint> scratch;
+    // Pixels under the provisional last segment, empty rect if none
+    InkDirtyRect provisional;
+    std::vector<uint8_t> underProvisional;
+};
+
+// Adds the stroke to the page as an /Ink annotation with an appearance
+// stream, without rendering anything. The overlay is placed like a tile of
+// TileRenderer::render. The fitted path is simplified to tolerance overlay
+// pixels. Returns the new annotation's index, or -1.
+int commitInkStroke(FPDF_PAGE page, const InkStroke &stroke, int startX, int startY,
+                    int drawSizeHor, int drawSizeVer, float tolerance);
+
+#endif //PDFVIEW_INK_ENGINE_H
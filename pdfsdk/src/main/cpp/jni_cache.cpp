@@ -0,0 +1,98 @@
+#include "jni_cache.h"
+#include "comm.h"
+
+#include <string.h>
+
+JniCache gJniCache = {};
+
+static jclass findGlobalClass(JNIEnv *env, const char *className) {
+    jclass localClass = env->FindClass(className);
+    if (localClass == NULL) {
+        LOGE("Unable to find class %s", className);
+        return NULL;
+    }
+    jclass globalClass = reinterpret_cast<jclass>(env->NewGlobalRef(localClass));
+    env->DeleteLocalRef(localClass);
+    return globalClass;
+}
+
+bool initJniCache(JNIEnv *env) {
+    JniCache &c = gJniCache;
+    if (env->GetJavaVM(&c.vm) != JNI_OK) return false;
+    c.objectClass = findGlobalClass(env, "java/lang/Object");
+    c.stringClass = findGlobalClass(env, "java/lang/String");
+    c.longClass = findGlobalClass(env, "java/lang/Long");
+    c.integerClass = findGlobalClass(env, "java/lang/Integer");
+    c.sizeClass = findGlobalClass(env, "com/hungknow/pdfsdk/models/Size");
+    c.illegalStateExceptionClass = findGlobalClass(env, "java/lang/IllegalStateException");
+    c.ioExceptionClass = findGlobalClass(env, "java/io/IOException");
+    c.bitmapClass = findGlobalClass(env, "android/graphics/Bitmap");
+    c.thumbnailListenerClass = findGlobalClass(env,
+                                               "com/hungknow/pdfsdk/listeners/OnThumbnailListener");
+    c.saveListenerClass = findGlobalClass(env, "com/hungknow/pdfsdk/listeners/OnSaveListener");
+    c.assemblyListenerClass = findGlobalClass(env,
+                                              "com/hungknow/pdfsdk/listeners/OnAssemblyListener");
+    c.printListenerClass = findGlobalClass(env, "com/hungknow/pdfsdk/listeners/OnPrintListener");
+    c.flattenListenerClass = findGlobalClass(env,
+                                             "com/hungknow/pdfsdk/listeners/OnFlattenListener");
+    if (c.objectClass == NULL || c.stringClass == NULL || c.longClass == NULL ||
+        c.integerClass == NULL || c.sizeClass == NULL ||
+        c.illegalStateExceptionClass == NULL || c.ioExceptionClass == NULL ||
+        c.bitmapClass == NULL || c.thumbnailListenerClass == NULL ||
+        c.saveListenerClass == NULL || c.assemblyListenerClass == NULL ||
+        c.printListenerClass == NULL || c.flattenListenerClass == NULL) {
+        return false;
+    }
+
+    jclass configClass = env->FindClass("android/graphics/Bitmap$Config");
+    if (configClass == NULL) return false;
+    jfieldID argb8888 = env->GetStaticFieldID(configClass, "ARGB_8888",
+                                              "Landroid/graphics/Bitmap$Config;");
+    jobject config = argb8888 != NULL ? env->GetStaticObjectField(configClass, argb8888) : NULL;
+    env->DeleteLocalRef(configClass);
+    if (config == NULL) return false;
+    c.argb8888Config = env->NewGlobalRef(config);
+    env->DeleteLocalRef(config);
+
+    c.longConstructor = env->GetMethodID(c.longClass, "<init>", "(J)V");
+    c.integerConstructor = env->GetMethodID(c.integerClass, "<init>", "(I)V");
+    c.sizeConstructor = env->GetMethodID(c.sizeClass, "<init>", "(II)V");
+    c.createBitmapMethod = env->GetStaticMethodID(
+            c.bitmapClass, "createBitmap",
+            "(IILandroid/graphics/Bitmap$Config;)Landroid/graphics/Bitmap;");
+    c.onThumbnailMethod = env->GetMethodID(c.thumbnailListenerClass, "onThumbnail",
+                                           "(ILandroid/graphics/Bitmap;Ljava/lang/String;)V");
+    c.onSaveProgressMethod = env->GetMethodID(c.saveListenerClass, "onSaveProgress", "(JJ)Z");
+    c.onSourceAssembledMethod = env->GetMethodID(c.assemblyListenerClass, "onSourceAssembled",
+                                                 "(II)Z");
+    c.onPageRenderedMethod = env->GetMethodID(c.printListenerClass, "onPageRendered", "(II)Z");
+    c.onPageFlattenedMethod = env->GetMethodID(c.flattenListenerClass, "onPageFlattened", "(IZ)Z");
+    return c.longConstructor != NULL && c.integerConstructor != NULL &&
+           c.sizeConstructor != NULL && c.createBitmapMethod != NULL &&
+           c.onThumbnailMethod != NULL && c.onSaveProgressMethod != NULL &&
+           c.onSourceAssembledMethod != NULL && c.onPageRenderedMethod != NULL &&
+           c.onPageFlattenedMethod != NULL;
+}
+
+void releaseJniCache(JNIEnv *env) {
+    JniCache &c = gJniCache;
+    jobject refs[] = {c.objectClass, c.stringClass, c.longClass, c.integerClass,
+                      c.sizeClass, c.illegalStateExceptionClass, c.ioExceptionClass,
+                      c.bitmapClass, c.argb8888Config, c.thumbnailListenerClass,
+                      c.saveListenerClass, c.assemblyListenerClass, c.printListenerClass,
+                      c.flattenListenerClass};
+    for (jobject ref : refs) {
+        if (ref != NULL) env->DeleteGlobalRef(ref);
+    }
+    gJniCache = JniCache();
+}
+
+jclass findCachedClass(const char *className) {
+    if (strcmp(className, "java/lang/IllegalStateException") == 0) {
+        return gJniCache.illegalStateExceptionClass;
+    }
+    if (strcmp(className, "java/io/IOException") == 0) {
+        return gJniCache.ioExceptionClass;
+    }
+    return NULL;
+}
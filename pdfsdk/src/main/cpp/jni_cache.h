@@ -0,0 +1,49 @@
+#ifndef PDFVIEW_JNI_CACHE_H
+#define PDFVIEW_JNI_CACHE_H
+
+#include <jni.h>
+
+/**
+ * Global references and IDs of every Java class the JNI layer touches,
+ * resolved once in JNI_OnLoad so hot paths never call FindClass or
+ * GetMethodID.
+ */
+struct JniCache {
+    JavaVM *vm;
+    jclass objectClass;
+    jclass stringClass;
+    jclass longClass;
+    jmethodID longConstructor;
+    jclass integerClass;
+    jmethodID integerConstructor;
+    jclass sizeClass;
+    jmethodID sizeConstructor;
+    jclass illegalStateExceptionClass;
+    jclass ioExceptionClass;
+    jclass bitmapClass;
+    // static Bitmap createBitmap(int, int, Bitmap.Config)
+    jmethodID createBitmapMethod;
+    // Bitmap.Config.ARGB_8888
+    jobject argb8888Config;
+    jclass thumbnailListenerClass;
+    jmethodID onThumbnailMethod;
+    jclass saveListenerClass;
+    jmethodID onSaveProgressMethod;
+    jclass assemblyListenerClass;
+    jmethodID onSourceAssembledMethod;
+    jclass printListenerClass;
+    jmethodID onPageRenderedMethod;
+    jclass flattenListenerClass;
+    jmethodID onPageFlattenedMethod;
+};
+
+extern JniCache gJniCache;
+
+bool initJniCache(JNIEnv *env);
+
+void releaseJniCache(JNIEnv *env);
+
+// Returns the cached class for a JNI class name, or NULL if it isn't cached.
+jclass findCachedClass(const char *className);
+
+#endif //PDFVIEW_JNI_CACHE_H
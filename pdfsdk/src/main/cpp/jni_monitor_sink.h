@@ -0,0 +1,54 @@
+#ifndef PDFVIEW_JNI_MONITOR_SINK_H
+#define PDFVIEW_JNI_MONITOR_SINK_H
+
+#include <stdarg.h>
+
+#include <jni.h>
+
+#include "pdfsdk_log.h"
+
+/**
+ * The Sink of a long native job driven from Java: takes the PdfiumSDK.lock
+ * monitor passed by the job around each of its PDFium steps and reports
+ * its progress to the Java listener, if any. Every call runs on the job's
+ * thread, the one env belongs to.
+ */
+template <class Sink>
+class JniMonitorSink : public Sink {
+public:
+    JniMonitorSink(JNIEnv *env, jobject lock, jobject listener)
+            : env(env), lock(lock), listener(listener) {}
+
+    void lockPdfium() override {
+        env->MonitorEnter(lock);
+    }
+
+    void unlockPdfium() override {
+        env->MonitorExit(lock);
+    }
+
+protected:
+    // Calls the listener's boolean progress method; a listener that throws
+    // cancels the job like one that returns false
+    bool notifyListener(const char *name, jmethodID method, ...) {
+        if (listener == NULL) return true;
+        va_list args;
+        va_start(args, method);
+        jboolean proceed = env->CallBooleanMethodV(listener, method, args);
+        va_end(args);
+        if (env->ExceptionCheck()) {
+            LOGE("%s threw, cancelling the job", name);
+            env->ExceptionDescribe();
+            env->ExceptionClear();
+            return false;
+        }
+        return proceed == JNI_TRUE;
+    }
+
+private:
+    JNIEnv *env;
+    jobject lock;
+    jobject listener;
+};
+
+#endif //PDFVIEW_JNI_MONITOR_SINK_H
@@ -0,0 +1,119 @@
+#include "outline_tree.h"
+
+#include <public/fpdf_doc.h>
+
+// Guards against cyclic or absurdly deep outlines in broken files
+static const int kMaxDepth = 64;
+
+OutlineTree::OutlineTree(FPDF_DOCUMENT document) : document(document) {
+    Node root = {};
+    root.bookmark = nullptr;
+    root.parent = -1;
+    root.pageIndex = -1;
+    root.hasChildren = FPDFBookmark_GetFirstChild(document, nullptr) != nullptr;
+    root.detailsLoaded = true;
+    nodes.push_back(root);
+}
+
+void OutlineTree::loadChildren(int node) {
+    if (nodes[node].childrenLoaded) return;
+    nodes[node].childrenLoaded = true;
+    nodes[node].firstChild = (int) nodes.size();
+
+    FPDF_BOOKMARK child = FPDFBookmark_GetFirstChild(document, nodes[node].bookmark);
+    int count = 0;
+    while (child != nullptr && ids.find(child) == ids.end()) {
+        Node entry = {};
+        entry.bookmark = child;
+        entry.parent = node;
+        entry.pageIndex = -1;
+        entry.hasChildren = FPDFBookmark_GetFirstChild(document, child) != nullptr;
+        ids[child] = (int) nodes.size();
+        nodes.push_back(entry);
+        count++;
+        child = FPDFBookmark_GetNextSibling(document, child);
+    }
+    nodes[node].childCount = count;
+}
+
+void OutlineTree::loadDetails(int node) {
+    Node &entry = nodes[node];
+    if (entry.detailsLoaded) return;
+    entry.detailsLoaded = true;
+
+    unsigned long bytes = FPDFBookmark_GetTitle(entry.bookmark, nullptr, 0);
+    if (bytes > 2) {
+        std::u16string title(bytes / 2, u'\0');
+        FPDFBookmark_GetTitle(entry.bookmark, &title[0], bytes);
+        entry.titleOffset = (uint32_t) titles.size();
+        entry.titleLength = (uint32_t) (bytes / 2 - 1);
+        titles.append(title, 0, entry.titleLength);
+    }
+
+    FPDF_DEST dest = FPDFBookmark_GetDest(document, entry.bookmark);
+    if (dest != nullptr) {
+        entry.pageIndex = FPDFDest_GetDestPageIndex(document, dest);
+    }
+}
+
+int OutlineTree::childCount(int node) {
+    if (!isValid(node)) return 0;
+    loadChildren(node);
+    return nodes[node].childCount;
+}
+
+void OutlineTree::getChildren(int node, int offset, int limit, std::vector<int> *out) {
+    int count = childCount(node);
+    if (offset < 0) offset = 0;
+    // Compared with what is left, offset + limit overflows for Int.MAX_VALUE
+    int end = limit < 0 || offset >= count || limit > count - offset ? count : offset + limit;
+    for (int i = offset; i < end; i++) {
+        out->push_back(nodes[node].firstChild + i);
+    }
+}
+
+std::u16string OutlineTree::title(int node) {
+    if (!isValid(node)) return std::u16string();
+    loadDetails(node);
+    return titles.substr(nodes[node].titleOffset, nodes[node].titleLength);
+}
+
+int OutlineTree::pageIndex(int node) {
+    if (!isValid(node)) return -1;
+    loadDetails(node);
+    return nodes[node].pageIndex;
+}
+
+bool OutlineTree::hasChildren(int node) const {
+    return isValid(node) && nodes[node].hasChildren;
+}
+
+bool OutlineTree::expandUntil(int node, FPDF_BOOKMARK target, int depth) {
+    if (depth > kMaxDepth || !nodes[node].hasChildren) return false;
+    loadChildren(node);
+    if (ids.find(target) != ids.end()) return true;
+
+    int first = nodes[node].firstChild;
+    int count = nodes[node].childCount;
+    for (int i = first; i < first + count; i++) {
+        if (expandUntil(i, target, depth + 1)) return true;
+    }
+    return false;
+}
+
+bool OutlineTree::find(const std::u16string &title, std::vector<int> *path) {
+    FPDF_BOOKMARK bookmark = FPDFBookmark_Find(document,
+                                               reinterpret_cast<FPDF_WIDESTRING>(title.c_str()));
+    if (bookmark == nullptr) return false;
+
+    if (ids.find(bookmark) == ids.end() && !expandUntil(kRoot, bookmark, 0)) {
+        return false;
+    }
+
+    std::vector<int> reversed;
+    for (int node = ids[bookmark]; node != kRoot; node = nodes[node].parent) {
+        reversed.push_back(node);
+    }
+    path->assign(reversed.rbegin(), reversed.rend());
+    return true;
+}
@@ -0,0 +1,72 @@
+#ifndef PDFVIEW_OUTLINE_TREE_H
+#define PDFVIEW_OUTLINE_TREE_H
+
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <public/fpdfview.h>
+
+/**
+ * Lazily loaded view of the document outline. Children of a node are read
+ * from PDFium only when the node is first expanded and are stored next to
+ * each other, so a node's children are addressed by a contiguous id range.
+ * Titles and destinations are only resolved for the entries actually
+ * requested and kept in one shared UTF-16 arena.
+ *
+ * Node 0 is the invisible root. Not thread-safe: callers hold the document
+ * lock, as for every other PDFium call.
+ */
+class OutlineTree {
+public:
+    static const int kRoot = 0;
+
+    explicit OutlineTree(FPDF_DOCUMENT document);
+
+    // Number of direct children of node, loading them if needed.
+    int childCount(int node);
+
+    // Appends the ids of the children of node in [offset, offset + limit).
+    void getChildren(int node, int offset, int limit, std::vector<int> *out);
+
+    std::u16string title(int node);
+
+    int pageIndex(int node);
+
+    bool hasChildren(int node) const;
+
+    // Looks up a bookmark with FPDFBookmark_Find and fills path with the ids
+    // from the top level down to the match, expanding the nodes in between.
+    // Returns false when nothing matches.
+    bool find(const std::u16string &title, std::vector<int> *path);
+
+private:
+    struct Node {
+        FPDF_BOOKMARK bookmark;
+        int parent;
+        int firstChild;
+        int childCount;
+        uint32_t titleOffset;
+        uint32_t titleLength;
+        int pageIndex;
+        bool hasChildren;
+        bool childrenLoaded;
+        bool detailsLoaded;
+    };
+
+    bool isValid(int node) const { return node >= 0 && node < (int) nodes.size(); }
+
+    void loadChildren(int node);
+
+    void loadDetails(int node);
+
+    bool expandUntil(int node, FPDF_BOOKMARK target, int depth);
+
+    FPDF_DOCUMENT document;
+    std::vector<Node> nodes;
+    std::u16string titles;
+    std::unordered_map<FPDF_BOOKMARK, int> ids;
+};
+
+#endif //PDFVIEW_OUTLINE_TREE_H
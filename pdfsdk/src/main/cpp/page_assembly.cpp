@@ -0,0 +1,137 @@
+#include "page_assembly.h"
+#include "document.h"
+#include "pdfium_library.h"
+#include "pdfsdk_log.h"
+#include "render_stats.h"
+
+#include <memory>
+
+#include <public/fpdf_edit.h>
+#include <public/fpdf_ppo.h>
+#include <public/fpdf_save.h>
+#include <public/cpp/fpdf_scopers.h>
+
+// Appends the pages of source to dest, after a blank page if padToOdd and
+// dest has an odd page count. On failure dest is left as it was and error
+// tells why.
+static bool importSource(FPDF_DOCUMENT dest, const AssemblySource &source, bool padToOdd,
+                         bool copyViewerPreferences, const char **error) {
+    unsigned long openError = FPDF_ERR_SUCCESS;
+    std::unique_ptr<Document> doc = Document::openFd(
+            source.fd, source.password.empty() ? nullptr : source.password.c_str(), &openError);
+    if (!doc) {
+        *error = describePdfError(openError);
+        return false;
+    }
+
+    const int before = FPDF_GetPageCount(dest);
+    if (padToOdd && before % 2 != 0) {
+        FS_SIZEF size;
+        FPDF_GetPageSizeByIndexF(dest, before - 1, &size);
+        FPDF_PAGE blank = FPDFPage_New(dest, before, size.width, size.height);
+        if (blank != nullptr) FPDF_ClosePage(blank);
+    }
+    if (!FPDF_ImportPages(dest, doc->get(),
+                          source.pageRange.empty() ? nullptr : source.pageRange.c_str(),
+                          FPDF_GetPageCount(dest))) {
+        // A failed import may have added some of the pages already
+        for (int i = FPDF_GetPageCount(dest) - 1; i >= before; i--) {
+            FPDFPage_Delete(dest, i);
+        }
+        *error = "Cannot import the pages, check the page range";
+        return false;
+    }
+    if (copyViewerPreferences) FPDF_CopyViewerPreferences(dest, doc->get());
+    return true;
+}
+
+static bool assemble(const std::vector<AssemblySource> &sources, const AssemblyOptions &options,
+                     int outputFd, SyncMode sync, AssemblySink *sink, AssemblyResult *result,
+                     ScopedFPDFDocument *output) {
+    {
+        PdfiumLock lock(sink);
+        output->reset(FPDF_CreateNewDocument());
+    }
+    if (!*output) {
+        result->error = "Cannot create the document";
+        return false;
+    }
+
+    bool viewerPreferences = options.copyViewerPreferences;
+    for (size_t i = 0; i < sources.size(); i++) {
+        const char *error = nullptr;
+        bool imported;
+        int pages;
+        {
+            PdfiumLock lock(sink);
+            imported = importSource(output->get(), sources[i], options.oddPageStarts,
+                                    viewerPreferences, &error);
+            pages = FPDF_GetPageCount(output->get());
+        }
+        if (imported) {
+            viewerPreferences = false;
+        } else if (options.skipBrokenSources) {
+            LOGI("Skipping source %d: %s", (int) i, error);
+            result->skippedSources.push_back((int) i);
+        } else {
+            LOGE("Cannot assemble source %d: %s", (int) i, error);
+            result->error = error;
+            return false;
+        }
+        if (!sink->onSourceAssembled((int) i, pages)) {
+            result->cancelled = true;
+            return false;
+        }
+    }
+
+    PdfiumLock lock(sink);
+    if (FPDF_GetPageCount(output->get()) == 0) {
+        result->error = "No page to assemble";
+        return false;
+    }
+    if (options.columns * options.rows > 1) {
+        FS_SIZEF size;
+        FPDF_GetPageSizeByIndexF(output->get(), 0, &size);
+        ScopedFPDFDocument sheets(FPDF_ImportNPagesToOne(
+                output->get(), options.sheetWidth > 0 ? options.sheetWidth : size.width,
+                options.sheetHeight > 0 ? options.sheetHeight : size.height,
+                (size_t) options.columns, (size_t) options.rows));
+        if (!sheets) {
+            result->error = "Cannot lay out the pages";
+            return false;
+        }
+        FPDF_CopyViewerPreferences(sheets.get(), output->get());
+        // The sheets hold copies, the merged pages can go before the save
+        output->reset(sheets.release());
+    }
+    result->pages = FPDF_GetPageCount(output->get());
+
+    FdFileWriter writer(outputFd, 0);
+    if (!FPDF_SaveAsCopy(output->get(), &writer, FPDF_NO_INCREMENTAL) || !writer.finish(sync)) {
+        result->error = "Cannot write the document";
+        return false;
+    }
+    result->bytesWritten = writer.bytesWritten();
+    return true;
+}
+
+bool assemblePages(const std::vector<AssemblySource> &sources, const AssemblyOptions &options,
+                   int outputFd, SyncMode sync, AssemblySink *sink, AssemblyResult *result) {
+    const int64_t start = statsNowNanos();
+    *result = AssemblyResult();
+    if (sources.empty() || options.columns < 1 || options.rows < 1 || outputFd < 0) {
+        result->error = "Nothing to assemble";
+        return false;
+    }
+
+    // Declared first so the library outlives the output
+    PdfiumLibrary::Ref library;
+    ScopedFPDFDocument output;
+    bool assembled = assemble(sources, options, outputFd, sync, sink, result, &output);
+    {
+        PdfiumLock lock(sink);
+        output.reset();
+    }
+    result->elapsedNanos = statsNowNanos() - start;
+    return assembled;
+}
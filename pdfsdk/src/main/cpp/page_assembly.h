@@ -0,0 +1,73 @@
+#ifndef PDFVIEW_PAGE_ASSEMBLY_H
+#define PDFVIEW_PAGE_ASSEMBLY_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "file_writer.h"
+#include "pdfium_lock.h"
+
+// A document whose pages go into the output
+struct AssemblySource {
+    // Read with pread, kept open by the caller
+    int fd = -1;
+    std::string password;
+    // FPDF_ImportPages syntax, 1-based ("1,3,5-7"); empty for all pages
+    std::string pageRange;
+};
+
+struct AssemblyOptions {
+    // Source pages per output sheet, 1 x 1 keeps the pages as they are
+    int columns = 1;
+    int rows = 1;
+    // Sheet size in points for n-up, 0 takes the size of the first page
+    float sheetWidth = 0;
+    float sheetHeight = 0;
+    // The output opens like the first source: page mode, print scaling...
+    bool copyViewerPreferences = true;
+    // Every source starts on an odd page, for duplex printing
+    bool oddPageStarts = false;
+    // A source that can't be opened or imported is left out instead of
+    // failing the job
+    bool skipBrokenSources = false;
+};
+
+struct AssemblyResult {
+    int pages = 0;
+    uint64_t bytesWritten = 0;
+    int64_t elapsedNanos = 0;
+    // Indexes of the sources left out by skipBrokenSources
+    std::vector<int> skippedSources;
+    // Why the job failed, NULL if it didn't
+    const char *error = nullptr;
+    bool cancelled = false;
+};
+
+/**
+ * Serializes the job's PDFium calls and follows its progress. Every method
+ * runs on the thread of assemblePages; onSourceAssembled is called without
+ * the PDFium lock held.
+ */
+class AssemblySink : public PdfiumLockSink {
+public:
+    // A source was imported (or skipped), pages is the output page count
+    // so far. False cancels the job before anything is written.
+    virtual bool onSourceAssembled(int index, int pages) = 0;
+};
+
+/**
+ * Builds a document from pages of the sources, in order, and saves it
+ * into outputFd (rewritten from the start). Merge is several whole
+ * sources, split one source and a range per job, n-up columns x rows.
+ * Sources are opened one at a time and closed once imported, and the
+ * output is streamed to the file through FdFileWriter, so memory holds the
+ * output's objects and one source, never a serialized copy. The PDFium
+ * lock is taken per source and for the final save, rendering interleaves
+ * with the job. Returns false with result->error set on failure, or with
+ * result->cancelled.
+ */
+bool assemblePages(const std::vector<AssemblySource> &sources, const AssemblyOptions &options,
+                   int outputFd, SyncMode sync, AssemblySink *sink, AssemblyResult *result);
+
+#endif //PDFVIEW_PAGE_ASSEMBLY_H
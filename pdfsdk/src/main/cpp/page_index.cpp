@@ -0,0 +1,242 @@
+#include "page_index.h"
+
+#include <math.h>
+#include <algorithm>
+
+#include <public/fpdf_annot.h>
+#include <public/fpdf_doc.h>
+#include <public/fpdf_text.h>
+
+static const int kMaxGridSide = 256;
+
+static bool isEmpty(const IndexRect &r) {
+    return r.right <= r.left && r.top <= r.bottom;
+}
+
+// Distance from the point to the box, 0 when the point is inside.
+static float distanceTo(const IndexRect &r, float x, float y) {
+    float dx = x < r.left ? r.left - x : (x > r.right ? x - r.right : 0);
+    float dy = y < r.bottom ? r.bottom - y : (y > r.top ? y - r.top : 0);
+    return dx > dy ? dx : dy;
+}
+
+void GridIndex::build(const std::vector<IndexRect> &items, const IndexRect &bounds) {
+    rects = items;
+    originX = bounds.left;
+    originY = bounds.bottom;
+
+    float width = std::max(bounds.right - bounds.left, 1.0f);
+    float height = std::max(bounds.top - bounds.bottom, 1.0f);
+
+    // Aim for about two boxes per cell, keeping cells roughly square
+    double cells = std::max<size_t>(1, rects.size() / 2);
+    cols = (int) ceil(sqrt(cells * width / height));
+    rows = (int) ceil(cells / cols);
+    cols = std::min(std::max(cols, 1), kMaxGridSide);
+    rows = std::min(std::max(rows, 1), kMaxGridSide);
+    cellWidth = width / cols;
+    cellHeight = height / rows;
+
+    // Counting pass, then fill pass into one packed array (CSR layout)
+    std::vector<uint32_t> counts(cols * rows + 1, 0);
+    for (size_t i = 0; i < rects.size(); i++) {
+        const IndexRect &r = rects[i];
+        if (isEmpty(r)) continue;
+        for (int cy = cellY(r.bottom); cy <= cellY(r.top); cy++) {
+            for (int cx = cellX(r.left); cx <= cellX(r.right); cx++) {
+                counts[cy * cols + cx + 1]++;
+            }
+        }
+    }
+    for (size_t i = 1; i < counts.size(); i++) {
+        counts[i] += counts[i - 1];
+    }
+    cellStart = counts;
+    cellItems.resize(cellStart.back());
+
+    for (size_t i = 0; i < rects.size(); i++) {
+        const IndexRect &r = rects[i];
+        if (isEmpty(r)) continue;
+        for (int cy = cellY(r.bottom); cy <= cellY(r.top); cy++) {
+            for (int cx = cellX(r.left); cx <= cellX(r.right); cx++) {
+                cellItems[counts[cy * cols + cx]++] = (uint32_t) i;
+            }
+        }
+    }
+}
+
+int GridIndex::cellX(float x) const {
+    int cx = (int) floorf((x - originX) / cellWidth);
+    return std::min(std::max(cx, 0), cols - 1);
+}
+
+int GridIndex::cellY(float y) const {
+    int cy = (int) floorf((y - originY) / cellHeight);
+    return std::min(std::max(cy, 0), rows - 1);
+}
+
+int GridIndex::hitTest(float x, float y, float xTolerance, float yTolerance) const {
+    if (rects.empty() || cellItems.empty()) return -1;
+
+    int best = -1;
+    float bestDistance = 0;
+    for (int cy = cellY(y - yTolerance); cy <= cellY(y + yTolerance); cy++) {
+        for (int cx = cellX(x - xTolerance); cx <= cellX(x + xTolerance); cx++) {
+            int cell = cy * cols + cx;
+            for (uint32_t i = cellStart[cell]; i < cellStart[cell + 1]; i++) {
+                int id = (int) cellItems[i];
+                const IndexRect &r = rects[id];
+                if (x < r.left - xTolerance || x > r.right + xTolerance ||
+                    y < r.bottom - yTolerance || y > r.top + yTolerance) {
+                    continue;
+                }
+                float d = distanceTo(r, x, y);
+                if (best < 0 || d < bestDistance || (d == bestDistance && id > best)) {
+                    best = id;
+                    bestDistance = d;
+                }
+            }
+        }
+    }
+    return best;
+}
+
+static void unionWith(IndexRect *bounds, const IndexRect &r) {
+    if (isEmpty(r)) return;
+    bounds->left = std::min(bounds->left, r.left);
+    bounds->bottom = std::min(bounds->bottom, r.bottom);
+    bounds->right = std::max(bounds->right, r.right);
+    bounds->top = std::max(bounds->top, r.top);
+}
+
+static IndexRect fromRectF(const FS_RECTF &r) {
+    IndexRect out;
+    out.left = std::min(r.left, r.right);
+    out.right = std::max(r.left, r.right);
+    out.bottom = std::min(r.bottom, r.top);
+    out.top = std::max(r.bottom, r.top);
+    return out;
+}
+
+PageIndex *PageIndex::build(FPDF_PAGE page, FPDF_TEXTPAGE textPage) {
+    if (page == nullptr) return nullptr;
+
+    IndexRect bounds = {0, 0, FPDF_GetPageWidthF(page), FPDF_GetPageHeightF(page)};
+
+    std::vector<IndexRect> charRects;
+    int charCount = textPage != nullptr ? FPDFText_CountChars(textPage) : 0;
+    charRects.reserve(charCount > 0 ? charCount : 0);
+    for (int i = 0; i < charCount; i++) {
+        double left = 0, right = 0, bottom = 0, top = 0;
+        IndexRect r = {0, 0, 0, 0};
+        if (FPDFText_GetCharBox(textPage, i, &left, &right, &bottom, &top)) {
+            r.left = (float) left;
+            r.right = (float) right;
+            r.bottom = (float) bottom;
+            r.top = (float) top;
+        }
+        charRects.push_back(r);
+        unionWith(&bounds, r);
+    }
+
+    std::vector<IndexRect> linkRects;
+    int startPos = 0;
+    FPDF_LINK link = nullptr;
+    while (FPDFLink_Enumerate(page, &startPos, &link)) {
+        FS_RECTF rect = {0, 0, 0, 0};
+        IndexRect r = {0, 0, 0, 0};
+        if (FPDFLink_GetAnnotRect(link, &rect)) {
+            r = fromRectF(rect);
+        }
+        linkRects.push_back(r);
+        unionWith(&bounds, r);
+    }
+
+    PageIndex *index = new PageIndex();
+
+    std::vector<IndexRect> annotRects;
+    int annotCount = FPDFPage_GetAnnotCount(page);
+    for (int i = 0; i < annotCount; i++) {
+        IndexRect r = {0, 0, 0, 0};
+        int subtype = FPDF_ANNOT_UNKNOWN;
+        FPDF_ANNOTATION annot = FPDFPage_GetAnnot(page, i);
+        if (annot != nullptr) {
+            FS_RECTF rect = {0, 0, 0, 0};
+            if (FPDFAnnot_GetRect(annot, &rect)) {
+                r = fromRectF(rect);
+            }
+            subtype = FPDFAnnot_GetSubtype(annot);
+            FPDFPage_CloseAnnot(annot);
+        }
+        annotRects.push_back(r);
+        index->annotSubtypes.push_back(subtype);
+        unionWith(&bounds, r);
+    }
+
+    index->chars.build(charRects, bounds);
+    index->links.build(linkRects, bounds);
+    index->annots.build(annotRects, bounds);
+    return index;
+}
+
+int PageIndex::charIndexAtPos(float x, float y, float xTolerance, float yTolerance) const {
+    return chars.hitTest(x, y, xTolerance, yTolerance);
+}
+
+int PageIndex::linkAtPos(float x, float y) const {
+    return links.hitTest(x, y, 0, 0);
+}
+
+int PageIndex::annotAtPos(float x, float y) const {
+    return annots.hitTest(x, y, 0, 0);
+}
+
+int PageIndex::annotSubtype(int annotIndex) const {
+    if (annotIndex < 0 || annotIndex >= (int) annotSubtypes.size()) {
+        return FPDF_ANNOT_UNKNOWN;
+    }
+    return annotSubtypes[annotIndex];
+}
+
+// Two boxes are on the same line when they overlap vertically by at least
+// half of the smaller height.
+static bool sameLine(const IndexRect &a, const IndexRect &b) {
+    float overlap = std::min(a.top, b.top) - std::max(a.bottom, b.bottom);
+    float minHeight = std::min(a.top - a.bottom, b.top - b.bottom);
+    return overlap > 0 && overlap * 2 >= minHeight;
+}
+
+int PageIndex::getCharRangeRects(int start, int count, std::vector<float> *out) const {
+    if (start < 0) start = 0;
+    // count may be INT_MAX for "to the end", start + count would overflow
+    const int end = start + std::min(count, countChars() - start);
+
+    int appended = 0;
+    bool hasLine = false;
+    IndexRect line = {0, 0, 0, 0};
+    for (int i = start; i < end; i++) {
+        const IndexRect &r = chars.rect(i);
+        if (isEmpty(r)) continue;
+        if (hasLine && sameLine(line, r) && r.left >= line.left) {
+            unionWith(&line, r);
+            continue;
+        }
+        if (hasLine) {
+            out->push_back(line.left);
+            out->push_back(line.top);
+            out->push_back(line.right);
+            out->push_back(line.bottom);
+            appended++;
+        }
+        line = r;
+        hasLine = true;
+    }
+    if (hasLine) {
+        out->push_back(line.left);
+        out->push_back(line.top);
+        out->push_back(line.right);
+        out->push_back(line.bottom);
+        appended++;
+    }
+    return appended;
+}
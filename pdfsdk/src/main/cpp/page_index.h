@@ -0,0 +1,87 @@
+#ifndef PDFVIEW_PAGE_INDEX_H
+#define PDFVIEW_PAGE_INDEX_H
+
+#include <stdint.h>
+#include <vector>
+
+#include <public/fpdfview.h>
+
+// Axis aligned box in PDF page space (y grows upwards).
+struct IndexRect {
+    float left;
+    float bottom;
+    float right;
+    float top;
+};
+
+/**
+ * Uniform grid over a set of boxes. Every cell keeps the ids of the boxes
+ * overlapping it in one packed array, so a point query only visits the
+ * handful of boxes sharing the cell with the point.
+ */
+class GridIndex {
+public:
+    void build(const std::vector<IndexRect> &rects, const IndexRect &bounds);
+
+    // Returns the id of the box closest to (x, y) within the tolerance, or -1.
+    // Boxes containing the point win; ties go to the higher id (top-most).
+    int hitTest(float x, float y, float xTolerance, float yTolerance) const;
+
+    size_t size() const { return rects.size(); }
+
+    const IndexRect &rect(int id) const { return rects[id]; }
+
+private:
+    int cellX(float x) const;
+
+    int cellY(float y) const;
+
+    std::vector<IndexRect> rects;
+    std::vector<uint32_t> cellStart;
+    std::vector<uint32_t> cellItems;
+    float originX = 0;
+    float originY = 0;
+    float cellWidth = 1;
+    float cellHeight = 1;
+    int cols = 0;
+    int rows = 0;
+};
+
+/**
+ * Immutable hit-testing index of one page: character boxes, link annotations
+ * and all other annotations. It is built once while the caller holds the
+ * document lock; afterwards queries only read native memory and never call
+ * into PDFium, so they are safe to run concurrently with rendering.
+ *
+ * All coordinates are in PDF page space. Link ids follow FPDFLink_Enumerate
+ * order and annotation ids follow FPDFPage_GetAnnot order.
+ */
+class PageIndex {
+public:
+    static PageIndex *build(FPDF_PAGE page, FPDF_TEXTPAGE textPage);
+
+    int charIndexAtPos(float x, float y, float xTolerance, float yTolerance) const;
+
+    int linkAtPos(float x, float y) const;
+
+    int annotAtPos(float x, float y) const;
+
+    int annotSubtype(int annotIndex) const;
+
+    int countChars() const { return (int) chars.size(); }
+
+    // Appends one box per text line touched by the character range
+    // [start, start + count) to out as left, top, right, bottom quadruples.
+    // Returns the number of boxes appended.
+    int getCharRangeRects(int start, int count, std::vector<float> *out) const;
+
+private:
+    PageIndex() {}
+
+    GridIndex chars;
+    GridIndex links;
+    GridIndex annots;
+    std::vector<int> annotSubtypes;
+};
+
+#endif //PDFVIEW_PAGE_INDEX_H
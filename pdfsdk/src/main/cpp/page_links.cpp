@@ -0,0 +1,86 @@
+#include "page_links.h"
+
+#include <public/fpdf_doc.h>
+#include <public/fpdf_text.h>
+#include <public/cpp/fpdf_scopers.h>
+
+static std::u16string getUriPath(FPDF_DOCUMENT document, FPDF_ACTION action) {
+    unsigned long length = FPDFAction_GetURIPath(document, action, nullptr, 0);
+    if (length <= 1) {
+        return std::u16string();
+    }
+
+    // The path is always 7-bit ASCII
+    std::string path(length, '\0');
+    FPDFAction_GetURIPath(document, action, &path[0], length);
+    return std::u16string(path.begin(), path.begin() + (length - 1));
+}
+
+static void extractAnnotLinks(FPDF_DOCUMENT document, FPDF_PAGE page,
+                              std::vector<PageLink> *out) {
+    int startPos = 0;
+    FPDF_LINK link = nullptr;
+    while (FPDFLink_Enumerate(page, &startPos, &link)) {
+        PageLink pageLink;
+        pageLink.rect = FS_RECTF();
+        pageLink.destPageIndex = -1;
+        FPDFLink_GetAnnotRect(link, &pageLink.rect);
+
+        FPDF_DEST dest = FPDFLink_GetDest(document, link);
+        FPDF_ACTION action = FPDFLink_GetAction(link);
+        if (dest == nullptr && action != nullptr &&
+            FPDFAction_GetType(action) == PDFACTION_GOTO) {
+            dest = FPDFAction_GetDest(document, action);
+        }
+        if (dest != nullptr) {
+            pageLink.destPageIndex = FPDFDest_GetDestPageIndex(document, dest);
+        } else if (action != nullptr && FPDFAction_GetType(action) == PDFACTION_URI) {
+            pageLink.uri = getUriPath(document, action);
+        }
+        out->push_back(pageLink);
+    }
+}
+
+static void extractWebLinks(FPDF_PAGE page, std::vector<PageLink> *out) {
+    ScopedFPDFTextPage textPage(FPDFText_LoadPage(page));
+    if (!textPage) return;
+    ScopedFPDFPageLink webLinks(FPDFLink_LoadWebLinks(textPage.get()));
+    if (!webLinks) return;
+
+    int count = FPDFLink_CountWebLinks(webLinks.get());
+    for (int i = 0; i < count; i++) {
+        int length = FPDFLink_GetURL(webLinks.get(), i, nullptr, 0);
+        std::u16string url;
+        if (length > 1) {
+            std::vector<unsigned short> buffer(length);
+            FPDFLink_GetURL(webLinks.get(), i, buffer.data(), length);
+            url.assign(buffer.begin(), buffer.begin() + (length - 1));
+        }
+
+        int rects = FPDFLink_CountRects(webLinks.get(), i);
+        for (int r = 0; r < rects; r++) {
+            double left, top, right, bottom;
+            if (!FPDFLink_GetRect(webLinks.get(), i, r, &left, &top, &right, &bottom)) {
+                continue;
+            }
+            PageLink pageLink;
+                pageLink.rect.left = (float) left;
+            pageLink.rect.top = (float) top;
+            pageLink.rect.right = (float) right;
+            pageLink.rect.bottom = (float) bottom;
+            pageLink.destPageIndex = -1;
+            pageLink.uri = url;
+            out->push_back(pageLink);
+        }
+    }
+}
+
+void extractPageLinks(FPDF_DOCUMENT document, FPDF_PAGE page, bool webLinks,
+                      std::vector<PageLink> *out) {
+    if (document == nullptr || page == nullptr) return;
+
+    extractAnnotLinks(document, page, out);
+    if (webLinks) {
+        extractWebLinks(page, out);
+    }
+}
@@ -0,0 +1,26 @@
+#ifndef PDFVIEW_PAGE_LINKS_H
+#define PDFVIEW_PAGE_LINKS_H
+
+#include <string>
+#include <vector>
+
+#include <public/fpdfview.h>
+
+struct PageLink {
+    // Link area in page coordinates
+    FS_RECTF rect;
+    // Target page for internal links, -1 otherwise
+    int destPageIndex;
+    // Target URI for external links, empty otherwise
+    std::u16string uri;
+};
+
+/**
+ * Append all links of a loaded page to out: link annotations first, in
+ * FPDFLink_Enumerate order, then (optionally) the web links detected in the
+ * page text, one entry per link rectangle.
+ */
+void extractPageLinks(FPDF_DOCUMENT document, FPDF_PAGE page, bool webLinks,
+                      std::vector<PageLink> *out);
+
+#endif //PDFVIEW_PAGE_LINKS_H
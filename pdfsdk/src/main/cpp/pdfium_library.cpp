@@ -0,0 +1,146 @@
+#include "pdfium_library.h"
+#include "font_info.h"
+#include "pdfsdk_log.h"
+
+#include <atomic>
+#include <mutex>
+
+#include <public/fpdf_ext.h>
+#include <public/fpdfview.h>
+
+static std::atomic<int> sReferenceCount(0);
+static std::mutex sLifecycleLock;
+static bool sPinned = false;
+static std::shared_ptr<const FontIndex> sFontIndex;
+
+static void unsupportedFeatureHandler(UNSUPPORT_INFO *, int type) {
+    const char *feature = "Unknown";
+    switch (type) {
+        case FPDF_UNSP_DOC_XFAFORM:
+            feature = "XFA";
+            break;
+        case FPDF_UNSP_DOC_PORTABLECOLLECTION:
+            feature = "Portfolios_Packages";
+            break;
+        case FPDF_UNSP_DOC_ATTACHMENT:
+        case FPDF_UNSP_ANNOT_ATTACHMENT:
+            feature = "Attachment";
+            break;
+        case FPDF_UNSP_DOC_SECURITY:
+            feature = "Rights_Management";
+            break;
+        case FPDF_UNSP_DOC_SHAREDREVIEW:
+            feature = "Shared_Review";
+            break;
+        case FPDF_UNSP_DOC_SHAREDFORM_ACROBAT:
+        case FPDF_UNSP_DOC_SHAREDFORM_FILESYSTEM:
+        case FPDF_UNSP_DOC_SHAREDFORM_EMAIL:
+            feature = "Shared_Form";
+            break;
+        case FPDF_UNSP_ANNOT_3DANNOT:
+            feature = "3D";
+            break;
+        case FPDF_UNSP_ANNOT_MOVIE:
+            feature = "Movie";
+            break;
+        case FPDF_UNSP_ANNOT_SOUND:
+            feature = "Sound";
+            break;
+        case FPDF_UNSP_ANNOT_SCREEN_MEDIA:
+        case FPDF_UNSP_ANNOT_SCREEN_RICHMEDIA:
+            feature = "Screen";
+            break;
+        case FPDF_UNSP_ANNOT_SIG:
+            feature = "Digital_Signature";
+            break;
+    }
+    LOGE("Unsupported feature: %s.", feature);
+}
+
+// PDFium keeps the pointer, so the struct must outlive the library
+static UNSUPPORT_INFO sUnsupportedInfo = {1, unsupportedFeatureHandler};
+
+bool PdfiumLibrary::acquire() {
+    // Fast path: the library is up, only bump a non-zero count
+    int count = sReferenceCount.load(std::memory_order_acquire);
+    while (count > 0) {
+        if (sReferenceCount.compare_exchange_weak(count, count + 1, std::memory_order_acq_rel)) {
+            return false;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(sLifecycleLock);
+    bool initialize = sReferenceCount.load(std::memory_order_acquire) == 0;
+    if (initialize) {
+        FPDF_LIBRARY_CONFIG config;
+        config.version = 3;
+        config.m_pUserFontPaths = nullptr;
+        config.m_pIsolate = nullptr;
+        config.m_v8EmbedderSlot = 0;
+        config.m_pPlatform = nullptr;
+        FPDF_InitLibraryWithConfig(&config);
+        FSDK_SetUnSpObjProcessHandler(&sUnsupportedInfo);
+        if (sFontIndex) {
+            FPDF_SetSystemFontInfo(newIndexedFontInfo(sFontIndex));
+        }
+        LOGI("PDFSDK Library Initialized!");
+    }
+    sReferenceCount.fetch_add(1, std::memory_order_acq_rel);
+    return initialize;
+}
+
+void PdfiumLibrary::release() {
+    // Fast path: not the last reference
+    int count = sReferenceCount.load(std::memory_order_acquire);
+    while (count > 1) {
+        if (sReferenceCount.compare_exchange_weak(count, count - 1, std::memory_order_acq_rel)) {
+            return;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(sLifecycleLock);
+    count = sReferenceCount.load(std::memory_order_acquire);
+    if (count <= 0) {
+        LOGE("PDFSDK library released more times than acquired");
+        return;
+    }
+    if (sReferenceCount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        FPDF_DestroyLibrary();
+        LOGI("PDFSDK Instance Destroyed!");
+    }
+}
+
+bool PdfiumLibrary::pin() {
+    {
+        std::lock_guard<std::mutex> lock(sLifecycleLock);
+        if (sPinned) return false;
+        sPinned = true;
+    }
+    return acquire();
+}
+
+void PdfiumLibrary::unpin() {
+    {
+        std::lock_guard<std::mutex> lock(sLifecycleLock);
+        if (!sPinned) return;
+        sPinned = false;
+    }
+    release();
+}
+
+int PdfiumLibrary::referenceCount() {
+    return sReferenceCount.load(std::memory_order_acquire);
+}
+
+void PdfiumLibrary::setFontIndex(const std::shared_ptr<const FontIndex> &index) {
+    std::lock_guard<std::mutex> lock(sLifecycleLock);
+    sFontIndex = index;
+    if (index && sReferenceCount.load(std::memory_order_acquire) > 0) {
+        FPDF_SetSystemFontInfo(newIndexedFontInfo(index));
+    }
+}
+
+FPDF_SYSFONTINFO *PdfiumLibrary::newSystemFontInfo() {
+    std::lock_guard<std::mutex> lock(sLifecycleLock);
+    return sFontIndex ? newIndexedFontInfo(sFontIndex) : NULL;
+}
@@ -0,0 +1,62 @@
+#ifndef PDFVIEW_PDFIUM_LIBRARY_H
+#define PDFVIEW_PDFIUM_LIBRARY_H
+
+#include <memory>
+
+#include <public/fpdf_sysfontinfo.h>
+
+#include "font_index.h"
+
+/**
+ * Process wide PDFium lifecycle. FPDF_InitLibraryWithConfig runs when the
+ * first reference is taken and FPDF_DestroyLibrary when the last one is
+ * dropped, both under one lock, so a close on one thread can never tear the
+ * library down under a render on another.
+ *
+ * Taking a reference while the library is already up is a single atomic
+ * increment and never touches the lock.
+ */
+class PdfiumLibrary {
+public:
+    // Returns true if this call initialized the library
+    static bool acquire();
+
+    static void release();
+
+    // Initializes the library ahead of the first document and keeps it alive
+    // until unpin(), so opening and closing documents never re-initializes it.
+    // Calling it again while pinned does nothing. Returns true if this call
+    // initialized the library.
+    static bool pin();
+
+    static void unpin();
+
+    static int referenceCount();
+
+    // Serves system fonts from the index instead of PDFium's default font
+    // info, which scans the font directories on first use. Installed at every
+    // initialization and right away if the library is up; it only takes
+    // effect if no page has needed a system font yet. NULL restores the
+    // default at the next initialization. Calls into PDFium, so the caller
+    // must hold the document lock.
+    static void setFontIndex(const std::shared_ptr<const FontIndex> &index);
+
+    // A new font info for the configured index, NULL when PDFium's default
+    // is used
+    static FPDF_SYSFONTINFO *newSystemFontInfo();
+
+    // RAII reference, declare it before any PDFium handle it must outlive
+    class Ref {
+    public:
+        Ref() { acquire(); }
+
+        ~Ref() { release(); }
+
+    private:
+        Ref(const Ref &);
+
+        Ref &operator=(const Ref &);
+    };
+};
+
+#endif //PDFVIEW_PDFIUM_LIBRARY_H
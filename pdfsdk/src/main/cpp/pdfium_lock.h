@@ -0,0 +1,31 @@
+#ifndef PDFVIEW_PDFIUM_LOCK_H
+#define PDFVIEW_PDFIUM_LOCK_H
+
+/**
+ * What a long native job calls around each of its PDFium steps. PDFium is
+ * not thread safe: the Java side passes the lock guarding it, so rendering
+ * can run between the steps.
+ */
+class PdfiumLockSink {
+public:
+    virtual ~PdfiumLockSink() {}
+
+    virtual void lockPdfium() = 0;
+
+    virtual void unlockPdfium() = 0;
+};
+
+// Holds the sink's PDFium lock for a scope
+class PdfiumLock {
+public:
+    explicit PdfiumLock(PdfiumLockSink *sink) : sink(sink) { sink->lockPdfium(); }
+
+    ~PdfiumLock() { sink->unlockPdfium(); }
+
+private:
+    PdfiumLock(const PdfiumLock &);
+
+    PdfiumLockSink *sink;
+};
+
+#endif //PDFVIEW_PDFIUM_LOCK_H
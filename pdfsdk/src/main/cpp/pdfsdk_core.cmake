@@ -0,0 +1,30 @@
+# Sources of pdfsdk_core, the rendering core without JNI or Android
+# dependencies. Shared by the JNI library and the host builds.
+set(PDFSDK_CORE_SOURCES
+    ${CMAKE_CURRENT_LIST_DIR}/document.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/file_writer.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/save_snapshot.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/form_fill.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/text_index.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/render_core.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/color_scheme.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/annot_layer.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/annot_codec.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/annot_sync.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/ink_engine.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/ink_commit.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/render_stats.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/pdfium_library.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/warm_up.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/page_assembly.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/flatten_job.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/print_renderer.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/raster_pdf_writer.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/thumbnailer.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/work_stealing_pool.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/font_index.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/font_info.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/page_index.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/page_links.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/outline_tree.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/document_info.cpp)
@@ -1,100 +1,47 @@
 #include "comm.h"
 
+#include <algorithm>
 #include <string>
 #include <stdbool.h>
-#include <unistd.h>
+#include <thread>
 
 #include <public/fpdf_ext.h>
 #include <public/fpdfview.h>
-#include <hk_file.h>
+#include <public/fpdf_text.h>
 #include <public/cpp/fpdf_scopers.h>
 
 #include <android/bitmap.h>
-
-template<class string_type>
-inline typename string_type::value_type *WriteInto(string_type *str, size_t length_with_null) {
-    str->reserve(length_with_null);
-    str->resize(length_with_null - 1);
-    return &((*str)[0]);
-}
+#include <sys/system_properties.h>
+
+#include "document.h"
+#include "jni_cache.h"
+#include "jni_monitor_sink.h"
+#include "page_index.h"
+#include "pdfium_library.h"
+#include "warm_up.h"
+#include "page_links.h"
+#include "outline_tree.h"
+#include "page_assembly.h"
+#include "print_renderer.h"
+#include "flatten_job.h"
+#include "document_info.h"
+#include "font_index.h"
+#include "render_core.h"
+#include "annot_layer.h"
+#include "annot_codec.h"
+#include "ink_engine.h"
+#include "render_stats.h"
+#include "text_index.h"
+#include "thumbnailer.h"
+#include "work_stealing_pool.h"
 
 extern "C" {
 
-static int sLibraryReferenceCount = 0;
-
-void UnsupportedInfoHandler(UNSUPPORT_INFO *, int type) {
-    std::string feature = "Unknown";
-    switch (type) {
-        case FPDF_UNSP_DOC_XFAFORM:
-            feature = "XFA";
-            break;
-        case FPDF_UNSP_DOC_PORTABLECOLLECTION:
-            feature = "Portfolios_Packages";
-            break;
-        case FPDF_UNSP_DOC_ATTACHMENT:
-        case FPDF_UNSP_ANNOT_ATTACHMENT:
-            feature = "Attachment";
-            break;
-        case FPDF_UNSP_DOC_SECURITY:
-            feature = "Rights_Management";
-            break;
-        case FPDF_UNSP_DOC_SHAREDREVIEW:
-            feature = "Shared_Review";
-            break;
-        case FPDF_UNSP_DOC_SHAREDFORM_ACROBAT:
-        case FPDF_UNSP_DOC_SHAREDFORM_FILESYSTEM:
-        case FPDF_UNSP_DOC_SHAREDFORM_EMAIL:
-            feature = "Shared_Form";
-            break;
-        case FPDF_UNSP_ANNOT_3DANNOT:
-            feature = "3D";
-            break;
-        case FPDF_UNSP_ANNOT_MOVIE:
-            feature = "Movie";
-            break;
-        case FPDF_UNSP_ANNOT_SOUND:
-            feature = "Sound";
-            break;
-        case FPDF_UNSP_ANNOT_SCREEN_MEDIA:
-        case FPDF_UNSP_ANNOT_SCREEN_RICHMEDIA:
-            feature = "Screen";
-            break;
-        case FPDF_UNSP_ANNOT_SIG:
-            feature = "Digital_Signature";
-            break;
-    }
-    LOGE("Unsupported feature: %s.\n", feature.c_str());
-}
-
-static void initLibraryIfNeed() {
-    if (sLibraryReferenceCount == 0) {
-        FPDF_LIBRARY_CONFIG config;
-        config.version = 3;
-        config.m_pUserFontPaths = nullptr;
-        config.m_pIsolate = nullptr;
-        config.m_v8EmbedderSlot = 0;
-        config.m_pPlatform = nullptr;
-
-        FPDF_InitLibraryWithConfig(&config);
-
-        UNSUPPORT_INFO unsupported_info = {};
-        unsupported_info.version = 1;
-        unsupported_info.FSDK_UnSupport_Handler = UnsupportedInfoHandler;
-        LOGI("PDFSDK Library Initialized!");
-    }
-}
-
-static void destroyLibraryIfNeed() {
-//    Mutex::Autolock lock(sLibraryLock);
-    sLibraryReferenceCount--;
-    if (sLibraryReferenceCount == 0) {
-        FPDF_DestroyLibrary();
-        LOGI("PDFSDK Instance Destroyed!");
-    }
-}
-
 int jniThrowException(JNIEnv *env, const char *className, const char *message) {
-    jclass exClass = env->FindClass(className);
+    jclass exClass = findCachedClass(className);
+    if (exClass == NULL) {
+        exClass = env->FindClass(className);
+    }
     if (exClass == NULL) {
         LOGE("Unable to find exception class %s", className);
         return -1;
@@ -108,168 +55,95 @@ int jniThrowException(JNIEnv *env, const char *className, const char *message) {
     return 0;
 }
 
-struct rgb {
-    uint8_t red;
-    uint8_t green;
-    uint8_t blue;
-};
-
 jobject NewLong(JNIEnv *env, jlong value) {
-    jclass cls = env->FindClass("java/lang/Long");
-    jmethodID methodID = env->GetMethodID(cls, "<init>", "(J)V");
-    return env->NewObject(cls, methodID, value);
+    return env->NewObject(gJniCache.longClass, gJniCache.longConstructor, value);
 }
 
 jobject NewInteger(JNIEnv *env, jint value) {
-    jclass cls = env->FindClass("java/lang/Integer");
-    jmethodID methodID = env->GetMethodID(cls, "<init>", "(I)V");
-    return env->NewObject(cls, methodID, value);
-}
-
-uint16_t rgb_to_565(unsigned char R8, unsigned char G8, unsigned char B8) {
-    unsigned char R5 = (R8 * 249 + 1014) >> 11;
-    unsigned char G6 = (G8 * 253 + 505) >> 10;
-    unsigned char B5 = (B8 * 249 + 1014) >> 11;
-    return (R5 << 11) | (G6 << 5) | (B5);
-}
-
-void rgbBitmapTo565(void *source, int sourceStride, void *dest, AndroidBitmapInfo *info) {
-    rgb *srcLine;
-    uint16_t *dstLine;
-    int y, x;
-    for (y = 0; y < info->height; y++) {
-        srcLine = (rgb *) source;
-        dstLine = (uint16_t *) dest;
-        for (x = 0; x < info->width; x++) {
-            rgb *r = &srcLine[x];
-            dstLine[x] = rgb_to_565(r->red, r->green, r->blue);
-        }
-        source = (char *) source + sourceStride;
-        dest = (char *) dest + info->stride;
-    }
+    return env->NewObject(gJniCache.integerClass, gJniCache.integerConstructor, value);
 }
 
-class DocumentFile {
-public:
-    ScopedFPDFDocument pdfDocument = nullptr;
-
-    DocumentFile() { initLibraryIfNeed(); }
-
-    virtual ~DocumentFile();
-};
-
-DocumentFile::~DocumentFile() {
-    destroyLibraryIfNeed();
-}
-
-static int getBlock(void *param, unsigned long position, unsigned char *outBuffer,
-                    unsigned long size) {
-    const int fd = (int)reinterpret_cast<intptr_t>(param);
-    const int readCount = pread(fd, outBuffer, size, position);
-    if (readCount < 0) {
-        LOGE("Cannot read from file descriptor.");
-        return 0;
+JNI_FUNC(jlong, PdfiumSDK, nativeOpenDocument)(JNI_ARGS, jint fd, jstring password) {
+    if (fd < 0) {
+        jniThrowException(env, "java/io/IOException",
+                          "file descriptor must be greater than or equal to 0");
+        return -1;
     }
-    return 1;
-}
-
-static jlong loadPageInternal(JNIEnv *env, DocumentFile *doc, int pageIndex) {
-    try {
-        if (doc == nullptr) throw "Get page document null";
 
-        if (doc->pdfDocument.get() != nullptr) {
-            FPDF_PAGE page = FPDF_LoadPage(doc->pdfDocument.get(), pageIndex);
-            if (page == nullptr) {
-                throw "Loaded page is NULL";
-            }
+    const char *cpassword = NULL;
+    if (password != NULL) {
+        cpassword = env->GetStringUTFChars(password, NULL);
+    }
 
-            return reinterpret_cast<jlong>(page);
-        } else {
-            throw "Get page pdf document null";
-        }
-    } catch (const char *msg) {
-        LOGE("%s", msg);
+    unsigned long error;
+    // The viewer lays out every page and reads the sizes lock-free
+    std::unique_ptr<Document> doc = Document::openFd(fd, cpassword, &error, true);
 
-        jniThrowException(env, "java/lang/IllegalStateException",
-                          "cannot load page");
+    if (cpassword != NULL) {
+        env->ReleaseStringUTFChars(password, cpassword);
+    }
 
+    if (!doc) {
+        jniThrowException(env, "java/io/IOException", describePdfError(error));
         return -1;
     }
+    return reinterpret_cast<jlong>(doc.release());
 }
 
-static void closePageInternal(jlong pagePtr) {
-    FPDF_ClosePage(reinterpret_cast<FPDF_PAGE>(pagePtr));
+JNI_FUNC(void, PdfiumSDK, nativeInitLibrary)(JNI_ARGS) {
+    PdfiumLibrary::pin();
 }
 
-unsigned long ConvertLastError(char *buf, size_t buf_len) {
-    unsigned long err = FPDF_GetLastError();
-    switch (err) {
-        case FPDF_ERR_SUCCESS:
-            snprintf(buf, buf_len, "Success");
-        case FPDF_ERR_UNKNOWN:
-            snprintf(buf, buf_len, "Unknown error");
-        case FPDF_ERR_FILE:
-            snprintf(buf, buf_len, "File not found or could not be opened");
-        case FPDF_ERR_FORMAT:
-            snprintf(buf, buf_len, "File not in PDF format or corrupted");
-        case FPDF_ERR_PASSWORD:
-            snprintf(buf, buf_len, "Password required or incorrect password");
-        case FPDF_ERR_SECURITY:
-            snprintf(buf, buf_len, "Unsupported security scheme");
-        case FPDF_ERR_PAGE:
-            snprintf(buf, buf_len, "Page not found or content error");
-        default:
-            snprintf(buf, buf_len,"Unknown error %ld", err);
-    }
-    return err;
+JNI_FUNC(void, PdfiumSDK, nativeReleaseLibrary)(JNI_ARGS) {
+    PdfiumLibrary::unpin();
 }
 
-JNI_FUNC(jlong, PdfiumSDK, nativeOpenDocument)(JNI_ARGS, jint fd, jstring password) {
-    int ret = -1;
-    if (fd < 0) {
-        jniThrowException(env, "java/io/IOException",
-                          "file descriptor must be greater than or equal to 0");
-        return ret;
-    }
-    ssize_t fileLen = fs_get_size_for_fd(fd);
-    if (fileLen <= 0) {
-        jniThrowException(env, "java/io/IOException",
-                          "File is empty");
-        return ret;
-    }
-
-    DocumentFile *docFile = new DocumentFile();
-
-    FPDF_FILEACCESS file_access = {};
-    file_access.m_FileLen = static_cast<unsigned long>(fileLen);
-    file_access.m_GetBlock = &getBlock;
-    file_access.m_Param = reinterpret_cast<void *>(intptr_t(fd));
+JNI_FUNC(jlongArray, PdfiumSDK, nativeWarmUp)(JNI_ARGS) {
+    WarmUpTimings timings;
+    warmUpLibrary(&timings);
 
-    const char *cpassword = NULL;
-    if (password != NULL) {
-        cpassword = env->GetStringUTFChars(password, NULL);
+    jlong values[] = {timings.libraryInitNanos, timings.fontEnumNanos, timings.renderNanos};
+    jlongArray result = env->NewLongArray(3);
+    if (result != NULL) {
+        env->SetLongArrayRegion(result, 0, 3, values);
     }
+    return result;
+}
 
-    FPDF_DOCUMENT document = FPDF_LoadCustomDocument(&file_access, cpassword);
-
-    if (cpassword != NULL) {
-        env->ReleaseStringUTFChars(password, cpassword);
+JNI_FUNC(jint, PdfiumSDK, nativeSetFontIndex)(JNI_ARGS, jstring cachePath, jobjectArray fontDirs) {
+    if (fontDirs == NULL) {
+        PdfiumLibrary::setFontIndex(std::shared_ptr<const FontIndex>());
+        return 0;
     }
 
-    if (!document) {
-        delete docFile;
-
-        char errMsg[256];
-        ConvertLastError(errMsg, sizeof(errMsg));
-        jniThrowException(env, "java/io/IOException", errMsg);
-        ret = -1;
-        return ret;
+    std::string cache;
+    if (cachePath != NULL) {
+        const char *path = env->GetStringUTFChars(cachePath, NULL);
+        if (path == NULL) return -1;
+        cache = path;
+        env->ReleaseStringUTFChars(cachePath, path);
     }
 
-    docFile->pdfDocument.reset(document);
+    std::vector<std::string> dirs;
+    jsize count = env->GetArrayLength(fontDirs);
+    for (jsize i = 0; i < count; i++) {
+        jstring dir = (jstring) env->GetObjectArrayElement(fontDirs, i);
+        const char *path = dir != NULL ? env->GetStringUTFChars(dir, NULL) : NULL;
+        if (path != NULL) {
+            dirs.push_back(path);
+            env->ReleaseStringUTFChars(dir, path);
+        }
+        env->DeleteLocalRef(dir);
+    }
 
-    ret = reinterpret_cast<jlong>(docFile);
-    return ret;
+    std::shared_ptr<const FontIndex> index = FontIndex::open(cache, dirs);
+    if (!index) {
+        LOGE("Unable to build the font index");
+        return -1;
+    }
+    LOGI("Font index: %d faces, %s", index->faceCount(), index->isMapped() ? "cached" : "scanned");
+    PdfiumLibrary::setFontIndex(index);
+    return index->faceCount();
 }
 
 JNI_FUNC(jlong, PdfiumSDK, nativeOpenMemDocument)(JNI_ARGS, jbyteArray data, jstring password) {
@@ -277,72 +151,208 @@ JNI_FUNC(jlong, PdfiumSDK, nativeOpenMemDocument)(JNI_ARGS, jbyteArray data, jst
 }
 
 JNI_FUNC(jint, PdfiumSDK, nativeGetPageCount)(JNI_ARGS, jlong documentPtr) {
-    DocumentFile *doc = reinterpret_cast<DocumentFile *>(documentPtr);
-    return (jint)FPDF_GetPageCount(doc->pdfDocument.get());
+    Document *doc = reinterpret_cast<Document *>(documentPtr);
+    return (jint) doc->pageCount();
 }
 
 JNI_FUNC(void, PdfiumSDK, nativeCloseDocument)(JNI_ARGS, jlong documentPtr) {
-    DocumentFile *doc = reinterpret_cast<DocumentFile *>(documentPtr);
+    Document *doc = reinterpret_cast<Document *>(documentPtr);
     delete doc;
 }
 
+// Bytes written, or -1
+JNI_FUNC(jlong, PdfiumSDK, nativeSaveDocument)(JNI_ARGS, jlong documentPtr, jint fd, jint flags,
+                                               jint version, jint syncMode) {
+    Document *doc = reinterpret_cast<Document *>(documentPtr);
+    if (doc == NULL || fd < 0) return -1;
+    return doc->save(fd, flags, version, (SyncMode) syncMode);
+}
+
+// Snapshot pointer, 0 if the document can't be saved
+JNI_FUNC(jlong, PdfiumSDK, nativeTakeSaveSnapshot)(JNI_ARGS, jlong documentPtr, jint flags,
+                                                   jint version) {
+    Document *doc = reinterpret_cast<Document *>(documentPtr);
+    if (doc == NULL) return 0;
+    std::unique_ptr<SaveSnapshot> snapshot(new SaveSnapshot());
+    if (!doc->snapshot(flags, version, snapshot.get())) return 0;
+    return reinterpret_cast<jlong>(snapshot.release());
+}
+
+JNI_FUNC(void, PdfiumSDK, nativeCloseSaveSnapshot)(JNI_ARGS, jlong snapshotPtr) {
+    delete reinterpret_cast<SaveSnapshot *>(snapshotPtr);
+}
+
+class JniSaveProgress : public SaveProgress {
+public:
+    JniSaveProgress(JNIEnv *env, jobject listener) : env(env), listener(listener) {}
+
+    bool onSaveProgress(uint64_t written, uint64_t total) override {
+        jboolean proceed = env->CallBooleanMethod(listener, gJniCache.onSaveProgressMethod,
+                                                  (jlong) written, (jlong) total);
+        if (env->ExceptionCheck()) {
+            LOGE("OnSaveListener threw, cancelling the save");
+            env->ExceptionDescribe();
+            env->ExceptionClear();
+            return false;
+        }
+        return proceed == JNI_TRUE;
+    }
+
+private:
+    JNIEnv *env;
+    jobject listener;
+};
+
+// Runs on the caller's thread without PDFium, listener may be null
+JNI_FUNC(jboolean, PdfiumSDK, nativeWriteSaveSnapshot)(JNI_ARGS, jlong snapshotPtr, jstring path,
+                                                       jint syncMode, jobject listener) {
+    SaveSnapshot *snapshot = reinterpret_cast<SaveSnapshot *>(snapshotPtr);
+    if (snapshot == NULL || path == NULL) return JNI_FALSE;
+    const char *cpath = env->GetStringUTFChars(path, NULL);
+    if (cpath == NULL) return JNI_FALSE;
+
+    JniSaveProgress progress(env, listener);
+    bool saved = writeSnapshot(*snapshot, cpath, (SyncMode) syncMode,
+                               listener != NULL ? &progress : NULL);
+    env->ReleaseStringUTFChars(path, cpath);
+    return saved ? JNI_TRUE : JNI_FALSE;
+}
+
 JNI_FUNC(jstring, PdfiumSDK, nativeGetDocumentMetaText)(JNI_ARGS, jlong documentPtr, jstring tag) {
     const char *ctag = env->GetStringUTFChars(tag, NULL);
     if (ctag == NULL) {
         return env->NewStringUTF("");
     }
-    DocumentFile *doc = reinterpret_cast<DocumentFile *>(documentPtr);
-    const unsigned long bufferLen = FPDF_GetMetaText(doc->pdfDocument.get(), ctag, NULL, 0);
-    if (bufferLen <= 2) {
-        return env->NewStringUTF("");
+    Document *doc = reinterpret_cast<Document *>(documentPtr);
+    std::u16string text = getMetaText(doc->get(), ctag);
+    env->ReleaseStringUTFChars(tag, ctag);
+    return env->NewString((const jchar *) text.data(), (jsize) text.size());
+}
+
+static jobjectArray toJavaStrings(JNIEnv *env, const std::u16string *strings, size_t count) {
+    jobjectArray result = env->NewObjectArray((jsize) count, gJniCache.stringClass, NULL);
+    for (size_t i = 0; i < count; i++) {
+        jstring value = env->NewString((const jchar *) strings[i].data(), (jsize) strings[i].size());
+        env->SetObjectArrayElement(result, (jsize) i, value);
+        env->DeleteLocalRef(value);
     }
+    return result;
+}
 
-    std::wstring text;
-    FPDF_GetMetaText(doc->pdfDocument.get(), ctag, WriteInto(&text, bufferLen + 1), bufferLen);
-    env->ReleaseStringUTFChars(tag, ctag);
-    return env->NewString((jchar *)text.c_str(), bufferLen / 2 - 1);
+// Packs the document info as { String[] meta, int[] values }, values being
+// page count, file version, permissions, page mode, tagged flag and
+// page labels flag.
+JNI_FUNC(jobjectArray, PdfiumSDK, nativeGetDocumentInfo)(JNI_ARGS, jlong documentPtr) {
+    Document *doc = reinterpret_cast<Document *>(documentPtr);
+    if (doc == NULL) {
+        jniThrowException(env, "java/lang/IllegalStateException", "Document is null");
+        return NULL;
+    }
+
+    DocumentInfo info;
+    readDocumentInfo(doc->get(), &info);
+
+    jint values[] = {info.pageCount, info.fileVersion, (jint) info.permissions,
+                     info.pageMode, info.tagged ? 1 : 0, info.hasPageLabels ? 1 : 0};
+    jintArray jvalues = env->NewIntArray(6);
+    env->SetIntArrayRegion(jvalues, 0, 6, values);
+
+    jobjectArray result = env->NewObjectArray(2, gJniCache.objectClass, NULL);
+    env->SetObjectArrayElement(result, 0, toJavaStrings(env, info.meta, kDocumentMetaTagCount));
+    env->SetObjectArrayElement(result, 1, jvalues);
+    return result;
+}
+
+// Packs the page label ranges as { int[] starts, String[] labels }
+JNI_FUNC(jobjectArray, PdfiumSDK, nativeGetPageLabels)(JNI_ARGS, jlong documentPtr) {
+    Document *doc = reinterpret_cast<Document *>(documentPtr);
+    if (doc == NULL) {
+        jniThrowException(env, "java/lang/IllegalStateException", "Document is null");
+        return NULL;
+    }
+
+    PageLabels labels;
+    readPageLabels(doc->get(), &labels);
+
+    jsize rangeCount = (jsize) labels.starts.size();
+    jintArray starts = env->NewIntArray(rangeCount);
+    if (rangeCount > 0) {
+        env->SetIntArrayRegion(starts, 0, rangeCount, labels.starts.data());
+    }
+
+    jobjectArray result = env->NewObjectArray(2, gJniCache.objectClass, NULL);
+    env->SetObjectArrayElement(result, 0, starts);
+    env->SetObjectArrayElement(result, 1, toJavaStrings(env, labels.labels.data(), labels.labels.size()));
+    return result;
 }
 
 JNI_FUNC(jlong, PdfiumSDK, nativeLoadPage)(JNI_ARGS, jlong documentPtr, jint pageIndex) {
-    DocumentFile *doc = reinterpret_cast<DocumentFile *>(documentPtr);
-    return loadPageInternal(env, doc, pageIndex);
+    Document *doc = reinterpret_cast<Document *>(documentPtr);
+    std::unique_ptr<Page> page;
+    if (doc != NULL) {
+        page = doc->loadPage(pageIndex);
+    }
+    if (!page) {
+        LOGE("Cannot load page %d", pageIndex);
+        jniThrowException(env, "java/lang/IllegalStateException", "cannot load page");
+        return -1;
+    }
+    return reinterpret_cast<jlong>(page.release());
+}
+
+JNI_FUNC(void, PdfiumSDK, nativeClosePage)(JNI_ARGS, jlong pagePtr) {
+    delete reinterpret_cast<Page *>(pagePtr);
 }
 
-JNI_FUNC(void, PdfiumSDK, nativeClosePage)(JNI_ARGS, jlong pagePtr) { closePageInternal(pagePtr); }
 JNI_FUNC(void, PdfiumSDK, nativeClosePages)(JNI_ARGS, jlongArray pagesPtr) {
     int length = (int) (env->GetArrayLength(pagesPtr));
     jlong *pages = env->GetLongArrayElements(pagesPtr, NULL);
+    if (pages == NULL) return;
 
-    int i;
-    for (i = 0; i < length; i++) { closePageInternal(pages[i]); }
+    for (int i = 0; i < length; i++) {
+        delete reinterpret_cast<Page *>(pages[i]);
+    }
+    env->ReleaseLongArrayElements(pagesPtr, pages, JNI_ABORT);
 }
 
 JNI_FUNC(jobject, PdfiumSDK, nativeGetPageSizeByIndex)(JNI_ARGS, jlong docPtr, jint pageIndex, jint dpi) {
-    DocumentFile *doc = reinterpret_cast<DocumentFile*>(docPtr);
+    Document *doc = reinterpret_cast<Document *>(docPtr);
     if (doc == NULL) {
         LOGE("Document is null");
         jniThrowException(env, "java/lang/IllegalStateException", "Document is null");
         return NULL;
     }
 
-    double width, height;
-    int result = FPDF_GetPageSizeByIndex(doc->pdfDocument.get(), pageIndex, &width, &height);
-    if (result == 0) {
-        width = 0;
-        height = 0;
+    // The same cached size as the fast binding
+    FS_SIZEF size = {0, 0};
+    doc->pageSize(pageIndex, &size);
+    jint widthInt = (jint) (size.width * dpi / 72);
+    jint heightInt = (jint) (size.height * dpi / 72);
+    return env->NewObject(gJniCache.sizeClass, gJniCache.sizeConstructor, widthInt, heightInt);
+}
+
+JNI_FUNC(jfloatArray, PdfiumSDK, nativeGetAllPageSizes)(JNI_ARGS, jlong docPtr, jint flags) {
+    Document *doc = reinterpret_cast<Document *>(docPtr);
+    if (doc == NULL) {
+        jniThrowException(env, "java/lang/IllegalStateException", "Document is null");
+        return NULL;
+    }
+
+    std::vector<float> sizes;
+    readPageSizes(*doc, flags, &sizes);
+
+    jfloatArray result = env->NewFloatArray((jsize) sizes.size());
+    if (result != NULL && !sizes.empty()) {
+        env->SetFloatArrayRegion(result, 0, (jsize) sizes.size(), sizes.data());
     }
-    jint widthInt = (jint) (width * dpi / 72);
-    jint heightInt = (jint) (height * dpi / 72);
-    jclass clazz = env->FindClass("com/hungknow/pdfsdk/models/Size");
-    jmethodID constructorId = env->GetMethodID(clazz, "<init>", "(II)V");
-    return env->NewObject(clazz, constructorId, widthInt, heightInt);
+    return result;
 }
 
 JNI_FUNC(void, PdfiumSDK, nativeRenderPageBitmap)(JNI_ARGS, jlong pagePtr, jobject bitmap,
                                                   jint dpi, jint startX, jint startY,
                                                   jint drawSizeHor, jint drawSizeVer,
-                                                  jboolean renderAnnot) {
-    FPDF_PAGE page = reinterpret_cast<FPDF_PAGE>(pagePtr);
+                                                  jboolean renderAnnot, jint colorScheme) {
+    Page *page = reinterpret_cast<Page *>(pagePtr);
     if (page == NULL || bitmap == NULL) {
         LOGE("Render page pointers invalid");
         return;
@@ -365,59 +375,244 @@ JNI_FUNC(void, PdfiumSDK, nativeRenderPageBitmap)(JNI_ARGS, jlong pagePtr, jobje
     }
 
     void *addr;
-    if ((ret = AndroidBitmap_lockPixels(env, bitmap, &addr)) != 0) {
+    {
+        StageTimer timer(kStageBitmapLock);
+        ret = AndroidBitmap_lockPixels(env, bitmap, &addr);
+    }
+    if (ret != 0) {
         LOGE("Locking bitmap failed: %s", strerror(ret * -1));
         return;
     }
 
-    void *tmp;
-    int format;
-    int sourceStride;
-    if (info.format == ANDROID_BITMAP_FORMAT_RGB_565) {
-        tmp = malloc(canvasVerSize * canvasHorSize * sizeof(rgb));
-        sourceStride = canvasHorSize * sizeof(rgb);
-        format = FPDFBitmap_BGR;
-    } else {
-        tmp = addr;
-        sourceStride = info.stride;
-        format = FPDFBitmap_BGRA;
+    RenderTarget target;
+    target.pixels = addr;
+    target.width = canvasHorSize;
+    target.height = canvasVerSize;
+    target.stride = info.stride;
+    target.format = info.format == ANDROID_BITMAP_FORMAT_RGB_565 ? kTileRgb565 : kTileRgba8888;
+    // Per thread, so the RGB_565 buffer is reused between the tiles of a
+    // render thread
+    static thread_local TileRenderer renderer;
+    ColorScheme scheme = colorScheme > 0 && colorScheme < kColorSchemeCount
+                         ? (ColorScheme) colorScheme : kColorSchemeNone;
+    FPDF_FORMHANDLE form = page->form() != NULL ? page->form()->get() : NULL;
+    if (!renderer.render(page->get(), target, startX, startY, drawSizeHor, drawSizeVer,
+                         renderAnnot, scheme, form)) {
+        LOGE("Unable to allocate the render buffer");
     }
 
-    FPDF_BITMAP pdfBitmap = FPDFBitmap_CreateEx(canvasHorSize, canvasVerSize,
-                                                format, tmp, sourceStride);
+    AndroidBitmap_unlockPixels(env, bitmap);
+}
+///////////////////////////////////////
+// Annotation layer api
+///////////
 
-    if (drawSizeHor < canvasHorSize || drawSizeVer < canvasVerSize) {
-        FPDFBitmap_FillRect(pdfBitmap, 0, 0, canvasHorSize, canvasVerSize,
-                            0x848484FF); //Gray
+// Packs the annotations as { int[] indexAndSubtype, float[] rects }, with
+// rects as page-relative left, top, right, bottom
+JNI_FUNC(jobjectArray, PdfiumSDK, nativeGetLayerAnnots)(JNI_ARGS, jlong pagePtr) {
+    Page *page = reinterpret_cast<Page *>(pagePtr);
+    if (page == NULL) {
+        jniThrowException(env, "java/lang/IllegalStateException", "Page is null");
+        return NULL;
     }
 
-    int baseHorSize = (canvasHorSize < drawSizeHor) ? canvasHorSize : (int) drawSizeHor;
-    int baseVerSize = (canvasVerSize < drawSizeVer) ? canvasVerSize : (int) drawSizeVer;
-    int baseX = (startX < 0) ? 0 : (int) startX;
-    int baseY = (startY < 0) ? 0 : (int) startY;
-    int flags = FPDF_REVERSE_BYTE_ORDER;
+    std::vector<LayerAnnot> annots;
+    listLayerAnnots(page->get(), &annots);
 
-    if (renderAnnot) {
-        flags |= FPDF_ANNOT;
+    jsize count = (jsize) annots.size();
+    jintArray indexAndSubtype = env->NewIntArray(count * 2);
+    jfloatArray rects = env->NewFloatArray(count * 4);
+    if (indexAndSubtype == NULL || rects == NULL) {
+        return NULL;
     }
 
-    if (info.format == ANDROID_BITMAP_FORMAT_RGB_565) {
-        FPDFBitmap_FillRect(pdfBitmap, baseX, baseY, baseHorSize, baseVerSize,
-                            0xFFFFFFFF); //White
+    std::vector<jint> intValues(count * 2);
+    std::vector<jfloat> rectValues(count * 4);
+    for (jsize i = 0; i < count; i++) {
+        intValues[i * 2] = annots[i].index;
+        intValues[i * 2 + 1] = annots[i].subtype;
+        rectValues[i * 4] = annots[i].left;
+        rectValues[i * 4 + 1] = annots[i].top;
+        rectValues[i * 4 + 2] = annots[i].right;
+        rectValues[i * 4 + 3] = annots[i].bottom;
     }
+    env->SetIntArrayRegion(indexAndSubtype, 0, count * 2, intValues.data());
+    env->SetFloatArrayRegion(rects, 0, count * 4, rectValues.data());
 
-    FPDF_RenderPageBitmap(pdfBitmap, page,
-                          startX, startY,
-                          (int) drawSizeHor, (int) drawSizeVer,
-                          0, flags);
+    jobjectArray result = env->NewObjectArray(2, gJniCache.objectClass, NULL);
+    env->SetObjectArrayElement(result, 0, indexAndSubtype);
+    env->SetObjectArrayElement(result, 1, rects);
+    return result;
+}
 
-    if (info.format == ANDROID_BITMAP_FORMAT_RGB_565) {
-        rgbBitmapTo565(tmp, sourceStride, addr, &info);
-        free(tmp);
+JNI_FUNC(jboolean, PdfiumSDK, nativeRenderAnnotation)(JNI_ARGS, jlong pagePtr, jint annotIndex,
+                                                      jobject bitmap, jint startX, jint startY,
+                                                      jint drawSizeHor, jint drawSizeVer,
+                                                      jint colorScheme) {
+    Page *page = reinterpret_cast<Page *>(pagePtr);
+    if (page == NULL || bitmap == NULL) {
+        LOGE("Render annotation pointers invalid");
+        return JNI_FALSE;
     }
 
+    AndroidBitmapInfo info;
+    int ret;
+    if ((ret = AndroidBitmap_getInfo(env, bitmap, &info)) < 0) {
+        LOGE("Fetching bitmap info failed: %s", strerror(ret * -1));
+        return JNI_FALSE;
+    }
+    if (info.format != ANDROID_BITMAP_FORMAT_RGBA_8888) {
+        LOGE("Annotation bitmaps must be RGBA_8888");
+        return JNI_FALSE;
+    }
+
+    void *addr;
+    if ((ret = AndroidBitmap_lockPixels(env, bitmap, &addr)) != 0) {
+        LOGE("Locking bitmap failed: %s", strerror(ret * -1));
+        return JNI_FALSE;
+    }
+
+    RenderTarget target;
+    target.pixels = addr;
+    target.width = info.width;
+    target.height = info.height;
+    target.stride = info.stride;
+    target.format = kTileRgba8888;
+    static thread_local AnnotRenderer renderer;
+    ColorScheme scheme = colorScheme > 0 && colorScheme < kColorSchemeCount
+                         ? (ColorScheme) colorScheme : kColorSchemeNone;
+    bool rendered = renderer.render(page->get(), annotIndex, target, startX, startY,
+                                    drawSizeHor, drawSizeVer, scheme);
+
     AndroidBitmap_unlockPixels(env, bitmap);
+    return (jboolean) rendered;
+}
+
+///////////////////////////////////////
+// Annotation sync api
+///////////
+
+// Annotations of pages [firstPage, lastPage] as an annot_codec.h blob
+JNI_FUNC(jbyteArray, PdfiumSDK, nativeExportAnnotations)(JNI_ARGS, jlong documentPtr,
+                                                         jint firstPage, jint lastPage) {
+    Document *doc = reinterpret_cast<Document *>(documentPtr);
+    if (doc == NULL) {
+        jniThrowException(env, "java/lang/IllegalStateException", "Document is null");
+        return NULL;
+    }
+
+    std::vector<AnnotRecord> records;
+    readAnnotRecords(doc->get(), firstPage, lastPage, &records);
+    std::vector<uint8_t> blob;
+    encodeAnnotRecords(records, &blob);
+
+    jbyteArray result = env->NewByteArray((jsize) blob.size());
+    if (result != NULL) {
+        env->SetByteArrayRegion(result, 0, (jsize) blob.size(),
+                                reinterpret_cast<const jbyte *>(blob.data()));
+    }
+    return result;
+}
+
+// Number of annotations created, -1 if the blob can't be decoded
+JNI_FUNC(jint, PdfiumSDK, nativeImportAnnotations)(JNI_ARGS, jlong documentPtr, jbyteArray data,
+                                                   jboolean replace) {
+    Document *doc = reinterpret_cast<Document *>(documentPtr);
+    if (doc == NULL || data == NULL) {
+        jniThrowException(env, "java/lang/IllegalStateException", "Document is null");
+        return -1;
+    }
+
+    std::vector<AnnotRecord> records;
+    jbyte *bytes = env->GetByteArrayElements(data, NULL);
+    if (bytes == NULL) return -1;
+    bool decoded = decodeAnnotRecords(reinterpret_cast<const uint8_t *>(bytes),
+                                      (size_t) env->GetArrayLength(data), &records);
+    env->ReleaseByteArrayElements(data, bytes, JNI_ABORT);
+    if (!decoded) {
+        LOGE("Malformed annotation data");
+        return -1;
+    }
+    return writeAnnotRecords(doc->get(), records, replace == JNI_TRUE);
+}
+
+///////////////////////////////////////
+// Ink api
+///////////
+
+// Input runs on the UI thread without the rendering lock: the stroke and
+// its overlay never touch PDFium until the commit
+
+JNI_FUNC(jlong, PdfiumSDK, nativeNewInkStroke)(JNI_ARGS, jint color, jfloat width) {
+    return reinterpret_cast<jlong>(new InkStroke((uint32_t) color, width));
+}
+
+JNI_FUNC(void, PdfiumSDK, nativeCloseInkStroke)(JNI_ARGS, jlong strokePtr) {
+    delete reinterpret_cast<InkStroke *>(strokePtr);
 }
+
+// Draws into the locked overlay; count < 0 finishes the stroke instead.
+// The drawn pixels go to dirty as left, top, right, bottom.
+static jboolean drawInk(JNIEnv *env, InkStroke *stroke, const jfloat *points, jint count,
+                        jobject overlay, jintArray dirty) {
+    AndroidBitmapInfo info;
+    void *addr;
+    if (AndroidBitmap_getInfo(env, overlay, &info) < 0 ||
+        info.format != ANDROID_BITMAP_FORMAT_RGBA_8888 ||
+        AndroidBitmap_lockPixels(env, overlay, &addr) != 0) {
+        LOGE("Ink overlays must be RGBA_8888 bitmaps");
+        return JNI_FALSE;
+    }
+    RenderTarget target;
+    target.pixels = addr;
+    target.width = info.width;
+    target.height = info.height;
+    target.stride = info.stride;
+    target.format = kTileRgba8888;
+    InkDirtyRect rect = count < 0 ? stroke->finish(target)
+                                  : stroke->addPoints(points, (size_t) count, target);
+    AndroidBitmap_unlockPixels(env, overlay);
+
+    if (rect.left >= rect.right) return JNI_FALSE;
+    if (dirty != NULL && env->GetArrayLength(dirty) >= 4) {
+        const jint values[4] = {rect.left, rect.top, rect.right, rect.bottom};
+        env->SetIntArrayRegion(dirty, 0, 4, values);
+    }
+    return JNI_TRUE;
+}
+
+JNI_FUNC(jboolean, PdfiumSDK, nativeAddInkPoints)(JNI_ARGS, jlong strokePtr, jfloatArray points,
+                                                  jint count, jobject overlay,
+                                                  jintArray dirty) {
+    InkStroke *stroke = reinterpret_cast<InkStroke *>(strokePtr);
+    if (stroke == NULL || points == NULL || overlay == NULL || count < 0 ||
+        count * 2 > env->GetArrayLength(points)) {
+        return JNI_FALSE;
+    }
+    static thread_local std::vector<jfloat> xy;
+    xy.resize(count * 2);
+    env->GetFloatArrayRegion(points, 0, count * 2, xy.data());
+    return drawInk(env, stroke, xy.data(), count, overlay, dirty);
+}
+
+JNI_FUNC(jboolean, PdfiumSDK, nativeFinishInkStroke)(JNI_ARGS, jlong strokePtr, jobject overlay,
+                                                     jintArray dirty) {
+    InkStroke *stroke = reinterpret_cast<InkStroke *>(strokePtr);
+    if (stroke == NULL || overlay == NULL) return JNI_FALSE;
+    return drawInk(env, stroke, NULL, -1, overlay, dirty);
+}
+
+// Index of the new /Ink annotation, or -1
+JNI_FUNC(jint, PdfiumSDK, nativeCommitInkStroke)(JNI_ARGS, jlong strokePtr, jlong pagePtr,
+                                                 jint startX, jint startY, jint drawSizeHor,
+                                                 jint drawSizeVer, jfloat tolerance) {
+    InkStroke *stroke = reinterpret_cast<InkStroke *>(strokePtr);
+    Page *page = reinterpret_cast<Page *>(pagePtr);
+    if (stroke == NULL || page == NULL) return -1;
+    return commitInkStroke(page->get(), *stroke, startX, startY, drawSizeHor, drawSizeVer,
+                           tolerance);
+}
+
 ///////////////////////////////////////
 // PDF TextPage api
 ///////////
@@ -429,4 +624,855 @@ JNI_FUNC(void, PdfiumSDK, nativeCloseTextPage)(JNI_ARGS, jlong textPagePtr) {
     closeTextPageInternal(textPagePtr);
 }
 
-} // extern "C"
\ No newline at end of file
+///////////////////////////////////////
+// Links api
+///////////
+
+// Packs links as { float[] rects, int[] dests, String[] uris }, with rects
+// as left, top, right, bottom quadruples.
+static jobjectArray linksToJava(JNIEnv *env, const std::vector<PageLink> &links) {
+    jsize count = (jsize) links.size();
+    jfloatArray rects = env->NewFloatArray(count * 4);
+    jintArray dests = env->NewIntArray(count);
+    jobjectArray uris = env->NewObjectArray(count, gJniCache.stringClass, NULL);
+    if (rects == NULL || dests == NULL || uris == NULL) {
+        return NULL;
+    }
+
+    std::vector<jfloat> rectValues(count * 4);
+    std::vector<jint> destValues(count);
+    for (jsize i = 0; i < count; i++) {
+        const PageLink &link = links[i];
+        rectValues[i * 4] = link.rect.left;
+        rectValues[i * 4 + 1] = link.rect.top;
+        rectValues[i * 4 + 2] = link.rect.right;
+        rectValues[i * 4 + 3] = link.rect.bottom;
+        destValues[i] = link.destPageIndex;
+        if (!link.uri.empty()) {
+            jstring uri = env->NewString((const jchar *) link.uri.data(), (jsize) link.uri.size());
+            env->SetObjectArrayElement(uris, i, uri);
+            env->DeleteLocalRef(uri);
+        }
+    }
+    env->SetFloatArrayRegion(rects, 0, count * 4, rectValues.data());
+    env->SetIntArrayRegion(dests, 0, count, destValues.data());
+
+    jobjectArray result = env->NewObjectArray(3, gJniCache.objectClass, NULL);
+    env->SetObjectArrayElement(result, 0, rects);
+    env->SetObjectArrayElement(result, 1, dests);
+    env->SetObjectArrayElement(result, 2, uris);
+    return result;
+}
+
+JNI_FUNC(jobjectArray, PdfiumSDK, nativeGetPageLinks)(JNI_ARGS, jlong docPtr, jlong pagePtr,
+                                                      jboolean webLinks) {
+    Document *doc = reinterpret_cast<Document *>(docPtr);
+    Page *page = reinterpret_cast<Page *>(pagePtr);
+    if (doc == NULL || page == NULL) {
+        jniThrowException(env, "java/lang/IllegalStateException", "Document or page is null");
+        return NULL;
+    }
+
+    std::vector<PageLink> links;
+    extractPageLinks(doc->get(), page->get(), webLinks, &links);
+    return linksToJava(env, links);
+}
+
+// Links of a page that isn't opened: it is loaded outside the form
+// environment, for its links only, and released right away. Null if the
+// page can't be loaded.
+JNI_FUNC(jobjectArray, PdfiumSDK, nativeLoadPageLinks)(JNI_ARGS, jlong docPtr, jint pageIndex,
+                                                       jboolean webLinks) {
+    Document *doc = reinterpret_cast<Document *>(docPtr);
+    if (doc == NULL) {
+        jniThrowException(env, "java/lang/IllegalStateException", "Document is null");
+        return NULL;
+    }
+
+    ScopedFPDFPage page(FPDF_LoadPage(doc->get(), pageIndex));
+    if (!page) return NULL;
+    std::vector<PageLink> links;
+    extractPageLinks(doc->get(), page.get(), webLinks, &links);
+    return linksToJava(env, links);
+}
+
+///////////////////////////////////////
+// Outline api
+///////////
+// Packs a page of children as { int[] header, String[] titles } where header
+// holds the total child count followed by id, page index, has-children triples.
+JNI_FUNC(jobjectArray, PdfiumSDK, nativeGetOutlineChildren)(JNI_ARGS, jlong docPtr, jint nodeId,
+                                                            jint offset, jint limit) {
+    Document *doc = reinterpret_cast<Document *>(docPtr);
+    if (doc == NULL) {
+        jniThrowException(env, "java/lang/IllegalStateException", "Document is null");
+        return NULL;
+    }
+
+    OutlineTree *outline = doc->outline();
+    std::vector<int> children;
+    outline->getChildren(nodeId, offset, limit, &children);
+
+    jsize count = (jsize) children.size();
+    std::vector<jint> header(1 + count * 3);
+    header[0] = outline->childCount(nodeId);
+    jobjectArray titles = env->NewObjectArray(count, gJniCache.stringClass, NULL);
+    for (jsize i = 0; i < count; i++) {
+        int child = children[i];
+        header[1 + i * 3] = child;
+        header[2 + i * 3] = outline->pageIndex(child);
+        header[3 + i * 3] = outline->hasChildren(child) ? 1 : 0;
+
+        std::u16string title = outline->title(child);
+        jstring jtitle = env->NewString((const jchar *) title.data(), (jsize) title.size());
+        env->SetObjectArrayElement(titles, i, jtitle);
+        env->DeleteLocalRef(jtitle);
+    }
+
+    jintArray jheader = env->NewIntArray((jsize) header.size());
+    env->SetIntArrayRegion(jheader, 0, (jsize) header.size(), header.data());
+
+    jobjectArray result = env->NewObjectArray(2, gJniCache.objectClass, NULL);
+    env->SetObjectArrayElement(result, 0, jheader);
+    env->SetObjectArrayElement(result, 1, titles);
+    return result;
+}
+
+JNI_FUNC(jintArray, PdfiumSDK, nativeFindOutline)(JNI_ARGS, jlong docPtr, jstring title) {
+    Document *doc = reinterpret_cast<Document *>(docPtr);
+    if (doc == NULL || title == NULL) {
+        jniThrowException(env, "java/lang/IllegalStateException", "Document is null");
+        return NULL;
+    }
+
+    const jchar *chars = env->GetStringChars(title, NULL);
+    if (chars == NULL) {
+        return env->NewIntArray(0);
+    }
+    std::u16string query((const char16_t *) chars, env->GetStringLength(title));
+    env->ReleaseStringChars(title, chars);
+
+    std::vector<int> path;
+    doc->outline()->find(query, &path);
+
+    jintArray result = env->NewIntArray((jsize) path.size());
+    if (!path.empty()) {
+        env->SetIntArrayRegion(result, 0, (jsize) path.size(), path.data());
+    }
+    return result;
+}
+
+///////////////////////////////////////
+// Page hit-testing index api
+///////////
+// Index pointer, 0 if it can't be built
+JNI_FUNC(jlong, PdfiumSDK, nativeBuildPageIndex)(JNI_ARGS, jlong pagePtr) {
+    Page *page = reinterpret_cast<Page *>(pagePtr);
+    if (page == NULL) {
+        jniThrowException(env, "java/lang/IllegalStateException", "Page is null");
+        return 0;
+    }
+
+    TextIndex text(*page);
+    return reinterpret_cast<jlong>(text.buildPageIndex());
+}
+
+JNI_FUNC(void, PdfiumSDK, nativeClosePageIndex)(JNI_ARGS, jlong indexPtr) {
+    delete reinterpret_cast<PageIndex *>(indexPtr);
+}
+
+JNI_FUNC(jint, PdfiumSDK, nativeIndexCharAtPos)(JNI_ARGS, jlong indexPtr, jfloat x, jfloat y,
+                                                jfloat xTolerance, jfloat yTolerance) {
+    PageIndex *index = reinterpret_cast<PageIndex *>(indexPtr);
+    if (index == NULL) return -1;
+    return index->charIndexAtPos(x, y, xTolerance, yTolerance);
+}
+
+JNI_FUNC(jint, PdfiumSDK, nativeIndexLinkAtPos)(JNI_ARGS, jlong indexPtr, jfloat x, jfloat y) {
+    PageIndex *index = reinterpret_cast<PageIndex *>(indexPtr);
+    if (index == NULL) return -1;
+    return index->linkAtPos(x, y);
+}
+
+JNI_FUNC(jint, PdfiumSDK, nativeIndexAnnotAtPos)(JNI_ARGS, jlong indexPtr, jfloat x, jfloat y) {
+    PageIndex *index = reinterpret_cast<PageIndex *>(indexPtr);
+    if (index == NULL) return -1;
+    return index->annotAtPos(x, y);
+}
+
+JNI_FUNC(jint, PdfiumSDK, nativeIndexAnnotSubtype)(JNI_ARGS, jlong indexPtr, jint annotIndex) {
+    PageIndex *index = reinterpret_cast<PageIndex *>(indexPtr);
+    if (index == NULL) return -1;
+    return index->annotSubtype(annotIndex);
+}
+
+JNI_FUNC(jint, PdfiumSDK, nativeIndexCountChars)(JNI_ARGS, jlong indexPtr) {
+    PageIndex *index = reinterpret_cast<PageIndex *>(indexPtr);
+    if (index == NULL) return 0;
+    return index->countChars();
+}
+
+JNI_FUNC(jfloatArray, PdfiumSDK, nativeIndexGetCharRangeRects)(JNI_ARGS, jlong indexPtr,
+                                                              jint start, jint count) {
+    PageIndex *index = reinterpret_cast<PageIndex *>(indexPtr);
+    std::vector<float> rects;
+    if (index != NULL) {
+        index->getCharRangeRects(start, count, &rects);
+    }
+
+    jfloatArray result = env->NewFloatArray((jsize) rects.size());
+    if (result != NULL && !rects.empty()) {
+        env->SetFloatArrayRegion(result, 0, (jsize) rects.size(), rects.data());
+    }
+    return result;
+}
+
+///////////////////////////////////////
+// Form fill api
+///////////
+JNI_FUNC(jboolean, PdfiumSDK, nativeInitFormFill)(JNI_ARGS, jlong docPtr) {
+    Document *doc = reinterpret_cast<Document *>(docPtr);
+    if (doc == NULL) {
+        jniThrowException(env, "java/lang/IllegalStateException", "Document is null");
+        return JNI_FALSE;
+    }
+    return (jboolean) (doc->enableForms() != NULL);
+}
+
+// The form environment a page is attached to, NULL if forms are off
+static FormFill *pageForm(jlong pagePtr, Page **page) {
+    *page = reinterpret_cast<Page *>(pagePtr);
+    return *page != NULL ? (*page)->form() : NULL;
+}
+
+JNI_FUNC(jboolean, PdfiumSDK, nativeFormTap)(JNI_ARGS, jlong pagePtr, jfloat x, jfloat y) {
+    Page *page;
+    FormFill *form = pageForm(pagePtr, &page);
+    if (form == NULL) return JNI_FALSE;
+    return (jboolean) form->tap(page, x, y);
+}
+
+JNI_FUNC(jboolean, PdfiumSDK, nativeFormTypeText)(JNI_ARGS, jlong pagePtr, jstring text) {
+    Page *page;
+    FormFill *form = pageForm(pagePtr, &page);
+    if (form == NULL || text == NULL) return JNI_FALSE;
+
+    const jchar *chars = env->GetStringChars(text, NULL);
+    if (chars == NULL) return JNI_FALSE;
+    bool handled = form->typeText(page, reinterpret_cast<const uint16_t *>(chars),
+                                  (size_t) env->GetStringLength(text));
+    env->ReleaseStringChars(text, chars);
+    return (jboolean) handled;
+}
+
+JNI_FUNC(jboolean, PdfiumSDK, nativeFormPressKey)(JNI_ARGS, jlong pagePtr, jint keyCode,
+                                                  jint modifiers) {
+    Page *page;
+    FormFill *form = pageForm(pagePtr, &page);
+    if (form == NULL) return JNI_FALSE;
+    return (jboolean) form->pressKey(page, keyCode, modifiers);
+}
+
+JNI_FUNC(void, PdfiumSDK, nativeFormKillFocus)(JNI_ARGS, jlong docPtr) {
+    Document *doc = reinterpret_cast<Document *>(docPtr);
+    if (doc != NULL && doc->forms() != NULL) {
+        doc->forms()->killFocus();
+    }
+}
+
+// Packs the dirty rects as { int[] pages, float[] rects }, with rects as
+// page-relative left, top, right, bottom
+JNI_FUNC(jobjectArray, PdfiumSDK, nativeTakeFormDirtyRects)(JNI_ARGS, jlong docPtr) {
+    Document *doc = reinterpret_cast<Document *>(docPtr);
+    std::vector<DirtyRect> dirty;
+    if (doc != NULL && doc->forms() != NULL) {
+        doc->forms()->takeDirtyRects(&dirty);
+    }
+
+    jsize count = (jsize) dirty.size();
+    jintArray pages = env->NewIntArray(count);
+    jfloatArray rects = env->NewFloatArray(count * 4);
+    if (pages == NULL || rects == NULL) {
+        return NULL;
+    }
+
+    std::vector<jint> pageValues(count);
+    std::vector<jfloat> rectValues(count * 4);
+    for (jsize i = 0; i < count; i++) {
+        pageValues[i] = dirty[i].page;
+        rectValues[i * 4] = dirty[i].left;
+        rectValues[i * 4 + 1] = dirty[i].top;
+        rectValues[i * 4 + 2] = dirty[i].right;
+        rectValues[i * 4 + 3] = dirty[i].bottom;
+    }
+    env->SetIntArrayRegion(pages, 0, count, pageValues.data());
+    env->SetFloatArrayRegion(rects, 0, count * 4, rectValues.data());
+
+    jobjectArray result = env->NewObjectArray(2, gJniCache.objectClass, NULL);
+    env->SetObjectArrayElement(result, 0, pages);
+    env->SetObjectArrayElement(result, 1, rects);
+    return result;
+}
+
+///////////////////////////////////////
+// Batch thumbnails api
+///////////
+
+// Detaches a pool thread from the VM when it exits
+struct ThreadDetacher {
+    bool attached = false;
+
+    ~ThreadDetacher() {
+        if (attached) gJniCache.vm->DetachCurrentThread();
+    }
+};
+
+static JNIEnv *attachCurrentThread() {
+    static thread_local ThreadDetacher detacher;
+    JNIEnv *env = NULL;
+    if (gJniCache.vm->GetEnv(reinterpret_cast<void **>(&env), JNI_VERSION_1_6) == JNI_OK) {
+        return env;
+    }
+    if (gJniCache.vm->AttachCurrentThread(&env, NULL) != JNI_OK) {
+        return NULL;
+    }
+    detacher.attached = true;
+    return env;
+}
+
+/**
+ * Hands the thumbnails to an OnThumbnailListener as ARGB_8888 bitmaps. The
+ * PDFium lock is the monitor of PdfiumSDK.lock, so the batch interleaves
+ * with the synchronized calls made from Kotlin.
+ */
+class JniThumbnailSink : public ThumbnailSink {
+public:
+    JniThumbnailSink(JNIEnv *env, jobject lock, jobject listener, int workers)
+            : lock(env->NewGlobalRef(lock)), listener(env->NewGlobalRef(listener)),
+              envs(workers), bitmaps(workers) {}
+
+    void release(JNIEnv *env) {
+        env->DeleteGlobalRef(lock);
+        env->DeleteGlobalRef(listener);
+    }
+
+    void lockPdfium(int worker) override {
+        workerEnv(worker)->MonitorEnter(lock);
+    }
+
+    void unlockPdfium(int worker) override {
+        workerEnv(worker)->MonitorExit(lock);
+    }
+
+    bool beginThumbnail(int worker, int index, int width, int height,
+                        RenderTarget *target) override {
+        JNIEnv *env = workerEnv(worker);
+        jobject bitmap = env->CallStaticObjectMethod(gJniCache.bitmapClass,
+                                                     gJniCache.createBitmapMethod, width,
+                                                     height, gJniCache.argb8888Config);
+        AndroidBitmapInfo info;
+        void *pixels;
+        if (env->ExceptionCheck() || bitmap == NULL ||
+            AndroidBitmap_getInfo(env, bitmap, &info) < 0 ||
+            AndroidBitmap_lockPixels(env, bitmap, &pixels) != 0) {
+            env->ExceptionClear();
+            if (bitmap != NULL) env->DeleteLocalRef(bitmap);
+            deliver(env, index, NULL, "Cannot allocate the thumbnail bitmap");
+            return false;
+        }
+
+        bitmaps[worker] = bitmap;
+        target->pixels = pixels;
+        target->width = (int) info.width;
+        target->height = (int) info.height;
+        target->stride = (int) info.stride;
+        target->format = kTileRgba8888;
+        return true;
+    }
+
+    void endThumbnail(int worker, int index, bool rendered) override {
+        JNIEnv *env = workerEnv(worker);
+        jobject bitmap = bitmaps[worker];
+        bitmaps[worker] = NULL;
+        AndroidBitmap_unlockPixels(env, bitmap);
+        deliver(env, index, rendered ? bitmap : NULL, rendered ? NULL : "Cannot render the page");
+        env->DeleteLocalRef(bitmap);
+    }
+
+    void failThumbnail(int worker, int index, const char *error) override {
+        deliver(workerEnv(worker), index, NULL, error);
+    }
+
+private:
+    JNIEnv *workerEnv(int worker) {
+        if (envs[worker] == NULL) envs[worker] = attachCurrentThread();
+        return envs[worker];
+    }
+
+    void deliver(JNIEnv *env, int index, jobject bitmap, const char *error) {
+        jstring message = error != NULL ? env->NewStringUTF(error) : NULL;
+        env->CallVoidMethod(listener, gJniCache.onThumbnailMethod, index, bitmap, message);
+        if (env->ExceptionCheck()) {
+            LOGE("OnThumbnailListener threw for document %d", index);
+            env->ExceptionDescribe();
+            env->ExceptionClear();
+        }
+        if (message != NULL) env->DeleteLocalRef(message);
+    }
+
+    jobject lock;
+    jobject listener;
+    // Indexed by pool worker, each only touched by its own thread
+    std::vector<JNIEnv *> envs;
+    std::vector<jobject> bitmaps;
+};
+
+JNI_FUNC(void, PdfiumSDK, nativeRenderThumbnails)(JNI_ARGS, jintArray fdArray, jint width,
+                                                  jint height, jobject lock, jobject listener) {
+    if (fdArray == NULL || lock == NULL || listener == NULL || width <= 0 || height <= 0) {
+        jniThrowException(env, "java/lang/IllegalStateException", "Invalid thumbnail batch");
+        return;
+    }
+    jsize count = env->GetArrayLength(fdArray);
+    if (count == 0) return;
+    std::vector<int> fds(count);
+    env->GetIntArrayRegion(fdArray, 0, count, reinterpret_cast<jint *>(fds.data()));
+
+    int workers = (int) std::min<unsigned>(std::max(1u, std::thread::hardware_concurrency()),
+                                           (unsigned) count);
+    JniThumbnailSink sink(env, lock, listener, workers);
+    {
+        WorkStealingPool pool(workers);
+        renderThumbnails(&pool, fds, width, height, &sink);
+    }
+    sink.release(env);
+}
+
+///////////////////////////////////////
+// Page assembly api
+///////////
+class JniAssemblySink : public JniMonitorSink<AssemblySink> {
+public:
+    using JniMonitorSink::JniMonitorSink;
+
+    bool onSourceAssembled(int index, int pages) override {
+        return notifyListener("OnAssemblyListener", gJniCache.onSourceAssembledMethod, index,
+                              pages);
+    }
+};
+
+// Element i of a String[], empty if null
+static std::string stringElement(JNIEnv *env, jobjectArray strings, jsize i) {
+    std::string value;
+    jstring element = (jstring) env->GetObjectArrayElement(strings, i);
+    const char *chars = element != NULL ? env->GetStringUTFChars(element, NULL) : NULL;
+    if (chars != NULL) {
+        value = chars;
+        env->ReleaseStringUTFChars(element, chars);
+    }
+    env->DeleteLocalRef(element);
+    return value;
+}
+
+// Options are columns, rows, kAssembly* flags and sync mode. Returns
+// { pages, bytes written, nanoseconds, skipped sources... }, null if the
+// listener cancelled, and throws IOException if the job failed.
+JNI_FUNC(jlongArray, PdfiumSDK, nativeAssemblePages)(JNI_ARGS, jintArray fdArray,
+                                                     jobjectArray passwords, jobjectArray ranges,
+                                                     jintArray optionArray, jfloat sheetWidth,
+                                                     jfloat sheetHeight, jint outputFd,
+                                                     jobject lock, jobject listener) {
+    enum {
+        kAssemblyViewerPreferences = 1,
+        kAssemblyOddPageStarts = 2,
+        kAssemblySkipBroken = 4,
+    };
+    if (fdArray == NULL || passwords == NULL || ranges == NULL || optionArray == NULL ||
+        lock == NULL || env->GetArrayLength(optionArray) < 4) {
+        jniThrowException(env, "java/lang/IllegalStateException", "Invalid assembly job");
+        return NULL;
+    }
+    jsize count = env->GetArrayLength(fdArray);
+    std::vector<jint> fds(count);
+    env->GetIntArrayRegion(fdArray, 0, count, fds.data());
+    std::vector<AssemblySource> sources(count);
+    for (jsize i = 0; i < count; i++) {
+        sources[i].fd = fds[i];
+        sources[i].password = stringElement(env, passwords, i);
+        sources[i].pageRange = stringElement(env, ranges, i);
+    }
+
+    jint values[4];
+    env->GetIntArrayRegion(optionArray, 0, 4, values);
+    AssemblyOptions options;
+    options.columns = values[0];
+    options.rows = values[1];
+    options.sheetWidth = sheetWidth;
+    options.sheetHeight = sheetHeight;
+    options.copyViewerPreferences = (values[2] & kAssemblyViewerPreferences) != 0;
+    options.oddPageStarts = (values[2] & kAssemblyOddPageStarts) != 0;
+    options.skipBrokenSources = (values[2] & kAssemblySkipBroken) != 0;
+
+    JniAssemblySink sink(env, lock, listener);
+    AssemblyResult result;
+    if (!assemblePages(sources, options, outputFd, (SyncMode) values[3], &sink, &result)) {
+        if (!result.cancelled) jniThrowException(env, "java/io/IOException", result.error);
+        return NULL;
+    }
+
+    std::vector<jlong> packed = {result.pages, (jlong) result.bytesWritten, result.elapsedNanos};
+    packed.insert(packed.end(), result.skippedSources.begin(), result.skippedSources.end());
+    jlongArray jresult = env->NewLongArray((jsize) packed.size());
+    if (jresult != NULL) {
+        env->SetLongArrayRegion(jresult, 0, (jsize) packed.size(), packed.data());
+    }
+    return jresult;
+}
+
+///////////////////////////////////////
+// Print api
+///////////
+class JniPrintSink : public JniMonitorSink<PrintSink> {
+public:
+    using JniMonitorSink::JniMonitorSink;
+
+    bool onPageRendered(int index, int pageIndex) override {
+        return notifyListener("OnPrintListener", gJniCache.onPageRenderedMethod, index,
+                              pageIndex);
+    }
+};
+
+// Returns { pages, bytes written, nanoseconds, band memory }, null if the
+// listener cancelled, and throws IOException if the job failed.
+JNI_FUNC(jlongArray, PdfiumSDK, nativePrintPages)(JNI_ARGS, jlong documentPtr, jintArray pageArray,
+                                                  jint dpi, jboolean grayscale, jint outputFd,
+                                                  jint syncMode, jobject lock, jobject listener) {
+    Document *doc = reinterpret_cast<Document *>(documentPtr);
+    if (doc == NULL || pageArray == NULL || lock == NULL) {
+        jniThrowException(env, "java/lang/IllegalStateException", "Invalid print job");
+        return NULL;
+    }
+    jsize count = env->GetArrayLength(pageArray);
+    std::vector<int> pages(count);
+    env->GetIntArrayRegion(pageArray, 0, count, reinterpret_cast<jint *>(pages.data()));
+
+    PrintOptions options;
+    options.dpi = dpi;
+    options.grayscale = grayscale == JNI_TRUE;
+    JniPrintSink sink(env, lock, listener);
+    PrintResult result;
+    if (!printPages(doc, pages, options, outputFd, (SyncMode) syncMode, &sink, &result)) {
+        if (!result.cancelled) jniThrowException(env, "java/io/IOException", result.error);
+        return NULL;
+    }
+
+    const jlong packed[] = {result.pages, (jlong) result.bytesWritten, result.elapsedNanos,
+                            (jlong) result.bandMemory};
+    jlongArray jresult = env->NewLongArray(4);
+    if (jresult != NULL) env->SetLongArrayRegion(jresult, 0, 4, packed);
+    return jresult;
+}
+
+///////////////////////////////////////
+// Flatten api
+///////////
+class JniFlattenSink : public JniMonitorSink<FlattenSink> {
+public:
+    using JniMonitorSink::JniMonitorSink;
+
+    bool onPageFlattened(int pageIndex, bool flattened) override {
+        return notifyListener("OnFlattenListener", gJniCache.onPageFlattenedMethod, pageIndex,
+                              (jboolean) flattened);
+    }
+};
+
+// Returns { pages, flattened pages, bytes written, nanoseconds }, null if
+// the listener cancelled, and throws IOException if the job failed.
+JNI_FUNC(jlongArray, PdfiumSDK, nativeFlattenDocument)(JNI_ARGS, jlong documentPtr, jint outputFd,
+                                                       jboolean forPrint, jint version,
+                                                       jint syncMode, jobject lock,
+                                                       jobject listener) {
+    Document *doc = reinterpret_cast<Document *>(documentPtr);
+    if (doc == NULL || lock == NULL) {
+        jniThrowException(env, "java/lang/IllegalStateException", "Invalid flatten job");
+        return NULL;
+    }
+
+    FlattenOptions options;
+    options.forPrint = forPrint == JNI_TRUE;
+    options.version = version;
+    JniFlattenSink sink(env, lock, listener);
+    FlattenResult result;
+    if (!flattenDocument(doc, options, outputFd, (SyncMode) syncMode, &sink, &result)) {
+        if (!result.cancelled) jniThrowException(env, "java/io/IOException", result.error);
+        return NULL;
+    }
+
+    const jlong packed[] = {result.pages, result.flattenedPages, (jlong) result.bytesWritten,
+                            result.elapsedNanos};
+    jlongArray jresult = env->NewLongArray(4);
+    if (jresult != NULL) env->SetLongArrayRegion(jresult, 0, 4, packed);
+    return jresult;
+}
+
+///////////////////////////////////////
+// Instrumentation api
+///////////
+JNI_FUNC(void, PdfiumSDK, nativeSetStatsMode)(JNI_ARGS, jint mode) {
+    setStatsMode(mode);
+}
+
+JNI_FUNC(void, PdfiumSDK, nativeResetStats)(JNI_ARGS) {
+    resetStats();
+}
+
+JNI_FUNC(jlongArray, PdfiumSDK, nativeGetStats)(JNI_ARGS) {
+    std::vector<int64_t> stats;
+    snapshotStats(&stats);
+
+    jlongArray result = env->NewLongArray((jsize) stats.size());
+    if (result != NULL) {
+        env->SetLongArrayRegion(result, 0, (jsize) stats.size(),
+                                reinterpret_cast<const jlong *>(stats.data()));
+    }
+    return result;
+}
+
+///////////////////////////////////////
+// Fast-path api
+//
+// Primitive-only getters bound to PdfiumFastNatives. From Android O they are
+// @CriticalNative (no JNIEnv, no class argument, no transition bookkeeping);
+// older releases ignore the annotation and get the regular wrappers below.
+// They can't take PdfiumSDK.lock, so none of them calls into PDFium: the
+// page getters read what Document cached at open (the SDK opens documents
+// with cachePageSizes), the others a PageIndex.
+///////////
+static jint criticalGetPageCount(jlong docPtr) {
+    Document *doc = reinterpret_cast<Document *>(docPtr);
+    if (doc == NULL) return 0;
+    return (jint) doc->pageCount();
+}
+
+// Width and height in points as float bits, width in the high word
+static jlong criticalGetPageSizePacked(jlong docPtr, jint pageIndex) {
+    Document *doc = reinterpret_cast<Document *>(docPtr);
+    FS_SIZEF size = {0, 0};
+    if (doc == NULL || !doc->cachedPageSize(pageIndex, &size)) {
+        size.width = 0;
+        size.height = 0;
+    }
+    uint32_t widthBits, heightBits;
+    memcpy(&widthBits, &size.width, sizeof(widthBits));
+    memcpy(&heightBits, &size.height, sizeof(heightBits));
+    return (jlong) (((uint64_t) widthBits << 32) | heightBits);
+}
+
+static jint criticalIndexCountChars(jlong indexPtr) {
+    PageIndex *index = reinterpret_cast<PageIndex *>(indexPtr);
+    return index != NULL ? index->countChars() : 0;
+}
+
+static jint criticalIndexCharAtPos(jlong indexPtr, jfloat x, jfloat y,
+                                   jfloat xTolerance, jfloat yTolerance) {
+    PageIndex *index = reinterpret_cast<PageIndex *>(indexPtr);
+    return index != NULL ? index->charIndexAtPos(x, y, xTolerance, yTolerance) : -1;
+}
+
+static jint criticalIndexLinkAtPos(jlong indexPtr, jfloat x, jfloat y) {
+    PageIndex *index = reinterpret_cast<PageIndex *>(indexPtr);
+    return index != NULL ? index->linkAtPos(x, y) : -1;
+}
+
+static jint criticalIndexAnnotAtPos(jlong indexPtr, jfloat x, jfloat y) {
+    PageIndex *index = reinterpret_cast<PageIndex *>(indexPtr);
+    return index != NULL ? index->annotAtPos(x, y) : -1;
+}
+
+static jint regularGetPageCount(JNIEnv *, jclass, jlong docPtr) {
+    return criticalGetPageCount(docPtr);
+}
+
+static jlong regularGetPageSizePacked(JNIEnv *, jclass, jlong docPtr, jint pageIndex) {
+    return criticalGetPageSizePacked(docPtr, pageIndex);
+}
+
+static jint regularIndexCountChars(JNIEnv *, jclass, jlong indexPtr) {
+    return criticalIndexCountChars(indexPtr);
+}
+
+static jint regularIndexCharAtPos(JNIEnv *, jclass, jlong indexPtr, jfloat x, jfloat y,
+                                  jfloat xTolerance, jfloat yTolerance) {
+    return criticalIndexCharAtPos(indexPtr, x, y, xTolerance, yTolerance);
+}
+
+static jint regularIndexLinkAtPos(JNIEnv *, jclass, jlong indexPtr, jfloat x, jfloat y) {
+    return criticalIndexLinkAtPos(indexPtr, x, y);
+}
+
+static jint regularIndexAnnotAtPos(JNIEnv *, jclass, jlong indexPtr, jfloat x, jfloat y) {
+    return criticalIndexAnnotAtPos(indexPtr, x, y);
+}
+
+// @FastNative keeps the JNIEnv, so the same function serves every release
+static jfloatArray fastIndexGetCharRangeRects(JNIEnv *env, jclass, jlong indexPtr,
+                                              jint start, jint count) {
+    return Java_com_hungknow_pdfsdk_PdfiumSDK_nativeIndexGetCharRangeRects(env, NULL, indexPtr,
+                                                                           start, count);
+}
+
+static bool sFastNativesRegistered = false;
+
+static jboolean nativeFastNativesRegistered(JNIEnv *, jclass) {
+    return (jboolean) sFastNativesRegistered;
+}
+
+#define FAST_METHOD(name, signature, fn) { #name, signature, reinterpret_cast<void *>(fn) }
+
+static const JNINativeMethod sCriticalMethods[] = {
+        FAST_METHOD(nativeIsRegistered, "()Z", nativeFastNativesRegistered),
+        FAST_METHOD(nativeGetPageCount, "(J)I", criticalGetPageCount),
+        FAST_METHOD(nativeGetPageSizePacked, "(JI)J", criticalGetPageSizePacked),
+        FAST_METHOD(nativeIndexCountChars, "(J)I", criticalIndexCountChars),
+        FAST_METHOD(nativeIndexCharAtPos, "(JFFFF)I", criticalIndexCharAtPos),
+        FAST_METHOD(nativeIndexLinkAtPos, "(JFF)I", criticalIndexLinkAtPos),
+        FAST_METHOD(nativeIndexAnnotAtPos, "(JFF)I", criticalIndexAnnotAtPos),
+        FAST_METHOD(nativeIndexGetCharRangeRects, "(JII)[F", fastIndexGetCharRangeRects),
+};
+
+static const JNINativeMethod sRegularMethods[] = {
+        FAST_METHOD(nativeIsRegistered, "()Z", nativeFastNativesRegistered),
+        FAST_METHOD(nativeGetPageCount, "(J)I", regularGetPageCount),
+        FAST_METHOD(nativeGetPageSizePacked, "(JI)J", regularGetPageSizePacked),
+        FAST_METHOD(nativeIndexCountChars, "(J)I", regularIndexCountChars),
+        FAST_METHOD(nativeIndexCharAtPos, "(JFFFF)I", regularIndexCharAtPos),
+        FAST_METHOD(nativeIndexLinkAtPos, "(JFF)I", regularIndexLinkAtPos),
+        FAST_METHOD(nativeIndexAnnotAtPos, "(JFF)I", regularIndexAnnotAtPos),
+        FAST_METHOD(nativeIndexGetCharRangeRects, "(JII)[F", fastIndexGetCharRangeRects),
+};
+
+#undef FAST_METHOD
+
+static int getDeviceApiLevel() {
+    char value[PROP_VALUE_MAX] = {0};
+    if (__system_property_get("ro.build.version.sdk", value) <= 0) return 0;
+    return atoi(value);
+}
+
+///////////////////////////////////////
+// Library loading
+///////////
+static const JNINativeMethod sPdfiumSDKMethods[] = {
+        NATIVE_METHOD(PdfiumSDK, nativeInitLibrary, "()V"),
+        NATIVE_METHOD(PdfiumSDK, nativeReleaseLibrary, "()V"),
+        NATIVE_METHOD(PdfiumSDK, nativeWarmUp, "()[J"),
+        NATIVE_METHOD(PdfiumSDK, nativeSetFontIndex, "(Ljava/lang/String;[Ljava/lang/String;)I"),
+        NATIVE_METHOD(PdfiumSDK, nativeOpenDocument, "(ILjava/lang/String;)J"),
+        NATIVE_METHOD(PdfiumSDK, nativeOpenMemDocument, "([BLjava/lang/String;)J"),
+        NATIVE_METHOD(PdfiumSDK, nativeGetPageCount, "(J)I"),
+        NATIVE_METHOD(PdfiumSDK, nativeCloseDocument, "(J)V"),
+        NATIVE_METHOD(PdfiumSDK, nativeSaveDocument, "(JIIII)J"),
+        NATIVE_METHOD(PdfiumSDK, nativeTakeSaveSnapshot, "(JII)J"),
+        NATIVE_METHOD(PdfiumSDK, nativeCloseSaveSnapshot, "(J)V"),
+        NATIVE_METHOD(PdfiumSDK, nativeWriteSaveSnapshot,
+                      "(JLjava/lang/String;ILcom/hungknow/pdfsdk/listeners/OnSaveListener;)Z"),
+        NATIVE_METHOD(PdfiumSDK, nativeGetDocumentMetaText, "(JLjava/lang/String;)Ljava/lang/String;"),
+        NATIVE_METHOD(PdfiumSDK, nativeGetDocumentInfo, "(J)[Ljava/lang/Object;"),
+        NATIVE_METHOD(PdfiumSDK, nativeGetPageLabels, "(J)[Ljava/lang/Object;"),
+        NATIVE_METHOD(PdfiumSDK, nativeLoadPage, "(JI)J"),
+        NATIVE_METHOD(PdfiumSDK, nativeClosePage, "(J)V"),
+        NATIVE_METHOD(PdfiumSDK, nativeClosePages, "([J)V"),
+        NATIVE_METHOD(PdfiumSDK, nativeGetPageSizeByIndex, "(JII)Lcom/hungknow/pdfsdk/models/Size;"),
+        NATIVE_METHOD(PdfiumSDK, nativeGetAllPageSizes, "(JI)[F"),
+        NATIVE_METHOD(PdfiumSDK, nativeRenderPageBitmap, "(JLandroid/graphics/Bitmap;IIIIIZI)V"),
+        NATIVE_METHOD(PdfiumSDK, nativeGetLayerAnnots, "(J)[Ljava/lang/Object;"),
+        NATIVE_METHOD(PdfiumSDK, nativeRenderAnnotation, "(JILandroid/graphics/Bitmap;IIIII)Z"),
+        NATIVE_METHOD(PdfiumSDK, nativeExportAnnotations, "(JII)[B"),
+        NATIVE_METHOD(PdfiumSDK, nativeImportAnnotations, "(J[BZ)I"),
+        NATIVE_METHOD(PdfiumSDK, nativeNewInkStroke, "(IF)J"),
+        NATIVE_METHOD(PdfiumSDK, nativeCloseInkStroke, "(J)V"),
+        NATIVE_METHOD(PdfiumSDK, nativeAddInkPoints, "(J[FILandroid/graphics/Bitmap;[I)Z"),
+        NATIVE_METHOD(PdfiumSDK, nativeFinishInkStroke, "(JLandroid/graphics/Bitmap;[I)Z"),
+        NATIVE_METHOD(PdfiumSDK, nativeCommitInkStroke, "(JJIIIIF)I"),
+        NATIVE_METHOD(PdfiumSDK, nativeCloseTextPage, "(J)V"),
+        NATIVE_METHOD(PdfiumSDK, nativeGetPageLinks, "(JJZ)[Ljava/lang/Object;"),
+        NATIVE_METHOD(PdfiumSDK, nativeLoadPageLinks, "(JIZ)[Ljava/lang/Object;"),
+        NATIVE_METHOD(PdfiumSDK, nativeGetOutlineChildren, "(JIII)[Ljava/lang/Object;"),
+        NATIVE_METHOD(PdfiumSDK, nativeFindOutline, "(JLjava/lang/String;)[I"),
+        NATIVE_METHOD(PdfiumSDK, nativeBuildPageIndex, "(J)J"),
+        NATIVE_METHOD(PdfiumSDK, nativeClosePageIndex, "(J)V"),
+        NATIVE_METHOD(PdfiumSDK, nativeIndexCharAtPos, "(JFFFF)I"),
+        NATIVE_METHOD(PdfiumSDK, nativeIndexLinkAtPos, "(JFF)I"),
+        NATIVE_METHOD(PdfiumSDK, nativeIndexAnnotAtPos, "(JFF)I"),
+        NATIVE_METHOD(PdfiumSDK, nativeIndexAnnotSubtype, "(JI)I"),
+        NATIVE_METHOD(PdfiumSDK, nativeIndexGetCharRangeRects, "(JII)[F"),
+        NATIVE_METHOD(PdfiumSDK, nativeIndexCountChars, "(J)I"),
+        NATIVE_METHOD(PdfiumSDK, nativeInitFormFill, "(J)Z"),
+        NATIVE_METHOD(PdfiumSDK, nativeFormTap, "(JFF)Z"),
+        NATIVE_METHOD(PdfiumSDK, nativeFormTypeText, "(JLjava/lang/String;)Z"),
+        NATIVE_METHOD(PdfiumSDK, nativeFormPressKey, "(JII)Z"),
+        NATIVE_METHOD(PdfiumSDK, nativeFormKillFocus, "(J)V"),
+        NATIVE_METHOD(PdfiumSDK, nativeTakeFormDirtyRects, "(J)[Ljava/lang/Object;"),
+        NATIVE_METHOD(PdfiumSDK, nativeRenderThumbnails,
+                      "([IIILjava/lang/Object;Lcom/hungknow/pdfsdk/listeners/OnThumbnailListener;)V"),
+        NATIVE_METHOD(PdfiumSDK, nativeAssemblePages,
+                      "([I[Ljava/lang/String;[Ljava/lang/String;[IFFILjava/lang/Object;"
+                      "Lcom/hungknow/pdfsdk/listeners/OnAssemblyListener;)[J"),
+        NATIVE_METHOD(PdfiumSDK, nativePrintPages,
+                      "(J[IIZIILjava/lang/Object;Lcom/hungknow/pdfsdk/listeners/OnPrintListener;)[J"),
+        NATIVE_METHOD(PdfiumSDK, nativeFlattenDocument,
+                      "(JIZIILjava/lang/Object;Lcom/hungknow/pdfsdk/listeners/OnFlattenListener;)[J"),
+        NATIVE_METHOD(PdfiumSDK, nativeSetStatsMode, "(I)V"),
+        NATIVE_METHOD(PdfiumSDK, nativeResetStats, "()V"),
+        NATIVE_METHOD(PdfiumSDK, nativeGetStats, "()[J"),
+};
+
+static bool registerNatives(JNIEnv *env, const char *className,
+                            const JNINativeMethod *methods, int count) {
+    jclass clazz = env->FindClass(className);
+    if (clazz == NULL) {
+        LOGE("Unable to find class %s", className);
+        return false;
+    }
+    bool registered = env->RegisterNatives(clazz, methods, count) == JNI_OK;
+    env->DeleteLocalRef(clazz);
+    if (!registered) {
+        LOGE("Unable to register natives of %s", className);
+    }
+    return registered;
+}
+
+JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM *vm, void *) {
+    JNIEnv *env;
+    if (vm->GetEnv(reinterpret_cast<void **>(&env), JNI_VERSION_1_6) != JNI_OK) {
+        return JNI_ERR;
+    }
+    if (!initJniCache(env)) {
+        return JNI_ERR;
+    }
+    if (!registerNatives(env, "com/hungknow/pdfsdk/PdfiumSDK", sPdfiumSDKMethods,
+                         sizeof(sPdfiumSDKMethods) / sizeof(sPdfiumSDKMethods[0]))) {
+        return JNI_ERR;
+    }
+
+    // The fast path is optional: if it can't be bound Kotlin keeps using the
+    // regular PdfiumSDK natives.
+    bool critical = getDeviceApiLevel() >= 26;
+    const JNINativeMethod *fastMethods = critical ? sCriticalMethods : sRegularMethods;
+    sFastNativesRegistered = registerNatives(env, "com/hungknow/pdfsdk/PdfiumFastNatives",
+                                             fastMethods,
+                                             sizeof(sCriticalMethods) / sizeof(sCriticalMethods[0]));
+    if (!sFastNativesRegistered) {
+        env->ExceptionClear();
+    }
+    return JNI_VERSION_1_6;
+}
+
+JNIEXPORT void JNICALL JNI_OnUnload(JavaVM *vm, void *) {
+    JNIEnv *env;
+    if (vm->GetEnv(reinterpret_cast<void **>(&env), JNI_VERSION_1_6) == JNI_OK) {
+        releaseJniCache(env);
+    }
+}
+
+} // extern "C"
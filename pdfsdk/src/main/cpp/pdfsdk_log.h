@@ -0,0 +1,29 @@
+#ifndef PDFVIEW_PDFSDK_LOG_H
+#define PDFVIEW_PDFSDK_LOG_H
+
+// Logging of the portable modules: logcat on Android, stderr elsewhere
+
+#define LOG_TAG "PDFSDK"
+
+#ifdef __ANDROID__
+
+#include <android/log.h>
+
+#define LOGI(...)   __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
+#define LOGE(...)   __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+#define LOGD(...)   __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, __VA_ARGS__)
+
+#else
+
+#include <stdio.h>
+
+#define LOG_PRINT_(level, ...) \
+    (fprintf(stderr, "%s/%s: ", level, LOG_TAG), fprintf(stderr, __VA_ARGS__), \
+     fputc('\n', stderr))
+#define LOGI(...)   LOG_PRINT_("I", __VA_ARGS__)
+#define LOGE(...)   LOG_PRINT_("E", __VA_ARGS__)
+#define LOGD(...)   LOG_PRINT_("D", __VA_ARGS__)
+
+#endif
+
+#endif //PDFVIEW_PDFSDK_LOG_H
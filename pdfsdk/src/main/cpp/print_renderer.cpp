@@ -0,0 +1,244 @@
+#include "print_renderer.h"
+#include "document.h"
+#include "raster_pdf_writer.h"
+#include "render_stats.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include <public/fpdf_formfill.h>
+#include <public/fpdfview.h>
+#include <public/cpp/fpdf_scopers.h>
+
+// Rows of a page on their way from the renderer to the encoder
+struct Band {
+    std::vector<uint8_t> pixels;
+    int stride = 0;
+    int rows = 0;
+    bool firstOfPage = false;
+    bool lastOfPage = false;
+    float widthPoints = 0;
+    float heightPoints = 0;
+    int pixelWidth = 0;
+    int pixelHeight = 0;
+};
+
+/**
+ * The fixed set of bands the renderer and the encoder pass back and forth:
+ * the renderer fills free bands and submits them, the encoder takes them in
+ * order and releases them. Either side can abort, which wakes the other.
+ */
+class BandQueue {
+public:
+    explicit BandQueue(int count) : bands(count), closed(false), stopped(false) {
+        for (Band &band : bands) freeBands.push_back(&band);
+    }
+
+    // A free band, NULL once aborted
+    Band *acquire() {
+        std::unique_lock<std::mutex> guard(mutex);
+        changed.wait(guard, [this] { return stopped || !freeBands.empty(); });
+        if (stopped) return nullptr;
+        Band *band = freeBands.front();
+        freeBands.pop_front();
+        return band;
+    }
+
+    void submit(Band *band) {
+        std::lock_guard<std::mutex> guard(mutex);
+        filledBands.push_back(band);
+        changed.notify_all();
+    }
+
+    // The next band to encode, NULL once closed and drained or aborted
+    Band *next() {
+        std::unique_lock<std::mutex> guard(mutex);
+        changed.wait(guard, [this] { return stopped || closed || !filledBands.empty(); });
+        if (stopped || filledBands.empty()) return nullptr;
+        Band *band = filledBands.front();
+        filledBands.pop_front();
+        return band;
+    }
+
+    void release(Band *band) {
+        std::lock_guard<std::mutex> guard(mutex);
+        freeBands.push_back(band);
+        changed.notify_all();
+    }
+
+    // No more bands will be submitted
+    void close() {
+        std::lock_guard<std::mutex> guard(mutex);
+        closed = true;
+        changed.notify_all();
+    }
+
+    void abort() {
+        std::lock_guard<std::mutex> guard(mutex);
+        stopped = true;
+        changed.notify_all();
+    }
+
+    bool aborted() {
+        std::lock_guard<std::mutex> guard(mutex);
+        return stopped;
+    }
+
+    // Buffers only grow, so once both sides are done this is the peak
+    uint64_t memory() const {
+        uint64_t total = 0;
+        for (const Band &band : bands) total += band.pixels.capacity();
+        return total;
+    }
+
+private:
+    std::vector<Band> bands;
+    std::deque<Band *> freeBands;
+    std::deque<Band *> filledBands;
+    std::mutex mutex;
+    std::condition_variable changed;
+    bool closed;
+    bool stopped;
+};
+
+static void encodeBands(BandQueue *queue, RasterPdfWriter *writer) {
+    while (Band *band = queue->next()) {
+        bool encoded = !band->firstOfPage ||
+                       writer->beginPage(band->widthPoints, band->heightPoints,
+                                         band->pixelWidth, band->pixelHeight);
+        encoded = encoded && writer->addBand(band->pixels.data(), band->stride, band->rows);
+        encoded = encoded && (!band->lastOfPage || writer->endPage());
+        queue->release(band);
+        if (!encoded) {
+            queue->abort();
+            return;
+        }
+    }
+}
+
+// Renders rows [top, top + band->rows) of the page scaled to width x height
+static bool renderBand(Page *page, Band *band, int width, int height, int top, int flags) {
+    ScopedFPDFBitmap bitmap(FPDFBitmap_CreateEx(width, band->rows, FPDFBitmap_BGRx,
+                                                band->pixels.data(), band->stride));
+    if (!bitmap) return false;
+    // Printed on paper, transparent pages are white
+    FPDFBitmap_FillRect(bitmap.get(), 0, 0, width, band->rows, 0xFFFFFFFF);
+
+    StageTimer timer(kStageRasterize);
+    const FS_MATRIX matrix = {width / page->width(), 0, 0, height / page->height(), 0,
+                              (float) -top};
+    const FS_RECTF clip = {0, 0, (float) width, (float) band->rows};
+    FPDF_RenderPageBitmapWithMatrix(bitmap.get(), page->get(), &matrix, &clip, flags);
+    if (page->form() != NULL) {
+        FPDF_FFLDraw(page->form()->get(), bitmap.get(), page->get(), 0, -top, width, height, 0,
+                     flags);
+    }
+    countStat(kCounterPixelsRendered, (int64_t) width * band->rows);
+    return true;
+}
+
+static bool renderPages(Document *doc, const std::vector<int> &pages,
+                        const PrintOptions &options, BandQueue *queue, PrintSink *sink,
+                        PrintResult *result) {
+    // Without FPDF_REVERSE_BYTE_ORDER: the encoder takes BGRx
+    const int flags = FPDF_PRINTING | FPDF_ANNOT | (options.grayscale ? FPDF_GRAYSCALE : 0);
+    for (size_t i = 0; i < pages.size(); i++) {
+        std::unique_ptr<Page> page;
+        int width = 0, height = 0;
+        {
+            PdfiumLock lock(sink);
+            page = doc->loadPage(pages[i]);
+            if (page) {
+                width = (int) (page->width() * options.dpi / 72 + 0.5f);
+                height = (int) (page->height() * options.dpi / 72 + 0.5f);
+            }
+        }
+        if (!page || width <= 0 || height <= 0) {
+            PdfiumLock lock(sink);
+            page.reset();
+            result->error = "Cannot load a page to print";
+            return false;
+        }
+
+        const int stride = width * 4;
+        const int bandRows = (int) std::min<size_t>(
+                std::max<size_t>(1, options.bandBytes / stride), (size_t) height);
+        bool rendered = true;
+        for (int top = 0; rendered && top < height; top += bandRows) {
+            Band *band = queue->acquire();
+            if (band == nullptr) {
+                rendered = false;
+                break;
+            }
+            band->pixels.resize((size_t) stride * bandRows);
+            band->stride = stride;
+            band->rows = std::min(bandRows, height - top);
+            band->firstOfPage = top == 0;
+            band->lastOfPage = top + band->rows == height;
+            band->widthPoints = page->width();
+            band->heightPoints = page->height();
+            band->pixelWidth = width;
+            band->pixelHeight = height;
+            {
+                PdfiumLock lock(sink);
+                rendered = renderBand(page.get(), band, width, height, top, flags);
+            }
+            if (rendered) {
+                queue->submit(band);
+            } else {
+                queue->release(band);
+            }
+        }
+        {
+            PdfiumLock lock(sink);
+            page.reset();
+        }
+        if (!rendered) {
+            result->error = queue->aborted() ? "Cannot write the print output"
+                                             : "Cannot render a page to print";
+            return false;
+        }
+        result->pages++;
+        if (!sink->onPageRendered((int) i, pages[i])) {
+            result->cancelled = true;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool printPages(Document *doc, const std::vector<int> &pages, const PrintOptions &options,
+                int outputFd, SyncMode sync, PrintSink *sink, PrintResult *result) {
+    const int64_t start = statsNowNanos();
+    *result = PrintResult();
+    if (doc == NULL || pages.empty() || options.dpi <= 0 || outputFd < 0) {
+        result->error = "Nothing to print";
+        return false;
+    }
+
+    RasterPdfWriter writer(outputFd);
+    BandQueue queue(std::max(2, options.bandsInFlight));
+    bool printed;
+    {
+        std::thread encoder(encodeBands, &queue, &writer);
+        printed = renderPages(doc, pages, options, &queue, sink, result);
+        if (printed) {
+            queue.close();
+        } else {
+            queue.abort();
+        }
+        encoder.join();
+    }
+    if (printed && (queue.aborted() || !writer.finish(sync))) {
+        result->error = "Cannot write the print output";
+        printed = false;
+    }
+    result->bytesWritten = writer.bytesWritten();
+    result->bandMemory = queue.memory();
+    result->elapsedNanos = statsNowNanos() - start;
+    return printed;
+}
@@ -0,0 +1,62 @@
+#ifndef PDFVIEW_PRINT_RENDERER_H
+#define PDFVIEW_PRINT_RENDERER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "file_writer.h"
+#include "pdfium_lock.h"
+
+class Document;
+
+struct PrintOptions {
+    int dpi = 300;
+    // Pixel budget of one band, its height follows from the page width
+    size_t bandBytes = 4 << 20;
+    // Bands rendered ahead of the encoder, at least 2 to overlap them
+    int bandsInFlight = 3;
+    // Grayscale output for monochrome printers (FPDF_GRAYSCALE)
+    bool grayscale = false;
+};
+
+struct PrintResult {
+    int pages = 0;
+    uint64_t bytesWritten = 0;
+    int64_t elapsedNanos = 0;
+    // Band buffers allocated, the pixel memory the job peaked at
+    uint64_t bandMemory = 0;
+    // Why the job failed, NULL if it didn't
+    const char *error = nullptr;
+    bool cancelled = false;
+
+    double pagesPerMinute() const {
+        return elapsedNanos > 0 ? pages * 60e9 / elapsedNanos : 0;
+    }
+};
+
+/**
+ * Serializes the job's PDFium calls and follows its progress. Every method
+ * runs on the thread of printPages; onPageRendered is called without the
+ * PDFium lock held.
+ */
+class PrintSink : public PdfiumLockSink {
+public:
+    // The page at position index of the job was rendered. False cancels
+    // the job.
+    virtual bool onPageRendered(int index, int pageIndex) = 0;
+};
+
+/**
+ * Rasterizes pages of doc at print resolution into a PDF of images written
+ * to outputFd (rewritten from the start), the input Android's print
+ * framework expects. Pages are rendered with FPDF_PRINTING in horizontal
+ * bands through FPDF_RenderPageBitmapWithMatrix on the calling thread,
+ * which takes the PDFium lock per band, while an encoder thread compresses
+ * the previous bands straight into the file; the bands in flight are the
+ * only pixels in memory, whatever the page size.
+ */
+bool printPages(Document *doc, const std::vector<int> &pages, const PrintOptions &options,
+                int outputFd, SyncMode sync, PrintSink *sink, PrintResult *result);
+
+#endif //PDFVIEW_PRINT_RENDERER_H
@@ -0,0 +1,208 @@
+#include "raster_pdf_writer.h"
+#include "pdfsdk_log.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+
+// Object numbers written by finish
+static const int kPagesObject = 1;
+static const int kCatalogObject = 2;
+
+RasterPdfWriter::RasterPdfWriter(int fd)
+        : writer(fd, 0), error(false), offsets(2, 0), zipReady(false), zipOut(64 * 1024),
+          pageWidth(0), pageHeight(0), pixelWidth(0), pixelHeight(0), rowsAdded(-1) {
+    memset(&zip, 0, sizeof(zip));
+    zipReady = deflateInit(&zip, kDeflateLevel) == Z_OK;
+    if (!zipReady) {
+        LOGE("Cannot initialize deflate");
+        error = true;
+    }
+    // The binary comment keeps transfers from treating the file as text
+    write("%PDF-1.4\n%\xE2\xE3\xCF\xD3\n", 15);
+}
+
+RasterPdfWriter::~RasterPdfWriter() {
+    if (zipReady) deflateEnd(&zip);
+}
+
+int RasterPdfWriter::newObject() {
+    offsets.push_back(0);
+    return (int) offsets.size();
+}
+
+bool RasterPdfWriter::write(const void *data, size_t size) {
+    if (error) return false;
+    if (!writer.WriteBlock(&writer, data, (unsigned long) size)) error = true;
+    return !error;
+}
+
+bool RasterPdfWriter::writeText(const char *format, ...) {
+    char text[256];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    if (length < 0 || length >= (int) sizeof(text)) {
+        error = true;
+        return false;
+    }
+    return write(text, (size_t) length);
+}
+
+bool RasterPdfWriter::beginObject(int number) {
+    offsets[number - 1] = writer.outputSize();
+    return writeText("%d 0 obj\n", number);
+}
+
+bool RasterPdfWriter::beginPage(float widthPoints, float heightPoints, int width, int height) {
+    if (error || rowsAdded >= 0 || widthPoints <= 0 || heightPoints <= 0 || width <= 0 ||
+        height <= 0) {
+        error = true;
+        return false;
+    }
+    pageWidth = widthPoints;
+    pageHeight = heightPoints;
+    pixelWidth = width;
+    pixelHeight = height;
+    rowsAdded = 0;
+    bandObjects.clear();
+    bandRows.clear();
+    row.resize((size_t) width * 3);
+    return true;
+}
+
+bool RasterPdfWriter::deflateRows(const uint8_t *bgrx, int stride, int rows,
+                                  uint64_t *compressed) {
+    *compressed = 0;
+    if (deflateReset(&zip) != Z_OK) return false;
+    for (int y = 0; y <= rows; y++) {
+        const bool last = y == rows;
+        if (!last) {
+            const uint8_t *src = bgrx + (size_t) y * stride;
+            uint8_t *dst = row.data();
+            for (int x = 0; x < pixelWidth; x++, src += 4, dst += 3) {
+                dst[0] = src[2];
+                dst[1] = src[1];
+                dst[2] = src[0];
+            }
+        }
+        zip.next_in = row.data();
+        zip.avail_in = last ? 0 : (uInt) row.size();
+        int result;
+        do {
+            zip.next_out = zipOut.data();
+            zip.avail_out = (uInt) zipOut.size();
+            result = deflate(&zip, last ? Z_FINISH : Z_NO_FLUSH);
+            if (result == Z_STREAM_ERROR) return false;
+            const size_t produced = zipOut.size() - zip.avail_out;
+            if (produced > 0 && !write(zipOut.data(), produced)) return false;
+            *compressed += produced;
+        } while (zip.avail_out == 0 || (last && result != Z_STREAM_END));
+    }
+    return true;
+}
+
+bool RasterPdfWriter::addBand(const uint8_t *bgrx, int stride, int rows) {
+    if (error || rowsAdded < 0 || rows <= 0 || rowsAdded + rows > pixelHeight) {
+        error = true;
+        return false;
+    }
+    // The length follows the stream, it isn't known before compressing
+    const int image = newObject();
+    const int length = newObject();
+    uint64_t compressed;
+    bool written = beginObject(image) &&
+                   writeText("<< /Type /XObject /Subtype /Image /Width %d /Height %d "
+                             "/ColorSpace /DeviceRGB /BitsPerComponent 8 "
+                             "/Filter /FlateDecode /Length %d 0 R >>\nstream\n",
+                             pixelWidth, rows, length) &&
+                   deflateRows(bgrx, stride, rows, &compressed) &&
+                   writeText("\nendstream\nendobj\n") &&
+                   beginObject(length) &&
+                   writeText("%llu\nendobj\n", (unsigned long long) compressed);
+    if (!written) {
+        error = true;
+        return false;
+    }
+    bandObjects.push_back(image);
+    bandRows.push_back(rows);
+    rowsAdded += rows;
+    return true;
+}
+
+bool RasterPdfWriter::endPage() {
+    if (error || rowsAdded != pixelHeight) {
+        error = true;
+        return false;
+    }
+
+    // Band i fills the page width, stacked from the top
+    std::string content;
+    std::string resources;
+    const float scale = pageHeight / pixelHeight;
+    int top = 0;
+    char text[128];
+    for (size_t i = 0; i < bandObjects.size(); i++) {
+        const float height = bandRows[i] * scale;
+        const float y = pageHeight - (top + bandRows[i]) * scale;
+        snprintf(text, sizeof(text), "q %.4f 0 0 %.4f 0 %.4f cm /B%d Do Q\n", pageWidth, height,
+                 y, (int) i);
+        content += text;
+        snprintf(text, sizeof(text), " /B%d %d 0 R", (int) i, bandObjects[i]);
+        resources += text;
+        top += bandRows[i];
+    }
+
+    const int contents = newObject();
+    const int page = newObject();
+    bool written = beginObject(contents) &&
+                   writeText("<< /Length %d >>\nstream\n", (int) content.size()) &&
+                   write(content.data(), content.size()) &&
+                   writeText("endstream\nendobj\n") &&
+                   beginObject(page) &&
+                   writeText("<< /Type /Page /Parent %d 0 R /MediaBox [0 0 %.4f %.4f] "
+                             "/Contents %d 0 R /Resources << /XObject <<", kPagesObject,
+                             pageWidth, pageHeight, contents) &&
+                   write(resources.data(), resources.size()) &&
+                   writeText(" >> >> >>\nendobj\n");
+    if (!written) {
+        error = true;
+        return false;
+    }
+    pageObjects.push_back(page);
+    rowsAdded = -1;
+    return true;
+}
+
+bool RasterPdfWriter::finish(SyncMode sync) {
+    if (error || rowsAdded >= 0 || pageObjects.empty()) {
+        error = true;
+        return false;
+    }
+
+    bool written = beginObject(kPagesObject) && writeText("<< /Type /Pages /Kids [");
+    for (size_t i = 0; written && i < pageObjects.size(); i++) {
+        written = writeText(" %d 0 R", pageObjects[i]);
+    }
+    written = written &&
+              writeText(" ] /Count %d >>\nendobj\n", (int) pageObjects.size()) &&
+              beginObject(kCatalogObject) &&
+              writeText("<< /Type /Catalog /Pages %d 0 R >>\nendobj\n", kPagesObject);
+
+    const uint64_t xref = writer.outputSize();
+    written = written && writeText("xref\n0 %d\n0000000000 65535 f \n", (int) offsets.size() + 1);
+    for (size_t i = 0; written && i < offsets.size(); i++) {
+        written = writeText("%010llu 00000 n \n", (unsigned long long) offsets[i]);
+    }
+    written = written &&
+              writeText("trailer\n<< /Size %d /Root %d 0 R >>\nstartxref\n%llu\n%%%%EOF\n",
+                        (int) offsets.size() + 1, kCatalogObject, (unsigned long long) xref);
+    if (!written || !writer.finish(sync)) {
+        error = true;
+        return false;
+    }
+    return true;
+}
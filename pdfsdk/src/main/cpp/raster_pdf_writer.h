@@ -0,0 +1,79 @@
+#ifndef PDFVIEW_RASTER_PDF_WRITER_H
+#define PDFVIEW_RASTER_PDF_WRITER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include <zlib.h>
+
+#include "file_writer.h"
+
+/**
+ * Writes a PDF whose pages are images, the format Android's print
+ * framework takes, straight into a file descriptor. A page is added a band
+ * of rows at a time: every band becomes a Flate compressed image drawn
+ * below the previous one, so only the band being compressed is ever in
+ * memory. Not thread-safe.
+ */
+class RasterPdfWriter {
+public:
+    // fd is rewritten from the start
+    explicit RasterPdfWriter(int fd);
+
+    ~RasterPdfWriter();
+
+    // A page of widthPoints x heightPoints showing pixelWidth x pixelHeight
+    // pixels, which the bands must add up to
+    bool beginPage(float widthPoints, float heightPoints, int pixelWidth, int pixelHeight);
+
+    // Rows of BGRx pixels (FPDFBitmap_BGRx), stride bytes apart, below the
+    // rows added before
+    bool addBand(const uint8_t *bgrx, int stride, int rows);
+
+    bool endPage();
+
+    // Writes the page tree, cross-reference table and trailer, then syncs
+    bool finish(SyncMode sync);
+
+    bool failed() const { return error; }
+
+    uint64_t bytesWritten() const { return writer.outputSize(); }
+
+    // Fast: print output is transient and mostly flat color
+    static const int kDeflateLevel = 1;
+
+private:
+    bool write(const void *data, size_t size);
+
+    bool writeText(const char *format, ...);
+
+    // Starts indirect object number, recording its offset
+    bool beginObject(int number);
+
+    // Reserves the next object number
+    int newObject();
+
+    bool deflateRows(const uint8_t *bgrx, int stride, int rows, uint64_t *compressed);
+
+    FdFileWriter writer;
+    bool error;
+    // Offset of each object, 0 until written; 1 is the page tree, 2 the catalog
+    std::vector<uint64_t> offsets;
+    std::vector<int> pageObjects;
+    z_stream zip;
+    bool zipReady;
+    std::vector<uint8_t> row;
+    std::vector<uint8_t> zipOut;
+
+    // Page being added
+    float pageWidth;
+    float pageHeight;
+    int pixelWidth;
+    int pixelHeight;
+    int rowsAdded;
+    std::vector<int> bandObjects;
+    std::vector<int> bandRows;
+};
+
+#endif //PDFVIEW_RASTER_PDF_WRITER_H
@@ -0,0 +1,145 @@
+#include "render_core.h"
+#include "render_stats.h"
+
+#include <new>
+
+#include <public/cpp/fpdf_scopers.h>
+#include <public/fpdf_progressive.h>
+
+struct rgb {
+    uint8_t red;
+    uint8_t green;
+    uint8_t blue;
+};
+
+uint16_t rgb_to_565(unsigned char R8, unsigned char G8, unsigned char B8) {
+    unsigned char R5 = (R8 * 249 + 1014) >> 11;
+    unsigned char G6 = (G8 * 253 + 505) >> 10;
+    unsigned char B5 = (B8 * 249 + 1014) >> 11;
+    return (R5 << 11) | (G6 << 5) | (B5);
+}
+
+void rgbBitmapTo565(const void *source, int sourceStride, void *dest, int destStride,
+                    int width, int height) {
+    for (int y = 0; y < height; y++) {
+        const rgb *srcLine = (const rgb *) source;
+        uint16_t *dstLine = (uint16_t *) dest;
+        for (int x = 0; x < width; x++) {
+            const rgb *r = &srcLine[x];
+            dstLine[x] = rgb_to_565(r->red, r->green, r->blue);
+        }
+        source = (const char *) source + sourceStride;
+        dest = (char *) dest + destStride;
+    }
+}
+
+// FPDFBitmap_FillRect ignores FPDF_REVERSE_BYTE_ORDER, so colors filled
+// next to rendered content get their red and blue swapped up front
+static FPDF_DWORD fillColor(FPDF_DWORD argb) {
+    return (argb & 0xFF00FF00) | ((argb >> 16) & 0xFF) | ((argb & 0xFF) << 16);
+}
+
+static FPDF_BOOL neverPause(IFSDK_PAUSE *) {
+    return false;
+}
+
+// The progressive entry points reject a NULL pause; this one never pauses,
+// so a render finishes in the first call
+static IFSDK_PAUSE sNoPause = {1, &neverPause, NULL};
+
+bool TileRenderer::render(FPDF_PAGE page, const RenderTarget &target, int startX, int startY,
+                          int drawSizeHor, int drawSizeVer, bool renderAnnot,
+                          ColorScheme scheme, FPDF_FORMHANDLE form) {
+    int canvasHorSize = target.width;
+    int canvasVerSize = target.height;
+
+    void *tmp;
+    int format;
+    int sourceStride;
+    if (target.format == kTileRgb565) {
+        size_t needed = (size_t) canvasVerSize * canvasHorSize * sizeof(rgb);
+        if (scratch.size() < needed) {
+            try {
+                scratch.resize(needed);
+            } catch (const std::bad_alloc &) {
+                return false;
+            }
+        }
+        tmp = scratch.data();
+        sourceStride = canvasHorSize * sizeof(rgb);
+        format = FPDFBitmap_BGR;
+    } else {
+        tmp = target.pixels;
+        sourceStride = target.stride;
+        format = FPDFBitmap_BGRA;
+    }
+
+    ScopedFPDFBitmap pdfBitmap(FPDFBitmap_CreateEx(canvasHorSize, canvasVerSize,
+                                                   format, tmp, sourceStride));
+
+    if (drawSizeHor < canvasHorSize || drawSizeVer < canvasVerSize) {
+        FPDFBitmap_FillRect(pdfBitmap.get(), 0, 0, canvasHorSize, canvasVerSize,
+                            0x848484FF); //Gray
+    }
+
+    int baseHorSize = (canvasHorSize < drawSizeHor) ? canvasHorSize : drawSizeHor;
+    int baseVerSize = (canvasVerSize < drawSizeVer) ? canvasVerSize : drawSizeVer;
+    int baseX = (startX < 0) ? 0 : startX;
+    int baseY = (startY < 0) ? 0 : startY;
+    int flags = FPDF_REVERSE_BYTE_ORDER;
+
+    if (renderAnnot) {
+        flags |= FPDF_ANNOT;
+    }
+
+    SchemeColors colors;
+    const bool recolor = schemeColors(scheme, &colors);
+    if (recolor) {
+        FPDFBitmap_FillRect(pdfBitmap.get(), baseX, baseY, baseHorSize, baseVerSize,
+                            fillColor(colors.background));
+    } else if (target.format == kTileRgb565 || scheme == kColorSchemeInvert) {
+        FPDFBitmap_FillRect(pdfBitmap.get(), baseX, baseY, baseHorSize, baseVerSize,
+                            0xFFFFFFFF); //White
+    }
+
+    {
+        StageTimer timer(kStageRasterize);
+        if (recolor) {
+            int status = FPDF_RenderPageBitmapWithColorScheme_Start(pdfBitmap.get(), page,
+                                                                    startX, startY,
+                                                                    drawSizeHor, drawSizeVer,
+                                                                    0, flags | colors.renderFlags,
+                                                                    &colors.colors, &sNoPause);
+            while (status == FPDF_RENDER_TOBECONTINUED) {
+                status = FPDF_RenderPage_Continue(page, &sNoPause);
+            }
+            FPDF_RenderPage_Close(page);
+            if (status == FPDF_RENDER_FAILED) return false;
+        } else {
+            FPDF_RenderPageBitmap(pdfBitmap.get(), page,
+                                  startX, startY,
+                                  drawSizeHor, drawSizeVer,
+                                  0, flags);
+        }
+        if (form != NULL) {
+            FPDF_FFLDraw(form, pdfBitmap.get(), page, startX, startY,
+                         drawSizeHor, drawSizeVer, 0, flags);
+        }
+    }
+    countStat(kCounterPixelsRendered, (int64_t) canvasHorSize * canvasVerSize);
+
+    if (scheme == kColorSchemeInvert) {
+        // Before the RGB_565 conversion, which would make it lossy
+        collectImageRects(page, startX, startY, drawSizeHor, drawSizeVer,
+                          canvasHorSize, canvasVerSize, &imageRects);
+        invertOutsideRects(tmp, sourceStride, canvasHorSize, canvasVerSize,
+                           format == FPDFBitmap_BGR ? 3 : 4, imageRects);
+    }
+
+    if (target.format == kTileRgb565) {
+        StageTimer timer(kStageConvert565);
+        rgbBitmapTo565(tmp, sourceStride, target.pixels, target.stride,
+                       canvasHorSize, canvasVerSize);
+    }
+    return true;
+}
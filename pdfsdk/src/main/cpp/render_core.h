@@ -0,0 +1,53 @@
+#ifndef PDFVIEW_RENDER_CORE_H
+#define PDFVIEW_RENDER_CORE_H
+
+#include <stdint.h>
+#include <vector>
+
+#include <public/fpdfview.h>
+#include <public/fpdf_formfill.h>
+
+#include "color_scheme.h"
+
+enum TilePixelFormat {
+    kTileRgba8888,
+    kTileRgb565,
+};
+
+// Caller owned pixels a tile is rendered into, e.g. a locked Android bitmap
+struct RenderTarget {
+    void *pixels;
+    int width;
+    int height;
+    int stride;
+    TilePixelFormat format;
+};
+
+uint16_t rgb_to_565(unsigned char R8, unsigned char G8, unsigned char B8);
+
+// Converts packed 24-bit RGB rows to RGB_565
+void rgbBitmapTo565(const void *source, int sourceStride, void *dest, int destStride,
+                    int width, int height);
+
+/**
+ * Renders pages into caller owned targets. RGB_565 targets go through a
+ * 24-bit buffer that is kept between tiles, so a renderer should live as
+ * long as the thread rendering tiles of one size. Not thread-safe.
+ */
+class TileRenderer {
+public:
+    // Renders the page scaled to drawSizeHor x drawSizeVer and offset by
+    // (startX, startY) into the target; the part of the target outside the
+    // page is filled gray. Returns false if no buffer could be allocated.
+    // Other schemes than kColorSchemeNone paint an opaque page background.
+    // With a form handle the page's form fields are drawn on top.
+    bool render(FPDF_PAGE page, const RenderTarget &target, int startX, int startY,
+                int drawSizeHor, int drawSizeVer, bool renderAnnot,
+                ColorScheme scheme = kColorSchemeNone, FPDF_FORMHANDLE form = NULL);
+
+private:
+    std::vector<unsigned char> scratch;
+    std::vector<DeviceRect> imageRects;
+};
+
+#endif //PDFVIEW_RENDER_CORE_H
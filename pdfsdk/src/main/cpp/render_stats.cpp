@@ -0,0 +1,191 @@
+#include "render_stats.h"
+
+#include <time.h>
+#include <mutex>
+
+#ifdef __ANDROID__
+#include <android/trace.h>
+#endif
+
+std::atomic<int> gStatsMode(0);
+
+static const char *const kStageNames[kStageCount] = {
+        "pdfsdk:fileRead",
+        "pdfsdk:documentOpen",
+        "pdfsdk:pageLoad",
+        "pdfsdk:rasterize",
+        "pdfsdk:convert565",
+        "pdfsdk:bitmapLock",
+        "pdfsdk:fileWrite",
+};
+
+/**
+ * Stats of one thread. Only the owning thread writes it, so updates are
+ * plain relaxed load/store pairs, no read-modify-write; snapshots read it
+ * from other threads without locks.
+ */
+struct ThreadStats {
+    struct Stage {
+        std::atomic<int64_t> count;
+        std::atomic<int64_t> totalNanos;
+        std::atomic<int64_t> maxNanos;
+        std::atomic<int64_t> buckets[kStatBuckets];
+    };
+
+    Stage stages[kStageCount];
+    std::atomic<int64_t> counters[kCounterCount];
+    ThreadStats *next;
+
+    ThreadStats() : next(nullptr) {
+        clear();
+    }
+
+    void clear() {
+        for (int s = 0; s < kStageCount; s++) {
+            stages[s].count.store(0, std::memory_order_relaxed);
+            stages[s].totalNanos.store(0, std::memory_order_relaxed);
+            stages[s].maxNanos.store(0, std::memory_order_relaxed);
+            for (int b = 0; b < kStatBuckets; b++) {
+                stages[s].buckets[b].store(0, std::memory_order_relaxed);
+            }
+        }
+        for (int c = 0; c < kCounterCount; c++) {
+            counters[c].store(0, std::memory_order_relaxed);
+        }
+    }
+};
+
+static void add(std::atomic<int64_t> &value, int64_t delta) {
+    value.store(value.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+}
+
+// Every buffer ever created, newest first. Buffers are never freed: a
+// thread that exits hands its buffer back to the free list, so its numbers
+// stay in the totals and the next new thread continues from there.
+static std::atomic<ThreadStats *> sAllStats(nullptr);
+static std::mutex sFreeLock;
+static std::vector<ThreadStats *> sFreeStats;
+
+class ThreadStatsOwner {
+public:
+    ThreadStatsOwner() : stats(nullptr) {}
+
+    ~ThreadStatsOwner() {
+        if (stats == nullptr) return;
+        std::lock_guard<std::mutex> lock(sFreeLock);
+        sFreeStats.push_back(stats);
+    }
+
+    ThreadStats *get() {
+        if (stats == nullptr) stats = acquire();
+        return stats;
+    }
+
+private:
+    static ThreadStats *acquire() {
+        {
+            std::lock_guard<std::mutex> lock(sFreeLock);
+            if (!sFreeStats.empty()) {
+                ThreadStats *reused = sFreeStats.back();
+                sFreeStats.pop_back();
+                return reused;
+            }
+        }
+        ThreadStats *created = new ThreadStats();
+        created->next = sAllStats.load(std::memory_order_relaxed);
+        while (!sAllStats.compare_exchange_weak(created->next, created,
+                                                std::memory_order_release,
+                                                std::memory_order_relaxed)) {
+        }
+        return created;
+    }
+
+    ThreadStats *stats;
+};
+
+static thread_local ThreadStatsOwner sThreadStats;
+
+void setStatsMode(int mode) {
+    gStatsMode.store(mode, std::memory_order_relaxed);
+}
+
+int64_t statsNowNanos() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t) ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int bucketOf(int64_t nanos) {
+    int64_t micros = nanos / 1000;
+    int bucket = 0;
+    while (micros > 0 && bucket < kStatBuckets - 1) {
+        micros >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+void recordStage(StatStage stage, int64_t nanos) {
+    ThreadStats::Stage &s = sThreadStats.get()->stages[stage];
+    add(s.count, 1);
+    add(s.totalNanos, nanos);
+    if (nanos > s.maxNanos.load(std::memory_order_relaxed)) {
+        s.maxNanos.store(nanos, std::memory_order_relaxed);
+    }
+    add(s.buckets[bucketOf(nanos)], 1);
+}
+
+void addCounter(StatCounter counter, int64_t value) {
+    add(sThreadStats.get()->counters[counter], value);
+}
+
+void beginTraceSection(StatStage stage) {
+#ifdef __ANDROID__
+    ATrace_beginSection(kStageNames[stage]);
+#else
+    (void) stage;
+#endif
+}
+
+void endTraceSection() {
+#ifdef __ANDROID__
+    ATrace_endSection();
+#endif
+}
+
+void resetStats() {
+    for (ThreadStats *t = sAllStats.load(std::memory_order_acquire); t != nullptr; t = t->next) {
+        t->clear();
+    }
+}
+
+void snapshotStats(std::vector<int64_t> *out) {
+    size_t stageSize = 3 + kStatBuckets;
+    out->assign(kStageCount * stageSize + kCounterCount, 0);
+    for (ThreadStats *t = sAllStats.load(std::memory_order_acquire); t != nullptr; t = t->next) {
+        for (int s = 0; s < kStageCount; s++) {
+            const ThreadStats::Stage &stage = t->stages[s];
+            int64_t *dst = out->data() + s * stageSize;
+            dst[0] += stage.count.load(std::memory_order_relaxed);
+            dst[1] += stage.totalNanos.load(std::memory_order_relaxed);
+            int64_t max = stage.maxNanos.load(std::memory_order_relaxed);
+            if (max > dst[2]) dst[2] = max;
+            for (int b = 0; b < kStatBuckets; b++) {
+                dst[3 + b] += stage.buckets[b].load(std::memory_order_relaxed);
+            }
+        }
+        for (int c = 0; c < kCounterCount; c++) {
+            (*out)[kStageCount * stageSize + c] += t->counters[c].load(std::memory_order_relaxed);
+        }
+    }
+}
+
+void StageTimer::begin() {
+    if (mode & kStatsTrace) beginTraceSection(stage);
+    if (mode & kStatsCollect) start = statsNowNanos();
+}
+
+void StageTimer::end() {
+    if (mode & kStatsCollect) recordStage(stage, statsNowNanos() - start);
+    if (mode & kStatsTrace) endTraceSection();
+}
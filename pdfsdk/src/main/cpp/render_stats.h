@@ -0,0 +1,93 @@
+#ifndef PDFVIEW_RENDER_STATS_H
+#define PDFVIEW_RENDER_STATS_H
+
+#include <stdint.h>
+#include <atomic>
+#include <vector>
+
+// Timed stages, in the order nativeGetStats reports them
+enum StatStage {
+    kStageFileRead = 0,     // getBlock, one pread
+    kStageDocumentOpen,     // FPDF_LoadCustomDocument
+    kStagePageLoad,         // FPDF_LoadPage, parses the page content
+    kStageRasterize,        // FPDF_RenderPageBitmap
+    kStageConvert565,       // RGB to RGB_565 copy
+    kStageBitmapLock,       // AndroidBitmap_lockPixels
+    kStageFileWrite,        // a coalesced pwrite or the fsync of a save
+    kStageCount
+};
+
+enum StatCounter {
+    kCounterBytesRead = 0,
+    kCounterPixelsRendered,
+    kCounterBytesWritten,
+    kCounterCount
+};
+
+// Histogram bucket i holds durations in [2^(i-1), 2^i) microseconds, bucket
+// 0 is under 1us and the last one is open ended (above ~0.5s)
+static const int kStatBuckets = 20;
+
+// Bits of the stats mode
+static const int kStatsCollect = 1;
+static const int kStatsTrace = 2;
+
+extern std::atomic<int> gStatsMode;
+
+inline int statsMode() {
+    return gStatsMode.load(std::memory_order_relaxed);
+}
+
+void setStatsMode(int mode);
+
+int64_t statsNowNanos();
+
+void recordStage(StatStage stage, int64_t nanos);
+
+void addCounter(StatCounter counter, int64_t value);
+
+void beginTraceSection(StatStage stage);
+
+void endTraceSection();
+
+// Zeroes every thread's buffer. Updates racing with it may survive, which
+// is fine for diagnostics; diff two snapshots for exact numbers.
+void resetStats();
+
+// Sums every thread's buffer as, per stage, count, total ns, max ns and the
+// histogram buckets, followed by the counters.
+void snapshotStats(std::vector<int64_t> *out);
+
+/**
+ * Times one stage of the enclosing scope. When stats and tracing are both
+ * off it costs one load and one predictable branch on entry and exit.
+ */
+class StageTimer {
+public:
+    explicit StageTimer(StatStage stage) : stage(stage), mode(statsMode()), start(0) {
+        if (mode != 0) begin();
+    }
+
+    ~StageTimer() {
+        if (mode != 0) end();
+    }
+
+private:
+    StageTimer(const StageTimer &);
+
+    StageTimer &operator=(const StageTimer &);
+
+    void begin();
+
+    void end();
+
+    const StatStage stage;
+    const int mode;
+    int64_t start;
+};
+
+inline void countStat(StatCounter counter, int64_t value) {
+    if (statsMode() & kStatsCollect) addCounter(counter, value);
+}
+
+#endif //PDFVIEW_RENDER_STATS_H
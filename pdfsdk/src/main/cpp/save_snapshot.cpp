@@ -0,0 +1,137 @@
+#include "save_snapshot.h"
+#include "pdfsdk_log.h"
+#include "render_stats.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <string>
+
+#include <hk_file.h>
+
+SnapshotWriter::SnapshotWriter(SaveSnapshot *snapshot)
+        : snapshot(snapshot), produced(0), error(false) {
+    version = 1;
+    WriteBlock = &writeBlockCallback;
+}
+
+int SnapshotWriter::writeBlockCallback(FPDF_FILEWRITE *self, const void *data,
+                                       unsigned long size) {
+    return static_cast<SnapshotWriter *>(self)->writeBlock(static_cast<const uint8_t *>(data),
+                                                           size) ? 1 : 0;
+}
+
+bool SnapshotWriter::writeBlock(const uint8_t *data, size_t size) {
+    if (error) return false;
+
+    const uint64_t sourceLength = snapshot->sourceLength;
+    if (produced < sourceLength) {
+        const size_t dropped = (size_t) std::min<uint64_t>(size, sourceLength - produced);
+        const uint64_t headEnd = sourceLength < kCheckedBytes ? sourceLength : kCheckedBytes;
+        const uint64_t tailBegin = sourceLength - headEnd;
+        if (!matchesSource(data, dropped, produced, 0, headEnd) ||
+            !matchesSource(data, dropped, produced, tailBegin, sourceLength)) {
+            LOGE("The saved document doesn't start with the file, no snapshot");
+            error = true;
+            return false;
+        }
+        data += dropped;
+        size -= dropped;
+        produced += dropped;
+    }
+    snapshot->tail.insert(snapshot->tail.end(), data, data + size);
+    produced += size;
+    return true;
+}
+
+// Compares the part of [begin, end) covered by a block at offset
+bool SnapshotWriter::matchesSource(const uint8_t *data, size_t size, uint64_t offset,
+                                   uint64_t begin, uint64_t end) {
+    const uint64_t from = std::max(begin, offset);
+    const uint64_t to = std::min(end, offset + size);
+    if (from >= to) return true;
+    const size_t count = (size_t) (to - from);
+    fileData.resize(count);
+    return pread(snapshot->sourceFd, fileData.data(), count, (off_t) from) == (ssize_t) count &&
+           memcmp(fileData.data(), data + (from - offset), count) == 0;
+}
+
+// Appends size bytes to the writer, false if it failed
+static bool writeChunk(FdFileWriter *writer, const uint8_t *data, size_t size) {
+    return writer->WriteBlock(writer, data, (unsigned long) size) != 0;
+}
+
+static bool copySnapshot(const SaveSnapshot &snapshot, int fd, SyncMode sync,
+                         SaveProgress *progress) {
+    const size_t chunkSize = FdFileWriter::kDefaultBufferSize;
+    const uint64_t total = snapshot.size();
+    FdFileWriter writer(fd, 0);
+    std::vector<uint8_t> chunk(chunkSize);
+
+    uint64_t done = 0;
+    while (done < snapshot.sourceLength) {
+        const size_t size = (size_t) std::min<uint64_t>(chunkSize, snapshot.sourceLength - done);
+        ssize_t readCount;
+        {
+            StageTimer timer(kStageFileRead);
+            do {
+                readCount = pread(snapshot.sourceFd, chunk.data(), size, (off_t) done);
+            } while (readCount < 0 && errno == EINTR);
+        }
+        if (readCount <= 0) {
+            LOGE("Cannot read the document being saved: %s",
+                 readCount < 0 ? strerror(errno) : "file shrank");
+            return false;
+        }
+        countStat(kCounterBytesRead, readCount);
+        if (!writeChunk(&writer, chunk.data(), (size_t) readCount)) return false;
+        done += readCount;
+        if (progress != NULL && !progress->onSaveProgress(done, total)) return false;
+    }
+
+    const uint8_t *tail = snapshot.tail.data();
+    size_t left = snapshot.tail.size();
+    while (left > 0) {
+        const size_t size = std::min(left, chunkSize);
+        if (!writeChunk(&writer, tail, size)) return false;
+        tail += size;
+        left -= size;
+        done += size;
+        if (progress != NULL && !progress->onSaveProgress(done, total)) return false;
+    }
+    return writer.finish(sync);
+}
+
+bool writeSnapshot(const SaveSnapshot &snapshot, const char *path, SyncMode sync,
+                   SaveProgress *progress) {
+    // Next to the target, a rename can't cross file systems
+    const std::string temp = std::string(path) + ".saving";
+    const int permissions = fs_get_permissions(path);
+    const int fd = open(temp.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC,
+                        permissions >= 0 ? (mode_t) permissions : 0644);
+    if (fd < 0) {
+        LOGE("Cannot create %s: %s", temp.c_str(), strerror(errno));
+        return false;
+    }
+
+    bool saved = copySnapshot(snapshot, fd, sync, progress);
+    if (close(fd) != 0) saved = false;
+    if (saved && fs_rename(temp.c_str(), path) != FS_SUCCESS) {
+        LOGE("Cannot rename %s: %s", temp.c_str(), strerror(errno));
+        saved = false;
+    }
+    if (!saved) {
+        unlink(temp.c_str());
+        return false;
+    }
+
+    // The new name only survives a crash once the directory is synced
+    if (sync != kSyncNone && fs_sync_parent_dir(path) != FS_SUCCESS) {
+        LOGE("Cannot sync the directory of %s: %s", path, strerror(errno));
+        return false;
+    }
+    return true;
+}
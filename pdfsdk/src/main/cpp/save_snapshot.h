@@ -0,0 +1,80 @@
+#ifndef PDFVIEW_SAVE_SNAPSHOT_H
+#define PDFVIEW_SAVE_SNAPSHOT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include <public/fpdf_save.h>
+
+#include "file_writer.h"
+
+/**
+ * The output of a save, taken while the document is held and written out
+ * later without it. An incremental save of a document read from a file
+ * starts with that whole file; the snapshot keeps a reference to it
+ * instead of a copy and only holds the bytes PDFium added in memory.
+ */
+struct SaveSnapshot {
+    // File the output starts with, -1 if tail is all of it. Must stay open
+    // and unchanged until the snapshot is written.
+    int sourceFd = -1;
+    // Bytes of sourceFd the output starts with
+    uint64_t sourceLength = 0;
+    std::vector<uint8_t> tail;
+
+    uint64_t size() const { return sourceLength + tail.size(); }
+};
+
+/**
+ * The FPDF_FILEWRITE a snapshot is taken through. Output bytes before
+ * sourceLength are dropped; the ones near both ends of that range are
+ * compared with the source file, which catches a save that doesn't start
+ * with a plain copy of it without reading the whole file again.
+ */
+class SnapshotWriter : public FPDF_FILEWRITE {
+public:
+    explicit SnapshotWriter(SaveSnapshot *snapshot);
+
+    bool failed() const { return error; }
+
+    uint64_t outputSize() const { return produced; }
+
+    // Bytes compared at each end of the dropped range
+    static const size_t kCheckedBytes = 4096;
+
+private:
+    static int writeBlockCallback(FPDF_FILEWRITE *self, const void *data, unsigned long size);
+
+    bool writeBlock(const uint8_t *data, size_t size);
+
+    bool matchesSource(const uint8_t *data, size_t size, uint64_t offset, uint64_t begin,
+                       uint64_t end);
+
+    SaveSnapshot *snapshot;
+    uint64_t produced;
+    bool error;
+    std::vector<uint8_t> fileData;
+};
+
+// Told how far writeSnapshot got, on its thread
+class SaveProgress {
+public:
+    virtual ~SaveProgress() {}
+
+    // False cancels the save, the target is left as it was
+    virtual bool onSaveProgress(uint64_t written, uint64_t total) = 0;
+};
+
+/**
+ * Writes a snapshot to path through a temporary file next to it, synced
+ * and then renamed over path, so a crash leaves either the old or the new
+ * document and never a mix. No PDFium calls: the document may be used by
+ * other threads meanwhile, including the file the snapshot starts with,
+ * which keeps being readable after the rename if it was path. progress
+ * may be NULL. Returns false if the save failed or was cancelled.
+ */
+bool writeSnapshot(const SaveSnapshot &snapshot, const char *path, SyncMode sync,
+                   SaveProgress *progress);
+
+#endif //PDFVIEW_SAVE_SNAPSHOT_H
@@ -0,0 +1,46 @@
+#include "text_index.h"
+#include "document.h"
+#include "page_index.h"
+
+TextIndex::TextIndex(const Page &page)
+        : page(page.get()), textPage(FPDFText_LoadPage(page.get())) {}
+
+int TextIndex::countChars() const {
+    return isValid() ? FPDFText_CountChars(textPage.get()) : 0;
+}
+
+std::u16string TextIndex::text(int start, int count) const {
+    int total = countChars();
+    if (start < 0 || start >= total || count <= 0) return std::u16string();
+    if (count > total - start) count = total - start;
+
+    // FPDFText_GetText writes a terminating NUL after the chars
+    std::u16string result(count + 1, u'\0');
+    int written = FPDFText_GetText(textPage.get(), start, count,
+                                   reinterpret_cast<unsigned short *>(&result[0]));
+    result.resize(written > 0 ? written - 1 : 0);
+    return result;
+}
+
+int TextIndex::find(const std::u16string &query, unsigned long flags,
+                    std::vector<TextMatch> *matches) const {
+    if (!isValid() || query.empty()) return 0;
+
+    ScopedFPDFTextFind search(FPDFText_FindStart(
+            textPage.get(), reinterpret_cast<FPDF_WIDESTRING>(query.c_str()), flags, 0));
+    if (!search) return 0;
+
+    int found = 0;
+    while (FPDFText_FindNext(search.get())) {
+        TextMatch match;
+        match.start = FPDFText_GetSchResultIndex(search.get());
+        match.count = FPDFText_GetSchCount(search.get());
+        matches->push_back(match);
+        found++;
+    }
+    return found;
+}
+
+PageIndex *TextIndex::buildPageIndex() const {
+    return PageIndex::build(page, textPage.get());
+}
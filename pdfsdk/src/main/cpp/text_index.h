@@ -0,0 +1,51 @@
+#ifndef PDFVIEW_TEXT_INDEX_H
+#define PDFVIEW_TEXT_INDEX_H
+
+#include <string>
+#include <vector>
+
+#include <public/fpdf_text.h>
+#include <public/cpp/fpdf_scopers.h>
+
+class Page;
+class PageIndex;
+
+// A search hit as a char range of the text page
+struct TextMatch {
+    int start;
+    int count;
+};
+
+/**
+ * The text layer of a loaded page: extraction, search and the hit-testing
+ * index built over it. The page must outlive it.
+ */
+class TextIndex {
+public:
+    explicit TextIndex(const Page &page);
+
+    // False if PDFium couldn't read the page text
+    bool isValid() const { return textPage.get() != nullptr; }
+
+    FPDF_TEXTPAGE get() const { return textPage.get(); }
+
+    int countChars() const;
+
+    // UTF-16 text of [start, start + count), clipped to the page
+    std::u16string text(int start, int count) const;
+
+    // Appends every match of query, flags being FPDF_MATCHCASE,
+    // FPDF_MATCHWHOLEWORD and FPDF_CONSECUTIVE. Returns the number found.
+    int find(const std::u16string &query, unsigned long flags,
+             std::vector<TextMatch> *matches) const;
+
+    // Builds the grid index over the chars, links and annotations; the
+    // caller owns it and may keep it after this TextIndex is gone.
+    PageIndex *buildPageIndex() const;
+
+private:
+    FPDF_PAGE page;
+    ScopedFPDFTextPage textPage;
+};
+
+#endif //PDFVIEW_TEXT_INDEX_H
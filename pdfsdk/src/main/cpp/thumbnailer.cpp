@@ -0,0 +1,87 @@
+#include "thumbnailer.h"
+#include "document.h"
+#include "pdfium_lock.h"
+#include "work_stealing_pool.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <memory>
+
+// The sink's PDFium lock as taken from one worker
+class WorkerLockSink : public PdfiumLockSink {
+public:
+    WorkerLockSink(ThumbnailSink *sink, int worker) : sink(sink), worker(worker) {}
+
+    void lockPdfium() override { sink->lockPdfium(worker); }
+
+    void unlockPdfium() override { sink->unlockPdfium(worker); }
+
+private:
+    ThumbnailSink *sink;
+    int worker;
+};
+
+static void renderThumbnail(ThumbnailSink *sink, TileRenderer *renderer, int worker,
+                            int index, int fd, int maxWidth, int maxHeight) {
+    std::unique_ptr<Document> doc;
+    std::unique_ptr<Page> page;
+    unsigned long error = FPDF_ERR_SUCCESS;
+    int width = 0, height = 0;
+    WorkerLockSink workerLock(sink, worker);
+    {
+        PdfiumLock lock(&workerLock);
+        doc = Document::openFd(fd, nullptr, &error);
+        if (doc) page = doc->loadPage(0);
+        if (page) {
+            float scale = std::min(maxWidth / page->width(), maxHeight / page->height());
+            width = std::max(1, (int) (page->width() * scale + 0.5f));
+            height = std::max(1, (int) (page->height() * scale + 0.5f));
+        } else {
+            // Handles are closed under the lock too
+            page.reset();
+            doc.reset();
+        }
+    }
+    if (!page) {
+        sink->failThumbnail(worker, index, error != FPDF_ERR_SUCCESS
+                                           ? describePdfError(error)
+                                           : "Cannot load the first page");
+        return;
+    }
+
+    RenderTarget target;
+    bool began = sink->beginThumbnail(worker, index, width, height, &target);
+    if (began) {
+        // Thumbnails are shown on white whatever the page background
+        for (int y = 0; y < target.height; y++) {
+            memset((char *) target.pixels + (size_t) y * target.stride, 0xFF,
+                   (size_t) target.width * 4);
+        }
+    }
+    bool rendered = false;
+    {
+        PdfiumLock lock(&workerLock);
+        if (began) {
+            rendered = renderer->render(page->get(), target, 0, 0, target.width,
+                                        target.height, true);
+        }
+        page.reset();
+        doc.reset();
+    }
+    if (began) sink->endThumbnail(worker, index, rendered);
+}
+
+void renderThumbnails(WorkStealingPool *pool, const std::vector<int> &fds, int maxWidth,
+                      int maxHeight, ThumbnailSink *sink) {
+    // One renderer per worker, so the scratch buffers aren't shared
+    std::vector<TileRenderer> renderers(pool->workerCount());
+    for (size_t i = 0; i < fds.size(); i++) {
+        int index = (int) i;
+        int fd = fds[i];
+        pool->submit([sink, &renderers, index, fd, maxWidth, maxHeight](int worker) {
+            renderThumbnail(sink, &renderers[worker], worker, index, fd, maxWidth, maxHeight);
+        });
+    }
+    pool->wait();
+}
@@ -0,0 +1,47 @@
+#ifndef PDFVIEW_THUMBNAILER_H
+#define PDFVIEW_THUMBNAILER_H
+
+#include <vector>
+
+#include "render_core.h"
+
+class WorkStealingPool;
+
+/**
+ * Receives the thumbnails of a batch. Every method runs on a pool worker
+ * (given by index) and, except lockPdfium/unlockPdfium themselves, without
+ * the PDFium lock held, so sinks may allocate and call back into the app.
+ */
+class ThumbnailSink {
+public:
+    virtual ~ThumbnailSink() {}
+
+    // Serializes the batch's PDFium calls with the other PDFium users of
+    // the process
+    virtual void lockPdfium(int worker) = 0;
+
+    virtual void unlockPdfium(int worker) = 0;
+
+    // Provides the RGBA_8888 target thumbnail index is rendered into, false
+    // to skip it
+    virtual bool beginThumbnail(int worker, int index, int width, int height,
+                                RenderTarget *target) = 0;
+
+    // Called after a successful beginThumbnail, rendered false if the page
+    // couldn't be drawn into the target
+    virtual void endThumbnail(int worker, int index, bool rendered) = 0;
+
+    // The document couldn't be opened or has no renderable first page
+    virtual void failThumbnail(int worker, int index, const char *error) = 0;
+};
+
+/**
+ * Renders the first page of every document fitted into maxWidth x
+ * maxHeight, one pool task per document: open, load page 0, render, close.
+ * Documents are read with pread on the fds, which the caller keeps open.
+ * Returns when every thumbnail was delivered to the sink.
+ */
+void renderThumbnails(WorkStealingPool *pool, const std::vector<int> &fds, int maxWidth,
+                      int maxHeight, ThumbnailSink *sink);
+
+#endif //PDFVIEW_THUMBNAILER_H
@@ -401,6 +401,62 @@ ssize_t fs_get_size_for_fd(const int fd) {
     return stats.st_size;
 }
 
+int fs_pwrite_all(int fd, const void* buf, size_t count, off_t offset) {
+    const char* p = (const char*)buf;
+    while (count > 0) {
+        errno = 0;
+        ssize_t written = pwrite(fd, p, count, offset);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            return FS_FAILURE;
+        }
+        p += written;
+        offset += written;
+        count -= written;
+    }
+    return FS_SUCCESS;
+}
+
+int fs_sync_fd(int fd, bool data_only) {
+    int res = data_only ? fdatasync(fd) : fsync(fd);
+    if (res == 0)
+        return FS_SUCCESS;
+    return FS_FAILURE;
+}
+
+int fs_truncate_fd(int fd, off_t size) {
+    if (ftruncate(fd, size) == 0)
+        return FS_SUCCESS;
+    return FS_FAILURE;
+}
+
+int fs_sync_parent_dir(const char* path) {
+    if (path == NULL || path[0] == '\0')
+        return FS_NOT_VALID;
+
+    char* dir = strdup(path);
+    if (dir == NULL)
+        return FS_FAILURE;
+    char* slash = strrchr(dir, '/');
+    if (slash == NULL)
+        strcpy(dir, ".");
+    else if (slash == dir)
+        slash[1] = '\0';   /* the root directory */
+    else
+        slash[0] = '\0';
+
+    int dfd = open(dir, O_RDONLY | O_DIRECTORY);
+    free(dir);
+    if (dfd < 0)
+        return FS_FAILURE;
+    int res = fsync(dfd);
+    close(dfd);
+    if (res == 0)
+        return FS_SUCCESS;
+    return FS_FAILURE;
+}
+
 /*******************************************************************************
 *   file Objects
 *******************************************************************************/
@@ -418,9 +474,10 @@ file_t init_with_stat(struct stat *stats, const char *filepath) {
     f->filesize = 0;
     f->num_lines = 0;
     f->lines = NULL;
+    f->fd = -1;
     f->mode = mode;
     f->filesize = stats->st_size;
-    f->is_symlink = is_symlink(reinterpret_cast<struct stat *>(stat)) == FS_SUCCESS ? true : false;
+    f->is_symlink = is_symlink(stats) == FS_SUCCESS ? true : false;
 
     if (filepath != NULL) {
         char *path = NULL;
@@ -443,7 +500,7 @@ file_t f_init(const char* filepath) {
         return NULL;
     }
 
-    return init_with_stat((struct stat *)&stat, filepath);
+    return init_with_stat(&stats, filepath);
 }
 
 file_t f_init_by_fd(int fd) {
@@ -454,7 +511,10 @@ file_t f_init_by_fd(int fd) {
         return NULL;
     }
 
-    return init_with_stat((struct stat *)&stat, nullptr);
+    file_t f = init_with_stat(&stats, nullptr);
+    if (f != NULL)
+        f->fd = fd;
+    return f;
 }
 
 void f_free(file_t f) {
@@ -488,7 +548,9 @@ size_t f_filesize(file_t f) {
 }
 
 ssize_t f_pread(file_t f, void *buf, size_t count, off_t offset) {
-
+    if (f == NULL || f->fd < 0)
+        return FS_FAILURE;
+    return pread(f->fd, buf, count, offset);
 }
 /*******************************************************************************
 *   PRIVATE FUNCTIONS
@@ -161,6 +161,38 @@ char** fs_list_dir(const char* path, int* items);
 
 ssize_t fs_get_size_for_fd(const int fd);
 
+/*  Write all count bytes of buf at offset of fd, retrying partial and
+    interrupted writes; the file position is left as is
+    Returns:
+        FS_SUCCESS
+        FS_FAILURE      - errno tells why
+*/
+int fs_pwrite_all(int fd, const void* buf, size_t count, off_t offset);
+
+/*  Flush the written data of fd to storage; with data_only, metadata not
+    needed to read the data back (e.g. mtime) may stay behind (fdatasync)
+    Returns:
+        FS_SUCCESS
+        FS_FAILURE
+*/
+int fs_sync_fd(int fd, bool data_only);
+
+/*  Cut or extend the file of fd to size bytes
+    Returns:
+        FS_SUCCESS
+        FS_FAILURE
+*/
+int fs_truncate_fd(int fd, off_t size);
+
+/*  Flush the directory entries of the directory holding path, which makes
+    a file created or renamed there survive a crash
+    Returns:
+        FS_SUCCESS
+        FS_FAILURE
+        FS_NOT_VALID    - invalid path name
+*/
+int fs_sync_parent_dir(const char* path);
+
 /**
  *  Initialize the file_t object and pull information about the file pointed to
     by filepath
@@ -0,0 +1,186 @@
+#include "warm_up.h"
+#include "pdfium_library.h"
+
+#include <time.h>
+
+#include <public/fpdf_sysfontinfo.h>
+#include <public/fpdfview.h>
+#include <public/cpp/fpdf_scopers.h>
+
+// One page, one line of text in a non-embedded TrueType font. Resolving the
+// font forces the mapper to enumerate the system fonts.
+static const char kWarmUpDocument[] =
+        "%PDF-1.4\n"
+        "1 0 obj\n"
+        "<< /Type /Catalog /Pages 2 0 R >>\n"
+        "endobj\n"
+        "2 0 obj\n"
+        "<< /Type /Pages /Kids [3 0 R] /Count 1 >>\n"
+        "endobj\n"
+        "3 0 obj\n"
+        "<< /Type /Page /Parent 2 0 R /MediaBox [0 0 64 32] /Resources << /Font << /F1 5 0 R >> >> /Contents 4 0 R >>\n"
+        "endobj\n"
+        "4 0 obj\n"
+        "<< /Length 36 >>\n"
+        "stream\n"
+        "BT /F1 12 Tf 2 10 Td (Warm up) Tj ET\n"
+        "endstream\n"
+        "endobj\n"
+        "5 0 obj\n"
+        "<< /Type /Font /Subtype /TrueType /BaseFont /Arial /Encoding /WinAnsiEncoding >>\n"
+        "endobj\n"
+        "xref\n"
+        "0 6\n"
+        "0000000000 65535 f \n"
+        "0000000009 00000 n \n"
+        "0000000058 00000 n \n"
+        "0000000115 00000 n \n"
+        "0000000239 00000 n \n"
+        "0000000325 00000 n \n"
+        "trailer\n"
+        "<< /Size 6 /Root 1 0 R >>\n"
+        "startxref\n"
+        "421\n"
+        "%%EOF\n";
+
+static int64_t nowNanos() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t) ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/**
+ * Forwards every call to the system font info in use and times the font
+ * enumeration. PDFium owns it once installed and calls Release when the
+ * library is destroyed.
+ */
+struct TimedFontInfo : public FPDF_SYSFONTINFO {
+    FPDF_SYSFONTINFO *base;
+    // PDFium's default info is freed differently from our own ones
+    bool baseIsDefault;
+    // The caller's timings during the warm-up render, NULL after it
+    WarmUpTimings *timings;
+};
+
+static FPDF_SYSFONTINFO *baseOf(FPDF_SYSFONTINFO *info) {
+    return static_cast<TimedFontInfo *>(info)->base;
+}
+
+static void timedRelease(FPDF_SYSFONTINFO *info) {
+    TimedFontInfo *self = static_cast<TimedFontInfo *>(info);
+    if (self->baseIsDefault) {
+        FPDF_FreeDefaultSystemFontInfo(self->base);
+    } else {
+        self->base->Release(self->base);
+    }
+    delete self;
+}
+
+static void timedEnumFonts(FPDF_SYSFONTINFO *info, void *mapper) {
+    TimedFontInfo *self = static_cast<TimedFontInfo *>(info);
+    int64_t start = nowNanos();
+    if (self->base->EnumFonts != NULL) {
+        self->base->EnumFonts(self->base, mapper);
+    }
+    // Only the warm-up render measures it, later enumerations (after a
+    // library restart) are not measured
+    if (self->timings != NULL) {
+        self->timings->fontEnumNanos = nowNanos() - start;
+        self->timings = NULL;
+    }
+}
+
+static void *timedMapFont(FPDF_SYSFONTINFO *info, int weight, FPDF_BOOL italic, int charset,
+                          int pitchFamily, const char *face, FPDF_BOOL *exact) {
+    FPDF_SYSFONTINFO *base = baseOf(info);
+    if (base->MapFont == NULL) return NULL;
+    return base->MapFont(base, weight, italic, charset, pitchFamily, face, exact);
+}
+
+static void *timedGetFont(FPDF_SYSFONTINFO *info, const char *face) {
+    FPDF_SYSFONTINFO *base = baseOf(info);
+    if (base->GetFont == NULL) return NULL;
+    return base->GetFont(base, face);
+}
+
+static unsigned long timedGetFontData(FPDF_SYSFONTINFO *info, void *font, unsigned int table,
+                                      unsigned char *buffer, unsigned long size) {
+    FPDF_SYSFONTINFO *base = baseOf(info);
+    return base->GetFontData(base, font, table, buffer, size);
+}
+
+static unsigned long timedGetFaceName(FPDF_SYSFONTINFO *info, void *font, char *buffer,
+                                      unsigned long size) {
+    FPDF_SYSFONTINFO *base = baseOf(info);
+    if (base->GetFaceName == NULL) return 0;
+    return base->GetFaceName(base, font, buffer, size);
+}
+
+static int timedGetFontCharset(FPDF_SYSFONTINFO *info, void *font) {
+    FPDF_SYSFONTINFO *base = baseOf(info);
+    if (base->GetFontCharset == NULL) return FXFONT_DEFAULT_CHARSET;
+    return base->GetFontCharset(base, font);
+}
+
+static void timedDeleteFont(FPDF_SYSFONTINFO *info, void *font) {
+    FPDF_SYSFONTINFO *base = baseOf(info);
+    base->DeleteFont(base, font);
+}
+
+// The installed wrapper, NULL if there is no font info to wrap
+static TimedFontInfo *installTimedFontInfo(WarmUpTimings *timings) {
+    // Wraps the font index when one is configured
+    FPDF_SYSFONTINFO *base = PdfiumLibrary::newSystemFontInfo();
+    bool baseIsDefault = base == NULL;
+    if (baseIsDefault) {
+        base = FPDF_GetDefaultSystemFontInfo();
+    }
+    if (base == NULL) return NULL;
+
+    TimedFontInfo *info = new TimedFontInfo();
+    info->version = 1;
+    info->Release = timedRelease;
+    info->EnumFonts = timedEnumFonts;
+    info->MapFont = timedMapFont;
+    info->GetFont = timedGetFont;
+    info->GetFontData = timedGetFontData;
+    info->GetFaceName = timedGetFaceName;
+    info->GetFontCharset = timedGetFontCharset;
+    info->DeleteFont = timedDeleteFont;
+    info->base = base;
+    info->baseIsDefault = baseIsDefault;
+    info->timings = timings;
+    FPDF_SetSystemFontInfo(info);
+    return info;
+}
+
+void warmUpLibrary(WarmUpTimings *timings) {
+    *timings = WarmUpTimings();
+
+    int64_t start = nowNanos();
+    bool initialized = PdfiumLibrary::pin();
+    timings->libraryInitNanos = nowNanos() - start;
+
+    // The mapper only enumerates once, so the timing hook is useful only
+    // while it hasn't run yet, that is right after initialization
+    TimedFontInfo *fontInfo = NULL;
+    if (initialized) {
+        fontInfo = installTimedFontInfo(timings);
+    }
+
+    start = nowNanos();
+    ScopedFPDFDocument doc(FPDF_LoadMemDocument(kWarmUpDocument, sizeof(kWarmUpDocument) - 1,
+                                                nullptr));
+    if (doc) {
+        ScopedFPDFPage page(FPDF_LoadPage(doc.get(), 0));
+        ScopedFPDFBitmap bitmap(FPDFBitmap_Create(64, 32, 0));
+        if (page && bitmap) {
+            FPDFBitmap_FillRect(bitmap.get(), 0, 0, 64, 32, 0xFFFFFFFF);
+            FPDF_RenderPageBitmap(bitmap.get(), page.get(), 0, 0, 64, 32, 0, FPDF_ANNOT);
+        }
+    }
+    timings->renderNanos = nowNanos() - start;
+    // The render may not have needed the fonts enumerated: timings lives
+    // on the caller's stack, a later enumeration must not write to it
+    if (fontInfo != NULL) fontInfo->timings = NULL;
+}
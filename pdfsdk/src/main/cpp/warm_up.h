@@ -0,0 +1,25 @@
+#ifndef PDFVIEW_WARM_UP_H
+#define PDFVIEW_WARM_UP_H
+
+#include <stdint.h>
+
+struct WarmUpTimings {
+    int64_t libraryInitNanos;
+    // Time PDFium spent enumerating system fonts, 0 if the font mapper was
+    // already set up before the warm-up
+    int64_t fontEnumNanos;
+    // First render of the embedded document, font enumeration included
+    int64_t renderNanos;
+};
+
+/**
+ * Pays the one-time costs of the first page ahead of time: pins the library,
+ * lets PDFium's font mapper enumerate the system fonts and renders a tiny
+ * embedded document with a non-embedded font so the mapper, the font cache
+ * and the glyph cache are all populated.
+ *
+ * Calls into PDFium, so the caller must hold the document lock.
+ */
+void warmUpLibrary(WarmUpTimings *timings);
+
+#endif //PDFVIEW_WARM_UP_H
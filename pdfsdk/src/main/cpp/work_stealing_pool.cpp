@@ -0,0 +1,90 @@
+#include "work_stealing_pool.h"
+
+// Index of the pool worker running on this thread, -1 on other threads
+static thread_local int sCurrentWorker = -1;
+static thread_local const WorkStealingPool *sCurrentPool = nullptr;
+
+WorkStealingPool::WorkStealingPool(int workers) : queued(0), nextQueue(0) {
+    if (workers < 1) workers = 1;
+    for (int i = 0; i < workers; i++) {
+        queues.push_back(std::unique_ptr<Queue>(new Queue()));
+    }
+    for (int i = 0; i < workers; i++) {
+        threads.push_back(std::thread(&WorkStealingPool::run, this, i));
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    wait();
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (size_t i = 0; i < threads.size(); i++) {
+        threads[i].join();
+    }
+}
+
+void WorkStealingPool::submit(Task task) {
+    int target = sCurrentPool == this ? sCurrentWorker
+                                      : (int) (nextQueue++ % queues.size());
+    {
+        std::lock_guard<std::mutex> guard(queues[target]->lock);
+        queues[target]->tasks.push_back(std::move(task));
+    }
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        pending++;
+        queued++;
+    }
+    wake.notify_one();
+}
+
+void WorkStealingPool::wait() {
+    std::unique_lock<std::mutex> guard(lock);
+    idle.wait(guard, [this] { return pending == 0; });
+}
+
+bool WorkStealingPool::take(int worker, Task *task) {
+    {
+        Queue &own = *queues[worker];
+        std::lock_guard<std::mutex> guard(own.lock);
+        if (!own.tasks.empty()) {
+            *task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            queued--;
+            return true;
+        }
+    }
+    int count = (int) queues.size();
+    for (int i = 1; i < count; i++) {
+        Queue &victim = *queues[(worker + i) % count];
+        std::lock_guard<std::mutex> guard(victim.lock);
+        if (!victim.tasks.empty()) {
+            *task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            queued--;
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::run(int worker) {
+    sCurrentWorker = worker;
+    sCurrentPool = this;
+    while (true) {
+        Task task;
+        if (take(worker, &task)) {
+            task(worker);
+            std::lock_guard<std::mutex> guard(lock);
+            if (--pending == 0) idle.notify_all();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> guard(lock);
+        wake.wait(guard, [this] { return stopping || queued.load() > 0; });
+        if (stopping && queued.load() == 0) return;
+    }
+}
@@ -0,0 +1,65 @@
+#ifndef PDFVIEW_WORK_STEALING_POOL_H
+#define PDFVIEW_WORK_STEALING_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Fixed set of worker threads, each with its own task deque. A worker runs
+ * its newest task first and, when its deque is empty, steals the oldest
+ * task of another worker. Tasks submitted from inside a task go to the
+ * submitting worker's deque, so a task can split its work and let idle
+ * workers take the pieces.
+ */
+class WorkStealingPool {
+public:
+    // Runs on a worker, given the worker's index in [0, workerCount())
+    typedef std::function<void(int)> Task;
+
+    explicit WorkStealingPool(int workers);
+
+    // Waits for the queued tasks, then stops the workers
+    ~WorkStealingPool();
+
+    void submit(Task task);
+
+    // Blocks until every submitted task, including those they submitted, ran
+    void wait();
+
+    int workerCount() const { return (int) queues.size(); }
+
+private:
+    struct Queue {
+        std::mutex lock;
+        std::deque<Task> tasks;
+    };
+
+    WorkStealingPool(const WorkStealingPool &);
+
+    WorkStealingPool &operator=(const WorkStealingPool &);
+
+    void run(int worker);
+
+    bool take(int worker, Task *task);
+
+    std::vector<std::unique_ptr<Queue> > queues;
+    std::vector<std::thread> threads;
+
+    std::mutex lock;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    // Tasks in the deques, changed under lock when it grows
+    std::atomic<int> queued;
+    // Tasks submitted and not finished yet, changed under lock
+    int pending = 0;
+    bool stopping = false;
+    std::atomic<unsigned> nextQueue;
+};
+
+#endif //PDFVIEW_WORK_STEALING_POOL_H
@@ -0,0 +1,63 @@
+package com.hungknow.pdfsdk
+
+import android.util.Log
+import com.hungknow.pdfsdk.listeners.OnSaveListener
+import java.io.File
+import java.util.concurrent.Callable
+import java.util.concurrent.Executors
+import java.util.concurrent.Future
+import java.util.concurrent.TimeUnit
+
+/**
+ * Saves [doc] into [target] every [intervalMs] while it has unsaved edits,
+ * with [PdfiumSDK.saveToFile] on a thread of its own: the viewer only waits
+ * for the PDFium lock while the save snapshot is taken, never for the
+ * write. Call [stop] before closing the document.
+ */
+class AutoSaver(private val sdk: PdfiumSDK, private val doc: PdfDocument, private val target: File,
+                private val intervalMs: Long = DEFAULT_INTERVAL_MS,
+                private val listener: OnSaveListener? = null) {
+
+    private val executor = Executors.newSingleThreadScheduledExecutor { Thread(it, "PdfAutoSave") }
+
+    /** [PdfDocument.changeCount] at the last snapshot that was saved */
+    @Volatile
+    private var savedChangeCount = doc.changeCount
+
+    fun start() {
+        executor.scheduleWithFixedDelay({ saveIfChanged() }, intervalMs, intervalMs,
+            TimeUnit.MILLISECONDS)
+    }
+
+    /** Save now if there are unsaved edits, true once they are saved */
+    fun saveNow(): Future<Boolean> = executor.submit(Callable { saveIfChanged() })
+
+    /**
+     * Stop saving, after a last save of the pending edits if [flush]. Waits
+     * for a running save, the document can be closed once it returns.
+     */
+    fun stop(flush: Boolean = true) {
+        if (flush && !executor.isShutdown) saveNow()
+        executor.shutdown()
+        executor.awaitTermination(Long.MAX_VALUE, TimeUnit.MILLISECONDS)
+    }
+
+    private fun saveIfChanged(): Boolean {
+        // Edits made while the snapshot is taken are counted again next time
+        val changeCount = doc.changeCount
+        if (changeCount == savedChangeCount) return true
+        val saved = sdk.saveToFile(doc, target, listener = listener)
+        if (saved) {
+            savedChangeCount = changeCount
+        } else {
+            Log.w(TAG, "Autosave to $target failed")
+        }
+        listener?.onSaveDone(target, saved)
+        return saved
+    }
+
+    companion object {
+        const val DEFAULT_INTERVAL_MS = 30_000L
+        private val TAG = AutoSaver::class.simpleName
+    }
+}
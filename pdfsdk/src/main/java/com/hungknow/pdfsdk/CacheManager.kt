@@ -1,7 +1,10 @@
 package com.hungknow.pdfsdk
 
 import android.graphics.RectF
+import com.hungknow.pdfsdk.models.AnnotationPart
 import com.hungknow.pdfsdk.models.PagePart
+import com.hungknow.pdfsdk.utils.ColorScheme
+import com.hungknow.pdfsdk.utils.Constants.Companion.Cache.ANNOTATIONS_CACHE_SIZE
 import com.hungknow.pdfsdk.utils.Constants.Companion.Cache.CACHE_SIZE
 import com.hungknow.pdfsdk.utils.Constants.Companion.Cache.THUMBNAILS_CACHE_SIZE
 import java.util.PriorityQueue
@@ -13,6 +16,9 @@ class CacheManager {
     private var passiveCache = PriorityQueue(CACHE_SIZE, orderComparator)
     var thumbnails = mutableListOf<PagePart>()
 
+    // Oldest first, at most one bitmap per annotation
+    private val annotations = mutableListOf<AnnotationPart>()
+
     private val passiveActiveLock = Any()
 
     val pageParts: List<PagePart>
@@ -65,8 +71,10 @@ class CacheManager {
         }
     }
 
-    fun upPartIfContained(page: Int, pageRelativeBounds: RectF, toOrder: Int): Boolean {
-        val fakePart = PagePart(page, null, pageRelativeBounds, false, 0)
+    // Parts are kept per color scheme, so switching schemes back and forth
+    // finds the parts of the previous one still cached
+    fun upPartIfContained(page: Int, pageRelativeBounds: RectF, toOrder: Int, colorScheme: ColorScheme): Boolean {
+        val fakePart = PagePart(page, null, pageRelativeBounds, false, 0, colorScheme)
 
         var found: PagePart?
         synchronized(passiveActiveLock) {
@@ -81,9 +89,64 @@ class CacheManager {
         }
     }
 
+    val annotationParts: List<AnnotationPart>
+        get() {
+            synchronized(annotations) {
+                return annotations.toList()
+            }
+        }
+
+    // Replaces the annotation's bitmap of another zoom level or scheme, if any
+    fun cacheAnnotation(part: AnnotationPart) {
+        synchronized(annotations) {
+            removeAnnotation(part.page, part.annotIndex)
+            while (annotations.size >= ANNOTATIONS_CACHE_SIZE) {
+                annotations.removeAt(0).renderedBitmap?.recycle()
+            }
+            annotations.add(part)
+        }
+    }
+
+    fun containsAnnotation(page: Int, annotIndex: Int, zoom: Float, colorScheme: ColorScheme): Boolean {
+        synchronized(annotations) {
+            return annotations.any {
+                it.isSameAnnotation(page, annotIndex) && it.zoom == zoom && it.colorScheme == colorScheme
+            }
+        }
+    }
+
+    fun removeAnnotation(page: Int, annotIndex: Int) {
+        synchronized(annotations) {
+            val it = annotations.iterator()
+            while (it.hasNext()) {
+                val part = it.next()
+                if (part.isSameAnnotation(page, annotIndex)) {
+                    part.renderedBitmap?.recycle()
+                    it.remove()
+                }
+            }
+        }
+    }
+
+    // Cached parts and thumbnails of a page overlapping page-relative bounds
+    fun partsIntersecting(page: Int, bounds: RectF): List<PagePart> {
+        val parts = mutableListOf<PagePart>()
+        synchronized(passiveActiveLock) {
+            (passiveCache + activeCache).filterTo(parts) {
+                it.page == page && RectF.intersects(it.pageRelativeBounds, bounds)
+            }
+        }
+        synchronized(thumbnails) {
+            thumbnails.filterTo(parts) {
+                it.page == page && RectF.intersects(it.pageRelativeBounds, bounds)
+            }
+        }
+        return parts
+    }
+
     // Return true if already contains the described PagePart
-    fun containsThumbnail(page: Int, pageRelativeBounds: RectF): Boolean {
-        val fakePart = PagePart(page, null, pageRelativeBounds, true, 0)
+    fun containsThumbnail(page: Int, pageRelativeBounds: RectF, colorScheme: ColorScheme): Boolean {
+        val fakePart = PagePart(page, null, pageRelativeBounds, true, 0, colorScheme)
         synchronized(thumbnails) {
             thumbnails.forEach {
                 if (it == fakePart) {
@@ -111,6 +174,12 @@ class CacheManager {
             }
             thumbnails.clear()
         }
+        synchronized(annotations) {
+            annotations.forEach {
+                it.renderedBitmap?.recycle()
+            }
+            annotations.clear()
+        }
     }
 
     // Add part if it doesn't exist, recycle bitmap otherwise
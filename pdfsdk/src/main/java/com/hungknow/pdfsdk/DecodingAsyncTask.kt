@@ -17,6 +17,10 @@ class DecodingAsyncTask(val docSource: DocumentSource, val password: String, val
             if (pdfView != null) {
                 val pdfDocument =
                     docSource.createDocument(pdfView.context, pdfiumSDK, password)
+                // Before any page is opened, pages attach to the form environment on load
+                if (pdfView.formFilling) {
+                    pdfiumSDK.initFormFill(pdfDocument)
+                }
                 pdfFile = PdfFile(
                     pdfiumSDK,
                     pdfDocument,
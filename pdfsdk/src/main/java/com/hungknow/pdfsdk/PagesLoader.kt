@@ -110,6 +110,7 @@ class PagesLoader(val pdfView: PdfView) {
 
         for (range in rangeList) {
 //            loadThumbnail(range.page)
+            pdfView.loadAnnotations(range.page)
         }
         for (range in rangeList) {
             calculatePartSize(range.gridSize)
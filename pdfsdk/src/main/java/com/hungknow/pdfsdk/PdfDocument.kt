@@ -2,11 +2,39 @@ package com.hungknow.pdfsdk
 
 import android.graphics.RectF
 import android.os.ParcelFileDescriptor
+import java.util.concurrent.ConcurrentHashMap
+import java.util.concurrent.locks.ReentrantReadWriteLock
 
 class PdfDocument(val NativeDocPtr: Long, var FileDescriptor: ParcelFileDescriptor?) {
     val NativePagesPtr = mutableMapOf<Int, Long>()
     val NativeTextPagesPtr = mutableMapOf<Int, Long>()
 
+    /** Hit-testing indexes, read from the UI thread while built on the rendering thread */
+    val NativePageIndexPtr = ConcurrentHashMap<Int, Long>()
+
+    /**
+     * Read by the index queries, which don't take the rendering lock, and
+     * written while an index is closed, so no query runs on a freed index
+     */
+    val pageIndexLock = ReentrantReadWriteLock()
+
+    /** Page size tables returned by [PdfiumSDK.getAllPageSizes], by flags */
+    val pageSizes = ConcurrentHashMap<Int, FloatArray>()
+
+    /** Annotation layer contents of each page, cleared when an annotation changes */
+    val layerAnnotations = ConcurrentHashMap<Int, List<Annotation>>()
+
+    /** Links of each page, filled on first use or all at once by [PdfiumSDK.prefetchLinks] */
+    val pageLinks = ConcurrentHashMap<Int, List<Link>>()
+
+    /** Read on first use by [PdfiumSDK.getPageLabels] */
+    @Volatile
+    var pageLabels: PdfPageLabels? = null
+
+    /** Edits made through [PdfiumSDK], for [AutoSaver] to tell whether there is anything to save */
+    @Volatile
+    var changeCount = 0L
+
     /**
      * The pages the user want to display in order
      * (ex: 0, 2, 2, 8, 8, 1, 1, 1)
@@ -43,4 +71,21 @@ class PdfDocument(val NativeDocPtr: Long, var FileDescriptor: ParcelFileDescript
     }
 
     data class Link(val bounds: RectF, val destPageIdx: Int, val uri: String)
+
+    /** An annotation of the annotation layer, [bounds] relative to the page size like PagePart bounds */
+    data class Annotation(val index: Int, val subtype: Int, val bounds: RectF)
+
+    /** Part of a page a form edit changed, [bounds] relative to the page size like PagePart bounds */
+    data class DirtyRect(val pageIdx: Int, val bounds: RectF)
+
+    /** Outline entry; [id] identifies it in later [PdfiumSDK.getBookmarks] calls */
+    data class Bookmark(val id: Int, val title: String, val pageIdx: Int, val hasChildren: Boolean)
+
+    /** A window of the children of an outline entry */
+    data class BookmarkPage(val totalCount: Int, val bookmarks: List<Bookmark>)
+
+    companion object {
+        /** Id of the invisible outline root, parent of the top level bookmarks */
+        const val OUTLINE_ROOT = 0
+    }
 }
\ No newline at end of file
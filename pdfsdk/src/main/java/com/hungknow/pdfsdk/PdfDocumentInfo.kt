@@ -0,0 +1,19 @@
+package com.hungknow.pdfsdk
+
+/**
+ * Everything the library screen shows about a document, read in one native
+ * call. The page labels themselves are read apart, by [PdfiumSDK.getPageLabels].
+ */
+class PdfDocumentInfo(
+    val meta: PdfDocumentMeta,
+    val pageCount: Int,
+    /** PDF version times ten, e.g. 17 for PDF 1.7, or 0 if unknown */
+    val fileVersion: Int,
+    /** FPDF_GetDocPermissions bits, 0xFFFFFFFF when not protected */
+    val permissions: Long,
+    /** One of the PAGEMODE_* values of fpdf_ext.h */
+    val pageMode: Int,
+    val isTagged: Boolean,
+    /** The document has a /PageLabels number tree */
+    val hasPageLabels: Boolean
+)
@@ -2,10 +2,12 @@ package com.hungknow.pdfsdk
 
 import android.graphics.Bitmap
 import android.graphics.Rect
+import android.graphics.RectF
 import android.util.SparseBooleanArray
 import com.hungknow.pdfsdk.exceptions.PageRenderingException
 import com.hungknow.pdfsdk.models.Size
 import com.hungknow.pdfsdk.models.SizeF
+import com.hungknow.pdfsdk.utils.ColorScheme
 import com.hungknow.pdfsdk.utils.FitPolicy
 import java.util.*
 
@@ -48,10 +50,10 @@ class PdfFile(
     private val openedPages = SparseBooleanArray()
 
     /** Page with maximum width  */
-    private val originalMaxWidthPageSize = Size(0, 0)
+    private var originalMaxWidthPageSize = Size(0, 0)
 
     /** Page with maximum height  */
-    private val originalMaxHeightPageSize = Size(0, 0)
+    private var originalMaxHeightPageSize = Size(0, 0)
 
     /** Scaled page with maximum height  */
     private val maxHeightPageSize = SizeF(0f, 0f)
@@ -90,6 +92,34 @@ class PdfFile(
      */
 //    private val originalUserPages = mutableListOf<Int>()
 
+    init {
+        setup()
+    }
+
+    private fun setup() {
+        val pdfDocument = this.pdfDocument ?: return
+        // All page sizes come from a single native call, memoized in the document
+        val sizes = pdfiumSDK.getAllPageSizes(pdfDocument)
+        val documentPagesCount = sizes.size / 2
+        val userPages = originalUserPages
+        pagesCount = if (userPages.isNullOrEmpty()) documentPagesCount else userPages.size
+
+        originalPageSizes.clear()
+        for (i in 0 until documentPagesCount) {
+            val pageSize = Size(
+                (sizes[i * 2] * PdfiumSDK.mCurrentDpi / 72).toInt(),
+                (sizes[i * 2 + 1] * PdfiumSDK.mCurrentDpi / 72).toInt()
+            )
+            if (pageSize.width > originalMaxWidthPageSize.width) {
+                originalMaxWidthPageSize = pageSize
+            }
+            if (pageSize.height > originalMaxHeightPageSize.height) {
+                originalMaxHeightPageSize = pageSize
+            }
+            originalPageSizes.add(pageSize)
+        }
+    }
+
     val maxPageSize
         get() = if (isVertical) maxWidthPageSize else maxHeightPageSize
 
@@ -215,9 +245,63 @@ class PdfFile(
         return !openedPages.get(docPage, false)
     }
 
-    fun renderPageBitmap(bitmap: Bitmap, pageIndex: Int, bounds: Rect, annotationRendering: Boolean) {
+    fun getLayerAnnotations(pageIndex: Int): List<PdfDocument.Annotation> {
+        val pdfDocument = this.pdfDocument ?: return emptyList()
+        return pdfiumSDK.getLayerAnnotations(pdfDocument, documentPage(pageIndex))
+    }
+
+    fun invalidateLayerAnnotations(pageIndex: Int) {
+        val pdfDocument = this.pdfDocument ?: return
+        pdfiumSDK.invalidateLayerAnnotations(pdfDocument, documentPage(pageIndex))
+    }
+
+    fun renderAnnotation(bitmap: Bitmap, pageIndex: Int, annotIndex: Int, bounds: Rect, colorScheme: ColorScheme): Boolean {
+        val pdfDocument = this.pdfDocument ?: return false
+        return pdfiumSDK.renderAnnotation(pdfDocument, bitmap, documentPage(pageIndex), annotIndex, bounds.left, bounds.top, bounds.width(), bounds.height(), colorScheme)
+    }
+
+    fun commitInkStroke(strokePtr: Long, pageIndex: Int, bounds: Rect): Int {
+        val pdfDocument = this.pdfDocument ?: return -1
+        return pdfiumSDK.commitInkStroke(pdfDocument, strokePtr, documentPage(pageIndex), bounds.left, bounds.top, bounds.width(), bounds.height())
+    }
+
+    fun formTap(pageIndex: Int, x: Float, y: Float): Boolean {
+        val pdfDocument = this.pdfDocument ?: return false
+        return pdfiumSDK.formTap(pdfDocument, documentPage(pageIndex), x, y)
+    }
+
+    fun formTypeText(pageIndex: Int, text: String): Boolean {
+        val pdfDocument = this.pdfDocument ?: return false
+        return pdfiumSDK.formTypeText(pdfDocument, documentPage(pageIndex), text)
+    }
+
+    fun formPressKey(pageIndex: Int, keyCode: Int, shift: Boolean): Boolean {
+        val pdfDocument = this.pdfDocument ?: return false
+        return pdfiumSDK.formPressKey(pdfDocument, documentPage(pageIndex), keyCode, shift)
+    }
+
+    /** Form edits to repaint, by user page; a document page shown several times appears for each */
+    fun takeFormDirtyRects(): List<Pair<Int, RectF>> {
+        val pdfDocument = this.pdfDocument ?: return emptyList()
+        val dirty = pdfiumSDK.takeFormDirtyRects(pdfDocument)
+        val userPages = originalUserPages
+        if (userPages.isNullOrEmpty()) {
+            return dirty.map { Pair(it.pageIdx, it.bounds) }
+        }
+        val result = mutableListOf<Pair<Int, RectF>>()
+        for (rect in dirty) {
+            userPages.forEachIndexed { userPage, docPage ->
+                if (docPage == rect.pageIdx) {
+                    result.add(Pair(userPage, rect.bounds))
+                }
+            }
+        }
+        return result
+    }
+
+    fun renderPageBitmap(bitmap: Bitmap, pageIndex: Int, bounds: Rect, annotationRendering: Boolean, colorScheme: ColorScheme) {
         val pdfDocument = this.pdfDocument ?: return
         val docPage = documentPage(pageIndex)
-        pdfiumSDK.renderPageBitmap(pdfDocument, bitmap, docPage, bounds.left, bounds.top, bounds.width(), bounds.height(), annotationRendering)
+        pdfiumSDK.renderPageBitmap(pdfDocument, bitmap, docPage, bounds.left, bounds.top, bounds.width(), bounds.height(), annotationRendering, colorScheme)
     }
 }
\ No newline at end of file
@@ -0,0 +1,38 @@
+package com.hungknow.pdfsdk
+
+/**
+ * The page labels of a document, kept as ranges: a range starts at a page
+ * with an explicit label and the following pages continue its trailing
+ * number.
+ */
+class PdfPageLabels(
+    private val pageCount: Int,
+    private val rangeStarts: IntArray,
+    private val rangeLabels: Array<String>
+) {
+    val isEmpty: Boolean
+        get() = rangeStarts.isEmpty()
+
+    /** Get the label of a page, or null if the document has no page labels */
+    fun getPageLabel(pageIndex: Int): String? {
+        if (pageIndex < 0 || pageIndex >= pageCount) {
+            return null
+        }
+        var range = rangeStarts.binarySearch(pageIndex)
+        if (range < 0) {
+            range = -range - 2
+        }
+        if (range < 0) {
+            return null
+        }
+
+        val label = rangeLabels[range]
+        val offset = pageIndex - rangeStarts[range]
+        if (offset == 0) {
+            return label
+        }
+        val digits = label.takeLastWhile { it in '0'..'9' }
+        val number = digits.toLongOrNull() ?: return label
+        return label.dropLast(digits.length) + (number + offset)
+    }
+}
@@ -0,0 +1,94 @@
+package com.hungknow.pdfsdk
+
+import android.os.Bundle
+import android.os.CancellationSignal
+import android.os.Handler
+import android.os.Looper
+import android.os.ParcelFileDescriptor
+import android.print.PageRange
+import android.print.PrintAttributes
+import android.print.PrintDocumentAdapter
+import android.print.PrintDocumentInfo
+import android.util.Log
+import com.hungknow.pdfsdk.listeners.OnPrintListener
+import java.util.concurrent.Executors
+import java.util.concurrent.RejectedExecutionException
+
+/**
+ * Prints an open document through Android's print framework, e.g.
+ * `printManager.print(name, PdfPrintAdapter(sdk, doc, name), null)`. The
+ * requested pages are rasterized at [dpi] by [PdfiumSDK.printPages] on a
+ * thread of the adapter, so the viewer keeps rendering meanwhile. Keep the
+ * document open until [onFinish].
+ */
+class PdfPrintAdapter(private val sdk: PdfiumSDK, private val doc: PdfDocument, private val name: String,
+                      private val dpi: Int = 300) : PrintDocumentAdapter() {
+
+    private val executor = Executors.newSingleThreadExecutor { Thread(it, "PdfPrint") }
+    private val mainHandler = Handler(Looper.getMainLooper())
+
+    /** Set by [onLayout] from the print attributes */
+    @Volatile
+    private var grayscale = false
+
+    override fun onLayout(oldAttributes: PrintAttributes?, newAttributes: PrintAttributes,
+                          cancellationSignal: CancellationSignal, callback: LayoutResultCallback,
+                          extras: Bundle?) {
+        if (cancellationSignal.isCanceled) {
+            callback.onLayoutCancelled()
+            return
+        }
+        grayscale = newAttributes.colorMode == PrintAttributes.COLOR_MODE_MONOCHROME
+        // Pages keep their own size, the printer scales them to the paper
+        val info = PrintDocumentInfo.Builder(name)
+            .setContentType(PrintDocumentInfo.CONTENT_TYPE_DOCUMENT)
+            .setPageCount(sdk.getPageCount(doc))
+            .build()
+        callback.onLayoutFinished(info, newAttributes != oldAttributes)
+    }
+
+    override fun onWrite(pages: Array<PageRange>, destination: ParcelFileDescriptor,
+                         cancellationSignal: CancellationSignal, callback: WriteResultCallback) {
+        // The framework waits on the callback, every path has to complete it
+        try {
+            executor.execute {
+                try {
+                    val indexes = pageIndexes(pages, sdk.getPageCount(doc))
+                    val result = sdk.printPages(doc, indexes, destination, dpi, grayscale,
+                        listener = object : OnPrintListener {
+                            override fun onPageRendered(index: Int, pageIndex: Int) = !cancellationSignal.isCanceled
+                        })
+                    if (result == null) {
+                        mainHandler.post { callback.onWriteCancelled() }
+                    } else {
+                        Log.i(TAG, "Printed $name: $result")
+                        mainHandler.post { callback.onWriteFinished(pages) }
+                    }
+                } catch (e: Exception) {
+                    Log.e(TAG, "Cannot print $name", e)
+                    mainHandler.post { callback.onWriteFailed(e.message) }
+                }
+            }
+        } catch (e: RejectedExecutionException) {
+            callback.onWriteFailed(e.message)
+        }
+    }
+
+    override fun onFinish() {
+        executor.shutdown()
+    }
+
+    companion object {
+        private val TAG = PdfPrintAdapter::class.simpleName
+
+        /** The 0-based page indexes of [ranges], in order and clipped to [pageCount] */
+        fun pageIndexes(ranges: Array<PageRange>, pageCount: Int): IntArray {
+            if (ranges.any { it == PageRange.ALL_PAGES }) return IntArray(pageCount) { it }
+            val indexes = mutableListOf<Int>()
+            for (range in ranges) {
+                for (page in range.start..minOf(range.end, pageCount - 1)) indexes.add(page)
+            }
+            return indexes.toIntArray()
+        }
+    }
+}
@@ -10,10 +10,13 @@ import android.widget.RelativeLayout
 import com.hungknow.pdfsdk.link.DefaultLinkHandler
 import com.hungknow.pdfsdk.link.LinkHandler
 import com.hungknow.pdfsdk.listeners.*
+import com.hungknow.pdfsdk.models.AnnotationPart
 import com.hungknow.pdfsdk.models.PagePart
 import com.hungknow.pdfsdk.scroll.ScrollHandle
 import com.hungknow.pdfsdk.source.AssetSource
 import com.hungknow.pdfsdk.source.DocumentSource
+import com.hungknow.pdfsdk.utils.ColorScheme
+import com.hungknow.pdfsdk.utils.Constants
 import com.hungknow.pdfsdk.utils.Constants.Companion.DEBUG_MODE
 import com.hungknow.pdfsdk.utils.FitPolicy
 import com.hungknow.pdfsdk.utils.MathUtils
@@ -28,6 +31,9 @@ class PdfView : RelativeLayout {
         const val DEFAULT_MAX_SCALE = 3.0f
         const val DEFAULT_MID_SCALE = 1.75f
         const val DEFAULT_MIN_SCALE = 1.0f
+
+        /** Page-relative bounds of a bitmap covering the whole page */
+        private val FULL_PAGE = RectF(0f, 0f, 1f, 1f)
     }
 
     private val minZoom: Float = DEFAULT_MIN_SCALE
@@ -126,6 +132,46 @@ class PdfView : RelativeLayout {
      */
     private var annotationRendering = false
 
+    /**
+     * True if annotations are drawn from per-annotation bitmaps over page
+     * parts rendered without them, so showing, hiding or editing one
+     * annotation doesn't re-render the pages
+     */
+    var annotationLayer = false
+        private set
+
+    /** Annotations of the layer not drawn, keyed by [annotationKey] */
+    private val hiddenAnnotations = HashSet<Long>()
+
+    /** True if AcroForm fields are interactive, read when the document is decoded */
+    var formFilling = false
+        private set
+
+    /** Native stroke [addInkPoints] feeds, 0 between strokes */
+    private var inkStrokePtr = 0L
+
+    /** Page of [inkOverlay] */
+    private var inkPage = -1
+
+    /**
+     * Strokes drawn on [inkPage] at [inkOverlayZoom], shown over the page
+     * until its parts are rendered again at another zoom, or with the
+     * annotation layer until the layer shows the committed strokes
+     */
+    private var inkOverlay: Bitmap? = null
+    private var inkOverlayZoom = 0f
+
+    /**
+     * Annotations committed from [inkOverlay] the annotation layer doesn't
+     * show yet; once it shows them all, the overlay would draw them twice
+     */
+    private val inkPendingAnnots = HashSet<Int>()
+
+    /** Overlay pixels per view pixel, below 1 on pages past [Constants.INK_OVERLAY_MAX_PIXELS] */
+    private var inkScale = 1f
+    private var inkPoints = FloatArray(64)
+    private val inkDirty = Rect()
+
     /**
      * True if the view should render during scaling<br></br>
      * Can not be forced on older API versions (< Build.VERSION_CODES.KITKAT) as the GestureDetector does
@@ -139,7 +185,19 @@ class PdfView : RelativeLayout {
     private val antialiasFilter =
         PaintFlagsDrawFilter(0, Paint.ANTI_ALIAS_FLAG or Paint.FILTER_BITMAP_FLAG)
 
-    private var nightMode = false
+    /**
+     * Reading mode the pages are rendered in. Changing it re-renders the
+     * visible parts; the parts of the previous scheme stay cached until
+     * evicted, so switching back is immediate.
+     */
+    var colorScheme = ColorScheme.NONE
+        set(value) {
+            if (field == value) return
+            field = value
+            if (!recycled) {
+                loadPages()
+            }
+        }
 
     /** Spacing between pages, in px  */
     var spacing = 0
@@ -231,6 +289,10 @@ class PdfView : RelativeLayout {
 
         // Cancel all current tasks
         renderingHandler!!.removeMessages(RenderingHandler.MSG_RENDER_TASK)
+        renderingHandler!!.removeMessages(RenderingHandler.MSG_ANNOTATION_TASK)
+        if (inkStrokePtr == 0L && inkOverlayZoom != zoom) {
+            recycleInkOverlay()
+        }
         cacheManager.makeANewSet()
         pagesLoader.loadPages()
         invalidate()
@@ -362,7 +424,7 @@ class PdfView : RelativeLayout {
 
         val bg = background
         if (bg == null) {
-            canvas.drawColor(if (nightMode) Color.BLACK else Color.WHITE)
+            canvas.drawColor(if (colorScheme.isDark) Color.BLACK else Color.WHITE)
         } else {
             bg.draw(canvas)
         }
@@ -381,12 +443,18 @@ class PdfView : RelativeLayout {
         canvas.translate(currentXOffset, currentYOffset)
 
         // Draw thumbnails
+        val colorScheme = this.colorScheme
         for (part in cacheManager.thumbnails) {
-            drawPart(canvas, part)
+            if (part.colorScheme == colorScheme) {
+                drawPart(canvas, part)
+            }
         }
 
         // Draw parts
         for (part in cacheManager.pageParts) {
+            if (part.colorScheme != colorScheme) {
+                continue
+            }
             drawPart(canvas, part)
             if (callbacks.onDrawAll != null
                 && !onDrawPagesNums.contains(part.page)
@@ -395,6 +463,22 @@ class PdfView : RelativeLayout {
             }
         }
 
+        // Draw the annotation layer
+        if (annotationLayer) {
+            for (part in cacheManager.annotationParts) {
+                if (part.colorScheme == colorScheme &&
+                    !hiddenAnnotations.contains(annotationKey(part.page, part.annotIndex))) {
+                    drawPageBitmap(canvas, part.page, part.renderedBitmap, part.pageRelativeBounds)
+                }
+            }
+        }
+
+        inkOverlay?.let {
+            if (inkOverlayZoom == zoom) {
+                drawPageBitmap(canvas, inkPage, it, FULL_PAGE)
+            }
+        }
+
         for (page in onDrawPagesNums) {
             drawWithListener(canvas, page, callbacks.onDrawAll)
         }
@@ -432,9 +516,11 @@ class PdfView : RelativeLayout {
 
     /** Draw a given PagePart on the canvas */
     private fun drawPart(canvas: Canvas, part: PagePart) {
-        // Can seem strange, but avoid lot of calls
-        val pageRelativeBounds = part.pageRelativeBounds
-        val renderedBitmap = part.renderedBitmap
+        drawPageBitmap(canvas, part.page, part.renderedBitmap, part.pageRelativeBounds)
+    }
+
+    // Draws a bitmap covering pageRelativeBounds of a page
+    private fun drawPageBitmap(canvas: Canvas, page: Int, renderedBitmap: Bitmap?, pageRelativeBounds: RectF) {
         val pdfFile = this.pdfFile ?: return
 
         if (renderedBitmap == null || renderedBitmap.isRecycled) {
@@ -444,13 +530,13 @@ class PdfView : RelativeLayout {
         // Move to the target page
         var localTranslationX = 0f
         var localTranslationY = 0f
-        var size = pdfFile.getPageSize(part.page)
+        var size = pdfFile.getPageSize(page)
 
         if (swipeVertical) {
-            localTranslationY = pdfFile.getPageOffset(part.page, zoom)
+            localTranslationY = pdfFile.getPageOffset(page, zoom)
             localTranslationX = toCurrentScale(pdfFile.maxPageWidth - size.width) / 2
         } else {
-            localTranslationX = pdfFile.getPageOffset(part.page, zoom)
+            localTranslationX = pdfFile.getPageOffset(page, zoom)
             localTranslationY = toCurrentScale(pdfFile.maxPageHeight - size.height) / 2
         }
         canvas.translate(localTranslationX, localTranslationY)
@@ -475,7 +561,7 @@ class PdfView : RelativeLayout {
         canvas.drawBitmap(renderedBitmap, srcRect, dstRect, paint)
 
         if (DEBUG_MODE) {
-            debugPaint.color = if (part.page % 2 === 0) Color.RED else Color.BLUE
+            debugPaint.color = if (page % 2 === 0) Color.RED else Color.BLUE
             canvas.drawRect(dstRect, debugPaint)
         }
 
@@ -483,6 +569,201 @@ class PdfView : RelativeLayout {
         canvas.translate(-localTranslationX, -localTranslationY)
     }
 
+    /**
+     * Queue the rendering of the annotation layer of a page at the current
+     * zoom, for the annotations not cached at this zoom yet. No-op unless
+     * the annotation layer is on.
+     */
+    fun loadAnnotations(page: Int) {
+        if (!annotationLayer) return
+        val pdfFile = this.pdfFile ?: return
+        val renderingHandler = this.renderingHandler ?: return
+        val size = pdfFile.getScaledPageSize(page, zoom)
+        renderingHandler.addAnnotationTask(page, size.width, size.height, zoom, colorScheme)
+    }
+
+    fun onAnnotationRendered(part: AnnotationPart) {
+        cacheManager.cacheAnnotation(part)
+        if (part.page == inkPage && inkPendingAnnots.remove(part.annotIndex)) {
+            recycleInkOverlayIfShown()
+        }
+        invalidate()
+    }
+
+    /** Show or hide one annotation of the layer, without rendering anything */
+    fun setAnnotationVisible(page: Int, annotIndex: Int, visible: Boolean) {
+        val key = annotationKey(page, annotIndex)
+        if (if (visible) hiddenAnnotations.remove(key) else hiddenAnnotations.add(key)) {
+            invalidate()
+        }
+    }
+
+    /**
+     * Re-render one annotation of the layer after it was edited; the pages
+     * and the other annotations stay as they are. Annotation indexes follow
+     * FPDFPage_GetAnnot order, so adding or removing annotations calls for a
+     * reload of the page's layer instead.
+     */
+    fun annotationChanged(page: Int, annotIndex: Int) {
+        pdfFile?.invalidateLayerAnnotations(page)
+        cacheManager.removeAnnotation(page, annotIndex)
+        loadAnnotations(page)
+        invalidate()
+    }
+
+    private fun annotationKey(page: Int, annotIndex: Int): Long {
+        return (page.toLong() shl 32) or annotIndex.toLong()
+    }
+
+    /**
+     * Tap a form field at a position in page coordinates; see
+     * [PdfiumSDK.formTap]. The parts of the page the tap changed are
+     * repainted, not the whole page.
+     */
+    fun formTap(page: Int, x: Float, y: Float): Boolean {
+        val pdfFile = this.pdfFile ?: return false
+        val handled = pdfFile.formTap(page, x, y)
+        repaintFormChanges()
+        return handled
+    }
+
+    /** Type text into the focused form field of a page */
+    fun formTypeText(page: Int, text: String): Boolean {
+        val pdfFile = this.pdfFile ?: return false
+        val handled = pdfFile.formTypeText(page, text)
+        repaintFormChanges()
+        return handled
+    }
+
+    /** Send an editing key, as a KeyEvent key code, to the focused form field of a page */
+    fun formPressKey(page: Int, keyCode: Int, shift: Boolean = false): Boolean {
+        val pdfFile = this.pdfFile ?: return false
+        val handled = pdfFile.formPressKey(page, keyCode, shift)
+        repaintFormChanges()
+        return handled
+    }
+
+    // Re-renders only the pixels of the cached parts that form edits invalidated
+    private fun repaintFormChanges() {
+        val pdfFile = this.pdfFile ?: return
+        val renderingHandler = this.renderingHandler ?: return
+        for ((page, dirty) in pdfFile.takeFormDirtyRects()) {
+            for (part in cacheManager.partsIntersecting(page, dirty)) {
+                renderingHandler.addRepaintTask(part, dirty, annotationRendering)
+            }
+        }
+    }
+
+    /**
+     * Start a handwritten stroke on a page, [width] view pixels wide at the
+     * current zoom, in an ARGB [color]. Follow with [addInkPoints] and
+     * [endInk]. Strokes are drawn into an overlay over the page, so the page
+     * isn't rendered again while writing.
+     */
+    fun beginInk(page: Int, color: Int, width: Float) {
+        endInk(false)
+        val pdfFile = this.pdfFile ?: return
+        if (inkOverlay != null && (inkPage != page || inkOverlayZoom != zoom)) {
+            recycleInkOverlay()
+        }
+        if (inkOverlay == null) {
+            val size = pdfFile.getScaledPageSize(page, zoom)
+            val pixels = size.width * size.height
+            inkScale = if (pixels > Constants.INK_OVERLAY_MAX_PIXELS) Math.sqrt(Constants.INK_OVERLAY_MAX_PIXELS / pixels.toDouble()).toFloat() else 1f
+            val overlayWidth = (size.width * inkScale).toInt()
+            val overlayHeight = (size.height * inkScale).toInt()
+            if (overlayWidth <= 0 || overlayHeight <= 0) return
+            try {
+                inkOverlay = Bitmap.createBitmap(overlayWidth, overlayHeight, Bitmap.Config.ARGB_8888)
+            } catch (e: OutOfMemoryError) {
+                Log.e(TAG, "Cannot create the ink overlay", e)
+                return
+            }
+            inkPage = page
+            inkOverlayZoom = zoom
+        }
+        inkStrokePtr = pdfFile.pdfiumSDK.newInkStroke(color, width * inkScale)
+    }
+
+    /**
+     * Add touch points of the current stroke, x y pairs in view coordinates
+     * as a MotionEvent reports them, historical points included
+     */
+    fun addInkPoints(points: FloatArray, count: Int = points.size / 2) {
+        val pdfFile = this.pdfFile ?: return
+        val overlay = inkOverlay ?: return
+        if (inkStrokePtr == 0L) return
+
+        // View coordinates to overlay pixels, the page placed as drawPageBitmap places it
+        val size = pdfFile.getPageSize(inkPage)
+        var pageX = currentXOffset
+        var pageY = currentYOffset
+        if (swipeVertical) {
+            pageY += pdfFile.getPageOffset(inkPage, zoom)
+            pageX += toCurrentScale(pdfFile.maxPageWidth - size.width) / 2
+        } else {
+            pageX += pdfFile.getPageOffset(inkPage, zoom)
+            pageY += toCurrentScale(pdfFile.maxPageHeight - size.height) / 2
+        }
+        if (inkPoints.size < count * 2) {
+            inkPoints = FloatArray(count * 2)
+        }
+        for (i in 0 until count) {
+            inkPoints[i * 2] = (points[i * 2] - pageX) * inkScale
+            inkPoints[i * 2 + 1] = (points[i * 2 + 1] - pageY) * inkScale
+        }
+        if (pdfFile.pdfiumSDK.addInkPoints(inkStrokePtr, inkPoints, count, overlay, inkDirty)) {
+            invalidate()
+        }
+    }
+
+    /**
+     * Pen up: end the current stroke and, with [commit], add it to the
+     * page as an /Ink annotation. Returns the index of the annotation, or -1.
+     */
+    fun endInk(commit: Boolean = true): Int {
+        val strokePtr = inkStrokePtr
+        if (strokePtr == 0L) return -1
+        inkStrokePtr = 0L
+        val pdfFile = this.pdfFile
+        val overlay = inkOverlay
+        var index = -1
+        if (pdfFile != null && overlay != null) {
+            if (pdfFile.pdfiumSDK.finishInkStroke(strokePtr, overlay, inkDirty)) {
+                invalidate()
+            }
+            if (commit) {
+                index = pdfFile.commitInkStroke(strokePtr, inkPage, Rect(0, 0, overlay.width, overlay.height))
+            }
+        }
+        pdfFile?.pdfiumSDK?.closeInkStroke(strokePtr)
+        if (annotationLayer) {
+            if (index >= 0) {
+                // A part cached for an annotation this index held before would never be replaced
+                cacheManager.removeAnnotation(inkPage, index)
+                inkPendingAnnots.add(index)
+                loadAnnotations(inkPage)
+            }
+            recycleInkOverlayIfShown()
+        }
+        return index
+    }
+
+    // The layer has every committed stroke and none is being written
+    private fun recycleInkOverlayIfShown() {
+        if (inkPendingAnnots.isEmpty() && inkStrokePtr == 0L) {
+            recycleInkOverlay()
+        }
+    }
+
+    private fun recycleInkOverlay() {
+        inkOverlay?.recycle()
+        inkOverlay = null
+        inkPage = -1
+        inkOverlayZoom = 0f
+        inkPendingAnnots.clear()
+    }
+
     fun toRealScale(size: Float): Float {
         return size / zoom
     }
@@ -547,6 +828,8 @@ class PdfView : RelativeLayout {
 
         // Clear caches
         cacheManager.recycle()
+        endInk(false)
+        recycleInkOverlay()
 
         scrollHandle?.let {
             if (isScrollHandleInit) {
@@ -841,7 +1124,9 @@ class PdfView : RelativeLayout {
         private var fitEachPage = false
         private var pageFling = false
         private var pageSnap = false
-        private var nightMode = false
+        private var colorScheme = ColorScheme.NONE
+        private var formFilling = false
+        private var annotationLayer = false
         fun pages(vararg pageNumbers: Int): Configurator {
             this.pageNumbers = pageNumbers.asList()
             return this
@@ -862,6 +1147,17 @@ class PdfView : RelativeLayout {
             return this
         }
 
+        /** Draw annotations as a separate layer, see [PdfView.annotationLayer] */
+        fun enableAnnotationLayer(annotationLayer: Boolean): Configurator {
+            this.annotationLayer = annotationLayer
+            return this
+        }
+
+        fun enableFormFilling(formFilling: Boolean): Configurator {
+            this.formFilling = formFilling
+            return this
+        }
+
         fun onDraw(onDrawListener: OnDrawListener?): Configurator {
             this.onDrawListener = onDrawListener
             return this
@@ -973,7 +1269,12 @@ class PdfView : RelativeLayout {
         }
 
         fun nightMode(nightMode: Boolean): Configurator {
-            this.nightMode = nightMode
+            this.colorScheme = if (nightMode) ColorScheme.NIGHT else ColorScheme.NONE
+            return this
+        }
+
+        fun colorScheme(colorScheme: ColorScheme): Configurator {
+            this.colorScheme = colorScheme
             return this
         }
 
@@ -1000,11 +1301,14 @@ class PdfView : RelativeLayout {
             this@PdfView.callbacks.onPageError = onPageErrorListener
             this@PdfView.callbacks.linkHandler = linkHandler
             this@PdfView.enableSwipe = enableSwipe
-            this@PdfView.nightMode = nightMode
+            this@PdfView.colorScheme = colorScheme
             this@PdfView.enableDoubletap(enableDoubletap)
             this@PdfView.defaultPage = defaultPage
             this@PdfView.swipeVertical = !swipeHorizontal
             this@PdfView.annotationRendering = annotationRendering
+            this@PdfView.formFilling = formFilling
+            this@PdfView.annotationLayer = annotationLayer
+            this@PdfView.hiddenAnnotations.clear()
             this@PdfView.scrollHandle = scrollHandle
             this@PdfView.enableAntialiasing = antialiasing
             this@PdfView.spacing = spacing
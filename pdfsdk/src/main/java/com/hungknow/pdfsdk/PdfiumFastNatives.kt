@@ -0,0 +1,56 @@
+package com.hungknow.pdfsdk
+
+import dalvik.annotation.optimization.CriticalNative
+import dalvik.annotation.optimization.FastNative
+
+/**
+ * Fast-path bindings of the tiny primitive-only getters that layout and
+ * hit-testing call thousands of times. They are registered natively as
+ * @CriticalNative/@FastNative on Android O and later and as regular JNI
+ * functions before that. If registration failed [enabled] is false and
+ * callers fall back to the [PdfiumSDK] natives.
+ */
+internal object PdfiumFastNatives {
+
+    val enabled: Boolean = try {
+        nativeIsRegistered()
+    } catch (e: UnsatisfiedLinkError) {
+        false
+    }
+
+    @JvmStatic
+    private external fun nativeIsRegistered(): Boolean
+
+    @JvmStatic
+    @CriticalNative
+    external fun nativeGetPageCount(docPtr: Long): Int
+
+    /** Page width and height in points as float bits, width in the high word */
+    @JvmStatic
+    @CriticalNative
+    external fun nativeGetPageSizePacked(docPtr: Long, pageIndex: Int): Long
+
+    @JvmStatic
+    @CriticalNative
+    external fun nativeIndexCountChars(indexPtr: Long): Int
+
+    @JvmStatic
+    @CriticalNative
+    external fun nativeIndexCharAtPos(indexPtr: Long, x: Float, y: Float, xTolerance: Float, yTolerance: Float): Int
+
+    @JvmStatic
+    @CriticalNative
+    external fun nativeIndexLinkAtPos(indexPtr: Long, x: Float, y: Float): Int
+
+    @JvmStatic
+    @CriticalNative
+    external fun nativeIndexAnnotAtPos(indexPtr: Long, x: Float, y: Float): Int
+
+    @JvmStatic
+    @FastNative
+    external fun nativeIndexGetCharRangeRects(indexPtr: Long, start: Int, count: Int): FloatArray
+
+    fun unpackWidth(packed: Long): Float = java.lang.Float.intBitsToFloat((packed ushr 32).toInt())
+
+    fun unpackHeight(packed: Long): Float = java.lang.Float.intBitsToFloat(packed.toInt())
+}
@@ -2,21 +2,79 @@ package com.hungknow.pdfsdk
 
 import android.R.attr
 import android.graphics.Bitmap
+import android.graphics.Rect
+import android.graphics.RectF
 import android.os.ParcelFileDescriptor
 import android.util.Log
+import android.view.KeyEvent
 import android.view.Surface
+import com.hungknow.pdfsdk.listeners.OnAssemblyListener
+import com.hungknow.pdfsdk.listeners.OnFlattenListener
+import com.hungknow.pdfsdk.listeners.OnPrintListener
+import com.hungknow.pdfsdk.listeners.OnSaveListener
+import com.hungknow.pdfsdk.listeners.OnThumbnailListener
+import com.hungknow.pdfsdk.models.FlattenResult
+import com.hungknow.pdfsdk.models.PageAssemblyJob
+import com.hungknow.pdfsdk.models.PageAssemblyResult
+import com.hungknow.pdfsdk.models.PrintResult
+import com.hungknow.pdfsdk.models.RenderStats
 import com.hungknow.pdfsdk.models.Size
+import com.hungknow.pdfsdk.models.WarmUpTimings
+import com.hungknow.pdfsdk.utils.ColorScheme
+import java.io.File
 import java.io.FileDescriptor
 import java.io.IOException
+import kotlin.concurrent.read
+import kotlin.concurrent.write
 
 
 class PdfiumSDK(val densityDpi: Int) {
 
+    private external fun nativeInitLibrary()
+    private external fun nativeReleaseLibrary()
+    private external fun nativeWarmUp(): LongArray
+    private external fun nativeSetFontIndex(cachePath: String?, fontDirs: Array<String>?): Int
+    private external fun nativeGetLayerAnnots(pagePtr: Long): Array<Any?>?
+    private external fun nativeRenderAnnotation(pagePtr: Long, annotIndex: Int, bitmap: Bitmap,
+                                                startX: Int, startY: Int, drawSizeHor: Int, drawSizeVer: Int,
+                                                colorScheme: Int): Boolean
+    private external fun nativeExportAnnotations(docPtr: Long, firstPage: Int, lastPage: Int): ByteArray?
+    private external fun nativeImportAnnotations(docPtr: Long, data: ByteArray, replace: Boolean): Int
+    private external fun nativeNewInkStroke(color: Int, width: Float): Long
+    private external fun nativeCloseInkStroke(strokePtr: Long)
+    private external fun nativeAddInkPoints(strokePtr: Long, points: FloatArray, count: Int, overlay: Bitmap, dirty: IntArray): Boolean
+    private external fun nativeFinishInkStroke(strokePtr: Long, overlay: Bitmap, dirty: IntArray): Boolean
+    private external fun nativeCommitInkStroke(strokePtr: Long, pagePtr: Long, startX: Int, startY: Int,
+                                               drawSizeHor: Int, drawSizeVer: Int, tolerance: Float): Int
+    private external fun nativeInitFormFill(docPtr: Long): Boolean
+    private external fun nativeFormTap(pagePtr: Long, x: Float, y: Float): Boolean
+    private external fun nativeFormTypeText(pagePtr: Long, text: String): Boolean
+    private external fun nativeFormPressKey(pagePtr: Long, keyCode: Int, modifiers: Int): Boolean
+    private external fun nativeFormKillFocus(docPtr: Long)
+    private external fun nativeTakeFormDirtyRects(docPtr: Long): Array<Any?>?
+    private external fun nativeRenderThumbnails(fds: IntArray, width: Int, height: Int, lock: Any, listener: OnThumbnailListener)
+    private external fun nativeAssemblePages(fds: IntArray, passwords: Array<String>, ranges: Array<String>,
+                                             options: IntArray, sheetWidth: Float, sheetHeight: Float,
+                                             outputFd: Int, lock: Any, listener: OnAssemblyListener?): LongArray?
+    private external fun nativePrintPages(docPtr: Long, pages: IntArray, dpi: Int, grayscale: Boolean, outputFd: Int,
+                                          syncMode: Int, lock: Any, listener: OnPrintListener?): LongArray?
+    private external fun nativeFlattenDocument(docPtr: Long, outputFd: Int, forPrint: Boolean, version: Int,
+                                               syncMode: Int, lock: Any, listener: OnFlattenListener?): LongArray?
+    private external fun nativeSetStatsMode(mode: Int)
+    private external fun nativeResetStats()
+    private external fun nativeGetStats(): LongArray
     external fun nativeOpenDocument(fd: Int, password: String): Long
     external fun nativeOpenMemDocument(data: ByteArray, password: String): Long
+    private external fun nativeSaveDocument(docPtr: Long, fd: Int, flags: Int, version: Int, syncMode: Int): Long
+    private external fun nativeTakeSaveSnapshot(docPtr: Long, flags: Int, version: Int): Long
+    private external fun nativeCloseSaveSnapshot(snapshotPtr: Long)
+    private external fun nativeWriteSaveSnapshot(snapshotPtr: Long, path: String, syncMode: Int,
+                                                 listener: OnSaveListener?): Boolean
     external fun nativeGetPageCount(documentPtr: Long): Int
     external fun nativeCloseDocument(documentPtr: Long)
     private external fun nativeGetDocumentMetaText(documentPtr: Long, tag: String): String
+    private external fun nativeGetDocumentInfo(documentPtr: Long): Array<Any?>?
+    private external fun nativeGetPageLabels(documentPtr: Long): Array<Any?>?
     private external fun nativeLoadPage(documentPtr: Long, pageIndex: Int): Long
     private external fun nativeClosePage(pagePtr: Long)
     private external fun nativeClosePages(pagesPtr: LongArray)
@@ -28,28 +86,537 @@ class PdfiumSDK(val densityDpi: Int) {
     private external fun nativeRenderPageBitmap(pagePtr: Long, bitmap: Bitmap, dpi: Int,
     startX: Int, startY: Int,
     drawSizeHor: Int, drawSizeVer: Int,
-    renderAnnot: Boolean)
+    renderAnnot: Boolean, colorScheme: Int)
 
     private external fun nativeGetPageSizeByIndex(documentPtr: Long, pageIndex: Int, dpi: Int): Size
+    private external fun nativeGetAllPageSizes(documentPtr: Long, flags: Int): FloatArray?
 
     ///////////////////////////////////////
     // PDF TextPage api
     ///////////
     private external fun nativeCloseTextPage(pagePtr: Long)
 
+    ///////////////////////////////////////
+    // Links api
+    ///////////
+    private external fun nativeGetPageLinks(docPtr: Long, pagePtr: Long, webLinks: Boolean): Array<Any?>?
+    private external fun nativeLoadPageLinks(docPtr: Long, pageIndex: Int, webLinks: Boolean): Array<Any?>?
+
+    ///////////////////////////////////////
+    // Outline api
+    ///////////
+    private external fun nativeGetOutlineChildren(docPtr: Long, nodeId: Int, offset: Int, limit: Int): Array<Any?>?
+    private external fun nativeFindOutline(docPtr: Long, title: String): IntArray
+
+    ///////////////////////////////////////
+    // Page hit-testing index api
+    ///////////
+    private external fun nativeBuildPageIndex(pagePtr: Long): Long
+    private external fun nativeClosePageIndex(indexPtr: Long)
+    private external fun nativeIndexCharAtPos(indexPtr: Long, x: Float, y: Float, xTolerance: Float, yTolerance: Float): Int
+    private external fun nativeIndexLinkAtPos(indexPtr: Long, x: Float, y: Float): Int
+    private external fun nativeIndexAnnotAtPos(indexPtr: Long, x: Float, y: Float): Int
+    private external fun nativeIndexAnnotSubtype(indexPtr: Long, annotIndex: Int): Int
+    private external fun nativeIndexGetCharRangeRects(indexPtr: Long, start: Int, count: Int): FloatArray
+    private external fun nativeIndexCountChars(indexPtr: Long): Int
+
     fun getPageCount(doc: PdfDocument): Int {
-       return nativeGetPageCount(doc.NativeDocPtr)
+        if (PdfiumFastNatives.enabled) {
+            return PdfiumFastNatives.nativeGetPageCount(doc.NativeDocPtr)
+        }
+        return nativeGetPageCount(doc.NativeDocPtr)
     }
 
     fun getPageSize(doc: PdfDocument, index: Int): Size {
+        val sizes = getAllPageSizes(doc)
+        if (index < 0 || index * 2 + 1 >= sizes.size) {
+            return Size(0, 0)
+        }
+        return Size((sizes[index * 2] * mCurrentDpi / 72).toInt(), (sizes[index * 2 + 1] * mCurrentDpi / 72).toInt())
+    }
+
+    // Uncached single page query, one JNI round trip per call; kept for benchmarks
+    internal fun getPageSizeByIndex(doc: PdfDocument, index: Int): Size {
+        if (PdfiumFastNatives.enabled) {
+            val packed = PdfiumFastNatives.nativeGetPageSizePacked(doc.NativeDocPtr, index)
+            return Size((PdfiumFastNatives.unpackWidth(packed) * mCurrentDpi / 72).toInt(),
+                (PdfiumFastNatives.unpackHeight(packed) * mCurrentDpi / 72).toInt())
+        }
+        return nativeGetPageSizeByIndex(doc.NativeDocPtr, index, mCurrentDpi)
+    }
+
+    // Same query through the regular binding, to compare against the fast path
+    internal fun getPageSizeByIndexRegular(doc: PdfDocument, index: Int): Size {
         return nativeGetPageSizeByIndex(doc.NativeDocPtr, index, mCurrentDpi)
     }
 
+    internal fun getPageCountRegular(doc: PdfDocument): Int {
+        return nativeGetPageCount(doc.NativeDocPtr)
+    }
+
+    /**
+     * Get the size of every page in points, in one native call. Each page has
+     * a record of width and height, followed by the rotation if [flags] has
+     * [PAGE_SIZE_ROTATION] and by the crop and media boxes (left, bottom,
+     * right, top) if it has [PAGE_SIZE_BOXES]; see [getPageSizeStride].
+     * Rotation and boxes need every page to be loaded, so they are much slower.
+     *
+     * The table is memoized in the document and must not be modified.
+     */
+    fun getAllPageSizes(doc: PdfDocument, flags: Int = 0): FloatArray {
+        doc.pageSizes[flags]?.let { return it }
+        synchronized(lock) {
+            doc.pageSizes[flags]?.let { return it }
+            val sizes = nativeGetAllPageSizes(doc.NativeDocPtr, flags) ?: FloatArray(0)
+            doc.pageSizes[flags] = sizes
+            return sizes
+        }
+    }
+
+    fun getPageSizeStride(flags: Int): Int {
+        return 2 + (if (flags and PAGE_SIZE_ROTATION != 0) 1 else 0) + (if (flags and PAGE_SIZE_BOXES != 0) 8 else 0)
+    }
+
+    /**
+     * Initialize PDFium ahead of the first document and keep it alive until
+     * [releaseLibrary], so opening and closing documents never re-initializes
+     * it. Safe to call from any thread and more than once.
+     */
+    fun initLibrary() {
+        nativeInitLibrary()
+    }
+
+    fun releaseLibrary() {
+        nativeReleaseLibrary()
+    }
+
+    /**
+     * Turn native instrumentation on or off: [STATS_COLLECT] records per-stage
+     * timings and counters for [getStats], [STATS_TRACE] emits ATrace
+     * sections visible in systrace and Perfetto. 0, the default, disables
+     * both at the cost of one branch per stage.
+     */
+    fun setStatsMode(mode: Int) {
+        nativeSetStatsMode(mode)
+    }
+
+    fun getStats(): RenderStats {
+        return RenderStats(nativeGetStats())
+    }
+
+    fun resetStats() {
+        nativeResetStats()
+    }
+
+    /**
+     * Serve system fonts from an index of [fontDirs] cached in [cacheFile]
+     * instead of letting PDFium scan the font directories on first use. The
+     * first call reads every font file once and writes the cache; later
+     * starts only mmap it, unless a font directory changed. Call it early on
+     * a background thread, before [warmUp] or the first document. A null
+     * [fontDirs] goes back to PDFium's default fonts at the next library
+     * initialization.
+     *
+     * Returns the number of indexed faces, or -1 on failure.
+     */
+    fun setFontIndex(cacheFile: File?, fontDirs: Array<String>? = SYSTEM_FONT_DIRS): Int {
+        synchronized(lock) {
+            return nativeSetFontIndex(cacheFile?.path, fontDirs)
+        }
+    }
+
+    /**
+     * Pay the first-page costs ahead of time on a background thread, ideally
+     * at app start: library init, system font enumeration and the font and
+     * glyph caches. The library stays pinned as with [initLibrary].
+     * [onDone] is called on the warm-up thread.
+     */
+    fun warmUp(onDone: ((WarmUpTimings) -> Unit)? = null): Thread {
+        val thread = Thread({
+            val values = synchronized(lock) { nativeWarmUp() }
+            val timings = WarmUpTimings(values[0], values[1], values[2])
+            Log.d(TAG, "PDFium warm-up: $timings")
+            onDone?.invoke(timings)
+        }, "PdfiumWarmUp")
+        thread.start()
+        return thread
+    }
+
+    /**
+     * Get the annotations of an opened page that the annotation layer draws,
+     * in FPDFPage_GetAnnot order. Cached until [invalidateLayerAnnotations].
+     */
+    fun getLayerAnnotations(doc: PdfDocument, pageIndex: Int): List<PdfDocument.Annotation> {
+        doc.layerAnnotations[pageIndex]?.let { return it }
+        synchronized(lock) {
+            val pagePtr = doc.NativePagesPtr[pageIndex] ?: return emptyList()
+            val packed = nativeGetLayerAnnots(pagePtr) ?: return emptyList()
+            val indexAndSubtype = packed[0] as IntArray
+            val rects = packed[1] as FloatArray
+            val annotations = List(indexAndSubtype.size / 2) { i ->
+                PdfDocument.Annotation(indexAndSubtype[i * 2], indexAndSubtype[i * 2 + 1],
+                    RectF(rects[i * 4], rects[i * 4 + 1], rects[i * 4 + 2], rects[i * 4 + 3]))
+            }
+            doc.layerAnnotations[pageIndex] = annotations
+            return annotations
+        }
+    }
+
+    /** Forget the layer annotations of a page after one of them changed */
+    fun invalidateLayerAnnotations(doc: PdfDocument, pageIndex: Int) {
+        doc.layerAnnotations.remove(pageIndex)
+    }
+
+    /**
+     * Render one annotation alone into an ARGB_8888 bitmap placed like
+     * [renderPageBitmap] places a page fragment. Pixels the annotation
+     * doesn't cover stay transparent, so the bitmap goes over page content
+     * rendered without annotations in the same [colorScheme].
+     */
+    fun renderAnnotation(doc: PdfDocument, bitmap: Bitmap, pageIndex: Int, annotIndex: Int, startX: Int, startY: Int, drawSizeX: Int, drawSizeY: Int,
+                         colorScheme: ColorScheme = ColorScheme.NONE): Boolean {
+        synchronized(lock) {
+            val pagePtr = doc.NativePagesPtr[pageIndex] ?: return false
+            return nativeRenderAnnotation(pagePtr, annotIndex, bitmap, startX, startY, drawSizeX, drawSizeY,
+                colorScheme.ordinal)
+        }
+    }
+
+    /**
+     * Serialize the annotations of pages [firstPage]..[lastPage] into one
+     * compact blob: subtype, rect, color, flags, attachment points, ink
+     * list and contents of each, without popups and form fields. Pages past
+     * the end are ignored. Read it back with [importAnnotations].
+     */
+    fun exportAnnotations(doc: PdfDocument, firstPage: Int = 0, lastPage: Int = Int.MAX_VALUE): ByteArray {
+        synchronized(lock) {
+            return nativeExportAnnotations(doc.NativeDocPtr, firstPage, lastPage) ?: ByteArray(0)
+        }
+    }
+
+    /**
+     * Create the annotations of a blob from [exportAnnotations] in one call,
+     * on the pages they were exported from. With [replace], the pages in the
+     * blob lose their other annotations, form fields excepted. Returns the
+     * number created, or -1 if the blob is malformed. Hit-testing indexes
+     * already built are closed, [buildPageIndex] rebuilds them.
+     */
+    fun importAnnotations(doc: PdfDocument, data: ByteArray, replace: Boolean = false): Int {
+        synchronized(lock) {
+            val created = nativeImportAnnotations(doc.NativeDocPtr, data, replace)
+            if (created >= 0) {
+                doc.layerAnnotations.clear()
+                doc.pageLinks.clear()
+                closePageIndexes(doc)
+                doc.changeCount++
+            }
+            return created
+        }
+    }
+
+    /**
+     * Start a handwritten stroke of an ARGB [color], [width] pixels wide in
+     * its overlay. Feed it with [addInkPoints], end it with
+     * [finishInkStroke] and [commitInkStroke], then free it with
+     * [closeInkStroke]. Capture doesn't take the rendering lock, so it never
+     * waits for a tile being rendered.
+     */
+    fun newInkStroke(color: Int, width: Float): Long {
+        return nativeNewInkStroke(color, width)
+    }
+
+    fun closeInkStroke(strokePtr: Long) {
+        nativeCloseInkStroke(strokePtr)
+    }
+
+    /**
+     * Add [count] touch points, x y pairs in pixels of an ARGB_8888
+     * [overlay], and draw the smoothed stroke up to them into it. Returns
+     * false if nothing was drawn, else sets [dirty] to the changed pixels.
+     */
+    fun addInkPoints(strokePtr: Long, points: FloatArray, count: Int, overlay: Bitmap, dirty: Rect): Boolean {
+        val bounds = IntArray(4)
+        if (!nativeAddInkPoints(strokePtr, points, count, overlay, bounds)) return false
+        dirty.set(bounds[0], bounds[1], bounds[2], bounds[3])
+        return true
+    }
+
+    /** Pen up: draw the end of the stroke into [overlay], as [addInkPoints] */
+    fun finishInkStroke(strokePtr: Long, overlay: Bitmap, dirty: Rect): Boolean {
+        val bounds = IntArray(4)
+        if (!nativeFinishInkStroke(strokePtr, overlay, bounds)) return false
+        dirty.set(bounds[0], bounds[1], bounds[2], bounds[3])
+        return true
+    }
+
+    /**
+     * Add a finished stroke to an opened page as an /Ink annotation, its
+     * overlay placed on the page like a [renderPageBitmap] fragment. The
+     * stroke is simplified to [tolerance] overlay pixels. Nothing is
+     * rendered: the overlay already shows the stroke. The page's hit-testing
+     * index is closed so the next [buildPageIndex] sees the stroke. Returns
+     * the index of the annotation, or -1.
+     */
+    fun commitInkStroke(doc: PdfDocument, strokePtr: Long, pageIndex: Int, startX: Int, startY: Int,
+                        drawSizeX: Int, drawSizeY: Int, tolerance: Float = 0.5f): Int {
+        synchronized(lock) {
+            val pagePtr = doc.NativePagesPtr[pageIndex] ?: return -1
+            val index = nativeCommitInkStroke(strokePtr, pagePtr, startX, startY, drawSizeX, drawSizeY, tolerance)
+            if (index >= 0) {
+                doc.layerAnnotations.remove(pageIndex)
+                closePageIndexes(doc, pageIndex)
+                doc.changeCount++
+            }
+            return index
+        }
+    }
+
+    /**
+     * Enable interactive form filling. Fields are drawn by [renderPageBitmap]
+     * and take input only on pages opened afterwards, so call it right after
+     * opening the document. Returns false if PDFium can't set it up.
+     */
+    fun initFormFill(doc: PdfDocument): Boolean {
+        synchronized(lock) {
+            return nativeInitFormFill(doc.NativeDocPtr)
+        }
+    }
+
+    /**
+     * Tap a form field at a position in page coordinates, focusing a text
+     * field or toggling a check box. Returns false if no field is there.
+     * Follow up with [takeFormDirtyRects] to repaint what changed.
+     */
+    fun formTap(doc: PdfDocument, pageIndex: Int, x: Float, y: Float): Boolean {
+        synchronized(lock) {
+            val pagePtr = doc.NativePagesPtr[pageIndex] ?: return false
+            return nativeFormTap(pagePtr, x, y).also { if (it) doc.changeCount++ }
+        }
+    }
+
+    /** Type text into the focused field of a page */
+    fun formTypeText(doc: PdfDocument, pageIndex: Int, text: String): Boolean {
+        synchronized(lock) {
+            val pagePtr = doc.NativePagesPtr[pageIndex] ?: return false
+            return nativeFormTypeText(pagePtr, text).also { if (it) doc.changeCount++ }
+        }
+    }
+
+    /**
+     * Send an editing key, as a [KeyEvent] key code, to the focused field of
+     * a page. Returns false for keys forms don't handle; text goes through
+     * [formTypeText].
+     */
+    fun formPressKey(doc: PdfDocument, pageIndex: Int, keyCode: Int, shift: Boolean = false): Boolean {
+        val fwlKey = when (keyCode) {
+            KeyEvent.KEYCODE_DEL -> FWL_VKEY_BACK
+            KeyEvent.KEYCODE_FORWARD_DEL -> FWL_VKEY_DELETE
+            KeyEvent.KEYCODE_TAB -> FWL_VKEY_TAB
+            KeyEvent.KEYCODE_ENTER -> FWL_VKEY_RETURN
+            KeyEvent.KEYCODE_DPAD_LEFT -> FWL_VKEY_LEFT
+            KeyEvent.KEYCODE_DPAD_RIGHT -> FWL_VKEY_RIGHT
+            KeyEvent.KEYCODE_MOVE_HOME -> FWL_VKEY_HOME
+            KeyEvent.KEYCODE_MOVE_END -> FWL_VKEY_END
+            else -> return false
+        }
+        synchronized(lock) {
+            val pagePtr = doc.NativePagesPtr[pageIndex] ?: return false
+            return nativeFormPressKey(pagePtr, fwlKey, if (shift) FWL_EVENTFLAG_SHIFT_KEY else 0)
+                .also { if (it) doc.changeCount++ }
+        }
+    }
+
+    /** Commit the focused field and remove the focus */
+    fun formKillFocus(doc: PdfDocument) {
+        synchronized(lock) {
+            nativeFormKillFocus(doc.NativeDocPtr)
+        }
+    }
+
+    /**
+     * Get and clear the page areas form edits invalidated since the last
+     * call. Only these need re-rendering, typing into a field changes
+     * little more than the field itself.
+     */
+    fun takeFormDirtyRects(doc: PdfDocument): List<PdfDocument.DirtyRect> {
+        val packed = synchronized(lock) {
+            nativeTakeFormDirtyRects(doc.NativeDocPtr)
+        } ?: return emptyList()
+        val pages = packed[0] as IntArray
+        val rects = packed[1] as FloatArray
+        return List(pages.size) { i ->
+            PdfDocument.DirtyRect(pages[i], RectF(rects[i * 4], rects[i * 4 + 1], rects[i * 4 + 2], rects[i * 4 + 3]))
+        }
+    }
+
+    /**
+     * Render the first page of every document in [fds] fitted into [width] x
+     * [height], for library screens. Documents are spread over one native
+     * worker per core, each opening, rendering page 0 and closing its
+     * document without building a [PdfFile]; results stream to [listener]
+     * as they complete. The fds stay owned by the caller.
+     *
+     * Blocks until the whole batch is done, so call it on a background
+     * thread, and never while holding [lock]: the workers take it around
+     * every PDFium call.
+     */
+    fun renderThumbnails(fds: IntArray, width: Int, height: Int, listener: OnThumbnailListener) {
+        check(!Thread.holdsLock(lock)) { "renderThumbnails would deadlock under the PDFium lock" }
+        nativeRenderThumbnails(fds, width, height, lock, listener)
+    }
+
+    /**
+     * Run a page assembly [job]: merge, split or n-up into [PageAssemblyJob.output],
+     * which is rewritten from the start. Sources are opened one at a time
+     * and closed once their pages are copied, and the output streams to
+     * its file as it is saved, so memory stays at the output's objects plus
+     * one source. [listener] follows the sources and can cancel.
+     *
+     * Blocks until the output is written, so call it on a background
+     * thread, and never while holding [lock]: the job takes it per source
+     * and for the save, so rendering goes on in between. Returns null if
+     * cancelled, throws [IOException] if the job failed.
+     */
+    fun assemblePages(job: PageAssemblyJob, listener: OnAssemblyListener? = null): PageAssemblyResult? {
+        check(!Thread.holdsLock(lock)) { "assemblePages would deadlock under the PDFium lock" }
+        val flags = (if (job.copyViewerPreferences) ASSEMBLY_VIEWER_PREFERENCES else 0) or
+                (if (job.oddPageStarts) ASSEMBLY_ODD_PAGE_STARTS else 0) or
+                (if (job.skipBrokenSources) ASSEMBLY_SKIP_BROKEN else 0)
+        val packed = nativeAssemblePages(
+            IntArray(job.sources.size) { job.sources[it].pfd.fd },
+            Array(job.sources.size) { job.sources[it].password },
+            Array(job.sources.size) { job.sources[it].pageRange ?: "" },
+            intArrayOf(job.columns, job.rows, flags, job.sync), job.sheetWidth, job.sheetHeight,
+            job.output.fd, lock, listener) ?: return null
+        val skipped = IntArray(packed.size - 3) { packed[3 + it].toInt() }
+        return PageAssemblyResult(packed[0].toInt(), packed[1], packed[2], skipped)
+    }
+
+    /**
+     * Rasterize [pages] of the document at [dpi] into [output], rewritten
+     * from the start, as a PDF of images for Android's print framework (see
+     * [PdfPrintAdapter]). Pages are rendered for printing in horizontal
+     * bands while a native encoder thread compresses the previous ones into
+     * [output], so a few bands are all the pixels in memory: a 300 DPI page
+     * never needs its 35 MB. [listener] follows the pages and can cancel.
+     *
+     * Blocks until the output is written, so call it on a background
+     * thread, and never while holding [lock]: the job takes it per band, so
+     * the viewer keeps rendering. Returns null if cancelled, throws
+     * [IOException] if the job failed.
+     */
+    fun printPages(doc: PdfDocument, pages: IntArray, output: ParcelFileDescriptor, dpi: Int = 300,
+                   grayscale: Boolean = false, sync: Int = SYNC_NONE,
+                   listener: OnPrintListener? = null): PrintResult? {
+        check(!Thread.holdsLock(lock)) { "printPages would deadlock under the PDFium lock" }
+        val packed = nativePrintPages(doc.NativeDocPtr, pages, dpi, grayscale, output.fd, sync, lock, listener)
+            ?: return null
+        return PrintResult(packed[0].toInt(), packed[1], packed[2], packed[3])
+    }
+
+    /**
+     * Bake the form fields and annotations of every page into the page
+     * content, the way shared copies should look, then save incrementally
+     * into [output] like [saveDocument]: into the file the document was
+     * opened from, only the flattened pages are appended. [forPrint] bakes
+     * in what printing shows rather than the screen. Pages are flattened
+     * natively in order, each loaded and released on its own, so memory
+     * stays flat on long documents. [listener] follows the pages and can
+     * cancel.
+     *
+     * Blocks until saved, so call it on a background thread, and never
+     * while holding [lock]: the job takes it per page and for the save, so
+     * rendering goes on in between. The document itself is flattened: on
+     * cancel or failure the pages done so far stay flattened in memory,
+     * unsaved, so close it rather than save it. Opened pages are reloaded
+     * (a page that fails to reload is left closed) and hit-testing indexes
+     * closed once the job ends, since their annotations are gone. Returns
+     * null if cancelled, throws
+     * [IOException] if the job failed.
+     */
+    fun flattenDocument(doc: PdfDocument, output: ParcelFileDescriptor, forPrint: Boolean = false,
+                        version: Int = 0, sync: Int = SYNC_DATA,
+                        listener: OnFlattenListener? = null): FlattenResult? {
+        check(!Thread.holdsLock(lock)) { "flattenDocument would deadlock under the PDFium lock" }
+        try {
+            val packed = nativeFlattenDocument(doc.NativeDocPtr, output.fd, forPrint, version, sync, lock, listener)
+                ?: return null
+            return FlattenResult(packed[0].toInt(), packed[1].toInt(), packed[2], packed[3])
+        } finally {
+            // The page dictionaries were rewritten: opened pages hold the old
+            // content without its annotations, and the indexes point at them
+            synchronized(lock) {
+                closePageIndexes(doc)
+                // Each entry goes before its page is reloaded, so a failing
+                // load leaves the page closed rather than a freed pointer
+                for (index in doc.NativePagesPtr.keys.toList()) {
+                    doc.NativePagesPtr.remove(index)?.let { nativeClosePage(it) }
+                    try {
+                        doc.NativePagesPtr[index] = nativeLoadPage(doc.NativeDocPtr, index)
+                    } catch (e: IllegalStateException) {
+                        Log.e(TAG, "Cannot reload page $index after flattening")
+                    }
+                }
+                doc.layerAnnotations.clear()
+                doc.pageLinks.clear()
+            }
+        }
+    }
+
     fun newDocument(pfd: ParcelFileDescriptor, password: String): PdfDocument {
         val nativeDocumentPtr = nativeOpenDocument(pfd.fd, password)
         return PdfDocument(nativeDocumentPtr, pfd)
     }
 
+    /**
+     * Save the document into [pfd], opened for reading and writing. With
+     * [incremental] only the changed objects are added after the original
+     * bytes; saving that way into the file the document was opened from
+     * appends them, so the time depends on the size of the change, not of
+     * the document. Other saves rewrite [pfd] from the start and must go to
+     * another file. [version] is 14 for PDF 1.4 etc, 0 keeps it. [sync] is
+     * one of [SYNC_NONE], [SYNC_DATA] and [SYNC_FULL]. The focused form
+     * field loses focus first, so the text being typed is saved. Returns
+     * the bytes written, or -1.
+     */
+    fun saveDocument(doc: PdfDocument, pfd: ParcelFileDescriptor, incremental: Boolean = true,
+                     version: Int = 0, sync: Int = SYNC_DATA): Long {
+        synchronized(lock) {
+            return nativeSaveDocument(doc.NativeDocPtr, pfd.fd,
+                if (incremental) SAVE_INCREMENTAL else SAVE_NO_INCREMENTAL, version, sync)
+        }
+    }
+
+    /**
+     * Save the document into [target] without holding the PDFium lock for
+     * the I/O, so pages keep rendering meanwhile. Only taking the snapshot
+     * of the output waits for the lock; with [incremental] that snapshot
+     * holds just the changed objects and refers to the file the document
+     * was opened from for the rest. The file is then written next to
+     * [target] and renamed over it once synced per [sync], so a crash
+     * never leaves a half-written document; [target] may be the file being
+     * viewed. [listener] follows the progress and can cancel. The focused
+     * form field loses focus first, so the text being typed is saved.
+     *
+     * Blocks until the file is written, so call it on a background thread
+     * (or use [AutoSaver]), never while holding [lock], and don't close the
+     * document before it returns. Returns false on failure or cancel.
+     */
+    fun saveToFile(doc: PdfDocument, target: File, incremental: Boolean = true, version: Int = 0,
+                   sync: Int = SYNC_DATA, listener: OnSaveListener? = null): Boolean {
+        check(!Thread.holdsLock(lock)) { "saveToFile would write under the PDFium lock" }
+        val snapshotPtr = synchronized(lock) {
+            nativeTakeSaveSnapshot(doc.NativeDocPtr,
+                if (incremental) SAVE_INCREMENTAL else SAVE_NO_INCREMENTAL, version)
+        }
+        if (snapshotPtr == 0L) return false
+        try {
+            return nativeWriteSaveSnapshot(snapshotPtr, target.path, sync, listener)
+        } finally {
+            nativeCloseSaveSnapshot(snapshotPtr)
+        }
+    }
+
     fun closeDocument(doc: PdfDocument) {
         for (index in doc.NativePagesPtr.keys) {
             doc.NativePagesPtr.get(index)?.let { nativeClosePage(it) }
@@ -59,6 +626,9 @@ class PdfiumSDK(val densityDpi: Int) {
             doc.NativeTextPagesPtr.get(ptr)?.let { nativeCloseTextPage(it) }
         }
         doc.NativeTextPagesPtr.clear()
+        doc.pageLinks.clear()
+        doc.pageSizes.clear()
+        closePageIndexes(doc)
         nativeCloseDocument(doc.NativeDocPtr)
         if (doc.FileDescriptor != null) {
             try {
@@ -70,16 +640,62 @@ class PdfiumSDK(val densityDpi: Int) {
         }
     }
 
-    fun getDocumentMeta(doc: PdfDocument): PdfDocumentMeta = PdfDocumentMeta(
-        title = nativeGetDocumentMetaText(doc.NativeDocPtr, "Title"),
-        author = nativeGetDocumentMetaText(doc.NativeDocPtr, "Author"),
-        subject = nativeGetDocumentMetaText (doc.NativeDocPtr, "Subject"),
-        keywords = nativeGetDocumentMetaText(doc.NativeDocPtr, "Keywords"),
-        creator = nativeGetDocumentMetaText(doc.NativeDocPtr, "Creator"),
-        producer = nativeGetDocumentMetaText(doc.NativeDocPtr, "Producer"),
-        creationDate = nativeGetDocumentMetaText(doc.NativeDocPtr, "CreationDate"),
-        modDate = nativeGetDocumentMetaText(doc.NativeDocPtr, "ModDate")
-    )
+    fun getDocumentMeta(doc: PdfDocument): PdfDocumentMeta = getDocumentInfo(doc).meta
+
+    /** Get the value of any Info dictionary entry, including custom ones */
+    fun getDocumentMetaText(doc: PdfDocument, tag: String): String {
+        synchronized(lock) {
+            return nativeGetDocumentMetaText(doc.NativeDocPtr, tag)
+        }
+    }
+
+    /**
+     * Get the metadata, page count, version, permissions and whether there
+     * are page labels in one call; the labels come from [getPageLabels]
+     */
+    fun getDocumentInfo(doc: PdfDocument): PdfDocumentInfo {
+        val packed = synchronized(lock) {
+            nativeGetDocumentInfo(doc.NativeDocPtr)
+        } ?: throw IllegalStateException("cannot read document info")
+
+        val meta = packed[0] as Array<*>
+        val values = packed[1] as IntArray
+        return PdfDocumentInfo(
+            PdfDocumentMeta(
+                title = meta[0] as String,
+                author = meta[1] as String,
+                subject = meta[2] as String,
+                keywords = meta[3] as String,
+                creator = meta[4] as String,
+                producer = meta[5] as String,
+                creationDate = meta[6] as String,
+                modDate = meta[7] as String
+            ),
+            pageCount = values[0],
+            fileVersion = values[1],
+            permissions = values[2].toLong() and 0xFFFFFFFFL,
+            pageMode = values[3],
+            isTagged = values[4] != 0,
+            hasPageLabels = values[5] != 0
+        )
+    }
+
+    /**
+     * Get the page labels. Reading them looks up every page in the label
+     * tree, so they are read on the first call only, and only documents
+     * that show labels should ask.
+     */
+    fun getPageLabels(doc: PdfDocument): PdfPageLabels {
+        doc.pageLabels?.let { return it }
+        synchronized(lock) {
+            doc.pageLabels?.let { return it }
+            val packed = nativeGetPageLabels(doc.NativeDocPtr)
+                ?: throw IllegalStateException("cannot read page labels")
+            val labels = packed[1] as Array<*>
+            return PdfPageLabels(getPageCount(doc), packed[0] as IntArray,
+                Array(labels.size) { labels[it] as String }).also { doc.pageLabels = it }
+        }
+    }
 
     // Open page and store native pointer
     fun openPage(doc: PdfDocument, pageIndex: Int): Long {
@@ -96,12 +712,18 @@ class PdfiumSDK(val densityDpi: Int) {
     }
 
     fun renderPageBitmap(doc: PdfDocument, bitmap: Bitmap, pageIndex: Int, startX: Int, startY: Int, drawSizeX: Int, drawSizeY: Int, renderAnnot: Boolean) {
+        renderPageBitmap(doc, bitmap, pageIndex, startX, startY, drawSizeX, drawSizeY, renderAnnot, ColorScheme.NONE)
+    }
+
+    // Render in a reading mode; the recoloring happens while rasterizing,
+    // so no color filter pass is needed when drawing the bitmap
+    fun renderPageBitmap(doc: PdfDocument, bitmap: Bitmap, pageIndex: Int, startX: Int, startY: Int, drawSizeX: Int, drawSizeY: Int, renderAnnot: Boolean, colorScheme: ColorScheme) {
         synchronized(lock) {
             try {
                 doc.NativePagesPtr[pageIndex]?.let {
                     nativeRenderPageBitmap(
                         it, bitmap, mCurrentDpi,
-                        startX, startY, drawSizeX, drawSizeY, renderAnnot
+                        startX, startY, drawSizeX, drawSizeY, renderAnnot, colorScheme.ordinal
                     )
                 }
             } catch (e: NullPointerException) {
@@ -114,13 +736,245 @@ class PdfiumSDK(val densityDpi: Int) {
         }
     }
 
+    /**
+     * Get all links of an opened page: link annotations first, in the order
+     * used by [getLinkIndexAtPos], then web links detected in the page text.
+     * The result is cached in the document.
+     */
+    fun getPageLinks(doc: PdfDocument, pageIndex: Int): List<PdfDocument.Link> {
+        doc.pageLinks[pageIndex]?.let { return it }
+        synchronized(lock) {
+            val pagePtr = doc.NativePagesPtr[pageIndex] ?: return emptyList()
+            val links = unpackLinks(nativeGetPageLinks(doc.NativeDocPtr, pagePtr, true))
+            doc.pageLinks[pageIndex] = links
+            return links
+        }
+    }
+
+    /**
+     * Fill the document link cache for every page, as [getPageLinks], so
+     * link overlays are ready with the first tile. Pages that aren't opened
+     * are loaded for their links only. The lock is taken per page, so
+     * rendering goes on in between; call it on a background thread.
+     */
+    fun prefetchLinks(doc: PdfDocument) {
+        check(!Thread.holdsLock(lock)) { "prefetchLinks would hold the PDFium lock for every page" }
+        for (pageIndex in 0 until getPageCount(doc)) {
+            if (doc.pageLinks.containsKey(pageIndex)) continue
+            synchronized(lock) {
+                val pagePtr = doc.NativePagesPtr[pageIndex]
+                val packed = if (pagePtr != null) {
+                    nativeGetPageLinks(doc.NativeDocPtr, pagePtr, true)
+                } else {
+                    nativeLoadPageLinks(doc.NativeDocPtr, pageIndex, true)
+                }
+                doc.pageLinks.putIfAbsent(pageIndex, unpackLinks(packed))
+            }
+        }
+    }
+
+    private fun unpackLinks(packed: Array<Any?>?): List<PdfDocument.Link> {
+        if (packed == null) {
+            return emptyList()
+        }
+        val rects = packed[0] as FloatArray
+        val dests = packed[1] as IntArray
+        val uris = packed[2] as Array<*>
+        return List(uris.size) { i ->
+            val bounds = RectF(rects[i * 4], rects[i * 4 + 1], rects[i * 4 + 2], rects[i * 4 + 3])
+            PdfDocument.Link(bounds, dests[i], uris[i] as String? ?: "")
+        }
+    }
+
+    /**
+     * Get the children of an outline entry, [limit] entries from [offset]
+     * (all of them if [limit] is negative). Entries are read from the document
+     * only when first requested, so expanding a huge outline stays cheap.
+     */
+    fun getBookmarks(doc: PdfDocument, parentId: Int = PdfDocument.OUTLINE_ROOT, offset: Int = 0, limit: Int = -1): PdfDocument.BookmarkPage {
+        synchronized(lock) {
+            val packed = nativeGetOutlineChildren(doc.NativeDocPtr, parentId, offset, limit)
+                ?: return PdfDocument.BookmarkPage(0, emptyList())
+            val header = packed[0] as IntArray
+            val titles = packed[1] as Array<*>
+            val bookmarks = List(titles.size) { i ->
+                PdfDocument.Bookmark(header[1 + i * 3], titles[i] as String? ?: "",
+                    header[2 + i * 3], header[3 + i * 3] != 0)
+            }
+            return PdfDocument.BookmarkPage(header[0], bookmarks)
+        }
+    }
+
+    /**
+     * Find the first bookmark with the given title. Returns the ids from the
+     * top level down to the match, or an empty array if there is none.
+     */
+    fun findBookmark(doc: PdfDocument, title: String): IntArray {
+        synchronized(lock) {
+            return nativeFindOutline(doc.NativeDocPtr, title)
+        }
+    }
+
+    /**
+     * Build the hit-testing index of an opened page. This walks the page text,
+     * links and annotations once, so it must run under the rendering lock;
+     * the query functions below never touch PDFium and only take the
+     * document's index lock. The returned handle is only valid until the
+     * index is closed.
+     */
+    fun buildPageIndex(doc: PdfDocument, pageIndex: Int): Long {
+        doc.NativePageIndexPtr[pageIndex]?.let { return it }
+        synchronized(lock) {
+            val pagePtr = doc.NativePagesPtr[pageIndex] ?: return 0
+            val indexPtr = nativeBuildPageIndex(pagePtr)
+            // Never cache a failed build, the queries would take 0 for an index
+            if (indexPtr == 0L) return 0
+            doc.NativePageIndexPtr.putIfAbsent(pageIndex, indexPtr)?.let {
+                nativeClosePageIndex(indexPtr)
+                return it
+            }
+            return indexPtr
+        }
+    }
+
+    /**
+     * Close the hit-testing index of [pageIndex], or of every page if null,
+     * once its annotations changed; [buildPageIndex] rebuilds it. The write
+     * lock waits for the queries running on it.
+     */
+    private fun closePageIndexes(doc: PdfDocument, pageIndex: Int? = null) {
+        doc.pageIndexLock.write {
+            val pages = if (pageIndex != null) listOf(pageIndex) else doc.NativePageIndexPtr.keys.toList()
+            for (index in pages) {
+                doc.NativePageIndexPtr.remove(index)?.let { nativeClosePageIndex(it) }
+            }
+        }
+    }
+
+    // Runs query on the index of pageIndex, kept open meanwhile; missing if it isn't built
+    private inline fun <T> queryPageIndex(doc: PdfDocument, pageIndex: Int, missing: T, query: (Long) -> T): T {
+        doc.pageIndexLock.read {
+            val indexPtr = doc.NativePageIndexPtr[pageIndex] ?: return missing
+            return query(indexPtr)
+        }
+    }
+
+    /**
+     * Get the character at a position in page coordinates, or -1.
+     * Page index must be built before with [buildPageIndex].
+     */
+    fun getCharIndexAtPos(doc: PdfDocument, pageIndex: Int, x: Float, y: Float, xTolerance: Float, yTolerance: Float): Int {
+        return queryPageIndex(doc, pageIndex, -1) { indexPtr ->
+            if (PdfiumFastNatives.enabled) {
+                PdfiumFastNatives.nativeIndexCharAtPos(indexPtr, x, y, xTolerance, yTolerance)
+            } else {
+                nativeIndexCharAtPos(indexPtr, x, y, xTolerance, yTolerance)
+            }
+        }
+    }
+
+    /** Get the link at a position in page coordinates, in FPDFLink_Enumerate order, or -1 */
+    fun getLinkIndexAtPos(doc: PdfDocument, pageIndex: Int, x: Float, y: Float): Int {
+        return queryPageIndex(doc, pageIndex, -1) { indexPtr ->
+            if (PdfiumFastNatives.enabled) {
+                PdfiumFastNatives.nativeIndexLinkAtPos(indexPtr, x, y)
+            } else {
+                nativeIndexLinkAtPos(indexPtr, x, y)
+            }
+        }
+    }
+
+    /** Get the top-most annotation at a position in page coordinates, or -1 */
+    fun getAnnotIndexAtPos(doc: PdfDocument, pageIndex: Int, x: Float, y: Float): Int {
+        return queryPageIndex(doc, pageIndex, -1) { indexPtr ->
+            if (PdfiumFastNatives.enabled) {
+                PdfiumFastNatives.nativeIndexAnnotAtPos(indexPtr, x, y)
+            } else {
+                nativeIndexAnnotAtPos(indexPtr, x, y)
+            }
+        }
+    }
+
+    /** Get the FPDF_ANNOT_* subtype of an indexed annotation */
+    fun getAnnotSubtype(doc: PdfDocument, pageIndex: Int, annotIndex: Int): Int {
+        return queryPageIndex(doc, pageIndex, -1) { indexPtr ->
+            nativeIndexAnnotSubtype(indexPtr, annotIndex)
+        }
+    }
+
+    /**
+     * Get the selection boxes of a character range, one per text line,
+     * packed as left, top, right, bottom in page coordinates. The range is
+     * clipped to the page, [count] may be [Int.MAX_VALUE] for the rest of it.
+     */
+    fun getCharRangeRects(doc: PdfDocument, pageIndex: Int, start: Int, count: Int): FloatArray {
+        return queryPageIndex(doc, pageIndex, FloatArray(0)) { indexPtr ->
+            val total = countIndexChars(indexPtr)
+            if (start < 0 || start >= total || count <= 0) return FloatArray(0)
+            val clipped = count.coerceAtMost(total - start)
+            if (PdfiumFastNatives.enabled) {
+                PdfiumFastNatives.nativeIndexGetCharRangeRects(indexPtr, start, clipped)
+            } else {
+                nativeIndexGetCharRangeRects(indexPtr, start, clipped)
+            }
+        }
+    }
+
+    /** Number of characters in the hit-testing index of a page, 0 if the page has none */
+    fun getCharCount(doc: PdfDocument, pageIndex: Int): Int {
+        return queryPageIndex(doc, pageIndex, 0) { indexPtr -> countIndexChars(indexPtr) }
+    }
+
+    private fun countIndexChars(indexPtr: Long): Int {
+        if (PdfiumFastNatives.enabled) {
+            return PdfiumFastNatives.nativeIndexCountChars(indexPtr)
+        }
+        return nativeIndexCountChars(indexPtr)
+    }
+
     companion object {
+        // FWL_VKEY_* and FWL_EVENTFLAG_* of fpdf_fwlevent.h
+        private const val FWL_VKEY_BACK = 0x08
+        private const val FWL_VKEY_TAB = 0x09
+        private const val FWL_VKEY_RETURN = 0x0D
+        private const val FWL_VKEY_END = 0x23
+        private const val FWL_VKEY_HOME = 0x24
+        private const val FWL_VKEY_LEFT = 0x25
+        private const val FWL_VKEY_RIGHT = 0x27
+        private const val FWL_VKEY_DELETE = 0x2E
+        private const val FWL_EVENTFLAG_SHIFT_KEY = 1
+
         val lock = Any()
         val TAG = PdfiumSDK::class.simpleName
         val FD_CLASS = FileDescriptor::class
         val FD_FIELD_NAME = "descriptor"
         val mCurrentDpi = 72
 
+        /** Flags of [getAllPageSizes] */
+        const val PAGE_SIZE_ROTATION = 1
+        const val PAGE_SIZE_BOXES = 2
+
+        // FPDF_SaveAsCopy flags of fpdf_save.h
+        private const val SAVE_INCREMENTAL = 1
+        private const val SAVE_NO_INCREMENTAL = 2
+
+        // Flags of nativeAssemblePages
+        private const val ASSEMBLY_VIEWER_PREFERENCES = 1
+        private const val ASSEMBLY_ODD_PAGE_STARTS = 2
+        private const val ASSEMBLY_SKIP_BROKEN = 4
+
+        /** How far [saveDocument] and [saveToFile] flush the file before returning */
+        const val SYNC_NONE = 0
+        const val SYNC_DATA = 1
+        const val SYNC_FULL = 2
+
+        /** Modes of [setStatsMode] */
+        const val STATS_COLLECT = 1
+        const val STATS_TRACE = 2
+
+        /** Font directories indexed by default by [setFontIndex] */
+        val SYSTEM_FONT_DIRS = arrayOf("/system/fonts")
+
         init {
             System.loadLibrary("pdfsdk")
             System.loadLibrary("pdfsdk_jni")
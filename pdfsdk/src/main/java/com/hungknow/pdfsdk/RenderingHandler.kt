@@ -1,6 +1,7 @@
 package com.hungknow.pdfsdk
 
 import android.graphics.Bitmap
+import android.graphics.Canvas
 import android.graphics.Matrix
 import android.graphics.Rect
 import android.graphics.RectF
@@ -9,7 +10,9 @@ import android.os.Looper
 import android.os.Message
 import android.util.Log
 import com.hungknow.pdfsdk.exceptions.PageRenderingException
+import com.hungknow.pdfsdk.models.AnnotationPart
 import com.hungknow.pdfsdk.models.PagePart
+import com.hungknow.pdfsdk.utils.ColorScheme
 import java.lang.IllegalArgumentException
 
 /**
@@ -26,6 +29,11 @@ class RenderingHandler(looper: Looper, val pdfView: PdfView): Handler(looper) {
 
     companion object {
         val MSG_RENDER_TASK = 1
+        val MSG_REPAINT_TASK = 2
+        val MSG_ANNOTATION_TASK = 3
+
+        /** Largest annotation bitmap, in pixels; bigger annotations render scaled down */
+        private const val MAX_ANNOTATION_PIXELS = 1024 * 1024
         val TAG = RenderingHandler::class.simpleName
     }
 
@@ -37,7 +45,37 @@ class RenderingHandler(looper: Looper, val pdfView: PdfView): Handler(looper) {
         running = true
     }
 
+    /**
+     * Re-render the part of an already rendered [part] covered by the
+     * page-relative [dirty] rect, e.g. a form field being typed into,
+     * instead of the whole tile.
+     */
+    fun addRepaintTask(part: PagePart, dirty: RectF, annotationRendering: Boolean) {
+        sendMessage(obtainMessage(MSG_REPAINT_TASK, RepaintTask(part, RectF(dirty), annotationRendering)))
+    }
+
+    /**
+     * Render the annotation layer of a page whose scaled size is
+     * [width] x [height] at [zoom], skipping annotations already cached at
+     * that zoom.
+     */
+    fun addAnnotationTask(page: Int, width: Float, height: Float, zoom: Float, colorScheme: ColorScheme) {
+        sendMessage(obtainMessage(MSG_ANNOTATION_TASK, AnnotationTask(page, width, height, zoom, colorScheme)))
+    }
+
     override fun handleMessage(msg: Message) {
+        if (msg.what == MSG_REPAINT_TASK) {
+            repaint(msg.obj as RepaintTask)
+            return
+        }
+        if (msg.what == MSG_ANNOTATION_TASK) {
+            try {
+                renderAnnotations(msg.obj as AnnotationTask)
+            } catch (e: PageRenderingException) {
+                Log.e(TAG, "cannot render the annotations of page ${e.page}", e)
+            }
+            return
+        }
         val task = msg.obj as RenderingTask
         try {
             val part = proceed(task)
@@ -73,9 +111,108 @@ class RenderingHandler(looper: Looper, val pdfView: PdfView): Handler(looper) {
         }
         calculateBounds(w, h, renderingTask.bounds)
 
-        pdfFile.renderPageBitmap(render, renderingTask.page, roundedRenderBounds, renderingTask.annotationRendering)
+        // With the annotation layer on, annotations are drawn from their own bitmaps
+        val renderAnnot = renderingTask.annotationRendering && !pdfView.annotationLayer
+        pdfFile.renderPageBitmap(render, renderingTask.page, roundedRenderBounds, renderAnnot, renderingTask.colorScheme)
 
-        return PagePart(renderingTask.page, render, renderingTask.bounds, renderingTask.thumbnail, renderingTask.cacheOrder)
+        return PagePart(renderingTask.page, render, renderingTask.bounds, renderingTask.thumbnail, renderingTask.cacheOrder, renderingTask.colorScheme)
+    }
+
+    private fun renderAnnotations(task: AnnotationTask) {
+        val pdfFile = pdfView.pdfFile ?: return
+        pdfFile.openPage(task.page)
+        if (pdfFile.pageHasError(task.page)) {
+            return
+        }
+
+        for (annotation in pdfFile.getLayerAnnotations(task.page)) {
+            if (!running) {
+                return
+            }
+            if (pdfView.cacheManager.containsAnnotation(task.page, annotation.index, task.zoom, task.colorScheme)) {
+                continue
+            }
+            val bounds = annotation.bounds
+            var w = bounds.width() * task.width
+            var h = bounds.height() * task.height
+            if (w * h > MAX_ANNOTATION_PIXELS) {
+                val scale = Math.sqrt((MAX_ANNOTATION_PIXELS / (w * h)).toDouble()).toFloat()
+                w *= scale
+                h *= scale
+            }
+            val bitmapWidth = Math.round(w)
+            val bitmapHeight = Math.round(h)
+            if (bitmapWidth == 0 || bitmapHeight == 0) {
+                continue
+            }
+
+            val bitmap: Bitmap
+            try {
+                bitmap = Bitmap.createBitmap(bitmapWidth, bitmapHeight, Bitmap.Config.ARGB_8888)
+            } catch (e: IllegalArgumentException) {
+                Log.e(TAG, "cannot create bitmap", e)
+                return
+            }
+            calculateBounds(bitmapWidth, bitmapHeight, bounds)
+            // In the tiles' scheme: the bitmap carries the content under the annotation
+            if (!pdfFile.renderAnnotation(bitmap, task.page, annotation.index, roundedRenderBounds, task.colorScheme)) {
+                bitmap.recycle()
+                continue
+            }
+
+            val part = AnnotationPart(task.page, annotation.index, bitmap, RectF(bounds), task.zoom, task.colorScheme)
+            pdfView.post {
+                if (running) {
+                    pdfView.onAnnotationRendered(part)
+                } else {
+                    bitmap.recycle()
+                }
+            }
+        }
+    }
+
+    private fun repaint(task: RepaintTask) {
+        val pdfFile = pdfView.pdfFile ?: return
+        val part = task.part
+        val target = part.renderedBitmap ?: return
+        if (target.isRecycled) {
+            return
+        }
+
+        // Pixels of the part bitmap under the dirty rect
+        val bounds = part.pageRelativeBounds
+        val w = target.width
+        val h = target.height
+        val left = Math.floor(((task.dirty.left - bounds.left) / bounds.width() * w).toDouble()).toInt().coerceIn(0, w)
+        val top = Math.floor(((task.dirty.top - bounds.top) / bounds.height() * h).toDouble()).toInt().coerceIn(0, h)
+        val right = Math.ceil(((task.dirty.right - bounds.left) / bounds.width() * w).toDouble()).toInt().coerceIn(0, w)
+        val bottom = Math.ceil(((task.dirty.bottom - bounds.top) / bounds.height() * h).toDouble()).toInt().coerceIn(0, h)
+        if (right <= left || bottom <= top) {
+            return
+        }
+
+        val patch: Bitmap
+        try {
+            patch = Bitmap.createBitmap(right - left, bottom - top, target.config)
+        } catch (e: IllegalArgumentException) {
+            Log.e(TAG, "cannot create bitmap", e)
+            return
+        }
+        // Same page placement as the part, shifted to the patch origin
+        calculateBounds(w, h, bounds)
+        roundedRenderBounds.offset(-left, -top)
+        // As in proceed: with the layer on, the annotations aren't part of the tiles
+        val renderAnnot = task.annotationRendering && !pdfView.annotationLayer
+        pdfFile.renderPageBitmap(patch, part.page, roundedRenderBounds, renderAnnot, part.colorScheme)
+
+        // Part bitmaps are drawn and recycled on the UI thread, patch them there
+        pdfView.post {
+            if (!target.isRecycled) {
+                Canvas(target).drawBitmap(patch, left.toFloat(), top.toFloat(), null)
+                pdfView.invalidate()
+            }
+            patch.recycle()
+        }
     }
 
     private fun calculateBounds(width: Int, height: Int, pageSliceBounds: RectF) {
@@ -88,7 +225,11 @@ class RenderingHandler(looper: Looper, val pdfView: PdfView): Handler(looper) {
         renderBounds.round(roundedRenderBounds)
     }
 
-    private data class RenderingTask(val width: Float, val height: Float, val bounds: RectF, val page: Int, val thumbnail: Boolean, val cacheOrder: Int, val bestQuality: Boolean, val annotationRendering: Boolean) {
+    private class AnnotationTask(val page: Int, val width: Float, val height: Float, val zoom: Float, val colorScheme: ColorScheme)
+
+    private class RepaintTask(val part: PagePart, val dirty: RectF, val annotationRendering: Boolean)
+
+    private data class RenderingTask(val width: Float, val height: Float, val bounds: RectF, val page: Int, val thumbnail: Boolean, val cacheOrder: Int, val bestQuality: Boolean, val annotationRendering: Boolean, val colorScheme: ColorScheme) {
 
     }
 }
\ No newline at end of file
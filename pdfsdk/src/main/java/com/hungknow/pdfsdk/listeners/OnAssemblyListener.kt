@@ -0,0 +1,12 @@
+package com.hungknow.pdfsdk.listeners
+
+interface OnAssemblyListener {
+    /**
+     * Called after each source of a [com.hungknow.pdfsdk.PdfiumSDK.assemblePages]
+     * job, on the job's thread and without the PDFium lock held
+     * @param index position of the source in the job
+     * @param pages output pages so far
+     * @return false to cancel the job, the output isn't written
+     */
+    fun onSourceAssembled(index: Int, pages: Int): Boolean
+}
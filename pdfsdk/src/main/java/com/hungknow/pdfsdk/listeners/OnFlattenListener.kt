@@ -0,0 +1,12 @@
+package com.hungknow.pdfsdk.listeners
+
+interface OnFlattenListener {
+    /**
+     * Called after each page of a [com.hungknow.pdfsdk.PdfiumSDK.flattenDocument]
+     * job, in page order, on the job's thread and without the PDFium lock held
+     * @param pageIndex the page processed
+     * @param flattened whether it had form fields or annotations to bake in
+     * @return false to cancel the job, nothing is saved
+     */
+    fun onPageFlattened(pageIndex: Int, flattened: Boolean): Boolean
+}
@@ -0,0 +1,12 @@
+package com.hungknow.pdfsdk.listeners
+
+interface OnPrintListener {
+    /**
+     * Called after each page of a [com.hungknow.pdfsdk.PdfiumSDK.printPages]
+     * job was rendered, on the job's thread and without the PDFium lock held
+     * @param index position of the page in the job
+     * @param pageIndex the page in the document
+     * @return false to cancel the job
+     */
+    fun onPageRendered(index: Int, pageIndex: Int): Boolean
+}
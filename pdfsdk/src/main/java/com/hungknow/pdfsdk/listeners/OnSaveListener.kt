@@ -0,0 +1,21 @@
+package com.hungknow.pdfsdk.listeners
+
+import java.io.File
+
+interface OnSaveListener {
+    /**
+     * Called while a [com.hungknow.pdfsdk.PdfiumSDK.saveToFile] writes, on
+     * the saving thread and without the PDFium lock held
+     * @param written bytes of the new file written so far
+     * @param total size of the new file
+     * @return false to cancel the save, the target keeps its old content
+     */
+    fun onSaveProgress(written: Long, total: Long): Boolean = true
+
+    /**
+     * Called by [com.hungknow.pdfsdk.AutoSaver] after each save, on its thread
+     * @param target the file saved to
+     * @param saved false if the save failed or was cancelled
+     */
+    fun onSaveDone(target: File, saved: Boolean) {}
+}
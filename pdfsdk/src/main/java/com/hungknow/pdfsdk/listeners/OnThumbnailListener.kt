@@ -0,0 +1,14 @@
+package com.hungknow.pdfsdk.listeners
+
+import android.graphics.Bitmap
+
+interface OnThumbnailListener {
+    /**
+     * Called once per document of a [com.hungknow.pdfsdk.PdfiumSDK.renderThumbnails]
+     * batch, on a native worker thread and in completion order
+     * @param index position of the document's fd in the batch
+     * @param bitmap the first page on white, null if it failed
+     * @param error why it failed, null on success
+     */
+    fun onThumbnail(index: Int, bitmap: Bitmap?, error: String?)
+}
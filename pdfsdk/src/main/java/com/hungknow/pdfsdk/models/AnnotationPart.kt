@@ -0,0 +1,17 @@
+package com.hungknow.pdfsdk.models
+
+import android.graphics.Bitmap
+import android.graphics.RectF
+import com.hungknow.pdfsdk.utils.ColorScheme
+
+/**
+ * One annotation rendered alone on transparent pixels, drawn over the page
+ * parts of the same [colorScheme] when the annotation layer is on.
+ * [annotIndex] follows FPDFPage_GetAnnot order.
+ */
+class AnnotationPart(val page: Int, val annotIndex: Int, val renderedBitmap: Bitmap?, val pageRelativeBounds: RectF, val zoom: Float,
+                     val colorScheme: ColorScheme) {
+    fun isSameAnnotation(page: Int, annotIndex: Int): Boolean {
+        return this.page == page && this.annotIndex == annotIndex
+    }
+}
@@ -0,0 +1,17 @@
+package com.hungknow.pdfsdk.models
+
+/** What a [com.hungknow.pdfsdk.PdfiumSDK.flattenDocument] job did and how fast */
+class FlattenResult(val pages: Int,
+                    /** Pages that had form fields or annotations to bake in */
+                    val flattenedPages: Int,
+                    /** Written by the save, 0 if nothing needed flattening in the source file */
+                    val bytesWritten: Long, val elapsedNanos: Long) {
+
+    val pagesPerSecond: Double
+        get() = if (elapsedNanos == 0L) 0.0 else pages * 1e9 / elapsedNanos
+
+    override fun toString(): String {
+        return pages.toString() + " pages, " + flattenedPages + " flattened, " + bytesWritten / 1024 + " KiB in " +
+                elapsedNanos / 1000000 + "ms (" + pagesPerSecond.toInt() + " pages/s)"
+    }
+}
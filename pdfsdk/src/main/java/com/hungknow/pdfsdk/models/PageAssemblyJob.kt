@@ -0,0 +1,58 @@
+package com.hungknow.pdfsdk.models
+
+import android.os.ParcelFileDescriptor
+import com.hungknow.pdfsdk.PdfiumSDK
+
+/**
+ * A document to build from pages of others, run by
+ * [com.hungknow.pdfsdk.PdfiumSDK.assemblePages] into [output]. Merge adds
+ * several whole sources, split adds one source with a page range per job,
+ * n-up sets [columns] and [rows]. The descriptors stay owned by the caller.
+ */
+class PageAssemblyJob(val output: ParcelFileDescriptor) {
+
+    /** [pageRange] is 1-based like "1,3,5-7", null for all pages */
+    class Source(val pfd: ParcelFileDescriptor, val pageRange: String?, val password: String)
+
+    val sources = mutableListOf<Source>()
+
+    /** Source pages per output sheet, 1 x 1 keeps the pages as they are */
+    var columns = 1
+    var rows = 1
+
+    /** Sheet size in points for n-up, 0 takes the size of the first page */
+    var sheetWidth = 0f
+    var sheetHeight = 0f
+
+    /** The output opens like the first source: page mode, print scaling... */
+    var copyViewerPreferences = true
+
+    /** A blank page is inserted where needed so every source starts on an odd page, for duplex printing */
+    var oddPageStarts = false
+
+    /** Leave out the sources that can't be opened or imported instead of failing */
+    var skipBrokenSources = false
+
+    var sync = PdfiumSDK.SYNC_DATA
+
+    fun add(pfd: ParcelFileDescriptor, pageRange: String? = null, password: String = ""): PageAssemblyJob {
+        sources.add(Source(pfd, pageRange, password))
+        return this
+    }
+}
+
+/** What a [PageAssemblyJob] produced and how fast */
+class PageAssemblyResult(val pages: Int, val bytesWritten: Long, val elapsedNanos: Long,
+                         val skippedSources: IntArray) {
+
+    val pagesPerSecond: Double
+        get() = if (elapsedNanos == 0L) 0.0 else pages * 1e9 / elapsedNanos
+
+    val bytesPerSecond: Double
+        get() = if (elapsedNanos == 0L) 0.0 else bytesWritten * 1e9 / elapsedNanos
+
+    override fun toString(): String {
+        return pages.toString() + " pages, " + bytesWritten / 1024 + " KiB in " + elapsedNanos / 1000000 +
+                "ms (" + pagesPerSecond.toInt() + " pages/s)"
+    }
+}
@@ -2,13 +2,14 @@ package com.hungknow.pdfsdk.models
 
 import android.graphics.Bitmap
 import android.graphics.RectF
+import com.hungknow.pdfsdk.utils.ColorScheme
 
-class PagePart(val page: Int, val renderedBitmap: Bitmap?, val pageRelativeBounds: RectF, val thumbnail: Boolean, var cacheOrder: Int) {
+class PagePart(val page: Int, val renderedBitmap: Bitmap?, val pageRelativeBounds: RectF, val thumbnail: Boolean, var cacheOrder: Int, val colorScheme: ColorScheme = ColorScheme.NONE) {
     override fun equals(other: Any?): Boolean {
         if (other !is PagePart) {
             return false
         }
 
-        return other.page == page && other.pageRelativeBounds.left == pageRelativeBounds.left && other.pageRelativeBounds.right == pageRelativeBounds.right && other.pageRelativeBounds.top == pageRelativeBounds.top && other.pageRelativeBounds.bottom == pageRelativeBounds.bottom
+        return other.page == page && other.colorScheme == colorScheme && other.pageRelativeBounds.left == pageRelativeBounds.left && other.pageRelativeBounds.right == pageRelativeBounds.right && other.pageRelativeBounds.top == pageRelativeBounds.top && other.pageRelativeBounds.bottom == pageRelativeBounds.bottom
     }
 }
\ No newline at end of file
@@ -0,0 +1,15 @@
+package com.hungknow.pdfsdk.models
+
+/** What a [com.hungknow.pdfsdk.PdfiumSDK.printPages] job produced and how fast */
+class PrintResult(val pages: Int, val bytesWritten: Long, val elapsedNanos: Long,
+                  /** Band buffers allocated, the pixel memory the job peaked at */
+                  val bandMemory: Long) {
+
+    val pagesPerMinute: Double
+        get() = if (elapsedNanos == 0L) 0.0 else pages * 60e9 / elapsedNanos
+
+    override fun toString(): String {
+        return pages.toString() + " pages, " + bytesWritten / 1024 + " KiB in " + elapsedNanos / 1000000 +
+                "ms (" + pagesPerMinute.toInt() + " pages/min, bands " + bandMemory / 1024 + " KiB)"
+    }
+}
@@ -0,0 +1,77 @@
+package com.hungknow.pdfsdk.models
+
+/**
+ * Snapshot of the native per-stage timings, see
+ * [com.hungknow.pdfsdk.PdfiumSDK.getStats]. Two snapshots can be diffed with
+ * [minus] to measure a single operation.
+ */
+class RenderStats(private val values: LongArray) {
+
+    class Stage(val name: String, val count: Long, val totalNanos: Long, val maxNanos: Long,
+                val histogram: LongArray) {
+
+        val meanNanos: Long
+            get() = if (count == 0L) 0 else totalNanos / count
+
+        /**
+         * Upper bound of the histogram bucket holding the given percentile
+         * (0 to 100), in nanoseconds; bucket i ends at 2^i microseconds.
+         */
+        fun percentileNanos(percentile: Double): Long {
+            if (count == 0L) return 0
+            val target = Math.ceil(count * percentile / 100).toLong().coerceAtLeast(1)
+            var seen = 0L
+            for (i in histogram.indices) {
+                seen += histogram[i]
+                if (seen >= target) return (1L shl i) * 1000
+            }
+            return maxNanos
+        }
+
+        override fun toString(): String {
+            return name + ": " + count + " calls, mean " + meanNanos / 1000 + "us, p99 " +
+                    percentileNanos(99.0) / 1000 + "us, max " + maxNanos / 1000 + "us"
+        }
+    }
+
+    val stages: List<Stage> = STAGE_NAMES.mapIndexed { i, name ->
+        val base = i * STAGE_SIZE
+        Stage(name, values[base], values[base + 1], values[base + 2],
+            values.copyOfRange(base + 3, base + STAGE_SIZE))
+    }
+
+    val bytesRead: Long
+        get() = values[STAGE_NAMES.size * STAGE_SIZE]
+
+    val pixelsRendered: Long
+        get() = values[STAGE_NAMES.size * STAGE_SIZE + 1]
+
+    val bytesWritten: Long
+        get() = values[STAGE_NAMES.size * STAGE_SIZE + 2]
+
+    fun stage(name: String): Stage? = stages.firstOrNull { it.name == name }
+
+    /** Counts and totals accumulated since [earlier]; maxima are kept as is */
+    operator fun minus(earlier: RenderStats): RenderStats {
+        val diff = values.copyOf()
+        for (i in diff.indices) {
+            if (i < STAGE_NAMES.size * STAGE_SIZE && i % STAGE_SIZE == 2) continue
+            diff[i] -= earlier.values[i]
+        }
+        return RenderStats(diff)
+    }
+
+    override fun toString(): String {
+        return stages.joinToString("\n") + "\nbytes read " + bytesRead + ", pixels " + pixelsRendered +
+                ", bytes written " + bytesWritten
+    }
+
+    companion object {
+        /** Native stages, in the order of render_stats.h */
+        val STAGE_NAMES = listOf("fileRead", "documentOpen", "pageLoad", "rasterize",
+            "convert565", "bitmapLock", "fileWrite")
+
+        const val HISTOGRAM_BUCKETS = 20
+        private const val STAGE_SIZE = 3 + HISTOGRAM_BUCKETS
+    }
+}
@@ -0,0 +1,14 @@
+package com.hungknow.pdfsdk.models
+
+/**
+ * What [com.hungknow.pdfsdk.PdfiumSDK.warmUp] spent, in nanoseconds.
+ * [fontEnumNanos] is 0 when the fonts were already enumerated before the
+ * warm-up; it is included in [renderNanos].
+ */
+class WarmUpTimings(val libraryInitNanos: Long, val fontEnumNanos: Long, val renderNanos: Long) {
+
+    override fun toString(): String {
+        return "init " + libraryInitNanos / 1000 + "us, fonts " + fontEnumNanos / 1000 +
+                "us, render " + renderNanos / 1000 + "us"
+    }
+}
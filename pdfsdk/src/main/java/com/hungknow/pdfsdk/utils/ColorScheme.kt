@@ -0,0 +1,15 @@
+package com.hungknow.pdfsdk.utils
+
+/**
+ * Reading modes pages are rendered in natively. NIGHT, SEPIA and
+ * HIGH_CONTRAST recolor text and paths to a flat palette and keep images as
+ * they are; INVERT inverts everything except raster images, which keeps
+ * colored vector art distinguishable. The ordinals are the native values.
+ */
+enum class ColorScheme {
+    NONE, NIGHT, SEPIA, HIGH_CONTRAST, INVERT;
+
+    /** True if the page background of the scheme is dark */
+    val isDark: Boolean
+        get() = this == NIGHT || this == HIGH_CONTRAST || this == INVERT
+}
@@ -17,10 +17,15 @@ class Constants {
         /** Part of document above and below screen that should be preloaded, in dp */
         var PRELOAD_OFFSET = 20
 
+        /** Largest ink overlay in pixels; bigger pages get a scaled down overlay */
+        var INK_OVERLAY_MAX_PIXELS = 4 * 1024 * 1024
+
         object Cache {
             /** The size of the cache (number of bitmaps kept)  */
             var CACHE_SIZE = 120
             var THUMBNAILS_CACHE_SIZE = 8
+            /** Annotation layer bitmaps kept, one per annotation */
+            var ANNOTATIONS_CACHE_SIZE = 64
         }
 
         object Pinch {
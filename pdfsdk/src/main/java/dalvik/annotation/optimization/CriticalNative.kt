@@ -0,0 +1,14 @@
+package dalvik.annotation.optimization
+
+/**
+ * Mirror of the platform's hidden annotation. ART (Android O and later)
+ * only matches it by name in the dex build-visible annotations, so a copy
+ * with binary retention is enough to enable the fast path; older releases
+ * ignore it.
+ *
+ * A @CriticalNative method must be static, take and return primitives only,
+ * and its native function gets neither a JNIEnv nor the class.
+ */
+@Retention(AnnotationRetention.BINARY)
+@Target(AnnotationTarget.FUNCTION)
+annotation class CriticalNative
@@ -0,0 +1,10 @@
+package dalvik.annotation.optimization
+
+/**
+ * Mirror of the platform's hidden annotation, see [CriticalNative]. A
+ * @FastNative method keeps the regular JNI signature but skips the thread
+ * state transition, so its native code must be short and never block.
+ */
+@Retention(AnnotationRetention.BINARY)
+@Target(AnnotationTarget.FUNCTION)
+annotation class FastNative
@@ -0,0 +1,130 @@
+#include "annot_codec.h"
+#include "test_main.h"
+
+#include <string.h>
+
+static FS_QUADPOINTSF quad(float left, float bottom, float right, float top) {
+    FS_QUADPOINTSF q = {left, top, right, top, left, bottom, right, bottom};
+    return q;
+}
+
+static bool sameRecords(const AnnotRecord &a, const AnnotRecord &b) {
+    if (a.page != b.page || a.subtype != b.subtype || a.flags != b.flags ||
+        memcmp(&a.rect, &b.rect, sizeof(a.rect)) != 0 || a.hasColor != b.hasColor ||
+        (a.hasColor && memcmp(a.color, b.color, 4) != 0) || a.contents != b.contents ||
+        a.attachmentPoints.size() != b.attachmentPoints.size() ||
+        a.inkList.size() != b.inkList.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.attachmentPoints.size(); i++) {
+        if (memcmp(&a.attachmentPoints[i], &b.attachmentPoints[i],
+                   sizeof(FS_QUADPOINTSF)) != 0) {
+            return false;
+        }
+    }
+    for (size_t i = 0; i < a.inkList.size(); i++) {
+        if (a.inkList[i].size() != b.inkList[i].size() ||
+            (!a.inkList[i].empty() && memcmp(a.inkList[i].data(), b.inkList[i].data(),
+                                             a.inkList[i].size() * sizeof(FS_POINTF)) != 0)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static std::vector<AnnotRecord> sampleRecords() {
+    std::vector<AnnotRecord> records(3);
+
+    AnnotRecord &highlight = records[0];
+    highlight.page = 0;
+    highlight.subtype = 9;  // FPDF_ANNOT_HIGHLIGHT
+    highlight.flags = 4;    // FPDF_ANNOT_FLAG_PRINT
+    highlight.rect.left = 72;
+    highlight.rect.top = 712.5f;
+    highlight.rect.right = 300;
+    highlight.rect.bottom = 700;
+    highlight.hasColor = true;
+    highlight.color[0] = 255;
+    highlight.color[1] = 230;
+    highlight.color[2] = 0;
+    highlight.color[3] = 128;
+    highlight.attachmentPoints.push_back(quad(72, 700, 300, 712.5f));
+    highlight.attachmentPoints.push_back(quad(72, 686, 180, 698.5f));
+    const char *note = "Check \xe2\x84\x96";
+    for (const char *c = note; *c; c++) highlight.contents.push_back((uint8_t) *c);
+    highlight.contents.push_back(0x2116);
+
+    AnnotRecord &ink = records[1];
+    ink.page = 300;
+    ink.subtype = 15;       // FPDF_ANNOT_INK
+    ink.rect.left = -1.5f;
+    ink.rect.top = 1e6f;
+    ink.inkList.resize(2);
+    for (int i = 0; i < 200; i++) {
+        FS_POINTF point = {i * 0.25f, 500 - i * 0.5f};
+        ink.inkList[i % 2].push_back(point);
+    }
+
+    // Only the required fields
+    records[2].page = 1;
+    records[2].subtype = 1;
+    return records;
+}
+
+TEST(RecordsSurviveARoundTrip) {
+    std::vector<AnnotRecord> records = sampleRecords();
+    std::vector<uint8_t> blob;
+    encodeAnnotRecords(records, &blob);
+
+    std::vector<AnnotRecord> decoded;
+    CHECK(decodeAnnotRecords(blob.data(), blob.size(), &decoded));
+    CHECK(decoded.size() == records.size());
+    for (size_t i = 0; i < records.size(); i++) {
+        CHECK(sameRecords(records[i], decoded[i]));
+    }
+
+    std::vector<uint8_t> empty;
+    encodeAnnotRecords(std::vector<AnnotRecord>(), &empty);
+    CHECK(empty.size() == 6);
+    CHECK(decodeAnnotRecords(empty.data(), empty.size(), &decoded));
+    CHECK(decoded.empty());
+}
+
+TEST(HighlightsStayCompact) {
+    // One quad, a color and flags: what a review highlight carries
+    std::vector<AnnotRecord> records(500, sampleRecords()[0]);
+    for (size_t i = 0; i < records.size(); i++) {
+        records[i].attachmentPoints.resize(1);
+        records[i].contents.clear();
+        records[i].page = (int) i / 10;
+    }
+    std::vector<uint8_t> blob;
+    encodeAnnotRecords(records, &blob);
+    CHECK(blob.size() < records.size() * 60);
+}
+
+TEST(DamagedBlobsAreRejected) {
+    std::vector<uint8_t> blob;
+    encodeAnnotRecords(sampleRecords(), &blob);
+    std::vector<AnnotRecord> decoded;
+
+    for (size_t size = 0; size < blob.size(); size++) {
+        CHECK(!decodeAnnotRecords(blob.data(), size, &decoded));
+    }
+
+    std::vector<uint8_t> trailing(blob);
+    trailing.push_back(0);
+    CHECK(!decodeAnnotRecords(trailing.data(), trailing.size(), &decoded));
+
+    std::vector<uint8_t> version(blob);
+    version[4] = 2;
+    CHECK(!decodeAnnotRecords(version.data(), version.size(), &decoded));
+
+    // A count far past the data must not be trusted
+    const uint8_t huge[] = {'P', 'D', 'F', 'A', 1, 0xFF, 0xFF, 0xFF, 0xFF, 0x0F};
+    CHECK(!decodeAnnotRecords(huge, sizeof(huge), &decoded));
+}
+
+int main() {
+    return runAllTests();
+}
@@ -0,0 +1,119 @@
+#include "file_writer.h"
+#include "render_stats.h"
+#include "test_main.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+static int openTemp(const std::string &contents) {
+    char path[] = "/tmp/pdfsdk_writer_XXXXXX";
+    int fd = mkstemp(path);
+    unlink(path);
+    if (fd >= 0 && !contents.empty()) {
+        if (write(fd, contents.data(), contents.size()) != (ssize_t) contents.size()) {
+            close(fd);
+            return -1;
+        }
+    }
+    return fd;
+}
+
+static std::string readAll(int fd) {
+    std::string contents;
+    char chunk[4096];
+    ssize_t n;
+    off_t offset = 0;
+    while ((n = pread(fd, chunk, sizeof(chunk), offset)) > 0) {
+        contents.append(chunk, n);
+        offset += n;
+    }
+    return contents;
+}
+
+// Hands the output to the writer like PDFium does, block by block
+static bool produce(FdFileWriter *writer, const std::string &output, size_t blockSize) {
+    for (size_t i = 0; i < output.size(); i += blockSize) {
+        std::string block = output.substr(i, blockSize);
+        if (!writer->WriteBlock(writer, block.data(), block.size())) return false;
+    }
+    return true;
+}
+
+TEST(SmallBlocksAreCoalesced) {
+    setStatsMode(kStatsCollect);
+    resetStats();
+    int fd = openTemp(std::string(10000, 'x'));
+    CHECK(fd >= 0);
+
+    std::string output;
+    for (int i = 0; i < 1000; i++) output += "obj " + std::to_string(i) + "\n";
+    output += std::string(5000, 'L');
+    FdFileWriter writer(fd, 0, 1024);
+    CHECK(produce(&writer, output, 7));
+    // One block larger than the buffer goes straight through
+    std::string large(3000, 'B');
+    CHECK(writer.WriteBlock(&writer, large.data(), large.size()));
+    output += large;
+    CHECK(writer.finish(kSyncData));
+
+    // The stale tail of the old contents is cut
+    CHECK(readAll(fd) == output);
+    CHECK(writer.bytesWritten() == output.size());
+    std::vector<int64_t> stats;
+    snapshotStats(&stats);
+    const int64_t writes = stats[kStageFileWrite * (3 + kStatBuckets)];
+    CHECK(writes > 1 && writes < (int64_t) output.size() / 7 / 10);
+    close(fd);
+    setStatsMode(0);
+}
+
+TEST(IncrementalSaveAppendsToTheSource) {
+    const std::string original = "%PDF-1.7 original body %%EOF\n";
+    int fd = openTemp(original + "stale previous append");
+    CHECK(fd >= 0);
+
+    const std::string delta = "1 0 obj changed endobj xref trailer %%EOF\n";
+    FdFileWriter writer(fd, original.size(), 16);
+    CHECK(produce(&writer, original + delta, 5));
+    CHECK(writer.finish(kSyncNone));
+    CHECK(readAll(fd) == original + delta);
+    CHECK(writer.bytesWritten() == delta.size());
+    CHECK(writer.outputSize() == original.size() + delta.size());
+    close(fd);
+}
+
+TEST(OutputNotStartingWithTheSourceWritesNothing) {
+    const std::string original = "%PDF-1.7 original body %%EOF\n";
+    int fd = openTemp(original);
+    CHECK(fd >= 0);
+
+    FdFileWriter writer(fd, original.size(), 16);
+    CHECK(!produce(&writer, "%PDF-1.7 rewritten body %%EOF\n and more", 4));
+    CHECK(writer.failed());
+    CHECK(!writer.finish(kSyncNone));
+    CHECK(readAll(fd) == original);
+    close(fd);
+}
+
+TEST(OutputNotEndingWithTheSourceWritesNothing) {
+    // Only the ends of a long source are compared, a changed tail is caught
+    const std::string original = std::string(3 * FdFileWriter::kCheckedBytes, 'o') + "%%EOF\n";
+    int fd = openTemp(original);
+    CHECK(fd >= 0);
+
+    std::string output = original;
+    output[output.size() - 2] = 'X';
+    FdFileWriter writer(fd, original.size(), 1024);
+    CHECK(!produce(&writer, output + "appended", 1000));
+    CHECK(writer.failed());
+    CHECK(readAll(fd) == original);
+    close(fd);
+}
+
+int main() {
+    return runAllTests();
+}
@@ -0,0 +1,260 @@
+#include "font_index.h"
+#include "font_info.h"
+#include "test_main.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <set>
+#include <string>
+#include <utility>
+
+// Fonts reported to the font mapper through FPDF_AddInstalledFont
+static std::set<std::pair<std::string, int> > sInstalledFonts;
+
+FPDF_EXPORT void FPDF_CALLCONV FPDF_AddInstalledFont(void *, const char *face, int charset) {
+    sInstalledFonts.insert(std::make_pair(std::string(face), charset));
+}
+
+struct FakeFace {
+    const char *family;
+    uint16_t weight;
+    bool italic;
+    uint32_t codePages;
+};
+
+static void putU16(std::vector<unsigned char> *out, size_t at, uint16_t v) {
+    (*out)[at] = (unsigned char) (v >> 8);
+    (*out)[at + 1] = (unsigned char) v;
+}
+
+static void putU32(std::vector<unsigned char> *out, size_t at, uint32_t v) {
+    putU16(out, at, (uint16_t) (v >> 16));
+    putU16(out, at + 2, (uint16_t) v);
+}
+
+// Appends an sfnt with only OS/2 and name tables at the end of out. Table
+// offsets are absolute, as they are inside a collection.
+static void appendFace(std::vector<unsigned char> *out, const FakeFace &face) {
+    size_t base = out->size();
+    size_t os2Offset = base + 12 + 2 * 16;
+    size_t os2Length = 86;
+    size_t nameOffset = os2Offset + os2Length;
+    size_t familyLength = strlen(face.family);
+    size_t nameLength = 6 + 12 + familyLength * 2;
+    out->resize(nameOffset + nameLength, 0);
+
+    putU32(out, base, 0x00010000);
+    putU16(out, base + 4, 2);
+    putU32(out, base + 12, 0x4F532F32); // OS/2
+    putU32(out, base + 12 + 8, (uint32_t) os2Offset);
+    putU32(out, base + 12 + 12, (uint32_t) os2Length);
+    putU32(out, base + 28, 0x6E616D65); // name
+    putU32(out, base + 28 + 8, (uint32_t) nameOffset);
+    putU32(out, base + 28 + 12, (uint32_t) nameLength);
+
+    putU16(out, os2Offset, 1);
+    putU16(out, os2Offset + 4, face.weight);
+    putU16(out, os2Offset + 62, face.italic ? 1 : 0);
+    putU32(out, os2Offset + 78, face.codePages);
+
+    putU16(out, nameOffset + 2, 1);
+    putU16(out, nameOffset + 4, 6 + 12);
+    putU16(out, nameOffset + 6, 3);
+    putU16(out, nameOffset + 8, 1);
+    putU16(out, nameOffset + 10, 0x409);
+    putU16(out, nameOffset + 12, 1);
+    putU16(out, nameOffset + 14, (uint16_t) (familyLength * 2));
+    putU16(out, nameOffset + 16, 0);
+    for (size_t i = 0; i < familyLength; i++) {
+        putU16(out, nameOffset + 18 + i * 2, (uint16_t) face.family[i]);
+    }
+}
+
+static std::vector<unsigned char> makeCollection(const FakeFace *faces, int count) {
+    std::vector<unsigned char> out(12 + count * 4, 0);
+    putU32(&out, 0, 0x74746366); // ttcf
+    putU32(&out, 4, 0x00010000);
+    putU32(&out, 8, (uint32_t) count);
+    for (int i = 0; i < count; i++) {
+        putU32(&out, 12 + i * 4, (uint32_t) out.size());
+        appendFace(&out, faces[i]);
+    }
+    return out;
+}
+
+static void writeFile(const std::string &path, const std::vector<unsigned char> &bytes) {
+    FILE *file = fopen(path.c_str(), "wb");
+    fwrite(bytes.data(), 1, bytes.size(), file);
+    fclose(file);
+}
+
+static const uint32_t kLatin = 1;
+static const uint32_t kCyrillic = 1 << 2;
+static const uint32_t kJapanese = 1 << 17;
+
+// A fake font directory: two plain fonts, a two face collection and a file
+// that isn't a font at all
+static std::string makeFontDir() {
+    char pattern[] = "/tmp/pdfsdk_fonts_XXXXXX";
+    std::string dir = mkdtemp(pattern);
+
+    std::vector<unsigned char> bytes;
+    FakeFace regular = {"Roboto", 400, false, kLatin | kCyrillic};
+    appendFace(&bytes, regular);
+    writeFile(dir + "/Roboto-Regular.ttf", bytes);
+
+    bytes.clear();
+    FakeFace bold = {"Roboto", 700, false, kLatin | kCyrillic};
+    appendFace(&bytes, bold);
+    writeFile(dir + "/Roboto-Bold.ttf", bytes);
+
+    FakeFace cjk[] = {{"Noto Sans CJK JP", 400, false, kLatin | kJapanese},
+                      {"Noto Sans CJK KR", 400, false, kLatin}};
+    writeFile(dir + "/NotoSansCJK.ttc", makeCollection(cjk, 2));
+
+    writeFile(dir + "/fonts.xml", std::vector<unsigned char>(64, 'x'));
+    return dir;
+}
+
+static int findFamily(const FontIndex &index, const char *family, uint16_t weight) {
+    for (int i = 0; i < index.faceCount(); i++) {
+        FontFace face = index.face(i);
+        if (strcmp(face.family, family) == 0 && face.weight == weight) return i;
+    }
+    return -1;
+}
+
+TEST(ScanReadsPlainFontsAndCollections) {
+    std::vector<std::string> dirs(1, makeFontDir());
+    std::shared_ptr<const FontIndex> index = FontIndex::scan(dirs);
+    CHECK(index);
+    CHECK(!index->isMapped());
+    CHECK(index->faceCount() == 4);
+
+    int bold = findFamily(*index, "Roboto", 700);
+    CHECK(bold >= 0);
+    CHECK(index->face(bold).codePages == (kLatin | kCyrillic));
+
+    int korean = findFamily(*index, "Noto Sans CJK KR", 400);
+    CHECK(korean >= 0);
+    FontFace face = index->face(korean);
+    CHECK(face.faceIndex == 1);
+    CHECK(std::string(face.path, face.pathLength) == dirs[0] + "/NotoSansCJK.ttc");
+}
+
+TEST(CacheRoundTripsThroughMmap) {
+    std::vector<std::string> dirs(1, makeFontDir());
+    std::string cache = dirs[0] + ".idx";
+    std::shared_ptr<const FontIndex> scanned = FontIndex::open(cache, dirs);
+    CHECK(scanned);
+    CHECK(!scanned->isMapped());
+
+    std::shared_ptr<const FontIndex> loaded = FontIndex::open(cache, dirs);
+    CHECK(loaded);
+    CHECK(loaded->isMapped());
+    CHECK(loaded->faceCount() == scanned->faceCount());
+    for (int i = 0; i < loaded->faceCount(); i++) {
+        CHECK(strcmp(loaded->face(i).family, scanned->face(i).family) == 0);
+        CHECK(strcmp(loaded->face(i).path, scanned->face(i).path) == 0);
+        CHECK(loaded->face(i).faceOffset == scanned->face(i).faceOffset);
+    }
+}
+
+TEST(CacheIsStaleWhenTheDirectoryChanges) {
+    std::vector<std::string> dirs(1, makeFontDir());
+    std::string cache = dirs[0] + ".idx";
+    CHECK(FontIndex::scan(dirs)->save(cache));
+    CHECK(FontIndex::load(cache, dirs));
+
+    // Another directory list never matches
+    std::vector<std::string> others(dirs);
+    others.push_back("/nonexistent");
+    CHECK(!FontIndex::load(cache, others));
+
+    // Set the directory time explicitly, a new file may land in the same tick
+    struct timeval times[2] = {{1000, 0}, {1000, 0}};
+    CHECK(utimes(dirs[0].c_str(), times) == 0);
+    CHECK(!FontIndex::load(cache, dirs));
+}
+
+TEST(CorruptCacheIsRejected) {
+    std::vector<std::string> dirs(1, makeFontDir());
+    std::string cache = dirs[0] + ".idx";
+    writeFile(cache, std::vector<unsigned char>(100, 0xFF));
+    CHECK(!FontIndex::load(cache, dirs));
+
+    std::shared_ptr<const FontIndex> index = FontIndex::open(cache, dirs);
+    CHECK(index);
+    CHECK(index->faceCount() == 4);
+}
+
+TEST(EnumFontsReportsFamiliesOncePerCharset) {
+    std::vector<std::string> dirs(1, makeFontDir());
+    FPDF_SYSFONTINFO *info = newIndexedFontInfo(FontIndex::scan(dirs));
+    sInstalledFonts.clear();
+    info->EnumFonts(info, nullptr);
+    info->Release(info);
+
+    CHECK(sInstalledFonts.size() == 5);
+    CHECK(sInstalledFonts.count(std::make_pair(std::string("Roboto"), FXFONT_CYRILLIC_CHARSET)));
+    CHECK(sInstalledFonts.count(
+            std::make_pair(std::string("Noto Sans CJK JP"), FXFONT_SHIFTJIS_CHARSET)));
+}
+
+TEST(MapFontPicksClosestFace) {
+    std::vector<std::string> dirs(1, makeFontDir());
+    FPDF_SYSFONTINFO *info = newIndexedFontInfo(FontIndex::scan(dirs));
+    char name[64];
+
+    void *font = info->MapFont(info, 700, 0, FXFONT_ANSI_CHARSET, 0, "Roboto,Bold", nullptr);
+    CHECK(font != nullptr);
+    CHECK(info->GetFaceName(info, font, name, sizeof(name)) == 7);
+    CHECK(strcmp(name, "Roboto") == 0);
+    // The bold face's OS/2 table says 700
+    unsigned char os2[86];
+    CHECK(info->GetFontData(info, font, 0x4F532F32, os2, sizeof(os2)) == 86);
+    CHECK(((os2[4] << 8) | os2[5]) == 700);
+    info->DeleteFont(info, font);
+
+    // An unknown family falls back to a face covering the charset
+    font = info->MapFont(info, 400, 0, FXFONT_SHIFTJIS_CHARSET, 0, "MS Mincho", nullptr);
+    CHECK(font != nullptr);
+    info->GetFaceName(info, font, name, sizeof(name));
+    CHECK(strcmp(name, "Noto Sans CJK JP") == 0);
+    info->DeleteFont(info, font);
+
+    CHECK(info->MapFont(info, 400, 0, FXFONT_ARABIC_CHARSET, 0, "Arial", nullptr) == nullptr);
+    info->Release(info);
+}
+
+TEST(CollectionFaceOffsetCanBeRecovered) {
+    std::vector<std::string> dirs(1, makeFontDir());
+    std::shared_ptr<const FontIndex> index = FontIndex::scan(dirs);
+    FPDF_SYSFONTINFO *info = newIndexedFontInfo(index);
+
+    void *font = info->MapFont(info, 400, 0, FXFONT_ANSI_CHARSET, 0, "Noto Sans CJK KR", nullptr);
+    CHECK(font != nullptr);
+    unsigned long collectionSize = info->GetFontData(info, font, 0x74746366, nullptr, 0);
+    unsigned long faceSize = info->GetFontData(info, font, 0, nullptr, 0);
+    CHECK(collectionSize > faceSize);
+    FontFace face = index->face(findFamily(*index, "Noto Sans CJK KR", 400));
+    CHECK(collectionSize - faceSize == face.faceOffset);
+
+    // Plain fonts are not collections
+    void *plain = info->MapFont(info, 400, 0, FXFONT_ANSI_CHARSET, 0, "Roboto", nullptr);
+    CHECK(plain != nullptr);
+    CHECK(info->GetFontData(info, plain, 0x74746366, nullptr, 0) == 0);
+    CHECK(info->GetFontData(info, plain, 0, nullptr, 0) > 0);
+
+    info->DeleteFont(info, plain);
+    info->DeleteFont(info, font);
+    info->Release(info);
+}
+
+int main() {
+    return runAllTests();
+}
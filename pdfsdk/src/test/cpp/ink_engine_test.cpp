@@ -0,0 +1,107 @@
+#include "ink_engine.h"
+#include "test_main.h"
+
+#include <math.h>
+
+#include <vector>
+
+static const int kSize = 64;
+
+struct Overlay {
+    std::vector<uint8_t> pixels;
+    RenderTarget target;
+
+    Overlay() : pixels(kSize * kSize * 4, 0) {
+        target.pixels = pixels.data();
+        target.width = kSize;
+        target.height = kSize;
+        target.stride = kSize * 4;
+        target.format = kTileRgba8888;
+    }
+
+    const uint8_t *at(int x, int y) const { return &pixels[(y * kSize + x) * 4]; }
+};
+
+TEST(SimplifyDropsCollinearPoints) {
+    std::vector<InkPoint> line;
+    for (int i = 0; i <= 100; i++) {
+        InkPoint point = {(float) i, i * 0.5f};
+        line.push_back(point);
+    }
+    std::vector<InkPoint> simplified;
+    simplifyPolyline(line, 0.1f, &simplified);
+    CHECK(simplified.size() == 2);
+    CHECK(simplified[0].x == 0 && simplified[1].x == 100);
+
+    // The corner of an L stays
+    InkPoint corner = {100, 100};
+    line.push_back(corner);
+    simplifyPolyline(line, 0.1f, &simplified);
+    CHECK(simplified.size() == 3);
+    CHECK(simplified[1].x == 100 && simplified[1].y == 50);
+}
+
+TEST(StrokePassesThroughTouchPoints) {
+    Overlay overlay;
+    InkStroke stroke(0xFF0000FF, 3);
+    const float points[] = {8, 8, 30, 20, 50, 10, 56, 50};
+    stroke.addPoints(points, 2, overlay.target);
+    stroke.addPoints(points + 4, 2, overlay.target);
+    stroke.finish(overlay.target);
+
+    for (int i = 0; i < 4; i++) {
+        const uint8_t *pixel = overlay.at((int) points[i * 2], (int) points[i * 2 + 1]);
+        CHECK(pixel[3] == 0xFF && pixel[2] == 0xFF && pixel[0] == 0);
+        bool onPath = false;
+        for (size_t p = 0; p < stroke.path().size(); p++) {
+            onPath |= fabsf(stroke.path()[p].x - points[i * 2]) < 1e-3f &&
+                      fabsf(stroke.path()[p].y - points[i * 2 + 1]) < 1e-3f;
+        }
+        CHECK(onPath);
+    }
+    // Far from the stroke
+    CHECK(overlay.at(5, 60)[3] == 0);
+}
+
+TEST(DirtyRectCoversOnlyNewPixels) {
+    Overlay overlay;
+    InkStroke stroke(0x80FF0000, 4);
+    const float first[] = {10, 10};
+    InkDirtyRect dirty = stroke.addPoints(first, 1, overlay.target);
+    // A dot on pen down
+    CHECK(dirty.left == 7 && dirty.top == 7 && dirty.right == 13 && dirty.bottom == 13);
+    CHECK(overlay.at(10, 10)[3] == 0x80);
+    CHECK(overlay.at(10, 10)[0] == 0x80);
+
+    const float next[] = {40, 10, 40.1f, 10};
+    dirty = stroke.addPoints(next, 2, overlay.target);
+    CHECK(dirty.left <= 10 && dirty.right >= 43 && dirty.right <= 44);
+    CHECK(dirty.top >= 6 && dirty.bottom <= 14);
+    // Drawn over its own overlap without getting darker
+    CHECK(overlay.at(25, 10)[3] == 0x80);
+
+    // Nothing new, nothing drawn
+    dirty = stroke.addPoints(next + 2, 1, overlay.target);
+    CHECK(dirty.left >= dirty.right);
+}
+
+TEST(ProvisionalSegmentLeavesNoTrace) {
+    // A sharp turn: the guessed end of each segment differs from its final shape
+    const float points[] = {8, 32, 30, 32, 30, 8, 52, 8, 52, 56, 12, 56};
+    Overlay oneByOne;
+    InkStroke live(0xFF00FF00, 3);
+    for (int i = 0; i < 6; i++) {
+        live.addPoints(points + i * 2, 1, oneByOne.target);
+    }
+    live.finish(oneByOne.target);
+
+    Overlay atOnce;
+    InkStroke whole(0xFF00FF00, 3);
+    whole.addPoints(points, 6, atOnce.target);
+    whole.finish(atOnce.target);
+    CHECK(oneByOne.pixels == atOnce.pixels);
+}
+
+int main() {
+    return runAllTests();
+}
@@ -0,0 +1,136 @@
+#include "raster_pdf_writer.h"
+#include "test_main.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include <zlib.h>
+
+static int openTemp() {
+    char path[] = "/tmp/pdfsdk_raster_XXXXXX";
+    int fd = mkstemp(path);
+    unlink(path);
+    return fd;
+}
+
+static std::string readAll(int fd) {
+    std::string contents;
+    char chunk[65536];
+    ssize_t n;
+    off_t offset = 0;
+    while ((n = pread(fd, chunk, sizeof(chunk), offset)) > 0) {
+        contents.append(chunk, n);
+        offset += n;
+    }
+    return contents;
+}
+
+// BGRx rows where pixel (x, y) is (x, y, x + y) in RGB
+static std::vector<uint8_t> gradient(int width, int top, int rows, int stride) {
+    std::vector<uint8_t> pixels((size_t) stride * rows, 0xEE);
+    for (int y = 0; y < rows; y++) {
+        for (int x = 0; x < width; x++) {
+            uint8_t *p = &pixels[(size_t) y * stride + x * 4];
+            p[0] = (uint8_t) (x + top + y);
+            p[1] = (uint8_t) (top + y);
+            p[2] = (uint8_t) x;
+        }
+    }
+    return pixels;
+}
+
+// Inflates the stream of object number, up to the end of its Flate data
+static std::string inflateObject(const std::string &pdf, int number) {
+    size_t object = pdf.find("\n" + std::to_string(number) + " 0 obj\n");
+    if (object == std::string::npos) return "";
+    size_t data = pdf.find("stream\n", object) + 7;
+
+    std::string out(1 << 20, '\0');
+    z_stream zip;
+    memset(&zip, 0, sizeof(zip));
+    inflateInit(&zip);
+    zip.next_in = (Bytef *) pdf.data() + data;
+    zip.avail_in = (uInt) (pdf.size() - data);
+    zip.next_out = (Bytef *) &out[0];
+    zip.avail_out = (uInt) out.size();
+    int result = inflate(&zip, Z_FINISH);
+    out.resize(zip.total_out);
+    inflateEnd(&zip);
+    return result == Z_STREAM_END ? out : "";
+}
+
+TEST(BandsBecomeStackedImages) {
+    int fd = openTemp();
+    CHECK(fd >= 0);
+    RasterPdfWriter writer(fd);
+
+    // Two pages, the first in bands of 3 + 3 + 1 rows
+    const int width = 5;
+    const int stride = width * 4 + 8;
+    CHECK(writer.beginPage(72, 50.4f, width, 7));
+    for (int top = 0; top < 7; top += 3) {
+        int rows = top + 3 <= 7 ? 3 : 7 - top;
+        std::vector<uint8_t> band = gradient(width, top, rows, stride);
+        CHECK(writer.addBand(band.data(), stride, rows));
+    }
+    CHECK(writer.endPage());
+    CHECK(writer.beginPage(100, 100, 2, 2));
+    std::vector<uint8_t> band = gradient(2, 0, 2, 8);
+    CHECK(writer.addBand(band.data(), 8, 2));
+    CHECK(writer.endPage());
+    CHECK(writer.finish(kSyncNone));
+
+    std::string pdf = readAll(fd);
+    CHECK(pdf.size() == writer.bytesWritten());
+    CHECK(pdf.compare(0, 9, "%PDF-1.4\n") == 0);
+    CHECK(pdf.find("/Count 2") != std::string::npos);
+    CHECK(pdf.find("/Width 5 /Height 3") != std::string::npos);
+    CHECK(pdf.find("/Width 5 /Height 1") != std::string::npos);
+    // The bottom band sits at y 0, the top one 3 rows (3 * 7.2pt) lower
+    CHECK(pdf.find("q 72.0000 0 0 7.2000 0 0.0000 cm /B2 Do Q") != std::string::npos);
+    CHECK(pdf.find("q 72.0000 0 0 21.6000 0 28.8000 cm /B0 Do Q") != std::string::npos);
+
+    // Objects 3 and 5 are the first two bands, as RGB rows
+    std::string first = inflateObject(pdf, 3);
+    CHECK(first.size() == (size_t) width * 3 * 3);
+    CHECK((uint8_t) first[3 * 4 + 0] == 4 && (uint8_t) first[3 * 4 + 1] == 0 &&
+          (uint8_t) first[3 * 4 + 2] == 4);
+    std::string second = inflateObject(pdf, 5);
+    CHECK(second.size() == (size_t) width * 3 * 3);
+    CHECK((uint8_t) second[0] == 0 && (uint8_t) second[1] == 3 && (uint8_t) second[2] == 3);
+
+    // Every cross-reference entry points at its object
+    size_t xref = pdf.find("xref\n0 ");
+    CHECK(xref != std::string::npos);
+    int count = atoi(pdf.c_str() + xref + 7);
+    CHECK(count > 2);
+    size_t entry = pdf.find('\n', pdf.find('\n', xref + 5) + 1) + 1;
+    for (int number = 1; number < count; number++, entry += 20) {
+        long offset = strtol(pdf.c_str() + entry, NULL, 10);
+        std::string expected = std::to_string(number) + " 0 obj\n";
+        CHECK(pdf.compare(offset, expected.size(), expected) == 0);
+    }
+    CHECK(pdf.find("startxref\n" + std::to_string(xref) + "\n%%EOF\n") != std::string::npos);
+    close(fd);
+}
+
+TEST(IncompletePagesAreRejected) {
+    int fd = openTemp();
+    CHECK(fd >= 0);
+    RasterPdfWriter writer(fd);
+    CHECK(writer.beginPage(72, 72, 4, 4));
+    std::vector<uint8_t> band = gradient(4, 0, 2, 16);
+    CHECK(writer.addBand(band.data(), 16, 2));
+    CHECK(!writer.endPage());
+    CHECK(writer.failed());
+    CHECK(!writer.finish(kSyncNone));
+    close(fd);
+}
+
+int main() {
+    return runAllTests();
+}
@@ -0,0 +1,166 @@
+#include "image_writer.h"
+#include "page_ranges.h"
+#include "work_stealing_pool.h"
+#include "test_main.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <zlib.h>
+
+TEST(PageRangesSelectExistingPages) {
+    std::vector<PageRange> ranges;
+    CHECK(parsePageRanges("2-3,7,9-", &ranges));
+    CHECK(ranges.size() == 3);
+
+    std::vector<int> pages;
+    expandPageRanges(ranges, 10, &pages);
+    int expected[] = {1, 2, 6, 8, 9};
+    CHECK(pages == std::vector<int>(expected, expected + 5));
+
+    // Ranges past the end are clipped
+    pages.clear();
+    expandPageRanges(ranges, 2, &pages);
+    CHECK(pages == std::vector<int>(1, 1));
+
+    CHECK(parsePageRanges("", &ranges));
+    pages.clear();
+    expandPageRanges(ranges, 3, &pages);
+    CHECK(pages.size() == 3);
+}
+
+TEST(PageRangesRejectMalformedSpecs) {
+    std::vector<PageRange> ranges;
+    CHECK(!parsePageRanges("0", &ranges));
+    CHECK(!parsePageRanges("3-1", &ranges));
+    CHECK(!parsePageRanges("1,", &ranges));
+    CHECK(!parsePageRanges("a-b", &ranges));
+    CHECK(!parsePageRanges("-4", &ranges));
+}
+
+TEST(PoolRunsNestedTasksOnEveryWorker) {
+    std::atomic<int> ran(0);
+    std::mutex lock;
+    std::set<int> workers;
+    {
+        WorkStealingPool pool(4);
+        for (int i = 0; i < 64; i++) {
+            pool.submit([&](int) {
+                // Each task splits off more work onto its own deque
+                for (int j = 0; j < 16; j++) {
+                    pool.submit([&](int worker) {
+                        volatile int spin = 0;
+                        for (int k = 0; k < 20000; k++) spin = spin + k;
+                        std::lock_guard<std::mutex> guard(lock);
+                        workers.insert(worker);
+                        ran++;
+                    });
+                }
+            });
+        }
+        pool.wait();
+        CHECK(ran.load() == 64 * 16);
+    }
+    CHECK(!workers.empty());
+    for (std::set<int>::iterator it = workers.begin(); it != workers.end(); ++it) {
+        CHECK(*it >= 0 && *it < 4);
+    }
+}
+
+static std::vector<unsigned char> readFile(const std::string &path) {
+    std::vector<unsigned char> bytes;
+    FILE *file = fopen(path.c_str(), "rb");
+    if (file == nullptr) return bytes;
+    unsigned char buffer[4096];
+    size_t read;
+    while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        bytes.insert(bytes.end(), buffer, buffer + read);
+    }
+    fclose(file);
+    return bytes;
+}
+
+static uint32_t getU32(const unsigned char *p) {
+    return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) | ((uint32_t) p[2] << 8) | p[3];
+}
+
+TEST(PngWriterStreamsBandsIntoOneImage) {
+    const int width = 300;
+    const int height = 200;
+    std::vector<uint8_t> pixels((size_t) width * height * 4);
+    for (size_t i = 0; i < pixels.size(); i++) {
+        pixels[i] = (uint8_t) (i * 7 + i / 1200);
+    }
+
+    std::string path = "/tmp/pdfsdk_png_test.png";
+    std::unique_ptr<ImageWriter> writer = newImageWriter(kImagePng);
+    CHECK(writer->begin(path, width, height));
+    // Uneven bands, as the rasterizer writes them
+    for (int top = 0; top < height; top += 70) {
+        int rows = height - top < 70 ? height - top : 70;
+        CHECK(writer->writeRows(&pixels[(size_t) top * width * 4], width * 4, rows));
+    }
+    CHECK(writer->finish());
+
+    std::vector<unsigned char> png = readFile(path);
+    CHECK(png.size() > 8 && memcmp(&png[1], "PNG", 3) == 0);
+
+    // Walk the chunks, checking CRCs and gathering IDAT
+    std::vector<unsigned char> idat;
+    size_t at = 8;
+    bool ended = false;
+    while (at + 12 <= png.size()) {
+        uint32_t length = getU32(&png[at]);
+        CHECK(at + 12 + length <= png.size());
+        uLong crc = crc32(0, &png[at + 4], 4 + length);
+        CHECK(crc == getU32(&png[at + 8 + length]));
+        std::string type((const char *) &png[at + 4], 4);
+        if (type == "IHDR") {
+            CHECK(getU32(&png[at + 8]) == (uint32_t) width);
+            CHECK(getU32(&png[at + 12]) == (uint32_t) height);
+        } else if (type == "IDAT") {
+            idat.insert(idat.end(), &png[at + 8], &png[at + 8] + length);
+        } else if (type == "IEND") {
+            ended = true;
+        }
+        at += 12 + length;
+    }
+    CHECK(ended);
+
+    std::vector<unsigned char> raw((size_t) (1 + width * 3) * height);
+    uLongf rawLength = raw.size();
+    CHECK(uncompress(raw.data(), &rawLength, idat.data(), idat.size()) == Z_OK);
+    CHECK(rawLength == raw.size());
+    for (int y = 0; y < height; y++) {
+        const unsigned char *row = &raw[(size_t) y * (1 + width * 3)];
+        CHECK(row[0] == 0);
+        for (int x = 0; x < width; x++) {
+            const uint8_t *src = &pixels[((size_t) y * width + x) * 4];
+            CHECK(memcmp(row + 1 + x * 3, src, 3) == 0);
+        }
+    }
+    unlink(path.c_str());
+}
+
+TEST(FailedImagesLeaveNoFile) {
+    std::string path = "/tmp/pdfsdk_partial_test.rgba";
+    {
+        std::unique_ptr<ImageWriter> writer = newImageWriter(kImageRaw);
+        CHECK(writer->begin(path, 4, 4));
+        uint8_t row[16] = {0};
+        CHECK(writer->writeRows(row, 16, 1));
+    }
+    CHECK(access(path.c_str(), F_OK) != 0);
+}
+
+int main() {
+    return runAllTests();
+}
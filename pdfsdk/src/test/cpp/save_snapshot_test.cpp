@@ -0,0 +1,180 @@
+#include "save_snapshot.h"
+#include "test_main.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <string>
+
+static std::string sourceContents() {
+    std::string contents = "%PDF-1.7\n";
+    for (int i = 0; contents.size() < 3 * 1024 * 1024; i++) {
+        contents += std::to_string(i) + " 0 obj\n<< /Length " + std::to_string(i * 7) + " >>\n";
+    }
+    return contents + "%%EOF\n";
+}
+
+static int openTemp(const std::string &contents) {
+    char path[] = "/tmp/pdfsdk_snapshot_XXXXXX";
+    int fd = mkstemp(path);
+    unlink(path);
+    if (fd >= 0 && write(fd, contents.data(), contents.size()) != (ssize_t) contents.size()) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static std::string readFile(const std::string &path) {
+    std::string contents;
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return contents;
+    char chunk[65536];
+    ssize_t n;
+    while ((n = read(fd, chunk, sizeof(chunk))) > 0) contents.append(chunk, n);
+    close(fd);
+    return contents;
+}
+
+static bool writeFile(const std::string &path, const std::string &contents) {
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+    bool written = write(fd, contents.data(), contents.size()) == (ssize_t) contents.size();
+    close(fd);
+    return written;
+}
+
+static std::string tempDir() {
+    char dir[] = "/tmp/pdfsdk_save_XXXXXX";
+    return mkdtemp(dir) != NULL ? dir : "";
+}
+
+// Hands the output to the writer like PDFium does, block by block
+static bool produce(SnapshotWriter *writer, const std::string &output, size_t blockSize) {
+    for (size_t i = 0; i < output.size(); i += blockSize) {
+        std::string block = output.substr(i, blockSize);
+        if (!writer->WriteBlock(writer, block.data(), block.size())) return false;
+    }
+    return true;
+}
+
+class CountingProgress : public SaveProgress {
+public:
+    explicit CountingProgress(int cancelAt) : calls(0), last(0), cancelAt(cancelAt) {}
+
+    bool onSaveProgress(uint64_t written, uint64_t total) override {
+        calls++;
+        last = written;
+        this->total = total;
+        return calls != cancelAt;
+    }
+
+    int calls;
+    uint64_t last;
+    uint64_t total = 0;
+    int cancelAt;
+};
+
+TEST(SnapshotHoldsOnlyWhatFollowsTheSource) {
+    const std::string source = sourceContents();
+    int fd = openTemp(source);
+    CHECK(fd >= 0);
+
+    SaveSnapshot snapshot;
+    snapshot.sourceFd = fd;
+    snapshot.sourceLength = source.size();
+    SnapshotWriter writer(&snapshot);
+    CHECK(produce(&writer, source + "9 0 obj\nnew\nendobj\n", 4096));
+    CHECK(!writer.failed());
+    CHECK(std::string(snapshot.tail.begin(), snapshot.tail.end()) == "9 0 obj\nnew\nendobj\n");
+    CHECK(snapshot.size() == source.size() + snapshot.tail.size());
+    close(fd);
+}
+
+TEST(SnapshotRejectsOutputNotStartingWithTheSource) {
+    const std::string source = sourceContents();
+    int fd = openTemp(source);
+    CHECK(fd >= 0);
+
+    // A rewritten header or trailer gives it away
+    std::string output = source;
+    output[5] = '2';
+    SaveSnapshot snapshot;
+    snapshot.sourceFd = fd;
+    snapshot.sourceLength = source.size();
+    SnapshotWriter writer(&snapshot);
+    CHECK(!produce(&writer, output, 4096));
+    CHECK(writer.failed());
+
+    output = source;
+    output[source.size() - 2] = 'x';
+    SaveSnapshot changedEnd;
+    changedEnd.sourceFd = fd;
+    changedEnd.sourceLength = source.size();
+    SnapshotWriter endWriter(&changedEnd);
+    CHECK(!produce(&endWriter, output + "tail", 1 << 20));
+    close(fd);
+}
+
+TEST(WrittenSnapshotReplacesTheTarget) {
+    const std::string source = sourceContents();
+    int fd = openTemp(source);
+    CHECK(fd >= 0);
+    const std::string dir = tempDir();
+    CHECK(!dir.empty());
+    const std::string path = dir + "/doc.pdf";
+    CHECK(writeFile(path, "old"));
+
+    SaveSnapshot snapshot;
+    snapshot.sourceFd = fd;
+    snapshot.sourceLength = source.size();
+    const std::string tail = "9 0 obj\nnew\nendobj\n";
+    snapshot.tail.assign(tail.begin(), tail.end());
+    CountingProgress progress(-1);
+    CHECK(writeSnapshot(snapshot, path.c_str(), kSyncData, &progress));
+
+    CHECK(readFile(path) == source + tail);
+    CHECK(access((path + ".saving").c_str(), F_OK) != 0);
+    // One call per MiB of the source, one for the tail
+    CHECK(progress.calls == 5);
+    CHECK(progress.last == progress.total);
+    CHECK(progress.total == source.size() + tail.size());
+
+    // Without a source the tail is the whole document
+    SaveSnapshot full;
+    full.tail.assign(source.begin(), source.end());
+    CHECK(writeSnapshot(full, path.c_str(), kSyncNone, NULL));
+    CHECK(readFile(path) == source);
+
+    unlink(path.c_str());
+    rmdir(dir.c_str());
+    close(fd);
+}
+
+TEST(CancelledSaveKeepsTheTarget) {
+    const std::string source = sourceContents();
+    int fd = openTemp(source);
+    CHECK(fd >= 0);
+    const std::string dir = tempDir();
+    CHECK(!dir.empty());
+    const std::string path = dir + "/doc.pdf";
+    CHECK(writeFile(path, "old"));
+
+    SaveSnapshot snapshot;
+    snapshot.sourceFd = fd;
+    snapshot.sourceLength = source.size();
+    CountingProgress progress(2);
+    CHECK(!writeSnapshot(snapshot, path.c_str(), kSyncData, &progress));
+    CHECK(progress.calls == 2);
+    CHECK(readFile(path) == "old");
+    CHECK(access((path + ".saving").c_str(), F_OK) != 0);
+
+    unlink(path.c_str());
+    rmdir(dir.c_str());
+    close(fd);
+}
+
+int main() {
+    return runAllTests();
+}
@@ -0,0 +1,56 @@
+#ifndef PDFVIEW_TEST_MAIN_H
+#define PDFVIEW_TEST_MAIN_H
+
+#include <stdio.h>
+#include <vector>
+
+// Minimal test harness: TEST registers a function, CHECK records a failure
+// and returns from it, RUN_ALL_TESTS runs everything and reports.
+typedef void (*TestFunction)();
+
+struct TestCase {
+    const char *name;
+    TestFunction function;
+};
+
+inline std::vector<TestCase> &testCases() {
+    static std::vector<TestCase> cases;
+    return cases;
+}
+
+inline int &testFailures() {
+    static int failures = 0;
+    return failures;
+}
+
+struct TestRegistrar {
+    TestRegistrar(const char *name, TestFunction function) {
+        TestCase test = {name, function};
+        testCases().push_back(test);
+    }
+};
+
+#define TEST(name) \
+    static void name(); \
+    static TestRegistrar name##Registrar(#name, name); \
+    static void name()
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            testFailures()++; \
+            return; \
+        } \
+    } while (0)
+
+inline int runAllTests() {
+    for (size_t i = 0; i < testCases().size(); i++) {
+        int before = testFailures();
+        testCases()[i].function();
+        printf("[%s] %s\n", testFailures() == before ? "  OK  " : "FAILED", testCases()[i].name);
+    }
+    return testFailures() == 0 ? 0 : 1;
+}
+
+#endif //PDFVIEW_TEST_MAIN_H
@@ -0,0 +1,242 @@
+#include "image_writer.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <vector>
+
+#include <zlib.h>
+
+#ifdef PDFSDK_HAVE_WEBP
+#include <webp/encode.h>
+#endif
+
+bool parseImageFormat(const std::string &name, ImageFormat *format) {
+    if (name == "png") {
+        *format = kImagePng;
+    } else if (name == "raw") {
+        *format = kImageRaw;
+#ifdef PDFSDK_HAVE_WEBP
+    } else if (name == "webp") {
+        *format = kImageWebpLossless;
+#endif
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char *imageExtension(ImageFormat format) {
+    switch (format) {
+        case kImagePng:
+            return "png";
+        case kImageWebpLossless:
+            return "webp";
+        default:
+            return "rgba";
+    }
+}
+
+// Owns the output file and removes it unless the image completed
+class FileImageWriter : public ImageWriter {
+public:
+    ~FileImageWriter() override {
+        abort();
+    }
+
+    bool begin(const std::string &path, int width, int height) override {
+        abort();
+        file = fopen(path.c_str(), "wb");
+        if (file == nullptr) return false;
+        filePath = path;
+        this->width = width;
+        this->height = height;
+        return true;
+    }
+
+protected:
+    bool write(const void *data, size_t size) {
+        return fwrite(data, 1, size, file) == size;
+    }
+
+    bool close() {
+        bool ok = fclose(file) == 0;
+        file = nullptr;
+        if (!ok) unlink(filePath.c_str());
+        return ok;
+    }
+
+    void abort() {
+        if (file == nullptr) return;
+        fclose(file);
+        file = nullptr;
+        unlink(filePath.c_str());
+    }
+
+    FILE *file = nullptr;
+    std::string filePath;
+    int width = 0;
+    int height = 0;
+};
+
+class RawWriter : public FileImageWriter {
+public:
+    bool writeRows(const uint8_t *pixels, int stride, int rows) override {
+        for (int y = 0; y < rows; y++) {
+            if (!write(pixels + (size_t) y * stride, (size_t) width * 4)) return false;
+        }
+        return true;
+    }
+
+    bool finish() override {
+        return close();
+    }
+};
+
+/**
+ * 8-bit RGB PNG. Rows are deflated as they come and written out as IDAT
+ * chunks whenever the output buffer fills, so memory stays at one row plus
+ * the zlib window.
+ */
+class PngWriter : public FileImageWriter {
+public:
+    ~PngWriter() override {
+        if (deflating) deflateEnd(&stream);
+    }
+
+    bool begin(const std::string &path, int width, int height) override {
+        if (!FileImageWriter::begin(path, width, height)) return false;
+
+        static const uint8_t kSignature[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+        uint8_t header[13];
+        putU32(header, (uint32_t) width);
+        putU32(header + 4, (uint32_t) height);
+        header[8] = 8; // bit depth
+        header[9] = 2; // RGB
+        header[10] = 0;
+        header[11] = 0;
+        header[12] = 0;
+        if (!write(kSignature, sizeof(kSignature)) || !writeChunk("IHDR", header, 13)) {
+            return false;
+        }
+
+        if (deflating) deflateEnd(&stream);
+        memset(&stream, 0, sizeof(stream));
+        deflating = deflateInit(&stream, 6) == Z_OK;
+        row.resize(1 + (size_t) width * 3);
+        out.resize(64 * 1024);
+        stream.next_out = out.data();
+        stream.avail_out = (uInt) out.size();
+        return deflating;
+    }
+
+    bool writeRows(const uint8_t *pixels, int stride, int rows) override {
+        for (int y = 0; y < rows; y++) {
+            const uint8_t *src = pixels + (size_t) y * stride;
+            row[0] = 0; // no filter
+            uint8_t *dest = &row[1];
+            for (int x = 0; x < width; x++) {
+                dest[0] = src[0];
+                dest[1] = src[1];
+                dest[2] = src[2];
+                dest += 3;
+                src += 4;
+            }
+            stream.next_in = row.data();
+            stream.avail_in = (uInt) row.size();
+            if (!deflateInput(Z_NO_FLUSH)) return false;
+        }
+        return true;
+    }
+
+    bool finish() override {
+        stream.next_in = nullptr;
+        stream.avail_in = 0;
+        if (!deflateInput(Z_FINISH) || !flushIdat() || !writeChunk("IEND", nullptr, 0)) {
+            return false;
+        }
+        deflateEnd(&stream);
+        deflating = false;
+        return close();
+    }
+
+private:
+    static void putU32(uint8_t *out, uint32_t value) {
+        out[0] = (uint8_t) (value >> 24);
+        out[1] = (uint8_t) (value >> 16);
+        out[2] = (uint8_t) (value >> 8);
+        out[3] = (uint8_t) value;
+    }
+
+    bool writeChunk(const char *type, const uint8_t *data, uint32_t length) {
+        uint8_t prefix[8];
+        putU32(prefix, length);
+        memcpy(prefix + 4, type, 4);
+        uLong crc = crc32(0, prefix + 4, 4);
+        if (length > 0) crc = crc32(crc, data, length);
+        uint8_t suffix[4];
+        putU32(suffix, (uint32_t) crc);
+        return write(prefix, 8) && (length == 0 || write(data, length)) && write(suffix, 4);
+    }
+
+    bool flushIdat() {
+        size_t used = out.size() - stream.avail_out;
+        if (used > 0 && !writeChunk("IDAT", out.data(), (uint32_t) used)) return false;
+        stream.next_out = out.data();
+        stream.avail_out = (uInt) out.size();
+        return true;
+    }
+
+    bool deflateInput(int flush) {
+        while (true) {
+            int result = deflate(&stream, flush);
+            if (result == Z_STREAM_ERROR) return false;
+            if (stream.avail_out == 0) {
+                if (!flushIdat()) return false;
+                continue;
+            }
+            if (flush == Z_FINISH ? result == Z_STREAM_END : stream.avail_in == 0) return true;
+        }
+    }
+
+    z_stream stream;
+    bool deflating = false;
+    std::vector<uint8_t> row;
+    std::vector<uint8_t> out;
+};
+
+#ifdef PDFSDK_HAVE_WEBP
+class WebpWriter : public FileImageWriter {
+public:
+    bool needsWholeImage() const override { return true; }
+
+    bool writeRows(const uint8_t *pixels, int stride, int rows) override {
+        if (rows != height) return false;
+        uint8_t *encoded = nullptr;
+        size_t size = WebPEncodeLosslessRGBA(pixels, width, height, stride, &encoded);
+        bool ok = size > 0 && write(encoded, size);
+        WebPFree(encoded);
+        return ok;
+    }
+
+    bool finish() override {
+        return close();
+    }
+};
+#endif
+
+std::unique_ptr<ImageWriter> newImageWriter(ImageFormat format) {
+    switch (format) {
+        case kImagePng:
+            return std::unique_ptr<ImageWriter>(new PngWriter());
+#ifdef PDFSDK_HAVE_WEBP
+        case kImageWebpLossless:
+            return std::unique_ptr<ImageWriter>(new WebpWriter());
+#endif
+        case kImageRaw:
+            return std::unique_ptr<ImageWriter>(new RawWriter());
+        default:
+            return std::unique_ptr<ImageWriter>();
+    }
+}
@@ -0,0 +1,42 @@
+#ifndef PDFVIEW_IMAGE_WRITER_H
+#define PDFVIEW_IMAGE_WRITER_H
+
+#include <stdint.h>
+#include <memory>
+#include <string>
+
+enum ImageFormat {
+    kImagePng,
+    // Headerless RGBA_8888 rows
+    kImageRaw,
+    kImageWebpLossless,
+};
+
+// Parses "png", "raw" or "webp", false for an unknown or unsupported format
+bool parseImageFormat(const std::string &name, ImageFormat *format);
+
+const char *imageExtension(ImageFormat format);
+
+/**
+ * Writes an image a band of rows at a time, so a page never has to be in
+ * memory at once. Formats that can't be streamed (WebP) report it through
+ * needsWholeImage() and get all rows in one writeRows call.
+ */
+class ImageWriter {
+public:
+    virtual ~ImageWriter() {}
+
+    virtual bool needsWholeImage() const { return false; }
+
+    virtual bool begin(const std::string &path, int width, int height) = 0;
+
+    // rows of RGBA_8888 pixels, stride bytes apart
+    virtual bool writeRows(const uint8_t *pixels, int stride, int rows) = 0;
+
+    // Completes the file; on failure the partial file is removed
+    virtual bool finish() = 0;
+};
+
+std::unique_ptr<ImageWriter> newImageWriter(ImageFormat format);
+
+#endif //PDFVIEW_IMAGE_WRITER_H
@@ -0,0 +1,55 @@
+#include "page_ranges.h"
+
+#include <stdlib.h>
+
+static bool parseNumber(const std::string &text, int *value) {
+    if (text.empty() || text.find_first_not_of("0123456789") != std::string::npos) {
+        return false;
+    }
+    *value = atoi(text.c_str());
+    return *value > 0;
+}
+
+bool parsePageRanges(const std::string &spec, std::vector<PageRange> *ranges) {
+    ranges->clear();
+    if (spec.empty()) {
+        PageRange all = {1, 0};
+        ranges->push_back(all);
+        return true;
+    }
+
+    size_t start = 0;
+    while (start <= spec.size()) {
+        size_t end = spec.find(',', start);
+        if (end == std::string::npos) end = spec.size();
+        std::string item = spec.substr(start, end - start);
+        start = end + 1;
+
+        PageRange range;
+        size_t dash = item.find('-');
+        if (dash == std::string::npos) {
+            if (!parseNumber(item, &range.first)) return false;
+            range.last = range.first;
+        } else {
+            if (!parseNumber(item.substr(0, dash), &range.first)) return false;
+            std::string last = item.substr(dash + 1);
+            if (last.empty()) {
+                range.last = 0;
+            } else if (!parseNumber(last, &range.last) || range.last < range.first) {
+                return false;
+            }
+        }
+        ranges->push_back(range);
+    }
+    return true;
+}
+
+void expandPageRanges(const std::vector<PageRange> &ranges, int pageCount,
+                      std::vector<int> *pages) {
+    for (size_t i = 0; i < ranges.size(); i++) {
+        int last = ranges[i].last == 0 || ranges[i].last > pageCount ? pageCount : ranges[i].last;
+        for (int page = ranges[i].first; page <= last; page++) {
+            pages->push_back(page - 1);
+        }
+    }
+}
@@ -0,0 +1,20 @@
+#ifndef PDFVIEW_PAGE_RANGES_H
+#define PDFVIEW_PAGE_RANGES_H
+
+#include <string>
+#include <vector>
+
+// Inclusive range of 1-based page numbers, last 0 meaning the last page
+struct PageRange {
+    int first;
+    int last;
+};
+
+// Parses "1-3,7,10-" style lists. An empty spec selects every page.
+bool parsePageRanges(const std::string &spec, std::vector<PageRange> *ranges);
+
+// 0-based indices of the selected pages that exist, in the given order
+void expandPageRanges(const std::vector<PageRange> &ranges, int pageCount,
+                      std::vector<int> *pages);
+
+#endif //PDFVIEW_PAGE_RANGES_H
@@ -0,0 +1,346 @@
+/**
+ * pdfsdk_rasterize: renders PDF pages to images with the same core as the
+ * app's nativeRenderPageBitmap, for server side previews.
+ *
+ *   pdfsdk_rasterize [options] file.pdf...
+ *     -o DIR             output directory (default .)
+ *     --files-from FILE  reads more input paths, one per line
+ *     --pages RANGES     1-based pages, e.g. 1-3,7,10- (default all)
+ *     --dpi N            resolution (default 96)
+ *     --format F         png, raw (RGBA_8888 rows) or webp (lossless, if built
+ *                        with libwebp); default png
+ *     --jobs N           worker threads (default one per core)
+ *     --max-memory MB    pixel buffer budget of a worker (default 64); pages
+ *                        over it are rendered and written in bands
+ *     --json             prints the throughput report as JSON on stdout
+ *
+ * Images are written as DIR/<file name>-<page>.<ext>. The exit code is 1
+ * if any page failed.
+ *
+ * PDFium is not thread-safe, so opening, loading and rasterizing hold one
+ * process wide lock; workers overlap file reads and image encoding, which
+ * is most of the time for PNG output. Run one process per core group for
+ * rasterization bound loads.
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "document.h"
+#include "image_writer.h"
+#include "page_ranges.h"
+#include "pdfium_library.h"
+#include "render_core.h"
+#include "work_stealing_pool.h"
+
+// Pages a task renders before the rest of its document can be stolen
+static const int kPagesPerTask = 4;
+
+struct Options {
+    std::string outputDir = ".";
+    std::vector<std::string> files;
+    std::vector<PageRange> pages;
+    int dpi = 96;
+    ImageFormat format = kImagePng;
+    int jobs = 0;
+    size_t maxMemory = 64 << 20;
+    bool json = false;
+};
+
+// Everything a worker keeps between tasks, only touched by its own thread
+struct Worker {
+    std::string openPath;
+    int fd = -1;
+    std::unique_ptr<Document> document;
+    TileRenderer renderer;
+    std::vector<uint8_t> pixels;
+    std::vector<double> latencies;
+    int64_t pagesRendered = 0;
+};
+
+static std::mutex sPdfiumLock;
+static std::atomic<int> sFailures(0);
+
+static double nowSeconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static std::string baseName(const std::string &path) {
+    size_t slash = path.rfind('/');
+    std::string name = slash == std::string::npos ? path : path.substr(slash + 1);
+    size_t dot = name.rfind('.');
+    return dot == std::string::npos || dot == 0 ? name : name.substr(0, dot);
+}
+
+static void closeDocument(Worker *worker) {
+    {
+        std::lock_guard<std::mutex> guard(sPdfiumLock);
+        worker->document.reset();
+    }
+    if (worker->fd >= 0) close(worker->fd);
+    worker->fd = -1;
+    worker->openPath.clear();
+}
+
+// Keeps the last document open, consecutive tasks mostly share it
+static Document *openDocument(Worker *worker, const std::string &path) {
+    if (worker->document && worker->openPath == path) return worker->document.get();
+    closeDocument(worker);
+
+    worker->fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (worker->fd < 0) {
+        fprintf(stderr, "%s: %s\n", path.c_str(), strerror(errno));
+        return nullptr;
+    }
+    unsigned long error;
+    {
+        std::lock_guard<std::mutex> guard(sPdfiumLock);
+        worker->document = Document::openFd(worker->fd, nullptr, &error);
+    }
+    if (!worker->document) {
+        fprintf(stderr, "%s: %s\n", path.c_str(), describePdfError(error));
+        closeDocument(worker);
+        return nullptr;
+    }
+    worker->openPath = path;
+    return worker->document.get();
+}
+
+static bool renderPage(Worker *worker, Document *document, int pageIndex,
+                       const std::string &path, const Options &options) {
+    double start = nowSeconds();
+    std::unique_ptr<Page> page;
+    int width, height;
+    {
+        std::lock_guard<std::mutex> guard(sPdfiumLock);
+        page = document->loadPage(pageIndex);
+        if (page) {
+            width = (int) (page->width() * options.dpi / 72 + 0.5f);
+            height = (int) (page->height() * options.dpi / 72 + 0.5f);
+        }
+    }
+    if (!page || width <= 0 || height <= 0) {
+        fprintf(stderr, "%s: cannot load page %d\n", path.c_str(), pageIndex + 1);
+        return false;
+    }
+
+    std::unique_ptr<ImageWriter> writer = newImageWriter(options.format);
+    size_t rowBytes = (size_t) width * 4;
+    int bandRows = (int) std::max<size_t>(1, options.maxMemory / rowBytes);
+    if (bandRows > height) bandRows = height;
+    if (writer->needsWholeImage() && bandRows < height) {
+        fprintf(stderr, "%s: page %d needs %zu MB, over --max-memory\n", path.c_str(),
+                pageIndex + 1, (rowBytes * height) >> 20);
+        std::lock_guard<std::mutex> guard(sPdfiumLock);
+        page.reset();
+        return false;
+    }
+    worker->pixels.resize(rowBytes * bandRows);
+
+    char name[32];
+    snprintf(name, sizeof(name), "-%d.", pageIndex + 1);
+    std::string output = options.outputDir + "/" + baseName(path) + name +
+                         imageExtension(options.format);
+    bool ok = writer->begin(output, width, height);
+
+    RenderTarget target;
+    target.pixels = worker->pixels.data();
+    target.width = width;
+    target.stride = (int) rowBytes;
+    target.format = kTileRgba8888;
+    for (int top = 0; ok && top < height; top += bandRows) {
+        target.height = std::min(bandRows, height - top);
+        // Pages may be transparent, previews are on white
+        memset(worker->pixels.data(), 0xFF, rowBytes * target.height);
+        {
+            std::lock_guard<std::mutex> guard(sPdfiumLock);
+            ok = worker->renderer.render(page->get(), target, 0, -top, width, height, true);
+        }
+        ok = ok && writer->writeRows(worker->pixels.data(), target.stride, target.height);
+    }
+    ok = ok && writer->finish();
+    {
+        std::lock_guard<std::mutex> guard(sPdfiumLock);
+        page.reset();
+    }
+
+    // A page over budget only needs its buffer while it renders
+    if (worker->pixels.capacity() > options.maxMemory) {
+        std::vector<uint8_t>().swap(worker->pixels);
+    }
+
+    if (!ok) {
+        fprintf(stderr, "%s: cannot write %s\n", path.c_str(), output.c_str());
+        return false;
+    }
+    worker->latencies.push_back(nowSeconds() - start);
+    worker->pagesRendered++;
+    return true;
+}
+
+static void renderPages(WorkStealingPool *pool, std::vector<Worker> *workers, int worker,
+                        const std::string &path, std::shared_ptr<const std::vector<int> > pages,
+                        size_t first, const Options &options) {
+    // Leaves the rest of the document to whichever worker gets there first
+    size_t end = std::min(pages->size(), first + kPagesPerTask);
+    if (end < pages->size()) {
+        pool->submit([pool, workers, path, pages, end, &options](int w) {
+            renderPages(pool, workers, w, path, pages, end, options);
+        });
+    }
+
+    Document *document = openDocument(&(*workers)[worker], path);
+    if (document == nullptr) {
+        sFailures += (int) (end - first);
+        return;
+    }
+    for (size_t i = first; i < end; i++) {
+        if (!renderPage(&(*workers)[worker], document, (*pages)[i], path, options)) {
+            sFailures++;
+        }
+    }
+}
+
+static void renderDocument(WorkStealingPool *pool, std::vector<Worker> *workers, int worker,
+                           const std::string &path, const Options &options) {
+    Document *document = openDocument(&(*workers)[worker], path);
+    if (document == nullptr) {
+        sFailures++;
+        return;
+    }
+    std::shared_ptr<std::vector<int> > pages(new std::vector<int>());
+    {
+        std::lock_guard<std::mutex> guard(sPdfiumLock);
+        expandPageRanges(options.pages, document->pageCount(), pages.get());
+    }
+    if (!pages->empty()) {
+        renderPages(pool, workers, worker, path, pages, 0, options);
+    }
+}
+
+static double percentile(const std::vector<double> &sorted, double p) {
+    if (sorted.empty()) return 0;
+    size_t index = (size_t) (p * (sorted.size() - 1) + 0.5);
+    return sorted[index];
+}
+
+static void report(const std::vector<Worker> &workers, size_t documents, double seconds,
+                   const Options &options) {
+    std::vector<double> latencies;
+    int64_t pages = 0;
+    for (size_t i = 0; i < workers.size(); i++) {
+        latencies.insert(latencies.end(), workers[i].latencies.begin(),
+                         workers[i].latencies.end());
+        pages += workers[i].pagesRendered;
+    }
+    std::sort(latencies.begin(), latencies.end());
+    double pagesPerSecond = seconds > 0 ? pages / seconds : 0;
+
+    if (options.json) {
+        printf("{\"documents\": %zu, \"pages\": %lld, \"failures\": %d, \"seconds\": %.3f, "
+               "\"pages_per_second\": %.2f, \"latency_ms\": {\"p50\": %.2f, \"p90\": %.2f, "
+               "\"p99\": %.2f, \"max\": %.2f}, \"jobs\": %zu}\n",
+               documents, (long long) pages, sFailures.load(), seconds, pagesPerSecond,
+               percentile(latencies, 0.5) * 1000, percentile(latencies, 0.9) * 1000,
+               percentile(latencies, 0.99) * 1000, percentile(latencies, 1) * 1000,
+               workers.size());
+        return;
+    }
+    fprintf(stderr, "%zu documents, %lld pages, %d failed in %.2f s with %zu jobs\n",
+            documents, (long long) pages, sFailures.load(), seconds, workers.size());
+    fprintf(stderr, "%.2f pages/s, latency ms p50 %.1f p90 %.1f p99 %.1f max %.1f\n",
+            pagesPerSecond, percentile(latencies, 0.5) * 1000,
+            percentile(latencies, 0.9) * 1000, percentile(latencies, 0.99) * 1000,
+            percentile(latencies, 1) * 1000);
+}
+
+static void usage() {
+    fprintf(stderr, "usage: pdfsdk_rasterize [-o DIR] [--files-from FILE] [--pages RANGES] "
+                    "[--dpi N] [--format png|raw|webp] [--jobs N] [--max-memory MB] "
+                    "[--json] file.pdf...\n");
+}
+
+static bool parseOptions(int argc, char **argv, Options *options) {
+    std::string pages;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--json") {
+            options->json = true;
+        } else if (arg[0] != '-') {
+            options->files.push_back(arg);
+        } else if (!hasValue) {
+            return false;
+        } else if (arg == "-o") {
+            options->outputDir = argv[++i];
+        } else if (arg == "--files-from") {
+            std::ifstream list(argv[++i]);
+            if (!list) return false;
+            std::string line;
+            while (std::getline(list, line)) {
+                if (!line.empty()) options->files.push_back(line);
+            }
+        } else if (arg == "--pages") {
+            pages = argv[++i];
+        } else if (arg == "--dpi") {
+            options->dpi = atoi(argv[++i]);
+        } else if (arg == "--format") {
+            if (!parseImageFormat(argv[++i], &options->format)) return false;
+        } else if (arg == "--jobs") {
+            options->jobs = atoi(argv[++i]);
+        } else if (arg == "--max-memory") {
+            options->maxMemory = (size_t) atoi(argv[++i]) << 20;
+        } else {
+            return false;
+        }
+    }
+    return parsePageRanges(pages, &options->pages) && options->dpi > 0 &&
+           options->maxMemory > 0 && !options->files.empty();
+}
+
+int main(int argc, char **argv) {
+    Options options;
+    if (!parseOptions(argc, argv, &options)) {
+        usage();
+        return 2;
+    }
+    if (options.jobs <= 0) {
+        options.jobs = (int) std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    PdfiumLibrary::pin();
+    double start = nowSeconds();
+    std::vector<Worker> workers(options.jobs);
+    {
+        WorkStealingPool pool(options.jobs);
+        for (size_t i = 0; i < options.files.size(); i++) {
+            std::string path = options.files[i];
+            pool.submit([&pool, &workers, path, &options](int worker) {
+                renderDocument(&pool, &workers, worker, path, options);
+            });
+        }
+        pool.wait();
+    }
+    for (size_t i = 0; i < workers.size(); i++) {
+        closeDocument(&workers[i]);
+    }
+    double seconds = nowSeconds() - start;
+    PdfiumLibrary::unpin();
+
+    report(workers, options.files.size(), seconds, options);
+    return sFailures.load() == 0 ? 0 : 1;
+}